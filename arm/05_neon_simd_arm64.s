@@ -1,13 +1,16 @@
 // ============================================================================
 // File: 05_neon_simd_arm64.s
 // Description: NEON SIMD programming for ARM64
-// Topics: Vector registers, NEON instructions, vectorization
+// Topics: Vector registers, NEON instructions, vectorization,
+//         multiple FMLA accumulators, loop tails
 // Assembler: GNU as (gas)
 // Build: as -o 05_neon_simd_arm64.o 05_neon_simd_arm64.s
 //        ld -o 05_neon_simd_arm64 05_neon_simd_arm64.o
 // ============================================================================
 
 .global _start
+.global vector_add_neon
+.global dot_product_neon
 
 .section .data
     // Aligned data (16-byte alignment for NEON)
@@ -23,10 +26,21 @@
     
     .align 4
     byte_array:     .byte 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+    
+    verify_ok_msg:  .ascii "NEON vector_add/dot_product match the scalar results\n"
+    .equ verify_ok_len, . - verify_ok_msg
+    verify_bad_msg: .ascii "NEON vector_add/dot_product MISMATCH\n"
+    .equ verify_bad_len, . - verify_bad_msg
+    
+    .equ VERIFY_MAX, 80             // Counts 0..VERIFY_MAX are checked
 
 .section .bss
     .align 4
     result_array:   .skip   64
+    .align 4
+    verify_a:       .skip   VERIFY_MAX * 4
+    verify_b:       .skip   VERIFY_MAX * 4
+    verify_out:     .skip   VERIFY_MAX * 4 + 4  // One guard element
 
 .section .text
 
@@ -354,6 +368,21 @@ _start:
     bl      dot_product_neon
     // Result in s0
     
+    // ========================================================================
+    // SELF-CHECK: every count from 0 to VERIFY_MAX (all tail lengths)
+    // ========================================================================
+    
+    bl      verify_neon_kernels
+    ldr     x1, =verify_ok_msg
+    mov     x2, #verify_ok_len
+    cbz     x0, 1f
+    ldr     x1, =verify_bad_msg
+    mov     x2, #verify_bad_len
+1:
+    mov     x0, #1                 // stdout
+    mov     x8, #64                // write
+    svc     #0
+    
     // ========================================================================
     // EXIT
     // ========================================================================
@@ -364,27 +393,49 @@ _start:
 
 // ============================================================================
 // FUNCTION: vector_add_neon
-// Description: Add two float vectors using NEON
+// Description: result[i] = array1[i] + array2[i] for any count
 // Arguments: X0 = array1, X1 = array2, X2 = result, X3 = count
+//
+// 16 floats per iteration: ld1 with four registers moves 64 bytes per
+// instruction, then one 4-float step and a scalar tail for the last 0-3
+// elements. No alignment is required.
 // ============================================================================
 vector_add_neon:
-    // Process 4 floats at a time
+    cmp     x3, #16
+    b.lt    .Lvec_add_by4
 .Lvec_add_loop:
+    ld1     {v0.4s, v1.4s, v2.4s, v3.4s}, [x0], #64
+    ld1     {v4.4s, v5.4s, v6.4s, v7.4s}, [x1], #64
+    fadd    v0.4s, v0.4s, v4.4s
+    fadd    v1.4s, v1.4s, v5.4s
+    fadd    v2.4s, v2.4s, v6.4s
+    fadd    v3.4s, v3.4s, v7.4s
+    st1     {v0.4s, v1.4s, v2.4s, v3.4s}, [x2], #64
+    sub     x3, x3, #16
+    cmp     x3, #16
+    b.ge    .Lvec_add_loop
+    
+.Lvec_add_by4:
     cmp     x3, #4
-    b.lt    .Lvec_add_done
-    
-    ld1     {v0.4s}, [x0], #16     // Load 4 floats, advance pointer
+    b.lt    .Lvec_add_tail
+    ld1     {v0.4s}, [x0], #16
     ld1     {v1.4s}, [x1], #16
-    fadd    v2.4s, v0.4s, v1.4s    // Add vectors
-    st1     {v2.4s}, [x2], #16     // Store result, advance pointer
-    
-    sub     x3, x3, #4             // Decrement count
-    b       .Lvec_add_loop
+    fadd    v0.4s, v0.4s, v1.4s
+    st1     {v0.4s}, [x2], #16
+    sub     x3, x3, #4
+    b       .Lvec_add_by4
+    
+.Lvec_add_tail:
+    cbz     x3, .Lvec_add_done     // 0-3 elements left
+.Lvec_add_scalar:
+    ldr     s0, [x0], #4
+    ldr     s1, [x1], #4
+    fadd    s0, s0, s1
+    str     s0, [x2], #4
+    subs    x3, x3, #1
+    b.ne    .Lvec_add_scalar
     
 .Lvec_add_done:
-    // Handle remaining elements (if count not multiple of 4)
-    // ... scalar code ...
-    
     ret
 
 // ============================================================================
@@ -392,28 +443,151 @@ vector_add_neon:
 // Description: Calculate dot product of two float vectors
 // Arguments: X0 = array1, X1 = array2, X2 = count
 // Returns: S0 = dot product
+//
+// fmla has a latency of about 4 cycles and most cores issue two per cycle,
+// so a single accumulator leaves the pipes idle. Four accumulators
+// (V16-V19) hold four independent chains; they are added together once,
+// after the loop, and reduced across lanes with two faddp. (There is no
+// faddv: the across-lanes float reductions are fmaxv/fminv only.)
+//
+// The summation order differs from a sequential loop, so the result can
+// differ from a scalar sum in the last bits.
 // ============================================================================
 dot_product_neon:
-    fmov    s0, wzr                // Accumulator = 0
+    movi    v16.4s, #0
+    movi    v17.4s, #0
+    movi    v18.4s, #0
+    movi    v19.4s, #0
     
-    // Process 4 floats at a time
+    cmp     x2, #16
+    b.lt    .Ldot_combine
 .Ldot_loop:
+    ld1     {v0.4s, v1.4s, v2.4s, v3.4s}, [x0], #64
+    ld1     {v4.4s, v5.4s, v6.4s, v7.4s}, [x1], #64
+    fmla    v16.4s, v0.4s, v4.4s
+    fmla    v17.4s, v1.4s, v5.4s
+    fmla    v18.4s, v2.4s, v6.4s
+    fmla    v19.4s, v3.4s, v7.4s
+    sub     x2, x2, #16
+    cmp     x2, #16
+    b.ge    .Ldot_loop
+    
+.Ldot_combine:
+    fadd    v16.4s, v16.4s, v17.4s
+    fadd    v18.4s, v18.4s, v19.4s
+    fadd    v16.4s, v16.4s, v18.4s
+    
+.Ldot_by4:
     cmp     x2, #4
-    b.lt    .Ldot_done
+    b.lt    .Ldot_reduce
+    ld1     {v0.4s}, [x0], #16
+    ld1     {v4.4s}, [x1], #16
+    fmla    v16.4s, v0.4s, v4.4s
+    sub     x2, x2, #4
+    b       .Ldot_by4
     
-    ld1     {v1.4s}, [x0], #16     // Load 4 floats from array1
-    ld1     {v2.4s}, [x1], #16     // Load 4 floats from array2
-    fmul    v3.4s, v1.4s, v2.4s    // Multiply
-    faddp   v3.4s, v3.4s, v3.4s    // Pairwise add
-    faddp   v3.4s, v3.4s, v3.4s    // Pairwise add again
-    fadd    s0, s0, s3             // Accumulate
+.Ldot_reduce:
+    faddp   v16.4s, v16.4s, v16.4s // [a+b, c+d, a+b, c+d]
+    faddp   s0, v16.2s             // (a+b) + (c+d)
     
-    sub     x2, x2, #4
-    b       .Ldot_loop
+    cbz     x2, .Ldot_done         // 0-3 elements left
+.Ldot_scalar:
+    ldr     s1, [x0], #4
+    ldr     s2, [x1], #4
+    fmadd   s0, s1, s2, s0         // s0 += s1 * s2
+    subs    x2, x2, #1
+    b.ne    .Ldot_scalar
     
 .Ldot_done:
     ret
 
+// ============================================================================
+// FUNCTION: verify_neon_kernels
+// Description: Check vector_add_neon and dot_product_neon for every count
+//              from 0 to VERIFY_MAX against exact expected values
+// Returns: X0 = 0 if all results match, 1 otherwise
+//
+// a[i] = i and b[i] = 2 keep every sum a small integer, which floats hold
+// exactly, so any summation order must give exactly n * (n - 1).
+// ============================================================================
+verify_neon_kernels:
+    stp     x29, x30, [sp, #-48]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    stp     x21, x22, [sp, #32]
+    
+    ldr     x19, =verify_a
+    ldr     x20, =verify_b
+    ldr     x21, =verify_out
+    fmov    s1, #2.0
+    mov     x0, #0
+1:
+    scvtf   s0, w0
+    str     s0, [x19, x0, lsl #2]
+    str     s1, [x20, x0, lsl #2]
+    add     x0, x0, #1
+    cmp     x0, #VERIFY_MAX
+    b.lt    1b
+    
+    mov     x22, #0                // Count
+.Lverify_count:
+    // Fill the output and its guard element with -1.0
+    fmov    s1, #-1.0
+    mov     x0, #0
+2:
+    str     s1, [x21, x0, lsl #2]
+    add     x0, x0, #1
+    cmp     x0, x22
+    b.le    2b
+    
+    mov     x0, x19
+    mov     x1, x20
+    mov     x2, x21
+    mov     x3, x22
+    bl      vector_add_neon
+    
+    // out[i] must be i + 2, out[n] must still be -1.0
+    mov     x0, #0
+3:
+    cmp     x0, x22
+    b.ge    4f
+    ldr     s0, [x21, x0, lsl #2]
+    add     x1, x0, #2
+    scvtf   s1, x1
+    fcmp    s0, s1
+    b.ne    .Lverify_fail
+    add     x0, x0, #1
+    b       3b
+4:
+    ldr     s0, [x21, x22, lsl #2]
+    fmov    s1, #-1.0
+    fcmp    s0, s1
+    b.ne    .Lverify_fail
+    
+    mov     x0, x19
+    mov     x1, x20
+    mov     x2, x22
+    bl      dot_product_neon
+    sub     x1, x22, #1
+    mul     x1, x1, x22            // n * (n - 1) = 2 * (0 + 1 + ... + n-1)
+    scvtf   s1, x1
+    fcmp    s0, s1
+    b.ne    .Lverify_fail
+    
+    add     x22, x22, #1
+    cmp     x22, #VERIFY_MAX
+    b.le    .Lverify_count
+    
+    mov     x0, #0
+    b       .Lverify_done
+.Lverify_fail:
+    mov     x0, #1
+.Lverify_done:
+    ldp     x21, x22, [sp, #32]
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #48
+    ret
+
 // ============================================================================
 // NOTES: NEON/SIMD Programming
 // ============================================================================
@@ -434,7 +608,7 @@ dot_product_neon:
 //   MAC: fmla, fmls, mla, mls
 //   Comparison: fcmeq, fcmgt, fcmge, cmeq, cmgt, cmge
 //   Min/Max: fmin, fmax, smin, smax, umin, umax
-//   Reduction: faddp, addv
+//   Reduction: faddp, addv (integer), fmaxv/fminv
 //   Conversion: scvtf, ucvtf, fcvtzs, fcvtzu
 //   Math: fsqrt, fabs, fneg, frecpe, frsqrte
 //   Logical: and, orr, eor, bic, mvn
@@ -445,7 +619,11 @@ dot_product_neon:
 //   - Keep data 16-byte aligned
 //   - Use load/store with post-increment
 //   - Avoid lane extractions in hot loops
-//   - Use reduction operations efficiently
+//   - Reduce across lanes once, after the loop - a faddp per iteration
+//     makes every iteration wait for the previous sum
+//   - Use several accumulators (4 x fmla) so the FMA latency overlaps
+//   - ld1/st1 with 2-4 registers moves up to 64 bytes per instruction
+//   - Finish with a scalar tail (ldr s / fmadd) - never drop elements
 //
 // Speedup:
 //   - 4x for single-precision operations
@@ -0,0 +1,287 @@
+// ============================================================================
+// File: 06_memory_ordering_arm64.s
+// Description: Memory ordering on ARM64: relaxed, acquire/release, seq_cst
+// Topics: ldar, stlr, dmb ish/ishld/ishst, ordering costs, cntvct_el0 timing
+// Assembler: GNU as (gas)
+// Build: as -o 06_memory_ordering_arm64.o 06_memory_ordering_arm64.s
+//        ld -o 06_memory_ordering_arm64 06_memory_ordering_arm64.o
+// ============================================================================
+//
+// The functions below are the ARM64 side of the memory-ordering API in
+// x86_64/09_inline_asm_c.c (load_acquire, store_release, fence_seq_cst...)
+// and follow AAPCS64, so they can be linked into C code. _start times each
+// ordering level and prints the counter ticks per 1000 operations.
+//
+// ARM64 is weakly ordered: without barriers the core may reorder any two
+// accesses to different addresses, so unlike x86 even acquire and release
+// cost an instruction. What each level needs:
+//
+//   relaxed  - ldr / str
+//   acquire  - ldar: later accesses cannot move above it
+//   release  - stlr: earlier accesses cannot move below it
+//   seq_cst  - ldar/stlr are already sequentially consistent with each
+//              other (an ldar never passes an earlier stlr), so seq_cst
+//              loads and stores are the same instructions. A standalone
+//              seq_cst fence is dmb ish.
+//
+// dmb ish waits for all earlier accesses to complete; ldar/stlr only
+// constrain the accesses on one side of them, which is why they are
+// cheaper than a load or store followed by a full dmb.
+// ============================================================================
+
+.global _start
+.global load_relaxed
+.global store_relaxed
+.global load_acquire
+.global store_release
+.global store_seq_cst
+.global fence_acquire
+.global fence_release
+.global fence_seq_cst
+
+.equ SYS_WRITE, 64
+.equ SYS_EXIT,  93
+.equ ITERATIONS, 10000000
+
+.section .data
+    title_msg:      .asciz "Memory ordering cost (counter ticks per 1000 store+load pairs)\n"
+    freq_msg:       .asciz "  counter frequency (Hz)               "
+    name_relaxed:   .asciz "  relaxed         str;  ldr            "
+    name_release:   .asciz "  release store   stlr; ldr            "
+    name_acquire:   .asciz "  acquire load    str;  ldar           "
+    name_seq_cst:   .asciz "  seq_cst         stlr; ldar           "
+    name_dmb_ld:    .asciz "  acquire fence   str;  dmb ishld; ldr "
+    name_dmb:       .asciz "  seq_cst fence   str;  dmb ish;   ldr "
+
+.section .bss
+    .align 6                        // Separate cache lines for the two slots
+    store_slot:     .skip   64
+    load_slot:      .skip   64
+    number_buffer:  .skip   32
+
+.section .text
+
+// ============================================================================
+// MEMORY-ORDERING API (AAPCS64)
+// ============================================================================
+// X0 = address, X1 = value for stores; loads return the value in X0.
+
+load_relaxed:
+    ldr     x0, [x0]
+    ret
+
+store_relaxed:
+    str     x1, [x0]
+    ret
+
+load_acquire:
+    ldar    x0, [x0]               // Load-acquire
+    ret
+
+store_release:
+    stlr    x1, [x0]               // Store-release
+    ret
+
+// stlr is ordered before any later ldar, which is all seq_cst needs as long
+// as seq_cst loads use ldar (load_acquire)
+store_seq_cst:
+    stlr    x1, [x0]
+    ret
+
+// Orders earlier loads before later loads and stores
+fence_acquire:
+    dmb     ishld
+    ret
+
+// Orders earlier loads and stores before later stores. dmb ishst alone
+// would not do: it orders stores with stores, not loads with stores.
+fence_release:
+    dmb     ish
+    ret
+
+// Full barrier for the inner-shareable domain (all cores of the system)
+fence_seq_cst:
+    dmb     ish
+    ret
+
+// ============================================================================
+// BENCHMARK LOOPS
+// ============================================================================
+// Each loop stores to one line and loads from another ITERATIONS times,
+// with the given instructions and optional fence in between.
+// Arguments: X0 = iterations, X1 = store address, X2 = load address
+// Returns: X0 = elapsed ticks of the virtual counter (cntvct_el0)
+
+.macro ORDER_LOOP name, store_insn, load_insn, fence
+\name:
+    mov     x3, #0
+    isb                            // Keep the counter read in program order
+    mrs     x9, cntvct_el0
+1:
+    \store_insn x3, [x1]
+.ifnb \fence
+    \fence
+.endif
+    \load_insn x4, [x2]
+    add     x3, x3, x4
+    subs    x0, x0, #1
+    b.ne    1b
+    isb
+    mrs     x10, cntvct_el0
+    sub     x0, x10, x9
+    ret
+.endm
+
+ORDER_LOOP bench_relaxed, str,  ldr
+ORDER_LOOP bench_release, stlr, ldr
+ORDER_LOOP bench_acquire, str,  ldar
+ORDER_LOOP bench_seq_cst, stlr, ldar
+ORDER_LOOP bench_dmb_ld,  str,  ldr,  "dmb ishld"
+ORDER_LOOP bench_dmb,     str,  ldr,  "dmb ish"
+
+// ============================================================================
+// MAIN PROGRAM
+// ============================================================================
+
+_start:
+    ldr     x0, =title_msg
+    bl      print_string
+
+    ldr     x0, =freq_msg
+    bl      print_string
+    mrs     x0, cntfrq_el0
+    bl      print_u64_line
+
+    ldr     x19, =name_relaxed
+    ldr     x20, =bench_relaxed
+    bl      run_one
+
+    ldr     x19, =name_release
+    ldr     x20, =bench_release
+    bl      run_one
+
+    ldr     x19, =name_acquire
+    ldr     x20, =bench_acquire
+    bl      run_one
+
+    ldr     x19, =name_seq_cst
+    ldr     x20, =bench_seq_cst
+    bl      run_one
+
+    ldr     x19, =name_dmb_ld
+    ldr     x20, =bench_dmb_ld
+    bl      run_one
+
+    ldr     x19, =name_dmb
+    ldr     x20, =bench_dmb
+    bl      run_one
+
+    mov     x0, #0
+    mov     x8, #SYS_EXIT
+    svc     #0
+
+// ============================================================================
+// FUNCTION: run_one
+// Description: Print a label, run one benchmark loop, print ticks per 1000
+// Arguments: X19 = label string, X20 = benchmark loop address
+// ============================================================================
+run_one:
+    stp     x29, x30, [sp, #-16]!
+    mov     x29, sp
+
+    mov     x0, x19
+    bl      print_string
+
+    ldr     x0, =ITERATIONS
+    ldr     x1, =store_slot
+    ldr     x2, =load_slot
+    blr     x20
+
+    mov     x1, #1000              // ticks * 1000 / ITERATIONS
+    mul     x0, x0, x1
+    ldr     x1, =ITERATIONS
+    udiv    x0, x0, x1
+    bl      print_u64_line
+
+    ldp     x29, x30, [sp], #16
+    ret
+
+// ============================================================================
+// FUNCTION: print_string
+// Description: Write a null-terminated string to stdout
+// Arguments: X0 = string address
+// ============================================================================
+print_string:
+    mov     x1, x0
+    mov     x2, #0
+1:
+    ldrb    w3, [x1, x2]
+    cbz     w3, 2f
+    add     x2, x2, #1
+    b       1b
+2:
+    mov     x0, #1                 // stdout
+    mov     x8, #SYS_WRITE
+    svc     #0
+    ret
+
+// ============================================================================
+// FUNCTION: print_u64_line
+// Description: Write an unsigned number in decimal followed by a newline
+// Arguments: X0 = value
+// ============================================================================
+print_u64_line:
+    ldr     x1, =number_buffer + 31
+    mov     w2, #'\n'
+    strb    w2, [x1]
+    mov     x3, #10
+1:
+    udiv    x4, x0, x3             // Quotient
+    msub    x5, x4, x3, x0         // Remainder = value - quotient * 10
+    add     w5, w5, #'0'
+    strb    w5, [x1, #-1]!
+    mov     x0, x4
+    cbnz    x0, 1b
+
+    ldr     x2, =number_buffer + 32
+    sub     x2, x2, x1             // Length including the newline
+    mov     x0, #1
+    mov     x8, #SYS_WRITE
+    svc     #0
+    ret
+
+// ============================================================================
+// NOTES: Memory Ordering on ARM64
+// ============================================================================
+//
+// Mapping of C11/C++11 orderings (what compilers emit):
+//   load relaxed    ldr            store relaxed    str
+//   load acquire    ldar (ldapr)   store release    stlr
+//   load seq_cst    ldar           store seq_cst    stlr
+//   fence acquire   dmb ishld      fence release    dmb ish
+//   fence seq_cst   dmb ish        RMW              ldaxr/stlxr loop, or
+//                                                   LSE ldaddal/swpal/casal
+//
+// Compared with x86-64 (see x86_64/09_inline_asm_c.c, MEMORY ORDERING):
+//   x86 acquire/release are plain movs and seq_cst costs a locked
+//   instruction; on ARM64 acquire/release cost something, but a seq_cst
+//   store is no dearer than a release store.
+//
+// Barrier options:
+//   ish    - inner shareable: all cores running this OS. Use this.
+//   sy     - full system, includes devices; only for MMIO/driver code.
+//   ld/st  - dmb ishld orders loads with later loads and stores; dmb ishst
+//            orders stores with stores only (enough for "write data, then
+//            write flag", not for release semantics in general).
+//
+// ldapr (ARMv8.3 RCpc) is a weaker acquire that may pass an earlier stlr
+// to a different address. It is what C11 memory_order_acquire allows and
+// is cheaper on some cores, but it is not seq_cst.
+//
+// Reading the results: a lone stlr or ldar costs little more than a plain
+// access. stlr followed by ldar is seq_cst, so the ldar waits for the
+// store to drain - on many cores that row is close to the dmb ish row,
+// which waits for the store to reach the cache every iteration. That
+// store->load drain is the same cost x86 pays for lock or/mfence.
+//
+// ============================================================================
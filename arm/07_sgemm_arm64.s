@@ -0,0 +1,783 @@
+// ============================================================================
+// File: 07_sgemm_arm64.s
+// Description: Single-precision matrix multiply (SGEMM) for ARM64 with an
+//              8x12 NEON microkernel, panel packing and cache blocking
+// Topics: Register blocking, fmla by element, packing, L1/L2/L3 blocking
+// Assembler: GNU as (gas)
+// Build: as -o 07_sgemm_arm64.o 07_sgemm_arm64.s
+//        ld -o 07_sgemm_arm64 07_sgemm_arm64.o
+// Run: ./07_sgemm_arm64   (checks the product against a naive triple loop)
+// ============================================================================
+//
+// The ARM64 counterpart of x86_64/15_sgemm.asm - same loop nest, same
+// packed layouts, different tile. dot_product_neon (05) loads two values
+// per fmla; here each loaded value feeds 8 or 12 of them:
+//
+//     C (M x N)  =  alpha * A (M x K) * B (K x N)  +  beta * C
+//
+// Row-major, leading dimensions in elements; beta = 0 never reads C.
+//
+// Loop nest (as in BLIS / GotoBLAS):
+//
+//   for jc in 0..N step NC            packed B block KC x NC  -> L3
+//     for pc in 0..K step KC
+//       pack_b
+//       for ic in 0..M step MC        packed A block MC x KC  -> L2
+//         pack_a
+//         for jr in 0..NC step 12     B micro-panel KC x 12   -> L1
+//           for ir in 0..MC step 8
+//             microkernel: C[8 x 12] += A micro-panel * B micro-panel
+//
+// Why 8x12: NEON has 32 vector registers. The 8x12 tile takes 24 of them
+// as accumulators (8 rows x 3 vectors of 4), B takes 3 and A 2 - 29 in
+// all. "fmla vd.4s, vb.4s, va.s[i]" multiplies by one lane of A directly,
+// so A needs no broadcast: 5 loads (2 A + 3 B vectors) feed 24 fmla per
+// k step.
+//
+// Arguments (AAPCS64):
+//   X0 = M, X1 = N, X2 = K, S0 = alpha, X3 = A, X4 = lda, X5 = B,
+//   X6 = ldb, S1 = beta, X7 = C, [sp] = ldc
+// ============================================================================
+
+.global _start
+.global sgemm_neon
+.global sgemm_kernel_8x12_neon
+.global sgemm_pack_a_neon
+.global sgemm_pack_b_neon
+
+.equ SYS_WRITE, 64
+.equ SYS_EXIT,  93
+
+.equ SGEMM_MR,  8                   // Microkernel rows
+.equ SGEMM_NR,  12                  // Microkernel columns (3 vectors)
+.equ SGEMM_KC,  256                 // B micro-panel KC*NR*4 = 12 KiB in L1
+.equ SGEMM_MC,  120                 // A block MC*KC*4 = 120 KiB in L2
+.equ SGEMM_NC,  2040                // B block KC*NC*4 = ~2 MiB in L3
+
+// Locals of sgemm_neon (after the saved registers at sp+0..95)
+.equ L_ALPHA,   96                  // float
+.equ L_BETA,    100                 // float
+.equ L_BETA_PC, 104                 // float: beta for this KC slice
+.equ L_NC,      112
+.equ L_KC,      120
+.equ L_MC,      128
+.equ L_PC,      136
+.equ L_IC,      144
+.equ L_JR,      152
+.equ L_IR,      160
+.equ L_NR,      168
+.equ L_MR,      176
+.equ L_CPTR,    184
+.equ L_TILE,    192                 // 8 x 12 floats for edge tiles
+.equ L_FRAME,   576
+
+.equ VERIFY_FLOATS, 16384           // Per test matrix
+.equ VERIFY_CASE,   32              // Bytes per test case
+
+.section .data
+    // Test cases: M, N, K, beta (float bits; 0x7FC00000 = beta 0 with C
+    // filled with NaN). Chosen to cross every edge and block size.
+    .align 3
+    verify_cases:
+                    .quad 1,   1,    1,   0x3F800000
+                    .quad 8,   12,   4,   0x7FC00000
+                    .quad 9,   13,   3,   0xBF800000
+                    .quad 5,   3,    0,   0xBF800000    // K = 0: C = beta*C
+                    .quad 13,  37,   257, 0x3F800000    // K > KC
+                    .quad 130, 40,   20,  0x7FC00000    // M > MC
+                    .quad 3,   2100, 2,   0x3F800000    // N > NC
+                    .quad 0,   5,    5,   0x3F800000    // Empty
+    .equ verify_count, (. - verify_cases) / VERIFY_CASE
+
+    verify_ok_msg:  .ascii "NEON SGEMM matches the reference\n"
+    .equ verify_ok_len, . - verify_ok_msg
+    verify_bad_msg: .ascii "NEON SGEMM MISMATCH\n"
+    .equ verify_bad_len, . - verify_bad_msg
+
+.section .bss
+    .align 6
+    sgemm_abuf:     .skip   SGEMM_MC * SGEMM_KC * 4
+    sgemm_bbuf:     .skip   SGEMM_KC * SGEMM_NC * 4
+    verify_a:       .skip   VERIFY_FLOATS * 4
+    verify_b:       .skip   VERIFY_FLOATS * 4
+    verify_c:       .skip   VERIFY_FLOATS * 4
+    verify_ref:     .skip   VERIFY_FLOATS * 4
+
+.section .text
+
+_start:
+    bl      verify_sgemm
+    mov     x19, x0
+
+    ldr     x1, =verify_ok_msg
+    mov     x2, #verify_ok_len
+    cbz     x19, 1f
+    ldr     x1, =verify_bad_msg
+    mov     x2, #verify_bad_len
+1:
+    mov     x0, #1
+    mov     x8, #SYS_WRITE
+    svc     #0
+
+    // Exit with 1 on mismatch
+    mov     x0, x19
+    mov     x8, #SYS_EXIT
+    svc     #0
+
+// ============================================================================
+// MICROKERNEL
+// ============================================================================
+
+// One row of the tile for one k step: three fmla by the same A lane
+.macro FMLA_ROW a, c0, c1, c2
+    fmla    \c0\().4s, v2.4s, \a
+    fmla    \c1\().4s, v3.4s, \a
+    fmla    \c2\().4s, v4.4s, \a
+.endm
+
+// Store one row of the tile (X3 = row), C = acc
+.macro STORE_ROW c0, c1, c2
+    st1     {\c0\().4s, \c1\().4s, \c2\().4s}, [x3]
+    add     x3, x3, x4
+.endm
+
+// Store one row of the tile, C = acc + beta * C (V5 = beta)
+.macro BETA_ROW c0, c1, c2
+    ld1     {v0.4s, v1.4s, v2.4s}, [x3]
+    fmla    \c0\().4s, v0.4s, v5.4s
+    fmla    \c1\().4s, v1.4s, v5.4s
+    fmla    \c2\().4s, v2.4s, v5.4s
+    st1     {\c0\().4s, \c1\().4s, \c2\().4s}, [x3]
+    add     x3, x3, x4
+.endm
+
+// ============================================================================
+// FUNCTION: sgemm_kernel_8x12_neon
+// Description: C[8 x 12] = A micro-panel * B micro-panel + beta * C
+// Arguments: X0 = k, X1 = packed A (8 floats per k), X2 = packed B
+//            (12 floats per k), X3 = C, X4 = ldc in bytes, S0 = beta
+//            (beta = +-0 does not read C)
+// Clobbers: X0-X3, X9, V0-V7, V16-V31 (saves D8-D15 per AAPCS64)
+// ============================================================================
+sgemm_kernel_8x12_neon:
+    stp     d8, d9, [sp, #-64]!
+    stp     d10, d11, [sp, #16]
+    stp     d12, d13, [sp, #32]
+    stp     d14, d15, [sp, #48]
+    fmov    w9, s0                  // Keep beta while V0 holds A
+
+    // Accumulators: row r in V(8+3r), V(9+3r), V(10+3r)
+    movi    v8.4s, #0
+    movi    v9.4s, #0
+    movi    v10.4s, #0
+    movi    v11.4s, #0
+    movi    v12.4s, #0
+    movi    v13.4s, #0
+    movi    v14.4s, #0
+    movi    v15.4s, #0
+    movi    v16.4s, #0
+    movi    v17.4s, #0
+    movi    v18.4s, #0
+    movi    v19.4s, #0
+    movi    v20.4s, #0
+    movi    v21.4s, #0
+    movi    v22.4s, #0
+    movi    v23.4s, #0
+    movi    v24.4s, #0
+    movi    v25.4s, #0
+    movi    v26.4s, #0
+    movi    v27.4s, #0
+    movi    v28.4s, #0
+    movi    v29.4s, #0
+    movi    v30.4s, #0
+    movi    v31.4s, #0
+
+    cbz     x0, .Lkernel_store
+.Lkernel_loop:
+    ld1     {v0.4s, v1.4s}, [x1], #32           // A: rows 0-7
+    ld1     {v2.4s, v3.4s, v4.4s}, [x2], #48    // B: columns 0-11
+    prfm    pldl1keep, [x2, #384]
+    FMLA_ROW v0.s[0], v8, v9, v10
+    FMLA_ROW v0.s[1], v11, v12, v13
+    FMLA_ROW v0.s[2], v14, v15, v16
+    FMLA_ROW v0.s[3], v17, v18, v19
+    FMLA_ROW v1.s[0], v20, v21, v22
+    FMLA_ROW v1.s[1], v23, v24, v25
+    FMLA_ROW v1.s[2], v26, v27, v28
+    FMLA_ROW v1.s[3], v29, v30, v31
+    subs    x0, x0, #1
+    b.ne    .Lkernel_loop
+
+.Lkernel_store:
+    tst     w9, #0x7FFFFFFF
+    b.eq    .Lkernel_write          // beta = 0: C is not read
+
+    dup     v5.4s, w9
+    BETA_ROW v8, v9, v10
+    BETA_ROW v11, v12, v13
+    BETA_ROW v14, v15, v16
+    BETA_ROW v17, v18, v19
+    BETA_ROW v20, v21, v22
+    BETA_ROW v23, v24, v25
+    BETA_ROW v26, v27, v28
+    BETA_ROW v29, v30, v31
+    b       .Lkernel_done
+
+.Lkernel_write:
+    STORE_ROW v8, v9, v10
+    STORE_ROW v11, v12, v13
+    STORE_ROW v14, v15, v16
+    STORE_ROW v17, v18, v19
+    STORE_ROW v20, v21, v22
+    STORE_ROW v23, v24, v25
+    STORE_ROW v26, v27, v28
+    STORE_ROW v29, v30, v31
+
+.Lkernel_done:
+    ldp     d10, d11, [sp, #16]
+    ldp     d12, d13, [sp, #32]
+    ldp     d14, d15, [sp, #48]
+    ldp     d8, d9, [sp], #64
+    ret
+
+// ============================================================================
+// FUNCTION: sgemm_merge_tile
+// Description: C[mr x nr] = tile + beta * C for a partial edge tile
+// Arguments: X0 = mr, X1 = nr, X2 = tile (row stride 48 bytes), X3 = C,
+//            X4 = ldc in bytes, S0 = beta
+// Clobbers: X0, X2, X3, X9, X10, V1, V2
+// ============================================================================
+sgemm_merge_tile:
+    fmov    w9, s0
+    and     w9, w9, #0x7FFFFFFF     // Zero if beta = +-0
+.Lmerge_row:
+    mov     x10, #0
+.Lmerge_col:
+    ldr     s1, [x2, x10, lsl #2]
+    cbz     w9, .Lmerge_put
+    ldr     s2, [x3, x10, lsl #2]
+    fmadd   s1, s2, s0, s1          // tile + C * beta
+.Lmerge_put:
+    str     s1, [x3, x10, lsl #2]
+    add     x10, x10, #1
+    cmp     x10, x1
+    b.lo    .Lmerge_col
+    add     x2, x2, #SGEMM_NR * 4
+    add     x3, x3, x4
+    subs    x0, x0, #1
+    b.ne    .Lmerge_row
+    ret
+
+// ============================================================================
+// PACKING
+// ============================================================================
+
+// ============================================================================
+// FUNCTION: sgemm_pack_a_neon
+// Description: Pack an mc x kc block of A into micro-panels of 8 rows:
+//              panel i holds alpha * A[8i + r][p] at (p*8 + r), rows past
+//              mc are zero
+// Arguments: X0 = mc, X1 = kc, X2 = A block, X3 = lda in bytes,
+//            X4 = destination, S0 = alpha
+// Clobbers: X0, X2, X4, X9-X13, V1
+// ============================================================================
+sgemm_pack_a_neon:
+    cbz     x1, .Lpack_a_done
+    mov     x13, #SGEMM_MR * 4      // Stride between k steps
+.Lpack_a_panel:
+    mov     x9, #0                  // Row within the panel
+.Lpack_a_row:
+    add     x11, x4, x9, lsl #2     // Column r of the panel
+    mov     x10, x1
+    cmp     x9, x0
+    b.hs    .Lpack_a_zero
+    madd    x12, x9, x3, x2         // Source row
+
+    // Four elements of the row = four k steps of the panel
+.Lpack_a_quad:
+    cmp     x10, #4
+    b.lo    .Lpack_a_single
+    ld1     {v1.4s}, [x12], #16
+    fmul    v1.4s, v1.4s, v0.s[0]
+    st1     {v1.s}[0], [x11], x13
+    st1     {v1.s}[1], [x11], x13
+    st1     {v1.s}[2], [x11], x13
+    st1     {v1.s}[3], [x11], x13
+    sub     x10, x10, #4
+    b       .Lpack_a_quad
+.Lpack_a_single:
+    cbz     x10, .Lpack_a_next
+    ldr     s1, [x12], #4
+    fmul    s1, s1, s0
+    str     s1, [x11]
+    add     x11, x11, x13
+    sub     x10, x10, #1
+    b       .Lpack_a_single
+
+.Lpack_a_zero:
+    str     wzr, [x11]
+    add     x11, x11, x13
+    subs    x10, x10, #1
+    b.ne    .Lpack_a_zero
+
+.Lpack_a_next:
+    add     x9, x9, #1
+    cmp     x9, #SGEMM_MR
+    b.lo    .Lpack_a_row
+
+    add     x4, x4, x1, lsl #5      // Next panel: 32 bytes per k
+    add     x2, x2, x3, lsl #3      // 8 rows down
+    subs    x0, x0, #SGEMM_MR
+    b.hi    .Lpack_a_panel
+.Lpack_a_done:
+    ret
+
+// ============================================================================
+// FUNCTION: sgemm_pack_b_neon
+// Description: Pack a kc x nc block of B into micro-panels of 12 columns:
+//              panel j holds B[p][12j + c] at (p*12 + c), columns past nc
+//              are zero
+// Arguments: X0 = kc, X1 = nc, X2 = B block, X3 = ldb in bytes,
+//            X4 = destination
+// Clobbers: X1, X2, X4, X9-X12, V0-V2
+// ============================================================================
+sgemm_pack_b_neon:
+    cbz     x0, .Lpack_b_done
+.Lpack_b_panel:
+    mov     x9, x2
+    mov     x10, x0
+    cmp     x1, #SGEMM_NR
+    b.lo    .Lpack_b_partial
+.Lpack_b_full:
+    ld1     {v0.4s, v1.4s, v2.4s}, [x9]
+    add     x9, x9, x3
+    st1     {v0.4s, v1.4s, v2.4s}, [x4], #48
+    subs    x10, x10, #1
+    b.ne    .Lpack_b_full
+    add     x2, x2, #SGEMM_NR * 4
+    subs    x1, x1, #SGEMM_NR
+    b.ne    .Lpack_b_panel
+.Lpack_b_done:
+    ret
+
+    // Last panel, 1-11 columns
+.Lpack_b_partial:
+    stp     xzr, xzr, [x4]
+    stp     xzr, xzr, [x4, #16]
+    stp     xzr, xzr, [x4, #32]
+    mov     x11, #0
+.Lpack_b_col:
+    ldr     w12, [x9, x11, lsl #2]
+    str     w12, [x4, x11, lsl #2]
+    add     x11, x11, #1
+    cmp     x11, x1
+    b.lo    .Lpack_b_col
+    add     x9, x9, x3
+    add     x4, x4, #SGEMM_NR * 4
+    subs    x10, x10, #1
+    b.ne    .Lpack_b_partial
+    ret
+
+// ============================================================================
+// FUNCTION: sgemm_neon
+// Description: C = alpha * A * B + beta * C (blocked, packed)
+// Arguments: see the header. Uses static packing buffers, so it must not
+//            run on two threads at once.
+// ============================================================================
+sgemm_neon:
+    sub     sp, sp, #L_FRAME
+    stp     x29, x30, [sp]
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    stp     x21, x22, [sp, #32]
+    stp     x23, x24, [sp, #48]
+    stp     x25, x26, [sp, #64]
+    stp     x27, x28, [sp, #80]
+
+    mov     x19, x0                 // M
+    mov     x20, x1                 // N
+    mov     x21, x2                 // K
+    mov     x22, x3                 // A
+    lsl     x23, x4, #2             // lda in bytes
+    mov     x24, x5                 // B
+    lsl     x25, x6, #2             // ldb in bytes
+    mov     x26, x7                 // C
+    ldr     x27, [sp, #L_FRAME]
+    lsl     x27, x27, #2            // ldc in bytes
+    str     s0, [sp, #L_ALPHA]
+    str     s1, [sp, #L_BETA]
+
+    cbz     x19, .Lsgemm_done
+    cbz     x20, .Lsgemm_done
+
+    mov     x28, #0                 // X28 = jc
+.Lsgemm_jc:
+    sub     x9, x20, x28
+    mov     x10, #SGEMM_NC
+    cmp     x9, x10
+    csel    x9, x9, x10, lo
+    str     x9, [sp, #L_NC]
+    str     xzr, [sp, #L_PC]
+
+    // Runs at least once: with K = 0 the kernel still applies beta
+.Lsgemm_pc:
+    ldr     x11, [sp, #L_PC]
+    sub     x9, x21, x11
+    mov     x10, #SGEMM_KC
+    cmp     x9, x10
+    csel    x9, x9, x10, lo
+    str     x9, [sp, #L_KC]
+
+    // The first KC slice applies the caller's beta, later ones accumulate
+    ldr     w9, [sp, #L_BETA]
+    mov     w10, #0x3F800000        // 1.0f
+    cmp     x11, #0
+    csel    w9, w9, w10, eq
+    str     w9, [sp, #L_BETA_PC]
+
+    ldr     x0, [sp, #L_KC]
+    ldr     x1, [sp, #L_NC]
+    madd    x2, x11, x25, x24
+    add     x2, x2, x28, lsl #2
+    mov     x3, x25
+    ldr     x4, =sgemm_bbuf
+    bl      sgemm_pack_b_neon
+
+    str     xzr, [sp, #L_IC]
+.Lsgemm_ic:
+    ldr     x11, [sp, #L_IC]
+    sub     x9, x19, x11
+    mov     x10, #SGEMM_MC
+    cmp     x9, x10
+    csel    x9, x9, x10, lo
+    str     x9, [sp, #L_MC]
+
+    mov     x0, x9
+    ldr     x1, [sp, #L_KC]
+    madd    x2, x11, x23, x22
+    ldr     x12, [sp, #L_PC]
+    add     x2, x2, x12, lsl #2
+    mov     x3, x23
+    ldr     x4, =sgemm_abuf
+    ldr     s0, [sp, #L_ALPHA]
+    bl      sgemm_pack_a_neon
+
+    str     xzr, [sp, #L_JR]
+.Lsgemm_jr:
+    ldr     x11, [sp, #L_JR]
+    ldr     x12, [sp, #L_NC]
+    sub     x9, x12, x11
+    mov     x10, #SGEMM_NR
+    cmp     x9, x10
+    csel    x9, x9, x10, lo
+    str     x9, [sp, #L_NR]
+
+    str     xzr, [sp, #L_IR]
+.Lsgemm_ir:
+    ldr     x11, [sp, #L_IR]
+    ldr     x12, [sp, #L_MC]
+    sub     x9, x12, x11
+    mov     x10, #SGEMM_MR
+    cmp     x9, x10
+    csel    x9, x9, x10, lo
+    str     x9, [sp, #L_MR]
+
+    ldr     x0, [sp, #L_KC]
+    ldr     x1, =sgemm_abuf         // A panel: abuf + ir*kc*4
+    mul     x9, x11, x0
+    add     x1, x1, x9, lsl #2
+    ldr     x12, [sp, #L_JR]        // B panel: bbuf + jr*kc*4
+    ldr     x2, =sgemm_bbuf
+    mul     x9, x12, x0
+    add     x2, x2, x9, lsl #2
+    ldr     x13, [sp, #L_IC]        // C + (ic + ir)*ldc + (jc + jr)*4
+    add     x13, x13, x11
+    madd    x3, x13, x27, x26
+    add     x9, x28, x12
+    add     x3, x3, x9, lsl #2
+    mov     x4, x27
+    ldr     s0, [sp, #L_BETA_PC]
+
+    ldr     x9, [sp, #L_MR]
+    cmp     x9, #SGEMM_MR
+    b.ne    .Lsgemm_edge
+    ldr     x9, [sp, #L_NR]
+    cmp     x9, #SGEMM_NR
+    b.ne    .Lsgemm_edge
+    bl      sgemm_kernel_8x12_neon
+    b       .Lsgemm_ir_next
+
+    // Partial tile: full 8x12 product into the tile, then merge
+.Lsgemm_edge:
+    str     x3, [sp, #L_CPTR]
+    add     x3, sp, #L_TILE
+    mov     x4, #SGEMM_NR * 4
+    movi    v0.4s, #0
+    bl      sgemm_kernel_8x12_neon
+    ldr     x0, [sp, #L_MR]
+    ldr     x1, [sp, #L_NR]
+    add     x2, sp, #L_TILE
+    ldr     x3, [sp, #L_CPTR]
+    mov     x4, x27
+    ldr     s0, [sp, #L_BETA_PC]
+    bl      sgemm_merge_tile
+
+.Lsgemm_ir_next:
+    ldr     x11, [sp, #L_IR]
+    add     x11, x11, #SGEMM_MR
+    str     x11, [sp, #L_IR]
+    ldr     x12, [sp, #L_MC]
+    cmp     x11, x12
+    b.lo    .Lsgemm_ir
+
+    ldr     x11, [sp, #L_JR]
+    add     x11, x11, #SGEMM_NR
+    str     x11, [sp, #L_JR]
+    ldr     x12, [sp, #L_NC]
+    cmp     x11, x12
+    b.lo    .Lsgemm_jr
+
+    ldr     x11, [sp, #L_IC]
+    add     x11, x11, #SGEMM_MC
+    str     x11, [sp, #L_IC]
+    cmp     x11, x19
+    b.lo    .Lsgemm_ic
+
+    ldr     x11, [sp, #L_PC]
+    add     x11, x11, #SGEMM_KC
+    str     x11, [sp, #L_PC]
+    cmp     x11, x21
+    b.lo    .Lsgemm_pc
+
+    add     x28, x28, #SGEMM_NC
+    cmp     x28, x20
+    b.lo    .Lsgemm_jc
+
+.Lsgemm_done:
+    ldp     x19, x20, [sp, #16]
+    ldp     x21, x22, [sp, #32]
+    ldp     x23, x24, [sp, #48]
+    ldp     x25, x26, [sp, #64]
+    ldp     x27, x28, [sp, #80]
+    ldp     x29, x30, [sp]
+    add     sp, sp, #L_FRAME
+    ret
+
+// ============================================================================
+// SELF-CHECK
+// ============================================================================
+//
+// Small integers in [-3, 3] with alpha = 2 keep every partial sum exact,
+// so the blocked product must match a naive triple loop bit for bit. The
+// leading dimensions exceed the row lengths (lda = K+1, ldb = N+2,
+// ldc = N+3): the padding columns of C must come back untouched.
+// ============================================================================
+
+// verify_fill: X0 = floats, X1 = count, W2 = seed -> small integers
+verify_fill:
+    cbz     x1, 2f
+    ldr     w9, =1103515245
+    mov     w10, #12345
+    mov     w13, #7
+1:
+    madd    w2, w2, w9, w10
+    lsr     w11, w2, #16
+    udiv    w12, w11, w13
+    msub    w12, w12, w13, w11      // (seed >> 16) mod 7
+    sub     w12, w12, #3
+    scvtf   s0, w12
+    str     s0, [x0], #4
+    subs    x1, x1, #1
+    b.ne    1b
+2:
+    ret
+
+// verify_case: X0 = case -> X0 = 0 if sgemm_neon matches the reference
+verify_case:
+    stp     x29, x30, [sp, #-64]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    stp     x21, x22, [sp, #32]
+    stp     x23, x24, [sp, #48]
+
+    ldp     x20, x21, [x0]          // M, N
+    ldp     x22, x19, [x0, #16]     // K, beta bits
+
+    // A: M x (K+1), B: K x (N+2), C and ref: M x (N+3)
+    ldr     x0, =verify_a
+    add     x1, x22, #1
+    mul     x1, x1, x20
+    mov     w2, #1
+    bl      verify_fill
+    ldr     x0, =verify_b
+    add     x1, x21, #2
+    mul     x1, x1, x22
+    mov     w2, #2
+    bl      verify_fill
+    ldr     x0, =verify_c
+    add     x23, x21, #3
+    mul     x23, x23, x20           // X23 = floats in C
+    mov     x1, x23
+    mov     w2, #3
+    bl      verify_fill
+
+    // beta 0 is encoded as NaN: C becomes NaN and must not be read
+    ldr     x24, =verify_c
+    mov     w9, #0x7FC00000
+    cmp     w19, w9
+    b.ne    .Lverify_beta
+    mov     x10, #0
+1:
+    cmp     x10, x23
+    b.hs    2f
+    str     w9, [x24, x10, lsl #2]
+    add     x10, x10, #1
+    b       1b
+2:
+    mov     w19, #0
+.Lverify_beta:
+    fmov    s5, w19                 // S5 = beta
+    fmov    s4, #2.0                // S4 = alpha
+
+    // ref = C, then ref[i][j] = sum(2*a*b) + beta*C for the M x N part
+    ldr     x9, =verify_ref
+    mov     x10, #0
+3:
+    cmp     x10, x23
+    b.hs    4f
+    ldr     w11, [x24, x10, lsl #2]
+    str     w11, [x9, x10, lsl #2]
+    add     x10, x10, #1
+    b       3b
+4:
+    ldr     x12, =verify_a
+    ldr     x13, =verify_b
+    mov     x10, #0                 // i
+.Lverify_i:
+    cmp     x10, x20
+    b.hs    .Lverify_run
+    mov     x11, #0                 // j
+.Lverify_j:
+    cmp     x11, x21
+    b.hs    .Lverify_i_next
+    movi    v0.4s, #0
+    mov     x14, #0                 // p
+.Lverify_p:
+    cmp     x14, x22
+    b.hs    .Lverify_store
+    add     x15, x22, #1            // a[i][p]
+    madd    x15, x15, x10, x14
+    ldr     s1, [x12, x15, lsl #2]
+    fmul    s1, s1, s4
+    add     x15, x21, #2            // b[p][j]
+    madd    x15, x15, x14, x11
+    ldr     s2, [x13, x15, lsl #2]
+    fmul    s1, s1, s2
+    fadd    s0, s0, s1
+    add     x14, x14, #1
+    b       .Lverify_p
+.Lverify_store:
+    add     x15, x21, #3
+    madd    x15, x15, x10, x11
+    cbz     w19, 5f
+    ldr     s1, [x24, x15, lsl #2]
+    fmul    s1, s1, s5
+    fadd    s0, s0, s1
+5:
+    str     s0, [x9, x15, lsl #2]
+    add     x11, x11, #1
+    b       .Lverify_j
+.Lverify_i_next:
+    add     x10, x10, #1
+    b       .Lverify_i
+
+    // sgemm_neon(M, N, K, 2, A, K+1, B, N+2, beta, C, N+3)
+.Lverify_run:
+    add     x9, x21, #3
+    str     x9, [sp, #-16]!
+    mov     x0, x20
+    mov     x1, x21
+    mov     x2, x22
+    fmov    s0, s4
+    ldr     x3, =verify_a
+    add     x4, x22, #1
+    ldr     x5, =verify_b
+    add     x6, x21, #2
+    fmov    s1, s5
+    mov     x7, x24
+    bl      sgemm_neon
+    add     sp, sp, #16
+
+    // Bitwise comparison, padding included
+    ldr     x9, =verify_ref
+    mov     x10, #0
+    mov     x0, #0
+6:
+    cmp     x10, x23
+    b.hs    7f
+    ldr     w11, [x24, x10, lsl #2]
+    ldr     w12, [x9, x10, lsl #2]
+    add     x10, x10, #1
+    cmp     w11, w12
+    b.eq    6b
+    mov     x0, #1
+7:
+    ldp     x19, x20, [sp, #16]
+    ldp     x21, x22, [sp, #32]
+    ldp     x23, x24, [sp, #48]
+    ldp     x29, x30, [sp], #64
+    ret
+
+// verify_sgemm -> X0 = 0 if every case matches
+verify_sgemm:
+    stp     x29, x30, [sp, #-32]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    ldr     x19, =verify_cases
+    mov     x20, #0
+1:
+    ldr     x9, =verify_cases + verify_count * VERIFY_CASE
+    cmp     x19, x9
+    b.hs    2f
+    mov     x0, x19
+    bl      verify_case
+    orr     x20, x20, x0
+    add     x19, x19, #VERIFY_CASE
+    b       1b
+2:
+    mov     x0, x20
+    ldp     x19, x20, [sp, #16]
+    ldp     x29, x30, [sp], #32
+    ret
+
+// ============================================================================
+// NOTES: SGEMM on ARM64
+// ============================================================================
+//
+// Tile shape versus x86-64:
+//   x86-64 AVX2 has 16 YMM registers, so 6x16 (12 accumulators) is the
+//   largest tile; ARM64 has 32 NEON registers of half the width, so 8x12
+//   (24 accumulators of 4 floats = 96 products in flight) fits. Both need
+//   at least latency x throughput independent accumulators: 4 cycles x 2
+//   (or 4) FMA pipes = 8-16 on current Cortex-A / Neoverse cores.
+//
+// fmla by element:
+//   "fmla v8.4s, v2.4s, v0.s[0]" uses lane 0 of v0 as the scalar, so one
+//   16-byte load of A serves four rows with no broadcast instruction. x86
+//   needs a vbroadcastss (a load-port uop) per row instead.
+//
+// Blocking sizes:
+//   KC keeps one B micro-panel in L1 (12 KiB of a 64 KiB L1d), MC keeps the
+//   packed A block in L2, NC the packed B block in L3 / system cache. MC
+//   must stay a multiple of 8 and NC of 12.
+//
+// Callee-saved registers:
+//   AAPCS64 preserves the low 64 bits of v8-v15, so the kernel saves
+//   d8-d15 once per call; with KC = 256 that is 8 stores + 8 loads per
+//   24 * 256 fmla.
+//
+// Not covered here: threads (the x86-64 version splits C into strips with
+// clone(); the same split works with clone (syscall 220) on ARM64),
+// transposed operands, SVE/SME kernels.
+//
+// ============================================================================
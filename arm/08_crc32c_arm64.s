@@ -0,0 +1,449 @@
+// ============================================================================
+// File: 08_crc32c_arm64.s
+// Description: CRC-32C for ARM64 with the CRC32CX instruction on three
+//              interleaved streams merged by PMULL, plus a fused copy
+// Topics: CRC32 extension, latency hiding, carry-less multiply, tbz tails
+// Assembler: GNU as (gas)
+// Build: as -o 08_crc32c_arm64.o 08_crc32c_arm64.s
+//        ld -o 08_crc32c_arm64 08_crc32c_arm64.o
+// Run: ./08_crc32c_arm64   (checks against a bit-at-a-time reference)
+// ============================================================================
+//
+// The ARM64 counterpart of crc32c_3way / crc32c_copy_3way in
+// x86_64/16_crc32.asm: same algorithm, same block sizes, same merge
+// constants. CRC32CX is CRC32 (SSE4.2) with the Castagnoli polynomial
+// and 8 bytes of data; PMULL v.1q, v.1d, v.1d is PCLMULQDQ.
+//
+//   crc32c_arm64         3 streams of 8 KiB (then 256 bytes), PMULL merge
+//   crc32c_serial_arm64  one CRC32CX chain, for comparison
+//   crc32c_copy_arm64    memcpy that returns the CRC-32C of what it copied
+//
+// All start from crc = 0 and chain: f(f(0, a), b) == f(0, ab).
+//
+// Arguments (AAPCS64):
+//   W0 = crc, X1 = buffer, X2 = length
+//   crc32c_copy_arm64: W0 = crc, X1 = destination, X2 = source, X3 = length
+//   Result: W0
+//
+// Needs FEAT_CRC32 (every ARMv8.1+ core) and FEAT_PMULL (the crypto
+// extension: Cortex-A53 and later with crypto, Neoverse, Apple M).
+// ============================================================================
+
+.arch armv8-a+crc+crypto
+
+.global _start
+.global crc32c_arm64
+.global crc32c_serial_arm64
+.global crc32c_copy_arm64
+
+.equ SYS_WRITE, 64
+.equ SYS_EXIT,  93
+
+.equ CRC_LONG,      8192            // Bytes per stream, long 3-way blocks
+.equ CRC_SHORT,     256             // Bytes per stream, short 3-way blocks
+.equ CRC32C_POLY,   0x82F63B78      // Reflected Castagnoli polynomial
+
+.equ VERIFY_MAX_N,  64              // Lengths 0..VERIFY_MAX_N vs. bitwise
+.equ VERIFY_BYTES,  3*CRC_LONG + 2*3*CRC_SHORT + 128
+.equ VERIFY_GUARD,  0x5A            // Byte after the end of a copy
+
+.section .data
+    // 3-way merge: bit-reversed x^(8*2n - 33) and x^(8*n - 33) mod P for
+    // n = bytes per stream (CRC32CX supplies the other x^33)
+    .align 4
+    crc32c_shift_long:  .quad 0x1DC403CC, 0x54A86326
+    crc32c_shift_short: .quad 0xDD7E3B0C, 0xB9E02B86
+
+    // Long lengths, checked against the serial version (0-terminated)
+    .align 3
+    verify_lengths: .quad 3*CRC_SHORT, 3*CRC_SHORT + 13, 2*3*CRC_SHORT + 7
+                    .quad 3*CRC_LONG + 3*CRC_SHORT + 8*5 + 7
+                    .quad VERIFY_BYTES - 16, 0
+
+    check_string:   .ascii "123456789"
+    .equ check_len, . - check_string
+
+    verify_ok_msg:  .ascii "CRC32CX 3-way CRC-32C matches the reference\n"
+    .equ verify_ok_len, . - verify_ok_msg
+    verify_bad_msg: .ascii "CRC32CX 3-way CRC-32C MISMATCH\n"
+    .equ verify_bad_len, . - verify_bad_msg
+
+.section .bss
+    .align 6
+    verify_src:     .skip   VERIFY_BYTES
+    verify_dst:     .skip   VERIFY_BYTES + 16
+
+.section .text
+
+_start:
+    bl      verify_crc32c
+    mov     x19, x0
+
+    ldr     x1, =verify_ok_msg
+    mov     x2, #verify_ok_len
+    cbz     x19, 1f
+    ldr     x1, =verify_bad_msg
+    mov     x2, #verify_bad_len
+1:
+    mov     x0, #1
+    mov     x8, #SYS_WRITE
+    svc     #0
+
+    // Exit with 1 on mismatch
+    mov     x0, x19
+    mov     x8, #SYS_EXIT
+    svc     #0
+
+// ============================================================================
+// SHARED PIECES
+// ============================================================================
+//
+// Register use inside the kernels: W0 = crc register, X1 = source,
+// X2 = length, X7 = destination (copy only); X3-X6, X9-X14, V0-V3 scratch.
+//
+
+// 3-way blocks of 3 * n bytes while they fit, then merged:
+//   crc = CRC32CX(0, A * x^(16n-33) ^ B * x^(8n-33)) ^ C
+// With copy = 1 each block is then copied out of L1, where the checksum
+// loop has just left it.
+.macro CRC32C_3WAY n, shift, copy
+    cmp     x2, #(3 * \n)
+    b.lo    4f
+    ldr     x14, =\shift
+1:
+    mov     w9, wzr                 // Stream B
+    mov     w10, wzr                // Stream C
+    add     x11, x1, #\n
+    add     x12, x1, #(2 * \n)
+    mov     x13, #\n
+2:
+    ldp     x3, x4, [x1], #16
+    ldp     x5, x6, [x11], #16
+    crc32cx w0, w0, x3
+    crc32cx w9, w9, x5
+    ldp     x3, x5, [x12], #16
+    crc32cx w10, w10, x3
+    crc32cx w0, w0, x4
+    crc32cx w9, w9, x6
+    crc32cx w10, w10, x5
+    subs    x13, x13, #16
+    b.ne    2b
+
+    fmov    s0, w0
+    fmov    s1, w9
+    ldp     d2, d3, [x14]
+    pmull   v0.1q, v0.1d, v2.1d
+    pmull   v1.1q, v1.1d, v3.1d
+    eor     v0.16b, v0.16b, v1.16b
+    fmov    x3, d0
+    crc32cx w0, wzr, x3
+    eor     w0, w0, w10
+
+.if \copy
+    sub     x11, x1, #\n            // Start of the block
+    mov     x13, #(3 * \n)
+3:
+    ldp     q0, q1, [x11], #32
+    ldp     q2, q3, [x11], #32
+    stp     q0, q1, [x7], #32
+    stp     q2, q3, [x7], #32
+    subs    x13, x13, #64
+    b.ne    3b
+.endif
+    mov     x1, x12                 // End of stream C = end of the block
+    sub     x2, x2, #(3 * \n)
+    cmp     x2, #(3 * \n)
+    b.hs    1b
+4:
+.endm
+
+// Everything after the 3-way blocks: 8 bytes per CRC32CX, then one
+// 4-, 2- and 1-byte step picked by the bits of the remaining length
+.macro CRC32C_TAIL copy
+    cmp     x2, #8
+    b.lo    2f
+1:
+    ldr     x3, [x1], #8
+    crc32cx w0, w0, x3
+.if \copy
+    str     x3, [x7], #8
+.endif
+    sub     x2, x2, #8
+    cmp     x2, #8
+    b.hs    1b
+2:
+    tbz     x2, #2, 3f
+    ldr     w3, [x1], #4
+    crc32cw w0, w0, w3
+.if \copy
+    str     w3, [x7], #4
+.endif
+3:
+    tbz     x2, #1, 4f
+    ldrh    w3, [x1], #2
+    crc32ch w0, w0, w3
+.if \copy
+    strh    w3, [x7], #2
+.endif
+4:
+    tbz     x2, #0, 5f
+    ldrb    w3, [x1], #1
+    crc32cb w0, w0, w3
+.if \copy
+    strb    w3, [x7], #1
+.endif
+5:
+.endm
+
+// ============================================================================
+// FUNCTION: crc32c_arm64
+// Description: CRC-32C of a buffer, three CRC32CX streams at a time
+// Arguments: W0 = crc (0 to start), X1 = buffer, X2 = length
+// Returns: W0 = updated crc
+// ============================================================================
+crc32c_arm64:
+    mvn     w0, w0
+
+    // Bytes up to an 8-byte boundary, so no load splits a cache line
+1:
+    tst     x1, #7
+    b.eq    2f
+    cbz     x2, 3f
+    ldrb    w3, [x1], #1
+    crc32cb w0, w0, w3
+    sub     x2, x2, #1
+    b       1b
+2:
+    CRC32C_3WAY CRC_LONG, crc32c_shift_long, 0
+    CRC32C_3WAY CRC_SHORT, crc32c_shift_short, 0
+    CRC32C_TAIL 0
+3:
+    mvn     w0, w0
+    ret
+
+// ============================================================================
+// FUNCTION: crc32c_serial_arm64
+// Description: CRC-32C of a buffer with one dependent CRC32CX chain
+// Arguments: W0 = crc (0 to start), X1 = buffer, X2 = length
+// Returns: W0 = updated crc
+// ============================================================================
+crc32c_serial_arm64:
+    mvn     w0, w0
+    CRC32C_TAIL 0
+    mvn     w0, w0
+    ret
+
+// ============================================================================
+// FUNCTION: crc32c_copy_arm64
+// Description: Copy a buffer and return the CRC-32C of the bytes copied
+// Arguments: W0 = crc (0 to start), X1 = destination, X2 = source,
+//            X3 = length
+// Returns: W0 = updated crc
+// ============================================================================
+crc32c_copy_arm64:
+    mvn     w0, w0
+    mov     x7, x1                  // X7 = destination
+    mov     x1, x2                  // X1 = source
+    mov     x2, x3                  // X2 = length
+    CRC32C_3WAY CRC_LONG, crc32c_shift_long, 1
+    CRC32C_3WAY CRC_SHORT, crc32c_shift_short, 1
+    CRC32C_TAIL 1
+    mvn     w0, w0
+    ret
+
+// ============================================================================
+// SELF-CHECK
+// ============================================================================
+//
+// crc32c_ref computes the CRC one bit at a time, with no CRC instruction.
+// Every length 0..VERIFY_MAX_N (at offsets 0-7) is checked against it,
+// plus the standard check value for "123456789". Longer lengths run
+// through the long and short 3-way blocks and are checked against the
+// serial version. Copies must reproduce the source and stop at its end.
+// ============================================================================
+
+// crc32c_ref: W0 = crc, X1 = buffer, X2 = length -> W0
+crc32c_ref:
+    mvn     w0, w0
+    ldr     w9, =CRC32C_POLY
+    cbz     x2, 3f
+1:
+    ldrb    w3, [x1], #1
+    eor     w0, w0, w3
+    mov     x4, #8
+2:
+    and     w5, w0, #1
+    neg     w5, w5                  // All ones if the low bit is set
+    and     w5, w5, w9
+    eor     w0, w5, w0, lsr #1
+    subs    x4, x4, #1
+    b.ne    2b
+    subs    x2, x2, #1
+    b.ne    1b
+3:
+    mvn     w0, w0
+    ret
+
+// verify_one: X19 = source, X20 = length, X21 = reference function
+// -> X0 = 0 if crc32c_arm64 and crc32c_copy_arm64 agree with it
+verify_one:
+    stp     x29, x30, [sp, #-48]!
+    mov     x29, sp
+    stp     x22, x23, [sp, #16]
+    str     x24, [sp, #32]
+
+    mul     w22, w20, w20           // Some non-zero starting crc
+    mov     w0, w22
+    mov     x1, x19
+    mov     x2, x20
+    blr     x21
+    mov     w23, w0                 // Expected
+
+    mov     w0, w22
+    mov     x1, x19
+    mov     x2, x20
+    bl      crc32c_arm64
+    cmp     w0, w23
+    b.ne    2f
+
+    // Copy to the opposite alignment, guard byte after the end
+    ldr     x24, =verify_dst
+    mvn     x9, x20
+    and     x9, x9, #7
+    add     x24, x24, x9
+    mov     w9, #VERIFY_GUARD
+    strb    w9, [x24, x20]
+    mov     w0, w22
+    mov     x1, x24
+    mov     x2, x19
+    mov     x3, x20
+    bl      crc32c_copy_arm64
+    cmp     w0, w23
+    b.ne    2f
+    ldrb    w9, [x24, x20]
+    cmp     w9, #VERIFY_GUARD
+    b.ne    2f
+    mov     x9, #0
+1:
+    cmp     x9, x20
+    b.hs    3f
+    ldrb    w10, [x19, x9]
+    ldrb    w11, [x24, x9]
+    add     x9, x9, #1
+    cmp     w10, w11
+    b.eq    1b
+2:
+    mov     x0, #1
+    b       4f
+3:
+    mov     x0, #0
+4:
+    ldp     x22, x23, [sp, #16]
+    ldr     x24, [sp, #32]
+    ldp     x29, x30, [sp], #48
+    ret
+
+// verify_crc32c -> X0 = 0 if everything matches
+verify_crc32c:
+    stp     x29, x30, [sp, #-64]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    stp     x21, x22, [sp, #32]
+    str     x23, [sp, #48]
+
+    // Fill the source with xorshift32 noise
+    ldr     x9, =verify_src
+    mov     x10, #VERIFY_BYTES / 4
+    ldr     w11, =0x9E3779B9
+1:
+    eor     w11, w11, w11, lsl #13
+    eor     w11, w11, w11, lsr #17
+    eor     w11, w11, w11, lsl #5
+    str     w11, [x9], #4
+    subs    x10, x10, #1
+    b.ne    1b
+
+    // The check value of every version
+    mov     x22, #0
+    ldr     x21, =crc32c_ref
+2:
+    mov     w0, #0
+    ldr     x1, =check_string
+    mov     x2, #check_len
+    blr     x21
+    ldr     w9, =0xE3069283
+    cmp     w0, w9
+    cset    x9, ne
+    orr     x22, x22, x9
+    ldr     x9, =crc32c_ref
+    cmp     x21, x9
+    ldr     x21, =crc32c_serial_arm64
+    b.eq    2b
+    mov     w0, #0
+    ldr     x1, =check_string
+    mov     x2, #check_len
+    bl      crc32c_arm64
+    ldr     w9, =0xE3069283
+    cmp     w0, w9
+    cset    x9, ne
+    orr     x22, x22, x9
+
+    // Short lengths against the bitwise reference
+    ldr     x21, =crc32c_ref
+    mov     x20, #0
+3:
+    ldr     x19, =verify_src
+    and     x9, x20, #7
+    add     x19, x19, x9
+    bl      verify_one
+    orr     x22, x22, x0
+    add     x20, x20, #1
+    cmp     x20, #VERIFY_MAX_N
+    b.ls    3b
+
+    // Long lengths against the serial CRC32CX loop
+    ldr     x21, =crc32c_serial_arm64
+    ldr     x23, =verify_lengths
+4:
+    ldr     x20, [x23], #8
+    cbz     x20, 5f
+    ldr     x19, =verify_src
+    and     x9, x20, #7
+    add     x19, x19, x9
+    bl      verify_one
+    orr     x22, x22, x0
+    b       4b
+5:
+    mov     x0, x22
+    ldp     x19, x20, [sp, #16]
+    ldp     x21, x22, [sp, #32]
+    ldr     x23, [sp, #48]
+    ldp     x29, x30, [sp], #64
+    ret
+
+// ============================================================================
+// NOTES: CRC-32C on ARM64
+// ============================================================================
+//
+// Latency versus throughput:
+//   CRC32CX has a latency of 2-3 cycles and a throughput of one per cycle
+//   on Cortex-A7x and Neoverse cores, so a single chain leaves most of the
+//   unit idle. Three streams keep it busy; LDP brings in 16 bytes of each
+//   stream per load, so 3 loads feed 6 CRC32CX.
+//
+// The merge:
+//   PMULL multiplies the two 32-bit stream results by x^k constants in one
+//   instruction each; their XOR, run through one CRC32CX with a zero crc,
+//   is reduced mod P. The constants are shared with the x86-64 version
+//   because both instructions compute exactly the same function.
+//
+// Tails with tbz:
+//   After the 8-byte loop fewer than 8 bytes remain, so bits 2, 1 and 0
+//   of the length say whether a 4-, 2- and 1-byte step is needed - at most
+//   three steps and no loop.
+//
+// Fused copy:
+//   Each 24 KiB block is checksummed from memory, then copied from L1 with
+//   LDP/STP of Q registers, so the source crosses the memory bus once.
+//
+// ============================================================================
@@ -0,0 +1,810 @@
+// ============================================================================
+// File: 09_ascii_arm64.s
+// Description: Branch-free ASCII transforms for ARM64 NEON: case mapping,
+//              case-insensitive compare, class bitmaps, table translation
+// Topics: unsigned range compare, CMTST, TBL/TBX table lookups, SHRN masks,
+//         ADDP bitmap packing, overlapping tails
+// Assembler: GNU as (gas)
+// Build: as -o 09_ascii_arm64.o 09_ascii_arm64.s
+//        ld -o 09_ascii_arm64 09_ascii_arm64.o
+// Run: ./09_ascii_arm64   (checks against byte-at-a-time references)
+// ============================================================================
+//
+// The ARM64 counterparts of the ascii_*_avx2 routines in
+// x86_64/05_strings_and_arrays.asm, with the same arguments and results:
+//
+//   ascii_toupper_neon   'a'-'z' -> 'A'-'Z', every other byte unchanged
+//   ascii_tolower_neon   'A'-'Z' -> 'a'-'z'
+//   ascii_casecmp_neon   Compare as if both strings were lower case
+//   ascii_classify_neon  Digit / letter / space bitmaps, 1 bit per byte
+//   ascii_translate_neon dst[i] = table[src[i]] for any 256-byte table
+//
+// Arguments (AAPCS64):
+//   toupper / tolower: X0 = destination, X1 = source, X2 = length -> X0
+//   casecmp:  X0 = a, X1 = b, X2 = length
+//             -> X0 = tolower(a[i]) - tolower(b[i]) at the first i where
+//                they differ, 0 if none
+//   classify: X0 = source, X1 = length, X2 = digit map, X3 = letter map,
+//             X4 = space map (each (length + 31) / 32 words; bit i of the
+//             maps describes byte i, bits past the end are 0)
+//   translate: X0 = destination, X1 = source, X2 = length, X3 = table -> X0
+//
+// Destination and source may be the same buffer but must not otherwise
+// overlap. Classes are those of the C locale: '0'-'9', 'A'-'Z' and 'a'-'z',
+// and ' ' \t \n \v \f \r.
+// ============================================================================
+
+.arch armv8-a
+
+.global _start
+.global ascii_toupper_neon
+.global ascii_tolower_neon
+.global ascii_casecmp_neon
+.global ascii_classify_neon
+.global ascii_translate_neon
+
+.equ SYS_WRITE, 64
+.equ SYS_EXIT,  93
+
+.equ ASCII_DIGIT,   0x01            // Class bits of ascii_class_lo/hi
+.equ ASCII_ALPHA,   0x06
+.equ ASCII_SPACE,   0x18
+
+.equ VERIFY_MAX_N,  72              // Lengths 0..VERIFY_MAX_N, then the list
+.equ VERIFY_BYTES,  320
+.equ VERIFY_MAP_WORDS, VERIFY_BYTES / 32 + 1
+.equ VERIFY_GUARD,  0xEE            // Bytes after the end of a result
+
+.section .data
+    // Class bits by low nibble and by high nibble: a byte is in a class
+    // if both of its entries have the bit (0x02 = letters @-O / `-o,
+    // 0x04 = P-Z / p-z, 0x08 = \t-\r, 0x10 = ' ')
+    .align 4
+    ascii_class_lo: .byte 0x15, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07
+                    .byte 0x07, 0x0F, 0x0E, 0x0A, 0x0A, 0x0A, 0x02, 0x02
+    ascii_class_hi: .byte 0x08, 0x00, 0x10, 0x01, 0x02, 0x04, 0x02, 0x04
+                    .byte 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    // Bit weights that turn 0x00/0xFF bytes into mask bits (see NOTES)
+    ascii_bit_weights: .byte 1, 2, 4, 8, 16, 32, 64, 128
+                       .byte 1, 2, 4, 8, 16, 32, 64, 128
+
+    // Long lengths, after 0..VERIFY_MAX_N (0-terminated)
+    .align 3
+    verify_lengths: .quad 127, 200, 256, VERIFY_BYTES - 8, 0
+
+    // Transforms checked by verify_one: NEON routine, reference
+    verify_pairs:   .quad ascii_toupper_neon, toupper_ref
+                    .quad ascii_tolower_neon, tolower_ref
+                    .quad ascii_translate_neon, translate_ref
+                    .quad 0
+
+    verify_ok_msg:  .ascii "NEON ASCII transforms match the byte loops\n"
+    .equ verify_ok_len, . - verify_ok_msg
+    verify_bad_msg: .ascii "NEON ASCII transforms MISMATCH\n"
+    .equ verify_bad_len, . - verify_bad_msg
+
+.section .bss
+    .align 6
+    verify_src:     .skip   VERIFY_BYTES
+    verify_b:       .skip   VERIFY_BYTES        // Second casecmp operand
+    verify_dst:     .skip   VERIFY_BYTES + 16
+    verify_ref:     .skip   VERIFY_BYTES + 16
+    verify_table:   .skip   256
+    verify_maps:    .skip   3 * 4 * VERIFY_MAP_WORDS
+    verify_ref_maps: .skip  3 * 4 * VERIFY_MAP_WORDS
+
+.section .text
+
+_start:
+    bl      verify_ascii
+    mov     x19, x0
+    ldr     x1, =verify_ok_msg
+    mov     x2, #verify_ok_len
+    cbz     x19, 1f
+    ldr     x1, =verify_bad_msg
+    mov     x2, #verify_bad_len
+1:
+    mov     x0, #1
+    mov     x8, #SYS_WRITE
+    svc     #0
+
+    // Exit with 1 on mismatch
+    mov     x0, x19
+    mov     x8, #SYS_EXIT
+    svc     #0
+
+// ============================================================================
+// CASE MAPPING
+// ============================================================================
+//
+// Subtracting the first letter moves the 26 letters to flip to 0..25, so
+// one unsigned compare (CMHI 26 > x) marks them with no second bound;
+// AND with 0x20 and EOR clears (or, from 'A', sets) the case bit.
+//
+// Register use: V5 = first letter, V6 = 26, V7 = 0x20, W12 = first letter.
+// ============================================================================
+
+// CASE_FLIP data, temp (full arrangements, e.g. v0.16b, v2.16b)
+.macro CASE_FLIP v, t
+    sub     \t, \v, v5.16b
+    cmhi    \t, v6.16b, \t          // 0xFF for letters of the case to flip
+    and     \t, \t, v7.16b
+    eor     \v, \v, \t
+.endm
+
+// ============================================================================
+// FUNCTION: ascii_toupper_neon / ascii_tolower_neon
+// Description: Copy a string with its letters mapped to one case
+// Arguments: X0 = destination, X1 = source, X2 = length
+// Returns: X0 = destination
+//
+// 32 bytes per iteration. The last 1-31 bytes end with one 16-byte block
+// that finishes exactly at the end, overlapping bytes already done:
+// mapping a byte twice gives the same result, even in place. Under 16
+// bytes the same arithmetic runs on one byte at a time.
+// ============================================================================
+ascii_toupper_neon:
+    mov     w12, #'a'
+    b       1f
+ascii_tolower_neon:
+    mov     w12, #'A'
+1:
+    dup     v5.16b, w12
+    movi    v6.16b, #26
+    movi    v7.16b, #0x20
+    mov     x9, x1                  // X9 = source, X10 = destination
+    mov     x10, x0
+    cmp     x2, #16
+    b.lo    5f
+    subs    x11, x2, #32
+    b.lo    3f
+2:
+    ldp     q0, q1, [x9], #32
+    CASE_FLIP v0.16b, v2.16b
+    CASE_FLIP v1.16b, v3.16b
+    stp     q0, q1, [x10], #32
+    subs    x11, x11, #32
+    b.hs    2b
+3:
+    tbz     x11, #4, 4f             // 16 or more left
+    ldr     q0, [x9], #16
+    CASE_FLIP v0.16b, v2.16b
+    str     q0, [x10], #16
+4:
+    ands    x11, x11, #15
+    b.eq    7f
+    add     x9, x1, x2              // Last 16 bytes
+    add     x10, x0, x2
+    ldur    q0, [x9, #-16]
+    CASE_FLIP v0.16b, v2.16b
+    stur    q0, [x10, #-16]
+    b       7f
+5:
+    cbz     x2, 7f
+    mov     x11, x2
+6:
+    ldrb    w3, [x9], #1
+    sub     w4, w3, w12
+    cmp     w4, #26
+    eor     w4, w3, #0x20
+    csel    w3, w4, w3, lo
+    strb    w3, [x10], #1
+    subs    x11, x11, #1
+    b.ne    6b
+7:
+    ret
+
+// ============================================================================
+// FUNCTION: ascii_casecmp_neon
+// Description: Case-insensitive comparison of two equal-length strings
+// Arguments: X0 = a, X1 = b, X2 = length
+// Returns: X0 = tolower(a[i]) - tolower(b[i]) at the first difference,
+//          0 if the strings match
+//
+// Both blocks are lowered and compared with CMEQ. SHRN #4 narrows the
+// 16 compare bytes to one 64-bit value with 4 bits per byte, so a single
+// GPR test finds a differing block and RBIT + CLZ gives its first byte.
+// ============================================================================
+ascii_casecmp_neon:
+    movi    v5.16b, #'A'
+    movi    v6.16b, #26
+    movi    v7.16b, #0x20
+    mov     x9, #0                  // X9 = offset of the current block
+    cmp     x2, #16
+    b.lo    4f
+    sub     x10, x2, #16            // Offset of the last block
+1:
+    ldr     q0, [x0, x9]
+    ldr     q1, [x1, x9]
+    CASE_FLIP v0.16b, v2.16b
+    CASE_FLIP v1.16b, v3.16b
+    cmeq    v0.16b, v0.16b, v1.16b
+    shrn    v0.8b, v0.8h, #4        // 4 bits per byte
+    fmov    x11, d0
+    mvn     x11, x11
+    cbnz    x11, 3f
+    cmp     x9, x10
+    b.eq    6f                      // That was the last block
+    add     x9, x9, #16
+    cmp     x9, x10
+    csel    x9, x9, x10, lo         // Overlapping last block
+    b       1b
+3:
+    rbit    x11, x11
+    clz     x11, x11
+    add     x9, x9, x11, lsr #2     // First differing byte
+    add     x2, x9, #1
+4:
+    // Bytes X9 .. X2 - 1, one at a time
+    cmp     x9, x2
+    b.hs    6f
+    ldrb    w3, [x0, x9]
+    ldrb    w4, [x1, x9]
+    add     x9, x9, #1
+    sub     w5, w3, #'A'
+    cmp     w5, #26
+    orr     w5, w3, #0x20
+    csel    w3, w5, w3, lo
+    sub     w5, w4, #'A'
+    cmp     w5, #26
+    orr     w5, w4, #0x20
+    csel    w4, w5, w4, lo
+    subs    x3, x3, x4
+    b.eq    4b
+    mov     x0, x3
+    ret
+6:
+    mov     x0, #0
+    ret
+
+// ============================================================================
+// FUNCTION: ascii_classify_neon
+// Description: Character-class bitmaps: bit i of a map describes byte i
+// Arguments: X0 = source, X1 = length, X2 = digit map, X3 = letter map,
+//            X4 = space map
+// Returns: nothing
+//
+// Two TBL lookups classify all three classes at once, one indexed by the
+// low nibble and one by the high nibble (bytes >= 0x80 have high-nibble
+// entries of 0). CMTST turns each class into 0x00/0xFF bytes, and ADDP
+// packs 32 of those into one map word (see NOTES). A partial last block
+// is classified from a zero-padded copy on the stack: 0 is in no class.
+// ============================================================================
+
+// CLASSIFY_BLOCK: classify the 32 bytes in V0/V1, store one word per map
+.macro CLASSIFY_BLOCK
+    ushr    v2.16b, v0.16b, #4
+    ushr    v3.16b, v1.16b, #4
+    and     v0.16b, v0.16b, v19.16b
+    and     v1.16b, v1.16b, v19.16b
+    tbl     v0.16b, {v16.16b}, v0.16b
+    tbl     v1.16b, {v16.16b}, v1.16b
+    tbl     v2.16b, {v17.16b}, v2.16b
+    tbl     v3.16b, {v17.16b}, v3.16b
+    and     v0.16b, v0.16b, v2.16b  // Class bits of every byte
+    and     v1.16b, v1.16b, v3.16b
+    cmtst   v2.16b, v0.16b, v20.16b // Digits
+    cmtst   v3.16b, v1.16b, v20.16b
+    cmtst   v4.16b, v0.16b, v21.16b // Letters
+    cmtst   v5.16b, v1.16b, v21.16b
+    cmtst   v6.16b, v0.16b, v22.16b // Spaces
+    cmtst   v7.16b, v1.16b, v22.16b
+    and     v2.16b, v2.16b, v18.16b
+    and     v3.16b, v3.16b, v18.16b
+    and     v4.16b, v4.16b, v18.16b
+    and     v5.16b, v5.16b, v18.16b
+    and     v6.16b, v6.16b, v18.16b
+    and     v7.16b, v7.16b, v18.16b
+    addp    v2.16b, v2.16b, v3.16b
+    addp    v4.16b, v4.16b, v5.16b
+    addp    v6.16b, v6.16b, v7.16b
+    addp    v2.16b, v2.16b, v4.16b
+    addp    v6.16b, v6.16b, v6.16b
+    addp    v2.16b, v2.16b, v6.16b  // Words: digits, letters, spaces
+    st1     {v2.s}[0], [x2], #4
+    st1     {v2.s}[1], [x3], #4
+    st1     {v2.s}[2], [x4], #4
+.endm
+
+ascii_classify_neon:
+    ldr     x9, =ascii_class_lo
+    ldp     q16, q17, [x9]          // V16 = low-nibble, V17 = high-nibble
+    ldr     q18, [x9, #32]          // V18 = bit weights
+    movi    v19.16b, #0x0F
+    movi    v20.16b, #ASCII_DIGIT
+    movi    v21.16b, #ASCII_ALPHA
+    movi    v22.16b, #ASCII_SPACE
+    subs    x1, x1, #32
+    b.lo    2f
+1:
+    ldp     q0, q1, [x0], #32
+    CLASSIFY_BLOCK
+    subs    x1, x1, #32
+    b.hs    1b
+2:
+    ands    x1, x1, #31
+    b.eq    4f
+    stp     xzr, xzr, [sp, #-32]!
+    stp     xzr, xzr, [sp, #16]
+    mov     x9, sp
+3:
+    ldrb    w10, [x0], #1
+    strb    w10, [x9], #1
+    subs    x1, x1, #1
+    b.ne    3b
+    ldp     q0, q1, [sp], #32
+    CLASSIFY_BLOCK
+4:
+    ret
+
+// ============================================================================
+// FUNCTION: ascii_translate_neon
+// Description: Map every byte through a 256-byte table
+// Arguments: X0 = destination, X1 = source, X2 = length, X3 = table
+// Returns: X0 = destination
+//
+// The table lives in V16-V31. TBL with four registers looks up a 64-byte
+// slice and gives 0 for indexes past it; TBX does the same but leaves
+// those bytes alone. So TBL on the first slice, then TBX on the other
+// three with 64 subtracted from the index each time, translates every
+// byte - indexes below the slice wrap to 192-255 and miss it.
+//
+// Translating twice is not the same as translating once, so the last
+// 16 bytes (which overlap earlier ones) are translated first and stored
+// last. Under 16 bytes the table is read a byte at a time.
+// ============================================================================
+
+// TRANSLATE data, temp index (full arrangements)
+.macro TRANSLATE v, t
+    sub     \t, \v, v6.16b
+    tbl     \v, {v16.16b - v19.16b}, \v
+    tbx     \v, {v20.16b - v23.16b}, \t
+    sub     \t, \t, v6.16b
+    tbx     \v, {v24.16b - v27.16b}, \t
+    sub     \t, \t, v6.16b
+    tbx     \v, {v28.16b - v31.16b}, \t
+.endm
+
+ascii_translate_neon:
+    mov     x9, x1                  // X9 = source, X10 = destination
+    mov     x10, x0
+    cmp     x2, #16
+    b.lo    5f
+    mov     x11, x3
+    ld1     {v16.16b - v19.16b}, [x11], #64
+    ld1     {v20.16b - v23.16b}, [x11], #64
+    ld1     {v24.16b - v27.16b}, [x11], #64
+    ld1     {v28.16b - v31.16b}, [x11]
+    movi    v6.16b, #64
+    add     x12, x1, x2
+    ldur    q4, [x12, #-16]         // Last 16 bytes, done first
+    TRANSLATE v4.16b, v5.16b
+    subs    x11, x2, #32
+    b.lo    3f
+2:
+    ldp     q0, q1, [x9], #32
+    TRANSLATE v0.16b, v2.16b
+    TRANSLATE v1.16b, v3.16b
+    stp     q0, q1, [x10], #32
+    subs    x11, x11, #32
+    b.hs    2b
+3:
+    tbz     x11, #4, 4f             // 16 or more left
+    ldr     q0, [x9], #16
+    TRANSLATE v0.16b, v2.16b
+    str     q0, [x10], #16
+4:
+    add     x12, x0, x2
+    stur    q4, [x12, #-16]
+    ret
+5:
+    cbz     x2, 7f
+    mov     x11, x2
+6:
+    ldrb    w12, [x9], #1
+    ldrb    w12, [x3, x12]
+    strb    w12, [x10], #1
+    subs    x11, x11, #1
+    b.ne    6b
+7:
+    ret
+
+// ============================================================================
+// SELF-CHECK
+// ============================================================================
+//
+// The references work a byte at a time with compares and branches, the
+// way the scalar uppercase loop in x86_64/05_strings_and_arrays.asm does.
+// Every length 0..VERIFY_MAX_N (at offsets 0-7) and the longer ones in
+// verify_lengths go through each routine: out of place and in place with
+// a guard byte after the end, casecmp with one byte changed every 7th
+// position (both argument orders), classify with guard words after each
+// map. The source is a permutation of all 256 byte values.
+// ============================================================================
+
+// toupper_ref / tolower_ref / translate_ref: X0 = dst, X1 = src, X2 = len,
+// X3 = table (translate only)
+toupper_ref:
+    mov     w12, #'a'
+    b       1f
+tolower_ref:
+    mov     w12, #'A'
+1:
+    cbz     x2, 3f
+    mov     x9, #0
+2:
+    ldrb    w10, [x1, x9]
+    cmp     w10, w12
+    b.lo    21f
+    add     w11, w12, #25
+    cmp     w10, w11
+    b.hi    21f
+    eor     w10, w10, #0x20
+21:
+    strb    w10, [x0, x9]
+    add     x9, x9, #1
+    cmp     x9, x2
+    b.lo    2b
+3:
+    ret
+
+translate_ref:
+    cbz     x2, 2f
+    mov     x9, #0
+1:
+    ldrb    w10, [x1, x9]
+    ldrb    w10, [x3, x10]
+    strb    w10, [x0, x9]
+    add     x9, x9, #1
+    cmp     x9, x2
+    b.lo    1b
+2:
+    ret
+
+// lower_ref: W10 = byte -> W10 = tolower(byte)
+lower_ref:
+    cmp     w10, #'A'
+    b.lo    1f
+    cmp     w10, #'Z'
+    b.hi    1f
+    orr     w10, w10, #0x20
+1:
+    ret
+
+// casecmp_ref: X0 = a, X1 = b, X2 = len -> X0
+casecmp_ref:
+    stp     x29, x30, [sp, #-16]!
+    mov     x29, sp
+    mov     x13, x0
+    mov     x9, #0
+1:
+    cmp     x9, x2
+    b.hs    2f
+    ldrb    w10, [x13, x9]
+    bl      lower_ref
+    mov     w14, w10
+    ldrb    w10, [x1, x9]
+    bl      lower_ref
+    add     x9, x9, #1
+    subs    x0, x14, x10
+    b.eq    1b
+    b       3f
+2:
+    mov     x0, #0
+3:
+    ldp     x29, x30, [sp], #16
+    ret
+
+// classify_ref: same arguments as ascii_classify_neon
+classify_ref:
+    mov     x9, #0
+1:
+    cmp     x9, x1
+    b.hs    6f
+    ldrb    w10, [x0, x9]
+    and     x11, x9, #31
+    mov     w12, #1
+    lsl     w12, w12, w11           // Bit of this byte in its word
+    lsr     x11, x9, #5
+    lsl     x11, x11, #2            // Offset of its word
+    tst     x9, #31
+    b.ne    2f
+    str     wzr, [x2, x11]          // New word: clear all three
+    str     wzr, [x3, x11]
+    str     wzr, [x4, x11]
+2:
+    mov     x13, x2
+    cmp     w10, #'0'
+    b.lo    3f
+    cmp     w10, #'9'
+    b.ls    5f
+3:
+    mov     x13, x3
+    orr     w14, w10, #0x20
+    cmp     w14, #'a'
+    b.lo    4f
+    cmp     w14, #'z'
+    b.ls    5f
+4:
+    mov     x13, x4
+    cmp     w10, #' '
+    b.eq    5f
+    cmp     w10, #'\t'
+    b.lo    51f
+    cmp     w10, #'\r'
+    b.hi    51f
+5:
+    ldr     w14, [x13, x11]
+    orr     w14, w14, w12
+    str     w14, [x13, x11]
+51:
+    add     x9, x9, #1
+    b       1b
+6:
+    ret
+
+// compare_bytes: X0 = a, X1 = b, X2 = len -> X0 = 0 if equal
+compare_bytes:
+    cbz     x2, 2f
+1:
+    ldrb    w9, [x0], #1
+    ldrb    w10, [x1], #1
+    cmp     w9, w10
+    b.ne    3f
+    subs    x2, x2, #1
+    b.ne    1b
+2:
+    mov     x0, #0
+    ret
+3:
+    mov     x0, #1
+    ret
+
+// copy_bytes: X0 = dst, X1 = src, X2 = len
+copy_bytes:
+    cbz     x2, 2f
+1:
+    ldrb    w9, [x1], #1
+    strb    w9, [x0], #1
+    subs    x2, x2, #1
+    b.ne    1b
+2:
+    ret
+
+// fill_bytes: X0 = dst, W1 = byte, X2 = len
+fill_bytes:
+    cbz     x2, 2f
+1:
+    strb    w1, [x0], #1
+    subs    x2, x2, #1
+    b.ne    1b
+2:
+    ret
+
+// verify_one: X19 = source, X20 = length -> X0 = 0 if all routines agree
+// with the references
+verify_one:
+    stp     x29, x30, [sp, #-64]!
+    mov     x29, sp
+    stp     x21, x22, [sp, #16]
+    stp     x23, x24, [sp, #32]
+    mov     x22, #0
+    ldr     x21, =verify_pairs
+1:
+    // Out of place, guard byte after both results
+    ldr     x23, [x21], #16
+    cbz     x23, 3f
+    ldr     x0, =verify_dst
+    mov     w9, #VERIFY_GUARD
+    strb    w9, [x0, x20]
+    ldr     x0, =verify_ref
+    strb    w9, [x0, x20]
+    mov     x1, x19
+    mov     x2, x20
+    ldr     x3, =verify_table
+    ldur    x9, [x21, #-8]
+    blr     x9
+    ldr     x0, =verify_dst
+    mov     x1, x19
+    mov     x2, x20
+    ldr     x3, =verify_table
+    blr     x23
+    ldr     x9, =verify_dst
+    cmp     x0, x9                  // Returns the destination
+    cset    x9, ne
+    orr     x22, x22, x9
+    ldr     x0, =verify_dst
+    ldr     x1, =verify_ref
+    add     x2, x20, #1
+    bl      compare_bytes
+    orr     x22, x22, x0
+
+    // In place
+    ldr     x0, =verify_dst
+    mov     x1, x19
+    mov     x2, x20
+    bl      copy_bytes
+    ldr     x0, =verify_dst
+    mov     x1, x0
+    mov     x2, x20
+    ldr     x3, =verify_table
+    blr     x23
+    ldr     x0, =verify_dst
+    ldr     x1, =verify_ref
+    add     x2, x20, #1
+    bl      compare_bytes
+    orr     x22, x22, x0
+    b       1b
+3:
+    // casecmp: B is the source in upper case, then one byte changed at a
+    // time
+    ldr     x0, =verify_b
+    mov     x1, x19
+    mov     x2, x20
+    bl      toupper_ref
+    mov     x23, #-1                // X23 = changed position, if any
+4:
+    mov     x0, x19
+    ldr     x1, =verify_b
+    mov     x2, x20
+    bl      casecmp_ref
+    mov     x24, x0
+    mov     x0, x19
+    ldr     x1, =verify_b
+    mov     x2, x20
+    bl      ascii_casecmp_neon
+    cmp     x0, x24
+    cset    x9, ne
+    orr     x22, x22, x9
+    ldr     x0, =verify_b
+    mov     x1, x19
+    mov     x2, x20
+    bl      casecmp_ref
+    mov     x24, x0
+    ldr     x0, =verify_b
+    mov     x1, x19
+    mov     x2, x20
+    bl      ascii_casecmp_neon
+    cmp     x0, x24
+    cset    x9, ne
+    orr     x22, x22, x9
+    ldr     x9, =verify_b
+    tbz     x23, #63, 41f
+    mov     x23, #0
+    b       42f
+41:
+    ldrb    w10, [x9, x23]          // Undo the last change
+    sub     w10, w10, #1
+    strb    w10, [x9, x23]
+    add     x23, x23, #7
+42:
+    cmp     x23, x20
+    b.hs    5f
+    ldrb    w10, [x9, x23]
+    add     w10, w10, #1
+    strb    w10, [x9, x23]
+    b       4b
+5:
+    // classify: guard words after every map
+    ldr     x0, =verify_maps
+    mov     w1, #VERIFY_GUARD
+    mov     x2, #(3 * 4 * VERIFY_MAP_WORDS)
+    bl      fill_bytes
+    ldr     x0, =verify_ref_maps
+    mov     w1, #VERIFY_GUARD
+    mov     x2, #(3 * 4 * VERIFY_MAP_WORDS)
+    bl      fill_bytes
+    mov     x0, x19
+    mov     x1, x20
+    ldr     x2, =verify_ref_maps
+    add     x3, x2, #(4 * VERIFY_MAP_WORDS)
+    add     x4, x3, #(4 * VERIFY_MAP_WORDS)
+    bl      classify_ref
+    mov     x0, x19
+    mov     x1, x20
+    ldr     x2, =verify_maps
+    add     x3, x2, #(4 * VERIFY_MAP_WORDS)
+    add     x4, x3, #(4 * VERIFY_MAP_WORDS)
+    bl      ascii_classify_neon
+    ldr     x0, =verify_maps
+    ldr     x1, =verify_ref_maps
+    mov     x2, #(3 * 4 * VERIFY_MAP_WORDS)
+    bl      compare_bytes
+    orr     x0, x22, x0
+
+    ldp     x21, x22, [sp, #16]
+    ldp     x23, x24, [sp, #32]
+    ldp     x29, x30, [sp], #64
+    ret
+
+// verify_ascii -> X0 = 0 if everything matches
+verify_ascii:
+    stp     x29, x30, [sp, #-48]!
+    mov     x29, sp
+    stp     x19, x20, [sp, #16]
+    stp     x21, x22, [sp, #32]
+
+    // Source: i * 167 + 13, a permutation of the byte values. Table:
+    // i * 73 + 5, so translating twice differs from translating once
+    ldr     x9, =verify_src
+    mov     x10, #0
+    mov     w12, #167
+1:
+    mul     w11, w10, w12
+    add     w11, w11, #13
+    strb    w11, [x9, x10]
+    add     x10, x10, #1
+    cmp     x10, #VERIFY_BYTES
+    b.lo    1b
+    ldr     x9, =verify_table
+    mov     x10, #0
+    mov     w12, #73
+11:
+    mul     w11, w10, w12
+    add     w11, w11, #5
+    strb    w11, [x9, x10]
+    add     x10, x10, #1
+    cmp     x10, #256
+    b.lo    11b
+
+    mov     x22, #0
+    mov     x20, #0
+2:
+    ldr     x19, =verify_src
+    and     x9, x20, #7
+    add     x19, x19, x9
+    bl      verify_one
+    orr     x22, x22, x0
+    add     x20, x20, #1
+    cmp     x20, #VERIFY_MAX_N
+    b.ls    2b
+
+    ldr     x21, =verify_lengths
+3:
+    ldr     x20, [x21], #8
+    cbz     x20, 4f
+    ldr     x19, =verify_src
+    and     x9, x20, #7
+    add     x19, x19, x9
+    bl      verify_one
+    orr     x22, x22, x0
+    b       3b
+4:
+    mov     x0, x22
+    ldp     x19, x20, [sp, #16]
+    ldp     x21, x22, [sp, #32]
+    ldp     x29, x30, [sp], #48
+    ret
+
+// ============================================================================
+// NOTES: ASCII transforms on ARM64
+// ============================================================================
+//
+// One compare per range:
+//   x - 'a' < 26 as unsigned bytes is 'a' <= x <= 'z': the subtraction
+//   wraps everything below 'a' to 0x80 and up. CMHI (unsigned >) does the
+//   compare directly, where SSE/AVX2 only have a signed byte compare and
+//   need a bias of 128 first.
+//
+// Table lookups:
+//   TBL/TBX index up to four registers (64 bytes), so a 256-byte table is
+//   four lookups on the same index minus 0, 64, 128, 192. PSHUFB indexes
+//   16 bytes, so the x86-64 version needs 16 rows combined through the
+//   low nibble instead. Classification only needs 16-entry tables, and
+//   uses the same two nibble tables on both.
+//
+// Masks without PMOVMSKB:
+//   NEON has no move-mask. To find the first differing byte, SHRN #4 of
+//   the compare result (as 16-bit lanes) keeps 4 bits per byte in a
+//   64-bit value; RBIT + CLZ on it, divided by 4, is the byte index. For
+//   bitmaps one bit per byte is needed: AND with 1, 2, 4 ... 128 and three
+//   ADDP rounds add each group of 8 bytes into one. The class words of
+//   all three maps share the last two ADDP.
+//
+// Tails:
+//   Case mapping is idempotent, so the last partial block simply overlaps
+//   the one before. Translation is not, so its last block is loaded and
+//   translated before anything is stored. Classification writes whole
+//   words, so it pads the tail with zero bytes instead.
+//
+// ============================================================================
@@ -1,19 +1,47 @@
 ; ============================================================================
 ; File: 04_functions_and_stack.asm
 ; Description: Demonstrates function calls, stack operations, and calling conventions
-; Topics: Stack, function prologue/epilogue, calling convention, local variables
+; Topics: Stack, function prologue/epilogue, calling convention, local variables,
+;         division-free number formatting, buffered output
 ; Assembler: NASM
 ; Build: nasm -f elf64 04_functions_and_stack.asm && ld -o 04_functions_and_stack 04_functions_and_stack.o
 ; ============================================================================
 
 global _start
 
+%define OUT_BUFFER_SIZE 65536   ; Bytes buffered before a write syscall
+%define EINTR           4
+%define EIO             5
+
 section .data
     result_msg: db "Result: ", 0
+    result_msg_len: equ $ - result_msg - 1
     newline:    db 0x0a
 
+    ; "00" "01" ... "99": two ASCII digits per table entry
+    digit_pairs:
+%assign i 0
+%rep 100
+    db '0' + i / 10, '0' + i % 10
+%assign i i + 1
+%endrep
+
+    hex_digits: db "0123456789abcdef"
+
+    ; powers_of_10[k] = 10^k, used to count decimal digits
+    powers_of_10:
+%assign i 0
+%assign p 1
+%rep 20
+    dq p
+%assign i i + 1
+%assign p p * 10
+%endrep
+
 section .bss
     digit_buffer: resb 20       ; Buffer for number to string conversion
+    out_used:     resq 1        ; Bytes waiting in out_buffer
+    out_buffer:   resb OUT_BUFFER_SIZE
 
 section .text
 
@@ -134,9 +162,29 @@ _start:
     ; DEMONSTRATION: Print result
     ; ========================================================================
     
+    mov     rdi, result_msg     ; "Result: "
+    mov     rsi, result_msg_len
+    call    out_bytes
     mov     rdi, r15            ; Print factorial result
     call    print_number
     
+    ; Signed, unsigned and hex output share the same buffer
+    mov     rdi, -9223372036854775808
+    call    out_i64             ; INT64_MIN
+    mov     edi, 0x0a
+    call    out_char
+    mov     rdi, -1
+    call    out_u64             ; 18446744073709551615
+    mov     edi, 0x0a
+    call    out_char
+    mov     rdi, 0xdeadbeef
+    call    out_hex
+    mov     edi, 0x0a
+    call    out_char
+    
+    ; Nothing has been written yet: one syscall sends it all
+    call    out_flush
+    
     ; Exit
     mov     rax, 60
     xor     rdi, rdi
@@ -328,10 +376,23 @@ complex_function:
 
 ; ============================================================================
 ; FUNCTION: print_number
-; Description: Prints a number to stdout
+; Description: Prints a number and a newline to stdout (buffered)
 ; Arguments: RDI = number to print
+; Note: Output stays in out_buffer until it fills or out_flush is called
 ; ============================================================================
 print_number:
+    call    out_u64
+    mov     edi, 0x0a
+    jmp     out_char            ; Tail call: out_char returns for us
+
+; ============================================================================
+; FUNCTION: print_number_div
+; Description: Prints a number to stdout (reference version)
+; Arguments: RDI = number to print
+; Note: One div per digit (20-90 cycles each) and one write per number;
+;       print_number does the same with multiplies and a shared buffer
+; ============================================================================
+print_number_div:
     push    rbp
     mov     rbp, rsp
     push    rbx
@@ -382,6 +443,227 @@ print_number:
     pop     rbp
     ret
 
+; ============================================================================
+; BUFFERED OUTPUT
+; ============================================================================
+;
+; The out_* functions append to out_buffer and only call write when it is
+; full or out_flush is called, so printing thousands of numbers costs a
+; handful of syscalls instead of one each. They preserve the callee-saved
+; registers (RBX, RBP, R12-R15) but may call out_flush, and so write, at
+; any time. Call out_flush before exiting.
+
+; ============================================================================
+; FUNCTION: out_u64
+; Description: Append an unsigned 64-bit number in decimal
+; Arguments: RDI = number
+;
+; No division: the digit count comes from the highest set bit
+; (digits ~ bits * log10(2) ~ bits * 1233 / 4096, then one compare against
+; a power of 10), and n / 100 is a multiply by a reciprocal:
+;   n / 100 = ((n >> 2) * 0x28F5C28F5C28F5C3) >> 66
+; Each step peels off two digits, looked up as a pair in digit_pairs.
+; ============================================================================
+out_u64:
+    mov     rax, [out_used]
+    cmp     rax, OUT_BUFFER_SIZE - 20
+    jbe     .room
+    push    rdi
+    call    out_flush
+    pop     rdi
+    xor     eax, eax
+    
+.room:
+    ; Digit count: t = (bsr(n | 1) + 1) * 1233 >> 12, plus 1 if n >= 10^t
+    mov     rdx, rdi
+    or      rdx, 1              ; 0 prints as one digit
+    bsr     rcx, rdx
+    inc     ecx
+    imul    ecx, ecx, 1233
+    shr     ecx, 12
+    cmp     rdx, [powers_of_10 + rcx * 8]
+    sbb     rcx, -1             ; RCX += 1 - CF
+    
+    add     rax, rcx
+    mov     [out_used], rax
+    lea     r8, [out_buffer + rax]  ; Digits are written backwards from here
+    
+    mov     rax, rdi
+    mov     r10, 0x28F5C28F5C28F5C3
+.pairs:
+    cmp     rax, 100
+    jb      .last
+    mov     r9, rax             ; n
+    shr     rax, 2
+    mul     r10
+    shr     rdx, 2              ; RDX = n / 100
+    imul    r11, rdx, 100
+    sub     r9, r11             ; R9 = n % 100
+    mov     rax, rdx
+    movzx   r9d, word [digit_pairs + r9 * 2]
+    sub     r8, 2
+    mov     [r8], r9w
+    jmp     .pairs
+    
+.last:
+    cmp     eax, 10
+    jb      .one
+    movzx   eax, word [digit_pairs + rax * 2]
+    mov     [r8 - 2], ax
+    ret
+    
+.one:
+    add     al, '0'
+    mov     [r8 - 1], al
+    ret
+
+; ============================================================================
+; FUNCTION: out_i64
+; Description: Append a signed 64-bit number in decimal
+; Arguments: RDI = number
+; ============================================================================
+out_i64:
+    test    rdi, rdi
+    jns     out_u64
+    
+    push    rdi
+    mov     edi, '-'
+    call    out_char
+    pop     rdi
+    neg     rdi                 ; INT64_MIN stays 2^63, correct as unsigned
+    jmp     out_u64
+
+; ============================================================================
+; FUNCTION: out_hex
+; Description: Append a number in lowercase hex, without leading zeros
+; Arguments: RDI = number
+; ============================================================================
+out_hex:
+    mov     rax, [out_used]
+    cmp     rax, OUT_BUFFER_SIZE - 16
+    jbe     .room
+    push    rdi
+    call    out_flush
+    pop     rdi
+    xor     eax, eax
+    
+.room:
+    mov     rcx, rdi
+    or      rcx, 1
+    bsr     rcx, rcx
+    shr     ecx, 2
+    inc     ecx                 ; Nibbles = bsr / 4 + 1
+    
+    add     rax, rcx
+    mov     [out_used], rax
+    lea     r8, [out_buffer + rax]
+    
+.nibble:
+    mov     edx, edi
+    and     edx, 15
+    movzx   edx, byte [hex_digits + rdx]
+    dec     r8
+    mov     [r8], dl
+    shr     rdi, 4
+    dec     ecx
+    jnz     .nibble
+    ret
+
+; ============================================================================
+; FUNCTION: out_char
+; Description: Append one byte
+; Arguments: DIL = byte
+; ============================================================================
+out_char:
+    mov     rax, [out_used]
+    cmp     rax, OUT_BUFFER_SIZE
+    jb      .room
+    push    rdi
+    call    out_flush
+    pop     rdi
+    xor     eax, eax
+    
+.room:
+    mov     [out_buffer + rax], dil
+    inc     rax
+    mov     [out_used], rax
+    ret
+
+; ============================================================================
+; FUNCTION: out_bytes
+; Description: Append a string
+; Arguments: RDI = pointer, RSI = length
+; Note: Strings larger than the buffer are written straight through
+; ============================================================================
+out_bytes:
+    mov     rax, [out_used]
+    lea     rdx, [rax + rsi]
+    cmp     rdx, OUT_BUFFER_SIZE
+    jbe     .copy
+    
+    push    rdi
+    push    rsi
+    call    out_flush
+    pop     rsi
+    pop     rdi
+    xor     eax, eax
+    cmp     rsi, OUT_BUFFER_SIZE
+    jbe     .copy
+    
+    mov     rdx, rsi
+    mov     rsi, rdi
+    jmp     write_stdout
+    
+.copy:
+    mov     rcx, rsi
+    mov     rsi, rdi
+    lea     rdi, [out_buffer + rax]
+    add     rax, rcx
+    mov     [out_used], rax
+    rep     movsb
+    ret
+
+; ============================================================================
+; FUNCTION: out_flush
+; Description: Write everything buffered to stdout
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+out_flush:
+    mov     rsi, out_buffer
+    mov     rdx, [out_used]
+    mov     qword [out_used], 0
+    ; Fall through
+
+; ============================================================================
+; FUNCTION: write_stdout
+; Description: Write a whole buffer to stdout, retrying short writes
+; Arguments: RSI = buffer, RDX = length
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+write_stdout:
+    xor     eax, eax
+    test    rdx, rdx
+    jz      .done
+    
+    mov     eax, 1              ; sys_write
+    mov     edi, 1              ; stdout
+    syscall
+    
+    cmp     rax, -EINTR
+    je      write_stdout
+    test    rax, rax
+    js      .done
+    jz      .stalled            ; No progress: don't spin forever
+    add     rsi, rax
+    sub     rdx, rax
+    jmp     write_stdout
+    
+.stalled:
+    mov     rax, -EIO
+    
+.done:
+    ret
+
 ; ============================================================================
 ; STACK FRAME VISUALIZATION
 ; ============================================================================
@@ -448,6 +730,8 @@ print_number:
 ; 5. Prefer leaf functions (no calls) to avoid prologue/epilogue overhead
 ; 6. For simple functions, inline or use registers only
 ; 7. Comment function contracts (args, returns, modifies)
+; 8. Avoid div in hot paths: dividing by a constant is a multiply and a
+;    shift (compilers do this too), and batch syscalls through a buffer
 ;
 ; ============================================================================
 
@@ -1,12 +1,46 @@
 ; ============================================================================
 ; File: 05_strings_and_arrays.asm
 ; Description: String manipulation and array operations
-; Topics: String instructions, array access, memory operations
+; Topics: String instructions, array access, memory operations,
+;         AVX2 memchr/memrchr/mismatch/memmem, PCMPESTRI,
+;         branch-free ASCII case/class/table transforms (VPSHUFB, XLATB),
+;         AVX2 integer reductions, clone() worker threads,
+;         AVX2 reverse/rotate/byte-swap/interleave permutations
 ; Assembler: NASM
 ; Build: nasm -f elf64 05_strings_and_arrays.asm && ld -o 05_strings_and_arrays 05_strings_and_arrays.o
+; Library: nasm -f elf64 -DLIBRARY 05_strings_and_arrays.asm -o 05_lib.o
+;          (exports the routines as asm_* for C callers, see 11_benchmark_harness.c)
 ; ============================================================================
 
+%ifdef LIBRARY
+    ; Prefix the routine names so they do not collide with libc's
+    %define strlen          asm_strlen
+    %define strcpy          asm_strcpy
+    %define strcmp          asm_strcmp
+    %define array_sum       asm_array_sum
+    %define array_reverse   asm_array_reverse
+    global asm_strlen, asm_strcpy, asm_strcmp, asm_array_sum, asm_array_reverse
+    global strlen_avx2, strcpy_avx2, strcmp_avx2, has_avx2
+    global strlen_byte, strcpy_byte, strcmp_byte
+    global memchr_avx2, memrchr_avx2, mismatch_avx2, memmem_avx2
+    global memmem_sse42, has_sse42
+    global memchr_scasb, memrchr_scasb, mismatch_cmpsb, memmem_byte
+    global ascii_toupper_avx2, ascii_tolower_avx2, ascii_casecmp_avx2
+    global ascii_classify_avx2, ascii_translate_avx2
+    global ascii_toupper_byte, ascii_tolower_byte, ascii_casecmp_byte
+    global ascii_classify_byte, ascii_translate_byte
+    global sum_i64_avx2, sum_i32_avx2, sum_i64_checked_avx2
+    global min_i64_avx2, max_i64_avx2, min_i32_avx2, max_i32_avx2
+    global argmin_i64_avx2, argmax_i64_avx2, reduce_i64_parallel
+    global reverse_u8_avx2, reverse_u16_avx2, reverse_u32_avx2, reverse_u64_avx2
+    global rotate_left_avx2, bswap16_avx2, bswap32_avx2, bswap64_avx2
+    global interleave_u8_avx2, interleave_u16_avx2
+    global interleave_u32_avx2, interleave_u64_avx2
+    global deinterleave_u8_avx2, deinterleave_u16_avx2
+    global deinterleave_u32_avx2, deinterleave_u64_avx2
+%else
 global _start
+%endif
 
 section .data
     ; Strings
@@ -27,11 +61,135 @@ section .data
     
     msg_not_found:  db "Character not found!", 0x0a
     msg_not_found_len: equ $ - msg_not_found
+    
+    msg_verify_ok:  db "Vector string routines match the byte versions", 0x0a
+    msg_verify_ok_len: equ $ - msg_verify_ok
+    
+    msg_verify_bad: db "Vector string routines MISMATCH", 0x0a
+    msg_verify_bad_len: equ $ - msg_verify_bad
+    
+    ; strlen, strcpy, strcmp entry points checked by verify_string_routines
+    verify_impls:   dq strlen, strcpy, strcmp
+                    dq strlen_avx2, strcpy_avx2, strcmp_avx2
+    
+    msg_search_ok:  db "Vector search routines match REPNE SCASB / REPE CMPSB", 0x0a
+    msg_search_ok_len: equ $ - msg_search_ok
+    
+    msg_search_bad: db "Vector search routines MISMATCH", 0x0a
+    msg_search_bad_len: equ $ - msg_search_bad
+    
+    msg_ascii_ok:   db "AVX2 ASCII transforms match the byte loops", 0x0a
+    msg_ascii_ok_len: equ $ - msg_ascii_ok
+    
+    msg_ascii_bad:  db "AVX2 ASCII transforms MISMATCH", 0x0a
+    msg_ascii_bad_len: equ $ - msg_ascii_bad
+    
+    ; Out-of-place transforms checked by verify_ascii_routines
+    ascii_xform_refs:  dq ascii_toupper_byte, ascii_tolower_byte, ascii_translate_byte
+    ascii_xform_impls: dq ascii_toupper_avx2, ascii_tolower_avx2, ascii_translate_avx2
+    
+    ; Character classes for ascii_classify_avx2: a byte is in a class if
+    ; the entries for its low and its high nibble share one of its bits.
+    ; Each bit is one rectangle of the nibble grid:
+    ;   0x01 digit  high 3     low 0-9
+    ;   0x02 alpha  high 4, 6  low 1-F   (A-O, a-o)
+    ;   0x04 alpha  high 5, 7  low 0-A   (P-Z, p-z)
+    ;   0x08 space  high 0     low 9-D   (\t \n \v \f \r)
+    ;   0x10 space  high 2     low 0     (' ')
+    ASCII_DIGIT     equ 0x01
+    ASCII_ALPHA     equ 0x06
+    ASCII_SPACE     equ 0x18
+    align 16
+    ascii_class_lo: db 0x15, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07
+                    db 0x07, 0x0F, 0x0E, 0x0A, 0x0A, 0x0A, 0x02, 0x02
+    ascii_class_hi: db 0x08, 0x00, 0x10, 0x01, 0x02, 0x04, 0x02, 0x04
+                    db 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    
+    msg_reduce_ok:  db "AVX2 integer reductions match the scalar loops", 0x0a
+    msg_reduce_ok_len: equ $ - msg_reduce_ok
+    
+    msg_reduce_bad: db "AVX2 integer reductions MISMATCH", 0x0a
+    msg_reduce_bad_len: equ $ - msg_reduce_bad
+    
+    ; Per-operation kernels for reduce_i64_parallel (REDUCE_SUM/MIN/MAX)
+    reduce_kernels: dq sum_i64_avx2, min_i64_avx2, max_i64_avx2
+    
+    align 32
+    lane_index:     dq 0, 1, 2, 3   ; Starting indices for argmin/argmax
+    
+    msg_perm_ok:    db "AVX2 permutations match the element-by-element copies", 0x0a
+    msg_perm_ok_len: equ $ - msg_perm_ok
+    
+    msg_perm_bad:   db "AVX2 permutations MISMATCH", 0x0a
+    msg_perm_bad_len: equ $ - msg_perm_bad
+    
+    ; Entry points by log2(element size), for verify_permutations
+    reverse_impls:  dq reverse_u8_avx2, reverse_u16_avx2
+                    dq reverse_u32_avx2, reverse_u64_avx2
+    bswap_impls:    dq 0, bswap16_avx2, bswap32_avx2, bswap64_avx2
+    interleave_impls: dq interleave_u8_avx2, interleave_u16_avx2
+                    dq interleave_u32_avx2, interleave_u64_avx2
+    deinterleave_impls: dq deinterleave_u8_avx2, deinterleave_u16_avx2
+                    dq deinterleave_u32_avx2, deinterleave_u64_avx2
+    
+    ; PSHUFB mask at offset s moves bytes down by s and zeroes the top s
+    ; (memmem_sse42 loads near a page end)
+    align 16
+    shift_down_mask: db 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+                    times 16 db 0x80
+    
+    ; VPSHUFB masks for one 16-byte lane (broadcast to both lanes)
+    align 16
+    reverse_masks:  db 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+                    db 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+                    db 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+                    db 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7
+    bswap_masks:    db 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+                    db 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+                    db 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+    ; Lane = 8 bytes of a, 8 bytes of b -> a0 b0 a1 b1 ...
+    interleave_masks:
+                    db 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15
+                    db 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15
+                    db 0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15
+                    db 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+    ; Lane = a0 b0 a1 b1 ... -> 8 bytes of a, 8 bytes of b
+    deinterleave_masks:
+                    db 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15
+                    db 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15
+                    db 0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15
+                    db 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
 
 section .bss
     dest_buffer:    resb 100        ; Destination buffer for string operations
     temp_buffer:    resb 100        ; Temporary buffer
     result_array:   resq 10         ; Result array (10 quad words)
+    
+    alignb 64
+    verify_src:     resb 256        ; Test strings for verify_string_routines
+    verify_dst:     resb 256
+    
+    SEARCH_TEST_LEN equ 160         ; verify_search_routines: buffer lengths
+    SEARCH_NEEDLE_MAX equ 40        ; and needle lengths, both from 0
+    
+    ASCII_TEST_LEN  equ 160         ; verify_ascii_routines: lengths 0..160
+    ASCII_MAP_DWORDS equ (ASCII_TEST_LEN + 31) / 32 + 1 ; One guard dword
+    alignb 64
+    ascii_src:      resb 256
+    ascii_ref:      resb 256
+    ascii_dst:      resb ASCII_TEST_LEN + 128
+    ascii_table:    resb 256
+    ascii_maps:     resd 6 * ASCII_MAP_DWORDS
+    
+    REDUCE_TEST_COUNT equ 1 << 19   ; 4 MiB: enough for two parallel slices
+    alignb 64
+    reduce_array:   resq REDUCE_TEST_COUNT
+    
+    PERM_TEST_BYTES equ 2048        ; 99 qwords, interleaved, with room to spare
+    alignb 64
+    perm_src:       resb PERM_TEST_BYTES
+    perm_ref:       resb PERM_TEST_BYTES
+    perm_dst:       resb PERM_TEST_BYTES * 2
 
 section .text
 
@@ -124,6 +282,7 @@ copy_done:
     mov     rcx, source_len         ; Length
     cld
     repne   scasb                   ; Repeat while not equal: compare AL with [RDI]
+                                    ; (microcoded, ~1 byte/cycle: see memchr_avx2)
     
     ; If found, ZF=1 and RDI points one byte AFTER the match
     jne     char_not_found
@@ -155,6 +314,7 @@ after_search:
     mov     rcx, source_len         ; Length
     cld
     repe    cmpsb                   ; Repeat while equal: compare [RSI] with [RDI]
+                                    ; (vector version: mismatch_avx2)
     
     ; If equal, ZF=1 after comparison
     ; If not equal, ZF=0 and RSI, RDI point past first mismatch
@@ -165,6 +325,7 @@ after_search:
     
     ; Process string character by character
     lea     rsi, [source_str]       ; Source string
+    lea     rdi, [temp_buffer]      ; Result
     mov     rcx, source_len
     
 process_loop:
@@ -182,12 +343,14 @@ process_loop:
     sub     al, 32                  ; Convert to uppercase
     
 .not_lowercase:
-    ; Do something with processed character
+    stosb                           ; Store AL to [RDI], inc RDI
     
     dec     rcx
     jmp     process_loop
     
 process_done:
+    ; Two compare/branch pairs per byte: ascii_toupper_avx2 does the same
+    ; for 32 bytes with four vector instructions and no branches
     
     ; ========================================================================
     ; DIRECTION FLAG
@@ -326,6 +489,62 @@ int_array_done:
     call    strcmp
     ; RAX = 0 if equal, <0 if str1 < str2, >0 if str1 > str2
     
+    ; ========================================================================
+    ; CHECK THE VECTOR STRING ROUTINES AGAINST THE BYTE VERSIONS
+    ; ========================================================================
+    
+    call    verify_string_routines
+    mov     rsi, msg_verify_ok
+    mov     rdx, msg_verify_ok_len
+    test    rax, rax
+    jz      print_verify
+    mov     rsi, msg_verify_bad
+    mov     rdx, msg_verify_bad_len
+print_verify:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+    
+    ; ========================================================================
+    ; VECTOR SEARCH (memchr, memrchr, mismatch, memmem) VS STRING INSTRUCTIONS
+    ; ========================================================================
+    
+    call    has_avx2
+    test    rax, rax
+    jz      search_skipped
+    call    verify_search_routines
+    mov     rsi, msg_search_ok
+    mov     rdx, msg_search_ok_len
+    test    rax, rax
+    jz      print_search
+    mov     rsi, msg_search_bad
+    mov     rdx, msg_search_bad_len
+print_search:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+search_skipped:
+    
+    ; ========================================================================
+    ; ASCII TRANSFORMS (case, case-insensitive compare, classes, tables)
+    ; ========================================================================
+    
+    call    has_avx2
+    test    rax, rax
+    jz      ascii_skipped
+    call    verify_ascii_routines
+    mov     rsi, msg_ascii_ok
+    mov     rdx, msg_ascii_ok_len
+    test    rax, rax
+    jz      print_ascii
+    mov     rsi, msg_ascii_bad
+    mov     rdx, msg_ascii_bad_len
+print_ascii:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+ascii_skipped:
+    
     ; ========================================================================
     ; ARRAY SUM FUNCTION
     ; ========================================================================
@@ -336,6 +555,46 @@ int_array_done:
     ; RAX contains sum
     mov     r13, rax
     
+    ; ========================================================================
+    ; AVX2 REDUCTIONS (sum, min/max, argmin/argmax, checked, parallel)
+    ; ========================================================================
+    
+    call    has_avx2
+    test    rax, rax
+    jz      reduce_skipped
+    call    verify_reductions
+    mov     rsi, msg_reduce_ok
+    mov     rdx, msg_reduce_ok_len
+    test    rax, rax
+    jz      print_reduce
+    mov     rsi, msg_reduce_bad
+    mov     rdx, msg_reduce_bad_len
+print_reduce:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+reduce_skipped:
+    
+    ; ========================================================================
+    ; AVX2 PERMUTATIONS (reverse, rotate, byte swap, interleave)
+    ; ========================================================================
+    
+    call    has_avx2
+    test    rax, rax
+    jz      perm_skipped
+    call    verify_permutations
+    mov     rsi, msg_perm_ok
+    mov     rdx, msg_perm_ok_len
+    test    rax, rax
+    jz      print_perm
+    mov     rsi, msg_perm_bad
+    mov     rdx, msg_perm_bad_len
+print_perm:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+perm_skipped:
+    
     ; ========================================================================
     ; ARRAY REVERSE FUNCTION
     ; ========================================================================
@@ -351,147 +610,3947 @@ int_array_done:
 
 ; ============================================================================
 ; FUNCTION: strlen
-; Description: Calculate string length (null-terminated)
+; Description: Calculate string length (null-terminated), 16 bytes per step
 ; Arguments: RDI = string address
 ; Returns: RAX = length (excluding null terminator)
+;
+; Page safety: a load never crosses a 16-byte boundary because every load is
+; 16-byte aligned, so it never touches a page the string does not reach.
+; The first aligned block may start before the string; the mask bits for
+; those bytes are shifted out.
 ; ============================================================================
 strlen:
+    mov     rax, rdi
+    and     rax, -16                ; Aligned block containing the first byte
+    mov     ecx, edi
+    and     ecx, 15                 ; Bytes of that block before the string
+    pxor    xmm0, xmm0              ; XMM0 = 16 zero bytes
+
+    movdqa  xmm1, [rax]
+    pcmpeqb xmm1, xmm0              ; 0xFF where byte == 0
+    pmovmskb edx, xmm1              ; One bit per byte
+    shr     edx, cl                 ; Discard bytes before the string
+    test    edx, edx
+    jnz     .head
+
+.loop:
+    add     rax, 16
+    movdqa  xmm1, [rax]
+    pcmpeqb xmm1, xmm0
+    pmovmskb edx, xmm1
+    test    edx, edx
+    jz      .loop
+
+    bsf     edx, edx                ; Index of the terminator in this block
+    sub     rax, rdi
+    add     rax, rdx
+    ret
+
+.head:
+    bsf     eax, edx                ; Terminator inside the first block
+    ret
+
+; ============================================================================
+; FUNCTION: strcpy
+; Description: Copy null-terminated string, 16 bytes per step
+; Arguments: RDI = destination, RSI = source
+; Returns: RAX = destination
+;
+; Only bytes up to and including the terminator are written, so the
+; destination needs exactly strlen(src) + 1 bytes. The first unaligned
+; 16-byte load is made only once the aligned block holding the start is
+; known to contain no terminator: the string then continues into the next
+; aligned block, which lies in a mapped page.
+; ============================================================================
+strcpy:
+    mov     rax, rdi                ; Return value
+    pxor    xmm0, xmm0
+
+    mov     rdx, rsi
+    and     rdx, -16
+    mov     ecx, esi
+    and     ecx, 15
+    movdqa  xmm1, [rdx]
+    pcmpeqb xmm1, xmm0
+    pmovmskb r8d, xmm1
+    shr     r8d, cl                 ; Bit i = source[i] is the terminator
+    test    r8d, r8d
+    jnz     .tail
+
+    movdqu  xmm1, [rsi]             ; Safe: see above
+    movdqa  xmm2, xmm1
+    pcmpeqb xmm2, xmm0
+    pmovmskb r8d, xmm2
+    test    r8d, r8d
+    jnz     .tail                   ; Terminator in the next aligned block
+    movdqu  [rdi], xmm1
+
+    mov     edx, 16
+    sub     edx, ecx                ; Advance to the next aligned source block
+    add     rsi, rdx
+    add     rdi, rdx
+
+.loop:
+    movdqa  xmm1, [rsi]
+    movdqa  xmm2, xmm1
+    pcmpeqb xmm2, xmm0
+    pmovmskb r8d, xmm2
+    test    r8d, r8d
+    jnz     .tail
+    movdqu  [rdi], xmm1
+    add     rsi, 16
+    add     rdi, 16
+    jmp     .loop
+
+.tail:
+    ; Copy 1-16 bytes ending with the terminator using two overlapping moves
+    bsf     ecx, r8d
+    inc     ecx                     ; RCX = bytes left, terminator included
+    cmp     ecx, 8
+    jb      .tail_4
+    mov     rdx, [rsi]
+    mov     r8, [rsi + rcx - 8]
+    mov     [rdi], rdx
+    mov     [rdi + rcx - 8], r8
+    ret
+.tail_4:
+    cmp     ecx, 4
+    jb      .tail_2
+    mov     edx, [rsi]
+    mov     r8d, [rsi + rcx - 4]
+    mov     [rdi], edx
+    mov     [rdi + rcx - 4], r8d
+    ret
+.tail_2:
+    cmp     ecx, 2
+    jb      .tail_1
+    movzx   edx, word [rsi]
+    movzx   r8d, word [rsi + rcx - 2]
+    mov     [rdi], dx
+    mov     [rdi + rcx - 2], r8w
+    ret
+.tail_1:
+    mov     byte [rdi], 0
+    ret
+
+; ============================================================================
+; FUNCTION: strcmp
+; Description: Compare two null-terminated strings, 16 bytes per step
+; Arguments: RDI = string1, RSI = string2
+; Returns: RAX = 0 (equal), <0 (str1 < str2), >0 (str1 > str2)
+;
+; The two strings have unrelated alignments, so loads are unaligned and
+; each one is checked for page crossing: when either pointer is within 16
+; bytes of a page end, one byte is compared the slow way instead.
+; ============================================================================
+strcmp:
+    pxor    xmm0, xmm0
+    xor     edx, edx                ; Offset into both strings
+
+.loop:
+    lea     eax, [rdi + rdx]
+    lea     ecx, [rsi + rdx]
+    and     eax, 4095
+    and     ecx, 4095
+    cmp     eax, 4096 - 16
+    ja      .byte_step
+    cmp     ecx, 4096 - 16
+    ja      .byte_step
+
+    movdqu  xmm1, [rdi + rdx]
+    movdqu  xmm2, [rsi + rdx]
+    pcmpeqb xmm2, xmm1              ; 0xFF where the strings agree
+    pminub  xmm2, xmm1              ; 0 where they differ or string1 ends
+    pcmpeqb xmm2, xmm0
+    pmovmskb eax, xmm2
+    test    eax, eax
+    jnz     .found
+    add     rdx, 16
+    jmp     .loop
+
+.byte_step:
+    movzx   eax, byte [rdi + rdx]
+    movzx   ecx, byte [rsi + rdx]
+    cmp     eax, ecx
+    jne     .diff
+    test    eax, eax
+    jz      .diff                   ; Both ended: RAX - RCX = 0
+    inc     rdx
+    jmp     .loop
+
+.found:
+    bsf     eax, eax
+    add     rdx, rax
+    movzx   eax, byte [rdi + rdx]
+    movzx   ecx, byte [rsi + rdx]
+.diff:
+    sub     rax, rcx                ; RAX = difference
+    ret
+
+; ============================================================================
+; AVX2 VERSIONS (32 bytes per step)
+; ============================================================================
+;
+; Same algorithms on YMM registers. Call only when CPUID reports AVX2 and
+; the OS has enabled YMM state (see has_avx2). VZEROUPPER before returning
+; avoids SSE/AVX transition stalls in the caller.
+;
+; ============================================================================
+; FUNCTION: strlen_avx2
+; Arguments: RDI = string address
+; Returns: RAX = length
+; ============================================================================
+strlen_avx2:
+    mov     rax, rdi
+    and     rax, -32
+    mov     ecx, edi
+    and     ecx, 31
+    vpxor   xmm0, xmm0, xmm0
+
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb edx, ymm1
+    shr     edx, cl
+    test    edx, edx
+    jnz     .head
+
+    ; One more 32-byte block if needed to reach 64-byte alignment
+    add     rax, 32
+    test    eax, 32
+    jz      .loop
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb edx, ymm1
+    test    edx, edx
+    jnz     .found
+    add     rax, 32
+
+.loop:
+    ; 64 bytes per iteration: the unsigned minimum of the two halves has a
+    ; zero byte wherever either half does
+    vmovdqa ymm1, [rax]
+    vpminub ymm2, ymm1, [rax + 32]
+    vpcmpeqb ymm2, ymm2, ymm0
+    vpmovmskb edx, ymm2
+    test    edx, edx
+    jnz     .found_pair
+    add     rax, 64
+    jmp     .loop
+
+.found_pair:
+    vpcmpeqb ymm1, ymm1, ymm0
+    vpmovmskb edx, ymm1
+    test    edx, edx
+    jnz     .found                  ; In the first half
+    add     rax, 32
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb edx, ymm1
+
+.found:
+    bsf     edx, edx
+    sub     rax, rdi
+    add     rax, rdx
+    vzeroupper
+    ret
+
+.head:
+    bsf     eax, edx
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: strcpy_avx2
+; Arguments: RDI = destination, RSI = source
+; Returns: RAX = destination
+; ============================================================================
+strcpy_avx2:
+    mov     rax, rdi
+    vpxor   xmm0, xmm0, xmm0
+
+    mov     rdx, rsi
+    and     rdx, -32
+    mov     ecx, esi
+    and     ecx, 31
+    vpcmpeqb ymm1, ymm0, [rdx]
+    vpmovmskb r8d, ymm1
+    shr     r8d, cl
+    test    r8d, r8d
+    jnz     .tail
+
+    vmovdqu ymm1, [rsi]
+    vpcmpeqb ymm2, ymm1, ymm0
+    vpmovmskb r8d, ymm2
+    test    r8d, r8d
+    jnz     .tail
+    vmovdqu [rdi], ymm1
+
+    mov     edx, 32
+    sub     edx, ecx
+    add     rsi, rdx
+    add     rdi, rdx
+
+.loop:
+    vmovdqa ymm1, [rsi]
+    vpcmpeqb ymm2, ymm1, ymm0
+    vpmovmskb r8d, ymm2
+    test    r8d, r8d
+    jnz     .tail
+    vmovdqu [rdi], ymm1
+    add     rsi, 32
+    add     rdi, 32
+    jmp     .loop
+
+.tail:
+    ; Copy 1-32 bytes ending with the terminator
+    vzeroupper
+    bsf     ecx, r8d
+    inc     ecx
+    cmp     ecx, 16
+    jb      .tail_8
+    movdqu  xmm1, [rsi]
+    movdqu  xmm2, [rsi + rcx - 16]
+    movdqu  [rdi], xmm1
+    movdqu  [rdi + rcx - 16], xmm2
+    ret
+.tail_8:
+    cmp     ecx, 8
+    jb      .tail_4
+    mov     rdx, [rsi]
+    mov     r8, [rsi + rcx - 8]
+    mov     [rdi], rdx
+    mov     [rdi + rcx - 8], r8
+    ret
+.tail_4:
+    cmp     ecx, 4
+    jb      .tail_2
+    mov     edx, [rsi]
+    mov     r8d, [rsi + rcx - 4]
+    mov     [rdi], edx
+    mov     [rdi + rcx - 4], r8d
+    ret
+.tail_2:
+    cmp     ecx, 2
+    jb      .tail_1
+    movzx   edx, word [rsi]
+    movzx   r8d, word [rsi + rcx - 2]
+    mov     [rdi], dx
+    mov     [rdi + rcx - 2], r8w
+    ret
+.tail_1:
+    mov     byte [rdi], 0
+    ret
+
+; ============================================================================
+; FUNCTION: strcmp_avx2
+; Arguments: RDI = string1, RSI = string2
+; Returns: RAX = 0 (equal), <0 (str1 < str2), >0 (str1 > str2)
+; ============================================================================
+strcmp_avx2:
+    vpxor   xmm0, xmm0, xmm0
+    xor     edx, edx
+
+.loop:
+    lea     eax, [rdi + rdx]
+    lea     ecx, [rsi + rdx]
+    and     eax, 4095
+    and     ecx, 4095
+    cmp     eax, 4096 - 32
+    ja      .byte_step
+    cmp     ecx, 4096 - 32
+    ja      .byte_step
+
+    vmovdqu ymm1, [rdi + rdx]
+    vpcmpeqb ymm2, ymm1, [rsi + rdx]
+    vpminub ymm2, ymm2, ymm1
+    vpcmpeqb ymm2, ymm2, ymm0
+    vpmovmskb eax, ymm2
+    test    eax, eax
+    jnz     .found
+    add     rdx, 32
+    jmp     .loop
+
+.byte_step:
+    movzx   eax, byte [rdi + rdx]
+    movzx   ecx, byte [rsi + rdx]
+    cmp     eax, ecx
+    jne     .diff
+    test    eax, eax
+    jz      .diff
+    inc     rdx
+    jmp     .loop
+
+.found:
+    bsf     eax, eax
+    add     rdx, rax
+    movzx   eax, byte [rdi + rdx]
+    movzx   ecx, byte [rsi + rdx]
+.diff:
+    vzeroupper
+    sub     rax, rcx
+    ret
+
+; ============================================================================
+; FUNCTION: has_avx2
+; Description: Check whether the AVX2 string routines may be used
+; Returns: RAX = 1 if AVX2 is supported and YMM state is enabled, else 0
+; ============================================================================
+has_avx2:
+    push    rbx                     ; CPUID writes EBX (callee-saved)
+
+    xor     eax, eax
+    cpuid
+    cmp     eax, 7
+    jb      .no
+
+    mov     eax, 1
+    cpuid
+    bt      ecx, 27                 ; OSXSAVE: XGETBV usable
+    jnc     .no
+    bt      ecx, 28                 ; AVX
+    jnc     .no
+    xor     ecx, ecx
+    xgetbv
+    and     eax, 0x06
+    cmp     eax, 0x06               ; XMM and YMM state saved by the OS
+    jne     .no
+
+    mov     eax, 7
+    xor     ecx, ecx
+    cpuid
+    bt      ebx, 5                  ; AVX2
+    jnc     .no
+
+    mov     eax, 1
+    pop     rbx
+    ret
+
+.no:
+    xor     eax, eax
+    pop     rbx
+    ret
+
+; ============================================================================
+; REFERENCE IMPLEMENTATIONS (one byte per iteration)
+; ============================================================================
+;
+; Kept to test the vector versions against and as the readable baseline.
+;
+; ============================================================================
+; FUNCTION: strlen_byte
+; Arguments: RDI = string address
+; Returns: RAX = length (excluding null terminator)
+; ============================================================================
+strlen_byte:
     push    rdi
     xor     rax, rax                ; Length counter
-    
+
 .loop:
     cmp     byte [rdi], 0           ; Check for null terminator
     je      .done
     inc     rax
     inc     rdi
     jmp     .loop
-    
+
 .done:
     pop     rdi
     ret
 
 ; ============================================================================
-; FUNCTION: strcpy
-; Description: Copy null-terminated string
+; FUNCTION: strcpy_byte
 ; Arguments: RDI = destination, RSI = source
-; Returns: RDI = destination (preserved)
+; Returns: RAX = destination
 ; ============================================================================
-strcpy:
-    push    rdi
-    
+strcpy_byte:
+    mov     rax, rdi
+
 .loop:
-    mov     al, [rsi]               ; Load source byte
-    mov     [rdi], al               ; Store to destination
-    test    al, al                  ; Check if null
+    mov     cl, [rsi]               ; Load source byte
+    mov     [rdi], cl               ; Store to destination
+    test    cl, cl                  ; Check if null
     jz      .done
     inc     rsi
     inc     rdi
     jmp     .loop
-    
+
 .done:
-    pop     rdi
     ret
 
 ; ============================================================================
-; FUNCTION: strcmp
-; Description: Compare two null-terminated strings
+; FUNCTION: strcmp_byte
 ; Arguments: RDI = string1, RSI = string2
 ; Returns: RAX = 0 (equal), <0 (str1 < str2), >0 (str1 > str2)
+; Note: Uses RCX/RDX (caller-saved) for the second string, so RBX survives
 ; ============================================================================
-strcmp:
+strcmp_byte:
     push    rdi
     push    rsi
-    
+
 .loop:
-    mov     al, [rdi]               ; Load char from string1
-    mov     bl, [rsi]               ; Load char from string2
-    
-    cmp     al, bl
+    movzx   eax, byte [rdi]         ; Load char from string1
+    movzx   ecx, byte [rsi]         ; Load char from string2
+
+    cmp     eax, ecx
     jne     .not_equal              ; Characters differ
-    
-    test    al, al                  ; Check if null (end of both strings)
-    jz      .equal
-    
+
+    test    eax, eax                ; Check if null (end of both strings)
+    jz      .done                   ; RAX = 0
+
     inc     rdi
     inc     rsi
     jmp     .loop
-    
-.equal:
-    xor     rax, rax                ; Return 0
-    jmp     .done
-    
+
 .not_equal:
-    movzx   rax, al                 ; Zero-extend AL to RAX
-    movzx   rbx, bl                 ; Zero-extend BL to RBX
-    sub     rax, rbx                ; RAX = difference
-    
+    sub     rax, rcx                ; RAX = difference
+
 .done:
     pop     rsi
     pop     rdi
     ret
 
 ; ============================================================================
-; FUNCTION: array_sum
-; Description: Sum all elements in a quad word array
-; Arguments: RDI = array address, RSI = array length
-; Returns: RAX = sum
-; ============================================================================
-array_sum:
-    xor     rax, rax                ; Sum = 0
-    xor     rcx, rcx                ; Index = 0
-    
-.loop:
-    cmp     rcx, rsi
-    jge     .done
-    
-    add     rax, [rdi + rcx*8]      ; Add element to sum
-    inc     rcx
-    jmp     .loop
-    
-.done:
-    ret
-
-; ============================================================================
-; FUNCTION: array_reverse
-; Description: Reverse a quad word array in place
-; Arguments: RDI = array address, RSI = array length
+; FUNCTION: verify_string_routines
+; Description: Check the vector string routines against the byte versions
+;              for every source alignment 0-63 and length 0-95
+; Returns: RAX = 0 if every result matches, 1 otherwise
 ; ============================================================================
-array_reverse:
+verify_string_routines:
     push    rbx
-    push    rcx
-    
-    xor     rcx, rcx                ; Left index = 0
-    mov     rbx, rsi                ; Right index = length
-    dec     rbx                     ; Right index = length - 1
-    
-.loop:
-    cmp     rcx, rbx
-    jge     .done                   ; Stop when left >= right
-    
-    ; Swap array[left] and array[right]
-    mov     rax, [rdi + rcx*8]      ; Temp = array[left]
-    mov     r8, [rdi + rbx*8]       ; Load array[right]
-    mov     [rdi + rbx*8], rax      ; array[right] = temp
-    mov     [rdi + rcx*8], r8       ; array[left] = array[right]
-    
-    inc     rcx                     ; left++
-    dec     rbx                     ; right--
-    jmp     .loop
-    
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+
+    call    has_avx2
+    mov     r15, rax                ; Also test the AVX2 set?
+    xor     r12d, r12d              ; Source alignment
+
+.align_loop:
+    xor     r13d, r13d              ; String length
+
+.len_loop:
+    ; Source: R13 'x' bytes + terminator at offset R12
+    lea     rbx, [verify_src + r12]
+    mov     rdi, rbx
+    mov     rcx, r13
+    mov     al, 'x'
+    rep     stosb
+    mov     byte [rdi], 0
+
+    ; Destination at a different alignment
+    lea     r14, [r12 + r12*4]
+    and     r14, 63
+    add     r14, verify_dst
+
+    lea     rbp, [verify_impls]
+    xor     eax, eax
+    cmp     r15, 0
+    je      .one_set
+    mov     eax, 1
+.one_set:
+    push    rax                     ; Extra sets to run after SSE2
+    sub     rsp, 8                  ; Keep the stack 16-byte aligned
+
+.impl_loop:
+    ; Guard bytes show any write past the terminator
+    mov     rdi, r14
+    mov     ecx, 128
+    mov     al, 0xEE
+    rep     stosb
+
+    mov     rdi, rbx
+    call    [rbp]                   ; strlen
+    cmp     rax, r13
+    jne     .fail
+
+    mov     rdi, r14
+    mov     rsi, rbx
+    call    [rbp + 8]               ; strcpy
+    cmp     rax, r14
+    jne     .fail
+    cmp     byte [r14 + r13], 0
+    jne     .fail
+    cmp     byte [r14 + r13 + 1], 0xEE
+    jne     .fail
+
+    mov     rdi, r14
+    mov     rsi, rbx
+    call    strcmp_byte             ; Copy must equal the source
+    test    rax, rax
+    jnz     .fail
+
+    mov     rdi, rbx
+    mov     rsi, r14
+    call    [rbp + 16]              ; strcmp, equal strings
+    test    rax, rax
+    jnz     .fail
+
+    test    r13, r13
+    jz      .next_impl
+    dec     byte [r14 + r13 - 1]    ; Last char 'x' -> 'w'
+    mov     rdi, rbx
+    mov     rsi, r14
+    call    [rbp + 16]
+    cmp     rax, 1                  ; 'x' - 'w'
+    jne     .fail
+    mov     rdi, r14
+    mov     rsi, rbx
+    call    [rbp + 16]
+    cmp     rax, -1
+    jne     .fail
+
+.next_impl:
+    add     rbp, 24
+    dec     qword [rsp + 8]
+    jns     .impl_loop
+    add     rsp, 16
+
+    inc     r13
+    cmp     r13, 96
+    jb      .len_loop
+    inc     r12
+    cmp     r12, 64
+    jb      .align_loop
+
+    xor     eax, eax
+    jmp     .done
+
+.fail:
+    add     rsp, 16
+    mov     eax, 1
+
 .done:
-    pop     rcx
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
     pop     rbx
     ret
 
 ; ============================================================================
-; NOTES:
+; MEMORY SEARCH (explicit lengths, 32 bytes per compare)
 ; ============================================================================
 ;
-; String Instructions Summary:
-; ┌──────────┬────────────────────────────────────────────────────────┐
-; │ MOVSB/Q  │ Move [RSI] to [RDI], advance both                     │
-; │ STOSB/Q  │ Store AL/RAX to [RDI], advance RDI                    │
-; │ LODSB/Q  │ Load [RSI] to AL/RAX, advance RSI                     │
+; REPNE SCASB and REPE CMPSB are microcoded and run at about a byte per
+; cycle at best, however long the buffer. The routines below compare 32
+; bytes per VPCMPEQB, turn the result into one bit per byte with VPMOVMSKB
+; and locate the hit with TZCNT/BSR. The *_scasb / *_cmpsb / memmem_byte
+; versions keep the string instructions as the baseline to test against.
+; The AVX2 routines need has_avx2; memmem_sse42 needs has_sse42.
+;
+; ============================================================================
+; FUNCTION: memchr_avx2
+; Description: Find the first occurrence of a byte
+; Arguments: RDI = buffer, ESI = byte, RDX = length
+; Returns: RAX = pointer to the first match, or 0
+;
+; Every load is 32-byte aligned and holds at least one byte of the buffer,
+; so none touches a page the buffer does not. Bits for bytes before the
+; buffer are cleared; a hit past the end is rejected in .found.
+; ============================================================================
+memchr_avx2:
+    test    rdx, rdx
+    jz      .none
+    vmovd   xmm0, esi
+    vpbroadcastb ymm0, xmm0         ; YMM0 = 32 copies of the byte
+
+    mov     rax, rdi
+    and     rax, -32                ; Aligned block holding the first byte
+    mov     ecx, edi
+    and     ecx, 31
+    add     rdx, rcx                ; RDX = bytes from RAX to the end
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb r8d, ymm1
+    shr     r8d, cl                 ; Drop the bytes before the buffer,
+    shl     r8d, cl                 ; keeping bit i = byte RAX + i
+    test    r8d, r8d
+    jnz     .found
+
+    add     rax, 32
+    sub     rdx, 32
+    jbe     .none
+    cmp     rdx, 128
+    jbe     .tail
+
+.loop:
+    ; 128 bytes per iteration, all inside the buffer (RDX > 128)
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpcmpeqb ymm2, ymm0, [rax + 32]
+    vpcmpeqb ymm3, ymm0, [rax + 64]
+    vpcmpeqb ymm4, ymm0, [rax + 96]
+    vpor    ymm5, ymm1, ymm2
+    vpor    ymm6, ymm3, ymm4
+    vpor    ymm5, ymm5, ymm6
+    vptest  ymm5, ymm5
+    jnz     .found_4
+    add     rax, 128
+    sub     rdx, 128
+    cmp     rdx, 128
+    ja      .loop
+
+.tail:
+    ; 1-128 bytes left, one block at a time
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb r8d, ymm1
+    test    r8d, r8d
+    jnz     .found
+    add     rax, 32
+    sub     rdx, 32
+    ja      .tail
+
+.none:
+    xor     eax, eax
+    vzeroupper
+    ret
+
+.found_4:
+    ; 64-bit masks: blocks 0-1, then blocks 2-3
+    vpmovmskb r8d, ymm1
+    vpmovmskb ecx, ymm2
+    shl     rcx, 32
+    or      r8, rcx
+    jnz     .found
+    vpmovmskb r8d, ymm3
+    vpmovmskb ecx, ymm4
+    shl     rcx, 32
+    or      r8, rcx
+    add     rax, 64
+    sub     rdx, 64
+
+.found:
+    tzcnt   r8, r8                  ; Offset of the first hit from RAX
+    cmp     r8, rdx
+    jae     .none                   ; Past the end of the buffer
+    add     rax, r8
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: memrchr_avx2
+; Description: Find the last occurrence of a byte
+; Arguments: RDI = buffer, ESI = byte, RDX = length
+; Returns: RAX = pointer to the last match, or 0
+;
+; Mirror image of memchr_avx2: aligned blocks from the one holding the last
+; byte down to the one holding the first, BSR for the highest hit.
+; ============================================================================
+memrchr_avx2:
+    test    rdx, rdx
+    jz      .none
+    vmovd   xmm0, esi
+    vpbroadcastb ymm0, xmm0
+
+    lea     rax, [rdi + rdx - 1]
+    mov     ecx, eax
+    not     ecx
+    and     ecx, 31                 ; Bytes of the last block after the buffer
+    and     rax, -32                ; Aligned block holding the last byte
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb r8d, ymm1
+    shl     r8d, cl                 ; Drop the bytes after the buffer
+    shr     r8d, cl
+    test    r8d, r8d
+    jnz     .found
+
+    mov     rdx, rax
+    sub     rdx, rdi                ; Bytes of the buffer below RAX
+    jbe     .none
+    cmp     rdx, 128
+    jbe     .tail
+
+.loop:
+    ; 128 bytes per iteration, all inside the buffer (RAX - RDI > 128)
+    sub     rax, 128
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpcmpeqb ymm2, ymm0, [rax + 32]
+    vpcmpeqb ymm3, ymm0, [rax + 64]
+    vpcmpeqb ymm4, ymm0, [rax + 96]
+    vpor    ymm5, ymm1, ymm2
+    vpor    ymm6, ymm3, ymm4
+    vpor    ymm5, ymm5, ymm6
+    vptest  ymm5, ymm5
+    jnz     .found_4
+    mov     rdx, rax
+    sub     rdx, rdi
+    cmp     rdx, 128
+    ja      .loop
+
+.tail:
+    ; 1-128 bytes of the buffer below RAX
+    sub     rax, 32
+    vpcmpeqb ymm1, ymm0, [rax]
+    vpmovmskb r8d, ymm1
+    test    r8d, r8d
+    jnz     .found
+    cmp     rax, rdi
+    ja      .tail
+
+.none:
+    xor     eax, eax
+    vzeroupper
+    ret
+
+.found_4:
+    ; 64-bit masks: blocks 2-3 first, they hold the later bytes
+    vpmovmskb r8d, ymm3
+    vpmovmskb ecx, ymm4
+    shl     rcx, 32
+    or      r8, rcx
+    jz      .low_pair
+    add     rax, 64
+    jmp     .found
+.low_pair:
+    vpmovmskb r8d, ymm1
+    vpmovmskb ecx, ymm2
+    shl     rcx, 32
+    or      r8, rcx
+
+.found:
+    bsr     r8, r8                  ; Offset of the last hit from RAX
+    add     rax, r8
+    cmp     rax, rdi
+    jb      .none                   ; Before the start of the buffer
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: mismatch_avx2
+; Description: Compare two buffers and locate the first difference
+; Arguments: RDI = buffer1, RSI = buffer2, RDX = length
+; Returns: RAX = offset of the first differing byte (length if equal)
+;          RDX = buffer1[RAX] - buffer2[RAX], the memcmp result (0 if equal)
+;
+; Loads never pass the end: the last 1-32 bytes are compared by a block
+; that ends at the last byte. It overlaps bytes already known to be equal,
+; so its first set bit is still the first difference. Under 32 bytes the
+; same trick is played with 16-, 8- and 4-byte loads.
+; ============================================================================
+mismatch_avx2:
+    xor     eax, eax                ; Offset
+    mov     r9, rdx                 ; R9 = length
+    cmp     rdx, 32
+    jb      .small
+    cmp     rdx, 64
+    jb      .last
+
+.loop:
+    vmovdqu ymm0, [rdi + rax]
+    vmovdqu ymm1, [rdi + rax + 32]
+    vpcmpeqb ymm0, ymm0, [rsi + rax]
+    vpcmpeqb ymm1, ymm1, [rsi + rax + 32]
+    vpand   ymm2, ymm0, ymm1
+    vpmovmskb r8d, ymm2
+    cmp     r8d, -1
+    jne     .found_2
+    add     rax, 64
+    lea     r8, [rax + 64]
+    cmp     r8, r9
+    jbe     .loop
+
+.last:
+    ; 0-63 bytes left, at least 32 compared or available before them
+    mov     rcx, r9
+    sub     rcx, rax
+    jz      .equal
+    cmp     rcx, 32
+    jbe     .final
+    vmovdqu ymm0, [rdi + rax]
+    vpcmpeqb ymm0, ymm0, [rsi + rax]
+    vpmovmskb r8d, ymm0
+    xor     r8d, -1                 ; Bit set = bytes differ
+    jnz     .found
+.final:
+    lea     rax, [r9 - 32]          ; Block ending at the last byte
+    vmovdqu ymm0, [rdi + rax]
+    vpcmpeqb ymm0, ymm0, [rsi + rax]
+    vpmovmskb r8d, ymm0
+    xor     r8d, -1
+    jnz     .found
+    jmp     .equal
+
+.found_2:
+    vpmovmskb r8d, ymm0
+    vpmovmskb ecx, ymm1
+    shl     rcx, 32
+    or      r8, rcx
+    not     r8
+
+.found:
+    tzcnt   r8, r8
+    add     rax, r8
+.diff:
+    movzx   edx, byte [rdi + rax]
+    movzx   ecx, byte [rsi + rax]
+    sub     rdx, rcx
+    vzeroupper
+    ret
+
+.equal:
+    mov     rax, r9
+    xor     edx, edx
+    vzeroupper
+    ret
+
+.small:
+    cmp     edx, 16
+    jb      .lt16
+    vmovdqu xmm0, [rdi]
+    vpcmpeqb xmm0, xmm0, [rsi]
+    vpmovmskb r8d, xmm0
+    xor     r8d, 0xFFFF
+    jnz     .found
+    lea     rax, [r9 - 16]
+    vmovdqu xmm0, [rdi + rax]
+    vpcmpeqb xmm0, xmm0, [rsi + rax]
+    vpmovmskb r8d, xmm0
+    xor     r8d, 0xFFFF
+    jnz     .found
+    jmp     .equal
+
+.lt16:
+    ; XOR of two little-endian words: the lowest set bit is in the first
+    ; differing byte
+    cmp     edx, 8
+    jb      .lt8
+    mov     r8, [rdi]
+    xor     r8, [rsi]
+    jnz     .found_bytes
+    lea     rax, [r9 - 8]
+    mov     r8, [rdi + rax]
+    xor     r8, [rsi + rax]
+    jnz     .found_bytes
+    jmp     .equal
+.lt8:
+    cmp     edx, 4
+    jb      .lt4
+    mov     r8d, [rdi]
+    xor     r8d, [rsi]
+    jnz     .found_bytes
+    lea     rax, [r9 - 4]
+    mov     r8d, [rdi + rax]
+    xor     r8d, [rsi + rax]
+    jnz     .found_bytes
+    jmp     .equal
+.lt4:
+    test    edx, edx
+    jz      .equal
+.byte:
+    movzx   ecx, byte [rdi + rax]
+    cmp     cl, [rsi + rax]
+    jne     .diff
+    inc     rax
+    cmp     rax, r9
+    jb      .byte
+    jmp     .equal
+
+.found_bytes:
+    tzcnt   r8, r8
+    shr     r8d, 3                  ; Bit -> byte
+    add     rax, r8
+    jmp     .diff
+
+; ============================================================================
+; FUNCTION: memmem_avx2
+; Description: Find the first occurrence of a byte string
+; Arguments: RDI = haystack, RSI = haystack length,
+;            RDX = needle, RCX = needle length
+; Returns: RAX = pointer to the first match, or 0
+;          (the haystack itself for an empty needle)
+;
+; First-and-last-byte filter: for 32 start positions at once, compare the
+; haystack with the needle's first byte and, shifted by needle length - 1,
+; with its last byte. Only positions where both agree are compared in full
+; (mem_equal), which on real text is rare even for short needles. The final
+; block is moved back to end at the last start position so no load passes
+; the haystack; haystacks with under 32 start positions go a byte at a time.
+; ============================================================================
+memmem_avx2:
+    mov     rax, rdi
+    test    rcx, rcx
+    jz      .ret                    ; Empty needle: match at the start
+    cmp     rcx, rsi
+    ja      .too_long
+    cmp     rcx, 1
+    je      .one_byte
+
+    vpbroadcastb ymm0, [rdx]            ; First needle byte
+    vpbroadcastb ymm1, [rdx + rcx - 1]  ; Last needle byte
+    mov     r8, rsi
+    sub     r8, rcx                 ; R8 = last start position
+    lea     r11, [rdi + rcx - 1]    ; R11 = haystack shifted to the last byte
+    xor     r9d, r9d                ; R9 = first start position of the block
+    cmp     r8, 31
+    jb      .scalar
+
+.loop:
+    vpcmpeqb ymm2, ymm0, [rdi + r9]
+    vpcmpeqb ymm3, ymm1, [r11 + r9]
+    vpand   ymm2, ymm2, ymm3
+    vpmovmskb r10d, ymm2
+    test    r10d, r10d
+    jnz     .candidates
+.next:
+    add     r9, 32
+    lea     rax, [r9 + 31]
+    cmp     rax, r8
+    jbe     .loop
+    cmp     r9, r8
+    ja      .none
+    lea     r9, [r8 - 31]           ; Last block, overlapping the previous one
+    jmp     .loop
+
+.candidates:
+    tzcnt   eax, r10d
+    add     rax, r9
+    add     rax, rdi                ; RAX = candidate
+    call    mem_equal
+    je      .found
+    lea     eax, [r10 - 1]
+    and     r10d, eax               ; Next candidate
+    jnz     .candidates
+    jmp     .next
+
+.scalar:
+    movzx   r10d, byte [rdx]
+.scalar_loop:
+    cmp     r9, r8
+    ja      .none
+    cmp     [rdi + r9], r10b
+    jne     .scalar_next
+    lea     rax, [rdi + r9]
+    call    mem_equal
+    je      .found
+.scalar_next:
+    inc     r9
+    jmp     .scalar_loop
+
+.found:
+    vzeroupper
+    ret
+
+.none:
+    vzeroupper
+.too_long:
+    xor     eax, eax
+.ret:
+    ret
+
+.one_byte:
+    movzx   eax, byte [rdx]
+    mov     rdx, rsi
+    mov     esi, eax
+    jmp     memchr_avx2
+
+; ============================================================================
+; FUNCTION: memmem_sse42
+; Description: memmem with PCMPESTRI, for CPUs without AVX2
+; Arguments: RDI = haystack, RSI = haystack length,
+;            RDX = needle, RCX = needle length
+; Returns: RAX = pointer to the first match, or 0
+;
+; PCMPESTRI in equal-ordered mode (imm8 0x0C) returns the first position in
+; a 16-byte block where the needle (its first 16 bytes) starts, including
+; a partial match running off the end of the block - that is how matches
+; straddling two blocks are found. Each candidate is then compared in full
+; and the search resumes one byte after it.
+; ============================================================================
+memmem_sse42:
+    mov     rax, rdi
+    test    rcx, rcx
+    jz      .ret
+    cmp     rcx, rsi
+    ja      .none
+
+    mov     r8, rdx                 ; R8 = needle
+    mov     r9, rcx                 ; R9 = needle length
+    lea     r10, [rdi + rsi]        ; R10 = end of the haystack
+    mov     r11, rdi                ; R11 = search position
+    mov     rsi, r8
+    mov     rdx, r9
+    call    .load
+    movdqa  xmm1, xmm0              ; XMM1 = needle, first 16 bytes at most
+
+.loop:
+    mov     rsi, r11
+    mov     rdx, r10
+    sub     rdx, r11                ; Haystack bytes left
+    cmp     rdx, r9
+    jb      .none                   ; Too few for a match
+    call    .load                   ; XMM0 = haystack block
+
+    mov     ecx, 16                 ; Explicit lengths, at most 16
+    cmp     rdx, rcx
+    cmova   rdx, rcx
+    mov     rax, r9
+    cmp     rax, rcx
+    cmova   rax, rcx
+    pcmpestri xmm1, xmm0, 0x0C
+    jnc     .advance                ; No (partial) match in this block
+
+    lea     rax, [r11 + rcx]        ; RAX = candidate
+    mov     rdx, r10
+    sub     rdx, rax
+    cmp     rdx, r9
+    jb      .none                   ; Runs past the end
+    mov     rdx, r8
+    mov     rcx, r9
+    call    mem_equal
+    je      .ret
+    lea     r11, [rax + 1]
+    jmp     .loop
+
+.advance:
+    cmp     edx, 16
+    jb      .none                   ; That was the end of the haystack
+    add     r11, 16
+    jmp     .loop
+
+.none:
+    xor     eax, eax
+.ret:
+    ret
+
+; XMM0 = 16 bytes at RSI, of which RDX (>= 1) are readable. If the other
+; bytes might be in the next page, load the 16 bytes ending at the last
+; readable one instead and shift them down with PSHUFB.
+.load:
+    cmp     rdx, 16
+    jae     .load_full
+    mov     eax, esi
+    and     eax, 4095
+    cmp     eax, 4096 - 16
+    jbe     .load_full
+    movdqu  xmm0, [rsi + rdx - 16]
+    mov     eax, 16
+    sub     eax, edx
+    movdqu  xmm2, [shift_down_mask + rax]
+    pshufb  xmm0, xmm2
+    ret
+.load_full:
+    movdqu  xmm0, [rsi]
+    ret
+
+; ============================================================================
+; FUNCTION: mem_equal (internal)
+; Description: Compare RCX bytes at RAX and RDX, 8 bytes per step
+; Returns: ZF = 1 if equal; every register is preserved
+; ============================================================================
+mem_equal:
+    push    rbx
+    push    r12
+    xor     ebx, ebx
+.qwords:
+    lea     r12, [rbx + 8]
+    cmp     r12, rcx
+    ja      .bytes
+    mov     r12, [rax + rbx]
+    cmp     r12, [rdx + rbx]
+    jne     .done
+    add     rbx, 8
+    jmp     .qwords
+.bytes:
+    cmp     rbx, rcx
+    je      .done                   ; All equal, ZF = 1
+    movzx   r12d, byte [rax + rbx]
+    cmp     r12b, [rdx + rbx]
+    jne     .done
+    inc     rbx
+    jmp     .bytes
+.done:
+    pop     r12                     ; POP leaves the flags alone
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: has_sse42
+; Description: Check whether memmem_sse42 may be used
+; Returns: RAX = 1 if CPUID reports SSE4.2, else 0
+; ============================================================================
+has_sse42:
+    push    rbx
+    mov     eax, 1
+    cpuid
+    xor     eax, eax
+    bt      ecx, 20                 ; SSE4.2
+    setc    al
+    pop     rbx
+    ret
+
+; ============================================================================
+; REFERENCE SEARCH (string instructions)
+; ============================================================================
+;
+; FUNCTION: memchr_scasb
+; Arguments: RDI = buffer, ESI = byte, RDX = length
+; Returns: RAX = pointer to the first match, or 0
+; ============================================================================
+memchr_scasb:
+    mov     eax, esi
+    mov     rcx, rdx
+    test    rcx, rcx
+    jz      .none                   ; REPNE with RCX = 0 leaves ZF alone
+    repne   scasb
+    jne     .none
+    lea     rax, [rdi - 1]          ; RDI stops one past the match
+    ret
+.none:
+    xor     eax, eax
+    ret
+
+; ============================================================================
+; FUNCTION: memrchr_scasb
+; Arguments: RDI = buffer, ESI = byte, RDX = length
+; Returns: RAX = pointer to the last match, or 0
+; ============================================================================
+memrchr_scasb:
+    mov     eax, esi
+    mov     rcx, rdx
+    test    rcx, rcx
+    jz      .none
+    lea     rdi, [rdi + rdx - 1]
+    std                             ; Scan downwards
+    repne   scasb
+    cld
+    jne     .none
+    lea     rax, [rdi + 1]
+    ret
+.none:
+    xor     eax, eax
+    ret
+
+; ============================================================================
+; FUNCTION: mismatch_cmpsb
+; Arguments: RDI = buffer1, RSI = buffer2, RDX = length
+; Returns: RAX = offset of the first differing byte (length if equal)
+;          RDX = buffer1[RAX] - buffer2[RAX] (0 if equal)
+; ============================================================================
+mismatch_cmpsb:
+    mov     rcx, rdx
+    mov     r8, rdx
+    test    rcx, rcx                ; ZF = 1: empty buffers are equal
+    repe    cmpsb
+    je      .equal
+    movzx   edx, byte [rdi - 1]     ; Both pointers stop one past it
+    movzx   eax, byte [rsi - 1]
+    sub     rdx, rax
+    mov     rax, r8
+    sub     rax, rcx
+    dec     rax
+    ret
+.equal:
+    mov     rax, r8
+    xor     edx, edx
+    ret
+
+; ============================================================================
+; FUNCTION: memmem_byte
+; Arguments: RDI = haystack, RSI = haystack length,
+;            RDX = needle, RCX = needle length
+; Returns: RAX = pointer to the first match, or 0
+; Note: REPE CMPSB at every start position
+; ============================================================================
+memmem_byte:
+    mov     rax, rdi
+    test    rcx, rcx
+    jz      .ret
+    cmp     rcx, rsi
+    ja      .none
+    lea     r8, [rdi + rsi]
+    sub     r8, rcx                 ; R8 = last start position
+    mov     r9, rcx
+    mov     r10, rdx
+.loop:
+    mov     rdi, rax
+    mov     rsi, r10
+    mov     rcx, r9
+    repe    cmpsb
+    je      .ret
+    inc     rax
+    cmp     rax, r8
+    jbe     .loop
+.none:
+    xor     eax, eax
+.ret:
+    ret
+
+; ============================================================================
+; FUNCTION: verify_search_routines
+; Description: Check memchr/memrchr/mismatch/memmem against the string
+;              instruction versions for lengths 0-160. The buffers sit
+;              against unmapped pages, so a load past either end faults.
+;              Needs AVX2; memmem_sse42 is checked too when SSE4.2 is there.
+; Returns: RAX = 0 if every result matches, 1 otherwise
+; ============================================================================
+verify_search_routines:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 24
+
+    call    has_sse42
+    mov     [rsp + 8], rax
+
+    ; Four pages: data, unmapped, data, unmapped
+    mov     eax, 9                  ; mmap
+    xor     edi, edi
+    mov     esi, 4 * 4096
+    mov     edx, 3                  ; PROT_READ | PROT_WRITE
+    mov     r10d, 0x22              ; MAP_PRIVATE | MAP_ANONYMOUS
+    mov     r8, -1
+    xor     r9d, r9d
+    syscall
+    cmp     rax, -4095
+    jae     .no_map
+    mov     rbp, rax
+    mov     eax, 10                 ; mprotect(page 1, PROT_NONE)
+    lea     rdi, [rbp + 4096]
+    mov     esi, 4096
+    xor     edx, edx
+    syscall
+    test    rax, rax
+    jnz     .fail
+    mov     eax, 10                 ; mprotect(page 3, PROT_NONE)
+    lea     rdi, [rbp + 3 * 4096]
+    mov     esi, 4096
+    xor     edx, edx
+    syscall
+    test    rax, rax
+    jnz     .fail
+
+    ; --- memchr/memrchr: an 'x' buffer in a page of 'y', with 'y' at
+    ;     positions p and length-1-p; the 'y' around it must be ignored ---
+    lea     rdi, [rbp + 2 * 4096]
+    mov     ecx, 4096
+    mov     al, 'y'
+    rep     stosb
+    xor     r12d, r12d              ; Length
+.chr_len:
+    xor     r15d, r15d              ; 0: at the page start, 1: at the page end
+.chr_place:
+    lea     r14, [rbp + 2 * 4096]
+    test    r15d, r15d
+    jz      .chr_fill
+    add     r14, 4096
+    sub     r14, r12
+.chr_fill:
+    mov     rdi, r14
+    mov     rcx, r12
+    mov     al, 'x'
+    rep     stosb
+    xor     r13d, r13d              ; p; p = length means no match
+.chr_pos:
+    cmp     r13, r12
+    jae     .chr_test
+    mov     byte [r14 + r13], 'y'
+    mov     rax, r12
+    sub     rax, r13
+    mov     byte [r14 + rax - 1], 'y'
+.chr_test:
+    mov     rdi, r14
+    mov     esi, 'y'
+    mov     rdx, r12
+    call    memchr_scasb
+    mov     rbx, rax
+    mov     rdi, r14
+    mov     esi, 'y'
+    mov     rdx, r12
+    call    memchr_avx2
+    cmp     rax, rbx
+    jne     .fail
+    mov     rdi, r14
+    mov     esi, 'y'
+    mov     rdx, r12
+    call    memrchr_scasb
+    mov     rbx, rax
+    mov     rdi, r14
+    mov     esi, 'y'
+    mov     rdx, r12
+    call    memrchr_avx2
+    cmp     rax, rbx
+    jne     .fail
+    cmp     r13, r12
+    jae     .chr_next
+    mov     byte [r14 + r13], 'x'
+    mov     rax, r12
+    sub     rax, r13
+    mov     byte [r14 + rax - 1], 'x'
+    inc     r13
+    jmp     .chr_pos
+.chr_next:
+    mov     rdi, r14
+    mov     rcx, r12
+    mov     al, 'y'
+    rep     stosb
+    inc     r15d
+    cmp     r15d, 2
+    jb      .chr_place
+    inc     r12
+    cmp     r12, SEARCH_TEST_LEN
+    jbe     .chr_len
+
+    ; --- mismatch: equal buffers ending at pages 0 and 2, then byte p
+    ;     incremented and the last byte changed as well ---
+    xor     ecx, ecx
+.cmp_fill:
+    lea     eax, [rcx*8]
+    sub     eax, ecx
+    add     eax, 3                  ; Byte i = i * 7 + 3
+    mov     [rbp + rcx], al
+    mov     [rbp + 2 * 4096 + rcx], al
+    inc     ecx
+    cmp     ecx, 4096
+    jb      .cmp_fill
+    xor     r12d, r12d
+.cmp_len:
+    lea     r14, [rbp + 3 * 4096]
+    sub     r14, r12                ; Buffer 1
+    xor     r13d, r13d              ; p; p = length means equal
+.cmp_pos:
+    cmp     r13, r12
+    jae     .cmp_test
+    inc     byte [r14 + r13]
+    xor     byte [r14 + r12 - 1], 0x40
+.cmp_test:
+    mov     rdi, r14
+    lea     rsi, [rbp + 4096]
+    sub     rsi, r12                ; Buffer 2
+    mov     rdx, r12
+    call    mismatch_cmpsb
+    mov     rbx, rax
+    mov     [rsp], rdx
+    mov     rdi, r14
+    lea     rsi, [rbp + 4096]
+    sub     rsi, r12
+    mov     rdx, r12
+    call    mismatch_avx2
+    cmp     rax, rbx
+    jne     .fail
+    cmp     rdx, [rsp]
+    jne     .fail
+    cmp     r13, r12
+    jae     .cmp_next
+    xor     byte [r14 + r12 - 1], 0x40
+    dec     byte [r14 + r13]
+    inc     r13
+    jmp     .cmp_pos
+.cmp_next:
+    inc     r12
+    cmp     r12, SEARCH_TEST_LEN
+    jbe     .cmp_len
+
+    ; --- memmem: Thue-Morse text ("abbabaab...") is full of near matches.
+    ;     Needles: a piece of the same sequence, then with the last byte
+    ;     flipped, then with a 'c' that never matches ---
+    xor     ecx, ecx
+.mem_fill:
+    popcnt  eax, ecx
+    and     eax, 1
+    add     eax, 'a'
+    mov     [rbp + 2 * 4096 + rcx], al
+    inc     ecx
+    cmp     ecx, 4096
+    jb      .mem_fill
+    xor     r12d, r12d
+.mem_len:
+    lea     r14, [rbp + 3 * 4096]
+    sub     r14, r12                ; Haystack
+    xor     r13d, r13d              ; Needle length
+.mem_needle:
+    lea     rax, [r12*8]
+    sub     rax, r12
+    lea     rax, [rax + r13*2]
+    add     rax, r13
+    and     eax, 2047               ; Needle = sequence from 7 * len + 3 * k
+    lea     rdi, [rbp + 4096]
+    sub     rdi, r13
+    xor     ecx, ecx
+.mem_needle_fill:
+    cmp     rcx, r13
+    jae     .mem_needle_done
+    lea     edx, [rax + rcx]
+    popcnt  edx, edx
+    and     edx, 1
+    add     edx, 'a'
+    mov     [rdi + rcx], dl
+    inc     ecx
+    jmp     .mem_needle_fill
+.mem_needle_done:
+    xor     r15d, r15d              ; Variant
+.mem_test:
+    mov     rdi, r14
+    mov     rsi, r12
+    lea     rdx, [rbp + 4096]
+    sub     rdx, r13
+    mov     rcx, r13
+    call    memmem_byte
+    mov     rbx, rax
+    mov     rdi, r14
+    mov     rsi, r12
+    lea     rdx, [rbp + 4096]
+    sub     rdx, r13
+    mov     rcx, r13
+    call    memmem_avx2
+    cmp     rax, rbx
+    jne     .fail
+    cmp     qword [rsp + 8], 0
+    je      .mem_variant
+    mov     rdi, r14
+    mov     rsi, r12
+    lea     rdx, [rbp + 4096]
+    sub     rdx, r13
+    mov     rcx, r13
+    call    memmem_sse42
+    cmp     rax, rbx
+    jne     .fail
+.mem_variant:
+    test    r13, r13
+    jz      .mem_next               ; Nothing to vary in an empty needle
+    inc     r15d
+    lea     rdi, [rbp + 4096]
+    sub     rdi, r13
+    cmp     r15d, 1
+    jne     .mem_variant_2
+    xor     byte [rdi + r13 - 1], 'a' ^ 'b'
+    jmp     .mem_test
+.mem_variant_2:
+    cmp     r15d, 2
+    jne     .mem_next
+    mov     rax, r13
+    shr     rax, 1
+    mov     byte [rdi + rax], 'c'
+    jmp     .mem_test
+.mem_next:
+    inc     r13
+    cmp     r13, SEARCH_NEEDLE_MAX
+    jbe     .mem_needle
+    inc     r12
+    cmp     r12, SEARCH_TEST_LEN
+    jbe     .mem_len
+
+    xor     ebx, ebx
+    jmp     .unmap
+
+.fail:
+    mov     ebx, 1
+
+.unmap:
+    mov     eax, 11                 ; munmap
+    mov     rdi, rbp
+    mov     esi, 4 * 4096
+    syscall
+    mov     eax, ebx
+    jmp     .done
+
+.no_map:
+    mov     eax, 1
+
+.done:
+    add     rsp, 24
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+; ============================================================================
+; ASCII TRANSFORMS (case, case-insensitive compare, classes, translation)
+; ============================================================================
+;
+; Vector forms of process_loop: every byte goes through the same few
+; instructions with no branch on its value, 32 bytes at a time. Bytes
+; outside the ASCII letters pass through unchanged, so UTF-8 text is safe.
+; The *_byte versions (LODSB/STOSB, XLATB) are the references they are
+; tested against. Destination and source may be the same buffer but must
+; not otherwise overlap. The AVX2 routines need has_avx2.
+;
+; Case flip without branches: adding 128 - 'a' moves 'a'..'z' to the 26
+; most negative signed bytes, so one VPCMPGTB against -128 + 26 marks them;
+; AND with 0x20 and XOR clears (or, with 'A', sets) the case bit.
+;
+; CASE_FLIP data, temp, bias (128 - first letter), -128 + 26, 0x20
+%macro CASE_FLIP 5
+    vpaddb  %2, %1, %3
+    vpcmpgtb %2, %4, %2             ; 0xFF for letters of the case to flip
+    vpand   %2, %2, %5
+    vpxor   %1, %1, %2
+%endmacro
+
+; ============================================================================
+; FUNCTION: ascii_toupper_avx2 / ascii_tolower_avx2
+; Description: Convert ASCII letters to upper / lower case
+; Arguments: RDI = destination, RSI = source (may equal RDI), RDX = length
+; Returns: RAX = destination
+;
+; The last 1-32 bytes are redone by a block ending at the last byte. In
+; place, that block re-reads bytes already converted, which is harmless:
+; converting twice gives the same result.
+; ============================================================================
+ascii_toupper_avx2:
+    mov     r9d, 'a'                ; First letter to flip
+    jmp     ascii_case_avx2
+ascii_tolower_avx2:
+    mov     r9d, 'A'
+
+ascii_case_avx2:
+    mov     rax, rdi
+    mov     ecx, 128
+    sub     ecx, r9d
+    vmovd   xmm13, ecx
+    vpbroadcastb ymm13, xmm13       ; YMM13 = 128 - first letter
+    mov     ecx, -128 + 26
+    vmovd   xmm14, ecx
+    vpbroadcastb ymm14, xmm14
+    mov     ecx, 0x20
+    vmovd   xmm15, ecx
+    vpbroadcastb ymm15, xmm15
+    cmp     rdx, 32
+    jb      .small
+
+    xor     ecx, ecx                ; Offset
+    cmp     rdx, 64
+    jb      .last
+.loop:
+    vmovdqu ymm0, [rsi + rcx]
+    vmovdqu ymm2, [rsi + rcx + 32]
+    CASE_FLIP ymm0, ymm1, ymm13, ymm14, ymm15
+    CASE_FLIP ymm2, ymm3, ymm13, ymm14, ymm15
+    vmovdqu [rdi + rcx], ymm0
+    vmovdqu [rdi + rcx + 32], ymm2
+    add     rcx, 64
+    lea     r8, [rcx + 64]
+    cmp     r8, rdx
+    jbe     .loop
+.last:
+    lea     r8, [rcx + 32]
+    cmp     r8, rdx
+    jae     .final                  ; At most 32 bytes left
+    vmovdqu ymm0, [rsi + rcx]
+    CASE_FLIP ymm0, ymm1, ymm13, ymm14, ymm15
+    vmovdqu [rdi + rcx], ymm0
+.final:
+    vmovdqu ymm0, [rsi + rdx - 32]
+    CASE_FLIP ymm0, ymm1, ymm13, ymm14, ymm15
+    vmovdqu [rdi + rdx - 32], ymm0
+    vzeroupper
+    ret
+
+.small:
+    cmp     edx, 16
+    jb      .bytes
+    vmovdqu xmm0, [rsi]
+    vmovdqu xmm2, [rsi + rdx - 16]  ; Both loaded before either store
+    CASE_FLIP xmm0, xmm1, xmm13, xmm14, xmm15
+    CASE_FLIP xmm2, xmm3, xmm13, xmm14, xmm15
+    vmovdqu [rdi], xmm0
+    vmovdqu [rdi + rdx - 16], xmm2
+    vzeroupper
+    ret
+
+.bytes:
+    ; Same test on one byte: (c - first) < 26 unsigned, SBB makes the mask
+    vzeroupper
+    xor     ecx, ecx
+    test    edx, edx
+    jz      .done
+.byte:
+    movzx   r8d, byte [rsi + rcx]
+    mov     r10d, r8d
+    sub     r10d, r9d
+    cmp     r10d, 26
+    sbb     r10d, r10d              ; -1 for a letter to flip, else 0
+    and     r10d, 0x20
+    xor     r8d, r10d
+    mov     [rdi + rcx], r8b
+    inc     ecx
+    cmp     ecx, edx
+    jb      .byte
+.done:
+    ret
+
+; ============================================================================
+; FUNCTION: ascii_casecmp_avx2
+; Description: Compare two buffers ignoring ASCII case
+; Arguments: RDI = buffer1, RSI = buffer2, RDX = length
+; Returns: RAX = tolower(buffer1[i]) - tolower(buffer2[i]) at the first
+;          difference, 0 if equal (the sign of strncasecmp)
+;
+; Both sides are lowered with CASE_FLIP and compared as in mismatch_avx2,
+; including the final block that ends at the last byte.
+; ============================================================================
+ascii_casecmp_avx2:
+    mov     ecx, 128 - 'A'
+    vmovd   xmm13, ecx
+    vpbroadcastb ymm13, xmm13
+    mov     ecx, -128 + 26
+    vmovd   xmm14, ecx
+    vpbroadcastb ymm14, xmm14
+    mov     ecx, 0x20
+    vmovd   xmm15, ecx
+    vpbroadcastb ymm15, xmm15
+    xor     eax, eax                ; Offset
+    cmp     rdx, 32
+    jb      .small
+    lea     r8, [rdx - 32]          ; Offset of the final block
+
+.loop:
+    vmovdqu ymm0, [rdi + rax]
+    vmovdqu ymm2, [rsi + rax]
+    CASE_FLIP ymm0, ymm1, ymm13, ymm14, ymm15
+    CASE_FLIP ymm2, ymm3, ymm13, ymm14, ymm15
+    vpcmpeqb ymm0, ymm0, ymm2
+    vpmovmskb ecx, ymm0
+    xor     ecx, -1                 ; Bit set = bytes differ
+    jnz     .found
+    cmp     rax, r8
+    je      .equal                  ; That was the final block
+    add     rax, 32
+    cmp     rax, r8
+    jbe     .loop
+    mov     rax, r8                 ; Block ending at the last byte
+    jmp     .loop
+
+.small:
+    cmp     edx, 16
+    jb      .bytes
+    vmovdqu xmm0, [rdi]
+    vmovdqu xmm2, [rsi]
+    CASE_FLIP xmm0, xmm1, xmm13, xmm14, xmm15
+    CASE_FLIP xmm2, xmm3, xmm13, xmm14, xmm15
+    vpcmpeqb xmm0, xmm0, xmm2
+    vpmovmskb ecx, xmm0
+    xor     ecx, 0xFFFF
+    jnz     .found
+    lea     rax, [rdx - 16]
+    vmovdqu xmm0, [rdi + rax]
+    vmovdqu xmm2, [rsi + rax]
+    CASE_FLIP xmm0, xmm1, xmm13, xmm14, xmm15
+    CASE_FLIP xmm2, xmm3, xmm13, xmm14, xmm15
+    vpcmpeqb xmm0, xmm0, xmm2
+    vpmovmskb ecx, xmm0
+    xor     ecx, 0xFFFF
+    jnz     .found
+.equal:
+    xor     eax, eax
+    vzeroupper
+    ret
+
+.found:
+    tzcnt   ecx, ecx
+    add     rax, rcx
+    mov     rdx, rax                ; Compare this byte and stop
+    inc     rdx
+
+.bytes:
+    vzeroupper
+.byte:
+    cmp     rax, rdx
+    jae     .byte_equal
+    movzx   ecx, byte [rdi + rax]
+    lea     r8d, [rcx - 'A']
+    cmp     r8d, 26
+    sbb     r8d, r8d
+    and     r8d, 0x20
+    or      ecx, r8d                ; tolower
+    movzx   r9d, byte [rsi + rax]
+    lea     r8d, [r9 - 'A']
+    cmp     r8d, 26
+    sbb     r8d, r8d
+    and     r8d, 0x20
+    or      r9d, r8d
+    inc     rax
+    sub     ecx, r9d
+    jz      .byte
+    movsx   rax, ecx
+    ret
+.byte_equal:
+    xor     eax, eax
+    ret
+
+; ============================================================================
+; FUNCTION: ascii_classify_avx2
+; Description: Character-class bitmaps: bit i of a map describes byte i
+; Arguments: RDI = source, RSI = length, RDX = digit map,
+;            RCX = letter map, R8 = space map
+;            (each map gets (length + 31) / 32 dwords; bits past the end
+;            are 0)
+;
+; Classes as in the C locale: '0'-'9', 'A'-'Z' and 'a'-'z', and ' ' \t \n
+; \v \f \r. Two VPSHUFB lookups classify all three at once, one indexed
+; by the low nibble and one by the high nibble: a byte has a class bit if
+; both its entries have it (ascii_class_lo / ascii_class_hi).
+; ============================================================================
+; CLASSIFY_BLOCK: classify the 32 bytes in YMM0, store one dword per map
+; and advance the map pointers
+%macro CLASSIFY_BLOCK 0
+    vpsrlw  ymm1, ymm0, 4
+    vpand   ymm0, ymm0, ymm15       ; Low nibbles
+    vpand   ymm1, ymm1, ymm15       ; High nibbles
+    vpshufb ymm0, ymm13, ymm0
+    vpshufb ymm1, ymm14, ymm1
+    vpand   ymm0, ymm0, ymm1        ; Class bits of every byte
+    vpand   ymm1, ymm0, ymm10
+    vpcmpgtb ymm1, ymm1, ymm9       ; Class bits are < 0x80: > 0 = has one
+    vpmovmskb eax, ymm1
+    mov     [rdx], eax
+    vpand   ymm1, ymm0, ymm11
+    vpcmpgtb ymm1, ymm1, ymm9
+    vpmovmskb eax, ymm1
+    mov     [rcx], eax
+    vpand   ymm1, ymm0, ymm12
+    vpcmpgtb ymm1, ymm1, ymm9
+    vpmovmskb eax, ymm1
+    mov     [r8], eax
+    add     rdx, 4
+    add     rcx, 4
+    add     r8, 4
+%endmacro
+
+ascii_classify_avx2:
+    vbroadcasti128 ymm13, [ascii_class_lo]
+    vbroadcasti128 ymm14, [ascii_class_hi]
+    mov     eax, 0x0F
+    vmovd   xmm15, eax
+    vpbroadcastb ymm15, xmm15
+    mov     eax, ASCII_DIGIT
+    vmovd   xmm10, eax
+    vpbroadcastb ymm10, xmm10
+    mov     eax, ASCII_ALPHA
+    vmovd   xmm11, eax
+    vpbroadcastb ymm11, xmm11
+    mov     eax, ASCII_SPACE
+    vmovd   xmm12, eax
+    vpbroadcastb ymm12, xmm12
+    vpxor   xmm9, xmm9, xmm9
+
+.loop:
+    cmp     rsi, 32
+    jb      .tail
+    vmovdqu ymm0, [rdi]
+    CLASSIFY_BLOCK
+    add     rdi, 32
+    sub     rsi, 32
+    jmp     .loop
+
+.tail:
+    ; Copy the last 1-31 bytes into a zeroed block on the stack (NUL is
+    ; in no class, so the padding adds no bits)
+    test    rsi, rsi
+    jz      .done
+    sub     rsp, 40
+    vmovdqu [rsp], ymm9
+    xor     eax, eax
+.tail_copy:
+    movzx   r9d, byte [rdi + rax]
+    mov     [rsp + rax], r9b
+    inc     eax
+    cmp     rax, rsi
+    jb      .tail_copy
+    vmovdqu ymm0, [rsp]
+    CLASSIFY_BLOCK
+    add     rsp, 40
+.done:
+    vzeroupper
+    ret
+
+
+; ============================================================================
+; FUNCTION: ascii_translate_avx2
+; Description: dst[i] = table[src[i]] for any 256-byte table
+; Arguments: RDI = destination, RSI = source (may equal RDI), RDX = length,
+;            RCX = table
+; Returns: RAX = destination
+;
+; VPSHUFB looks up 16 entries and returns 0 for an index with bit 7 set.
+; For a 7-bit index i, i - 16h has bit 7 clear exactly when h <= i / 16,
+; so XOR-ing the lookups in the difference rows D[h] = row h ^ row h-1
+; for h = 0..7 leaves row (i / 16) entry (i % 16). The two 128-entry
+; halves of the table each run that chain on the low 7 bits, and
+; VPBLENDVB picks one per byte by bit 7 of the source.
+;
+; Translating twice is not the same as translating once, so the last
+; block (which overlaps earlier ones) is translated first and stored last.
+; Under 32 bytes the table is read a byte at a time.
+; ============================================================================
+; TRANSLATE_ROW D[row] register, row: one step of both chains (inside
+; .block, so the stack rows are 8 bytes further up)
+%macro TRANSLATE_ROW 2
+    vpsubb  ymm1, ymm1, ymm6        ; Index - 16 * row
+    vpshufb ymm4, %1, ymm1
+    vpxor   ymm2, ymm2, ymm4
+    vmovdqa ymm5, [rsp + 8 + (8 + %2) * 32]
+    vpshufb ymm5, ymm5, ymm1
+    vpxor   ymm3, ymm3, ymm5
+%endmacro
+
+ascii_translate_avx2:
+    push    rbp
+    mov     rbp, rsp
+    sub     rsp, 16 * 32 + 32
+    and     rsp, -32
+    mov     rax, rdi
+
+    cmp     rdx, 32
+    jb      .bytes
+
+    ; D[0..15] on the stack, D[0..7] also in YMM8-YMM15
+    vbroadcasti128 ymm0, [rcx]
+    vmovdqa [rsp], ymm0
+    vbroadcasti128 ymm0, [rcx + 128]
+    vmovdqa [rsp + 8 * 32], ymm0
+    mov     r8d, 16                 ; Table offset of row h = 1..7
+.rows:
+    vbroadcasti128 ymm0, [rcx + r8 - 16]
+    vbroadcasti128 ymm1, [rcx + r8]
+    vpxor   ymm0, ymm0, ymm1
+    vmovdqa [rsp + r8*2], ymm0      ; D[h] at 32h
+    vbroadcasti128 ymm0, [rcx + r8 + 128 - 16]
+    vbroadcasti128 ymm1, [rcx + r8 + 128]
+    vpxor   ymm0, ymm0, ymm1
+    vmovdqa [rsp + r8*2 + 8 * 32], ymm0
+    add     r8d, 16
+    cmp     r8d, 128
+    jb      .rows
+    vmovdqa ymm8, [rsp]
+    vmovdqa ymm9, [rsp + 32]
+    vmovdqa ymm10, [rsp + 2 * 32]
+    vmovdqa ymm11, [rsp + 3 * 32]
+    vmovdqa ymm12, [rsp + 4 * 32]
+    vmovdqa ymm13, [rsp + 5 * 32]
+    vmovdqa ymm14, [rsp + 6 * 32]
+    vmovdqa ymm15, [rsp + 7 * 32]
+    mov     r8d, 0x7F
+    vmovd   xmm7, r8d
+    vpbroadcastb ymm7, xmm7
+    mov     r8d, 0x10
+    vmovd   xmm6, r8d
+    vpbroadcastb ymm6, xmm6
+
+    lea     r8, [rdx - 32]          ; Offset of the last block
+    vmovdqu ymm0, [rsi + r8]
+    call    .block
+    vmovdqa [rsp + 16 * 32], ymm0   ; Stored after the loop
+    xor     r9d, r9d
+.loop:
+    cmp     r9, r8
+    jae     .last
+    vmovdqu ymm0, [rsi + r9]
+    call    .block
+    vmovdqu [rdi + r9], ymm0
+    add     r9, 32
+    jmp     .loop
+.last:
+    vmovdqa ymm0, [rsp + 16 * 32]
+    vmovdqu [rdi + r8], ymm0
+    vzeroupper
+    leave
+    ret
+
+.bytes:
+    xor     r8d, r8d
+.byte:
+    cmp     r8, rdx
+    jae     .bytes_done
+    movzx   r9d, byte [rsi + r8]
+    movzx   r9d, byte [rcx + r9]
+    mov     [rdi + r8], r9b
+    inc     r8
+    jmp     .byte
+.bytes_done:
+    leave
+    ret
+
+; Translate the 32 bytes in YMM0
+.block:
+    vpand   ymm1, ymm0, ymm7        ; Low 7 bits
+    vpshufb ymm2, ymm8, ymm1        ; Lower half, row 0
+    vmovdqa ymm4, [rsp + 8 + 8 * 32]
+    vpshufb ymm3, ymm4, ymm1        ; Upper half, row 8
+    TRANSLATE_ROW ymm9, 1
+    TRANSLATE_ROW ymm10, 2
+    TRANSLATE_ROW ymm11, 3
+    TRANSLATE_ROW ymm12, 4
+    TRANSLATE_ROW ymm13, 5
+    TRANSLATE_ROW ymm14, 6
+    TRANSLATE_ROW ymm15, 7
+    vpblendvb ymm0, ymm2, ymm3, ymm0
+    ret
+
+; ============================================================================
+; REFERENCE ASCII TRANSFORMS (one byte per iteration)
+; ============================================================================
+;
+; FUNCTION: ascii_toupper_byte / ascii_tolower_byte
+; Arguments: RDI = destination, RSI = source, RDX = length
+; Returns: RAX = destination
+; Note: process_loop with the result stored
+; ============================================================================
+ascii_toupper_byte:
+    mov     r8d, 'a'
+    jmp     ascii_case_byte
+ascii_tolower_byte:
+    mov     r8d, 'A'
+
+ascii_case_byte:
+    mov     r9, rdi
+    mov     rcx, rdx
+    jrcxz   .done
+.loop:
+    lodsb
+    cmp     al, r8b
+    jb      .store
+    lea     edx, [r8 + 25]
+    cmp     al, dl
+    ja      .store
+    xor     al, 0x20                ; Flip the case bit
+.store:
+    stosb
+    dec     rcx
+    jnz     .loop
+.done:
+    mov     rax, r9
+    ret
+
+; ============================================================================
+; FUNCTION: ascii_casecmp_byte
+; Arguments: RDI = buffer1, RSI = buffer2, RDX = length
+; Returns: RAX = tolower(buffer1[i]) - tolower(buffer2[i]), 0 if equal
+; ============================================================================
+ascii_casecmp_byte:
+    xor     ecx, ecx
+.loop:
+    cmp     rcx, rdx
+    jae     .equal
+    movzx   eax, byte [rdi + rcx]
+    movzx   r8d, byte [rsi + rcx]
+    inc     rcx
+    cmp     eax, 'A'
+    jb      .a_done
+    cmp     eax, 'Z'
+    ja      .a_done
+    or      eax, 0x20
+.a_done:
+    cmp     r8d, 'A'
+    jb      .b_done
+    cmp     r8d, 'Z'
+    ja      .b_done
+    or      r8d, 0x20
+.b_done:
+    sub     eax, r8d
+    jz      .loop
+    movsx   rax, eax
+    ret
+.equal:
+    xor     eax, eax
+    ret
+
+; ============================================================================
+; FUNCTION: ascii_classify_byte
+; Arguments: as ascii_classify_avx2
+; ============================================================================
+ascii_classify_byte:
+    push    rbx
+    ; Clear the maps: (length + 31) / 32 dwords each
+    lea     rax, [rsi + 31]
+    shr     rax, 5
+    xor     r9d, r9d
+.clear:
+    cmp     r9, rax
+    jae     .cleared
+    mov     dword [rdx + r9*4], 0
+    mov     dword [rcx + r9*4], 0
+    mov     dword [r8 + r9*4], 0
+    inc     r9
+    jmp     .clear
+.cleared:
+    xor     r9d, r9d
+.loop:
+    cmp     r9, rsi
+    jae     .done
+    movzx   eax, byte [rdi + r9]
+    lea     ebx, [rax - '0']
+    cmp     ebx, 10
+    jae     .not_digit
+    bts     [rdx], r9               ; Bit offset can exceed 63 with memory
+.not_digit:
+    mov     ebx, eax
+    or      ebx, 0x20
+    sub     ebx, 'a'
+    cmp     ebx, 26
+    jae     .not_alpha
+    bts     [rcx], r9
+.not_alpha:
+    cmp     eax, ' '
+    je      .space
+    lea     ebx, [rax - 9]
+    cmp     ebx, 5                  ; \t \n \v \f \r
+    jae     .next
+.space:
+    bts     [r8], r9
+.next:
+    inc     r9
+    jmp     .loop
+.done:
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: ascii_translate_byte
+; Arguments: RDI = destination, RSI = source, RDX = length, RCX = table
+; Returns: RAX = destination
+; Note: XLATB is AL = [RBX + AL], the original table-lookup instruction
+; ============================================================================
+ascii_translate_byte:
+    push    rbx
+    mov     rbx, rcx
+    mov     r9, rdi
+    mov     rcx, rdx
+    jrcxz   .done
+.loop:
+    lodsb
+    xlatb
+    stosb
+    dec     rcx
+    jnz     .loop
+.done:
+    mov     rax, r9
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: verify_ascii_routines
+; Description: Check the AVX2 ASCII transforms against the byte versions
+;              for every length 0-ASCII_TEST_LEN, in place and out of place
+;              (needs AVX2)
+; Returns: RAX = 0 if every result matches, 1 otherwise
+; ============================================================================
+verify_ascii_routines:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 8
+
+    ; Source: byte i = i * 7 + 3 (every value in each 256 bytes);
+    ; table: byte i = i * 37 + 11 (a permutation)
+    xor     ecx, ecx
+.fill:
+    lea     eax, [rcx*8]
+    sub     eax, ecx
+    add     eax, 3
+    mov     [ascii_src + rcx], al
+    imul    eax, ecx, 37
+    add     eax, 11
+    mov     [ascii_table + rcx], al
+    inc     ecx
+    cmp     ecx, 256
+    jb      .fill
+
+    xor     r12d, r12d              ; Length
+.len_loop:
+    mov     r13, r12
+    and     r13, 31
+    add     r13, ascii_src          ; Source at alignment len % 32
+    lea     r14, [r12 + r12*4]
+    and     r14, 31
+    add     r14, ascii_dst + 32     ; Destination at another, guards before
+
+    ; --- toupper, tolower, translate: out of place, then in place ---
+    xor     r15d, r15d
+.xform_loop:
+    mov     rdi, ascii_ref
+    mov     rsi, r13
+    mov     rdx, r12
+    mov     rcx, ascii_table
+    call    [ascii_xform_refs + r15*8]
+    call    .guard
+    mov     rdi, r14
+    mov     rsi, r13
+    mov     rdx, r12
+    mov     rcx, ascii_table
+    call    [ascii_xform_impls + r15*8]
+    cmp     rax, r14
+    jne     .fail
+    call    .compare
+    jne     .fail
+    call    .guard                  ; Source copy at the destination
+    mov     rdi, r14
+    mov     rsi, r13
+    mov     rcx, r12
+    rep     movsb
+    mov     rdi, r14
+    mov     rsi, r14
+    mov     rdx, r12
+    mov     rcx, ascii_table
+    call    [ascii_xform_impls + r15*8]
+    call    .compare
+    jne     .fail
+    inc     r15d
+    cmp     r15d, 3
+    jb      .xform_loop
+
+    ; --- casecmp: source vs. its upper-case copy, then one byte changed ---
+    mov     rdi, r14
+    mov     rsi, r13
+    mov     rdx, r12
+    call    ascii_toupper_byte
+    mov     rdi, r13
+    mov     rsi, r14
+    mov     rdx, r12
+    call    ascii_casecmp_avx2
+    test    rax, rax
+    jnz     .fail
+    xor     ebx, ebx                ; Position to change
+.cmp_loop:
+    cmp     rbx, r12
+    jae     .classify
+    mov     rbp, rbx
+    add     rbp, r14
+    mov     al, [rbp]
+    mov     [rsp], al
+    inc     byte [rbp]              ; 'Z' + 1 = '[', 'z' -> '{' etc.
+    mov     rdi, r13
+    mov     rsi, r14
+    mov     rdx, r12
+    call    ascii_casecmp_byte
+    mov     r15, rax
+    mov     rdi, r13
+    mov     rsi, r14
+    mov     rdx, r12
+    call    ascii_casecmp_avx2
+    cmp     rax, r15
+    jne     .fail
+    mov     rdi, r14
+    mov     rsi, r13
+    mov     rdx, r12
+    call    ascii_casecmp_avx2      ; Swapped: the negated result
+    add     rax, r15
+    jnz     .fail
+    mov     al, [rsp]
+    mov     [rbp], al
+    add     rbx, 7                  ; Every 7th position keeps it quick
+    jmp     .cmp_loop
+
+.classify:
+    ; --- classify: three maps each, compared with a guard dword after ---
+    mov     rdi, ascii_maps
+    mov     ecx, 6 * ASCII_MAP_DWORDS
+    mov     eax, 0xEEEEEEEE
+    rep     stosd
+    mov     rdi, r13
+    mov     rsi, r12
+    mov     rdx, ascii_maps
+    mov     rcx, ascii_maps + 4 * ASCII_MAP_DWORDS
+    mov     r8, ascii_maps + 8 * ASCII_MAP_DWORDS
+    call    ascii_classify_byte
+    mov     rdi, r13
+    mov     rsi, r12
+    mov     rdx, ascii_maps + 12 * ASCII_MAP_DWORDS
+    mov     rcx, ascii_maps + 16 * ASCII_MAP_DWORDS
+    mov     r8, ascii_maps + 20 * ASCII_MAP_DWORDS
+    call    ascii_classify_avx2
+    mov     rsi, ascii_maps
+    mov     rdi, ascii_maps + 12 * ASCII_MAP_DWORDS
+    mov     ecx, 3 * ASCII_MAP_DWORDS
+    repe    cmpsd
+    jne     .fail
+
+    inc     r12
+    cmp     r12, ASCII_TEST_LEN
+    jbe     .len_loop
+
+    xor     eax, eax
+    jmp     .done
+
+.fail:
+    mov     eax, 1
+
+.done:
+    add     rsp, 8
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+; Fill the destination area with guard bytes
+.guard:
+    lea     rdi, [r14 - 32]
+    mov     ecx, ASCII_TEST_LEN + 64
+    mov     al, 0xEE
+    rep     stosb
+    ret
+
+; ZF = 1 if the destination matches ascii_ref and the guards are intact
+.compare:
+    mov     rsi, ascii_ref
+    mov     rdi, r14
+    mov     rcx, r12
+    cmp     rcx, rcx
+    repe    cmpsb
+    jne     .compare_done
+    cmp     byte [r14 - 1], 0xEE
+    jne     .compare_done
+    cmp     byte [r14 + r12], 0xEE
+.compare_done:
+    ret
+
+; ============================================================================
+; FUNCTION: array_sum
+; Description: Sum all elements in a quad word array
+; Arguments: RDI = array address, RSI = array length
+; Returns: RAX = sum
+; ============================================================================
+array_sum:
+    xor     rax, rax                ; Sum = 0
+    xor     rcx, rcx                ; Index = 0
+    
+.loop:
+    cmp     rcx, rsi
+    jge     .done
+    
+    add     rax, [rdi + rcx*8]      ; Add element to sum
+    inc     rcx
+    jmp     .loop
+    
+.done:
+    ret
+
+; ============================================================================
+; FUNCTION: array_reverse
+; Description: Reverse a quad word array in place, one pair per iteration
+;              (see reverse_u64_avx2 for the vector version)
+; Arguments: RDI = array address, RSI = array length
+; Clobbers: RAX, RCX, RDX, RDI
+; ============================================================================
+array_reverse:
+    lea     rdx, [rdi + rsi*8 - 8]  ; Right pointer = last element
+    
+.loop:
+    cmp     rdi, rdx
+    jae     .done                   ; Stop when left >= right
+    
+    ; Swap array[left] and array[right]
+    mov     rax, [rdi]
+    mov     rcx, [rdx]
+    mov     [rdx], rax
+    mov     [rdi], rcx
+    
+    add     rdi, 8                  ; left++
+    sub     rdx, 8                  ; right--
+    jmp     .loop
+    
+.done:
+    ret
+
+; ============================================================================
+; AVX2 INTEGER REDUCTIONS
+; ============================================================================
+;
+; Column aggregates over int64/int32 arrays. array_sum above stays as the
+; readable baseline: one add, one compare and one jump per element, and
+; every add waits for the previous one (a single dependency chain).
+;
+; The vector versions keep four independent YMM accumulators, so four
+; vpaddq (or compares) are in flight at once and the loop is limited by
+; loads, not by add latency: 128 bytes per iteration, which is enough to
+; saturate memory bandwidth once the array is larger than the caches.
+; The accumulators are combined once at the end, and the last few
+; elements are handled one at a time.
+;
+; Max is computed as min of the bitwise complement: ~x = -x - 1 reverses
+; the signed order, so max(x) = ~min(~x) and argmax(x) = argmin(~x). One
+; loop body serves both, with R9/YMM15 = 0 (min) or all ones (max).
+;
+; All routines need AVX2 (see has_avx2) and end with VZEROUPPER.
+;
+; ============================================================================
+
+REDUCE_SUM          equ 0           ; reduce_i64_parallel operations
+REDUCE_MIN          equ 1
+REDUCE_MAX          equ 2
+
+; ============================================================================
+; FUNCTION: sum_i64_avx2
+; Description: Sum an int64 array (wraps on overflow, like array_sum)
+; Arguments: RDI = array address, RSI = element count
+; Returns: RAX = sum
+; ============================================================================
+sum_i64_avx2:
+    vpxor   xmm0, xmm0, xmm0        ; Four accumulators, 4 qwords each
+    vpxor   xmm1, xmm1, xmm1
+    vpxor   xmm2, xmm2, xmm2
+    vpxor   xmm3, xmm3, xmm3
+    xor     ecx, ecx                ; Index
+    mov     rdx, rsi
+    and     rdx, -16                ; Elements covered by the unrolled loop
+    jz      .by4
+
+.loop:
+    vpaddq  ymm0, ymm0, [rdi + rcx*8]
+    vpaddq  ymm1, ymm1, [rdi + rcx*8 + 32]
+    vpaddq  ymm2, ymm2, [rdi + rcx*8 + 64]
+    vpaddq  ymm3, ymm3, [rdi + rcx*8 + 96]
+    add     rcx, 16
+    cmp     rcx, rdx
+    jb      .loop
+
+.by4:
+    mov     rdx, rsi
+    and     rdx, -4
+    cmp     rcx, rdx
+    jae     .reduce
+.loop4:
+    vpaddq  ymm0, ymm0, [rdi + rcx*8]
+    add     rcx, 4
+    cmp     rcx, rdx
+    jb      .loop4
+
+.reduce:
+    vpaddq  ymm0, ymm0, ymm1
+    vpaddq  ymm2, ymm2, ymm3
+    vpaddq  ymm0, ymm0, ymm2
+    vextracti128 xmm1, ymm0, 1      ; Fold 256 -> 128 -> 64 bits
+    vpaddq  xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0x4E        ; Swap the two qwords
+    vpaddq  xmm0, xmm0, xmm1
+    vmovq   rax, xmm0
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    add     rax, [rdi + rcx*8]
+    inc     rcx
+    jmp     .tail
+
+.done:
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: sum_i32_avx2
+; Description: Sum an int32 array into a 64-bit total (cannot overflow
+;              below 2^32 elements)
+; Arguments: RDI = array address, RSI = element count
+; Returns: RAX = sum
+;
+; VPMOVSXDQ loads 4 dwords and sign-extends them to 4 qwords in one step.
+; ============================================================================
+sum_i32_avx2:
+    vpxor   xmm0, xmm0, xmm0
+    vpxor   xmm1, xmm1, xmm1
+    vpxor   xmm2, xmm2, xmm2
+    vpxor   xmm3, xmm3, xmm3
+    xor     ecx, ecx
+    mov     rdx, rsi
+    and     rdx, -16
+    jz      .by4
+
+.loop:
+    vpmovsxdq ymm4, [rdi + rcx*4]
+    vpmovsxdq ymm5, [rdi + rcx*4 + 16]
+    vpmovsxdq ymm6, [rdi + rcx*4 + 32]
+    vpmovsxdq ymm7, [rdi + rcx*4 + 48]
+    vpaddq  ymm0, ymm0, ymm4
+    vpaddq  ymm1, ymm1, ymm5
+    vpaddq  ymm2, ymm2, ymm6
+    vpaddq  ymm3, ymm3, ymm7
+    add     rcx, 16
+    cmp     rcx, rdx
+    jb      .loop
+
+.by4:
+    mov     rdx, rsi
+    and     rdx, -4
+    cmp     rcx, rdx
+    jae     .reduce
+.loop4:
+    vpmovsxdq ymm4, [rdi + rcx*4]
+    vpaddq  ymm0, ymm0, ymm4
+    add     rcx, 4
+    cmp     rcx, rdx
+    jb      .loop4
+
+.reduce:
+    vpaddq  ymm0, ymm0, ymm1
+    vpaddq  ymm2, ymm2, ymm3
+    vpaddq  ymm0, ymm0, ymm2
+    vextracti128 xmm1, ymm0, 1
+    vpaddq  xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0x4E
+    vpaddq  xmm0, xmm0, xmm1
+    vmovq   rax, xmm0
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    movsxd  rdx, dword [rdi + rcx*4]
+    add     rax, rdx
+    inc     rcx
+    jmp     .tail
+
+.done:
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: min_i64_avx2 / max_i64_avx2
+; Description: Smallest / largest element of an int64 array
+; Arguments: RDI = array address, RSI = element count
+; Returns: RAX = min (INT64_MAX if empty) / max (INT64_MIN if empty)
+;
+; AVX2 has no 64-bit vpminsq (that is AVX-512), so each step is a signed
+; compare plus a blend: take the new value where the accumulator is larger.
+; ============================================================================
+min_i64_avx2:
+    xor     r9d, r9d                ; Complement mask: none
+    jmp     minmax_i64_avx2
+
+max_i64_avx2:
+    mov     r9, -1                  ; Complement every element
+
+minmax_i64_avx2:
+    vmovq   xmm15, r9
+    vpbroadcastq ymm15, xmm15
+    mov     rax, 0x7FFFFFFFFFFFFFFF ; Identity for min
+    vmovq   xmm0, rax
+    vpbroadcastq ymm0, xmm0
+    vmovdqa ymm1, ymm0
+    vmovdqa ymm2, ymm0
+    vmovdqa ymm3, ymm0
+    xor     ecx, ecx
+    mov     rdx, rsi
+    and     rdx, -16
+    jz      .by4
+
+.loop:
+    vpxor   ymm4, ymm15, [rdi + rcx*8]
+    vpxor   ymm5, ymm15, [rdi + rcx*8 + 32]
+    vpxor   ymm6, ymm15, [rdi + rcx*8 + 64]
+    vpxor   ymm7, ymm15, [rdi + rcx*8 + 96]
+    vpcmpgtq ymm8, ymm0, ymm4       ; acc > x: x is the new minimum
+    vpcmpgtq ymm9, ymm1, ymm5
+    vpcmpgtq ymm10, ymm2, ymm6
+    vpcmpgtq ymm11, ymm3, ymm7
+    vpblendvb ymm0, ymm0, ymm4, ymm8
+    vpblendvb ymm1, ymm1, ymm5, ymm9
+    vpblendvb ymm2, ymm2, ymm6, ymm10
+    vpblendvb ymm3, ymm3, ymm7, ymm11
+    add     rcx, 16
+    cmp     rcx, rdx
+    jb      .loop
+
+.by4:
+    mov     rdx, rsi
+    and     rdx, -4
+    cmp     rcx, rdx
+    jae     .reduce
+.loop4:
+    vpxor   ymm4, ymm15, [rdi + rcx*8]
+    vpcmpgtq ymm8, ymm0, ymm4
+    vpblendvb ymm0, ymm0, ymm4, ymm8
+    add     rcx, 4
+    cmp     rcx, rdx
+    jb      .loop4
+
+.reduce:
+    vpcmpgtq ymm8, ymm0, ymm1
+    vpblendvb ymm0, ymm0, ymm1, ymm8
+    vpcmpgtq ymm9, ymm2, ymm3
+    vpblendvb ymm2, ymm2, ymm3, ymm9
+    vpcmpgtq ymm8, ymm0, ymm2
+    vpblendvb ymm0, ymm0, ymm2, ymm8
+    vextracti128 xmm1, ymm0, 1
+    vpcmpgtq xmm8, xmm0, xmm1
+    vpblendvb xmm0, xmm0, xmm1, xmm8
+    vpshufd xmm1, xmm0, 0x4E
+    vpcmpgtq xmm8, xmm0, xmm1
+    vpblendvb xmm0, xmm0, xmm1, xmm8
+    vmovq   rax, xmm0
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    mov     rdx, [rdi + rcx*8]
+    xor     rdx, r9
+    cmp     rdx, rax
+    cmovl   rax, rdx
+    inc     rcx
+    jmp     .tail
+
+.done:
+    xor     rax, r9                 ; Undo the complement for max
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: min_i32_avx2 / max_i32_avx2
+; Description: Smallest / largest element of an int32 array
+; Arguments: RDI = array address, RSI = element count
+; Returns: RAX = min (INT32_MAX if empty) / max (INT32_MIN if empty),
+;          sign-extended
+; ============================================================================
+min_i32_avx2:
+    xor     r9d, r9d
+    jmp     minmax_i32_avx2
+
+max_i32_avx2:
+    mov     r9d, -1
+
+minmax_i32_avx2:
+    vmovd   xmm15, r9d
+    vpbroadcastd ymm15, xmm15
+    mov     eax, 0x7FFFFFFF
+    vmovd   xmm0, eax
+    vpbroadcastd ymm0, xmm0
+    vmovdqa ymm1, ymm0
+    vmovdqa ymm2, ymm0
+    vmovdqa ymm3, ymm0
+    xor     ecx, ecx
+    mov     rdx, rsi
+    and     rdx, -32                ; 32 dwords per iteration
+    jz      .by8
+
+.loop:
+    vpxor   ymm4, ymm15, [rdi + rcx*4]
+    vpxor   ymm5, ymm15, [rdi + rcx*4 + 32]
+    vpxor   ymm6, ymm15, [rdi + rcx*4 + 64]
+    vpxor   ymm7, ymm15, [rdi + rcx*4 + 96]
+    vpminsd ymm0, ymm0, ymm4
+    vpminsd ymm1, ymm1, ymm5
+    vpminsd ymm2, ymm2, ymm6
+    vpminsd ymm3, ymm3, ymm7
+    add     rcx, 32
+    cmp     rcx, rdx
+    jb      .loop
+
+.by8:
+    mov     rdx, rsi
+    and     rdx, -8
+    cmp     rcx, rdx
+    jae     .reduce
+.loop8:
+    vpxor   ymm4, ymm15, [rdi + rcx*4]
+    vpminsd ymm0, ymm0, ymm4
+    add     rcx, 8
+    cmp     rcx, rdx
+    jb      .loop8
+
+.reduce:
+    vpminsd ymm0, ymm0, ymm1
+    vpminsd ymm2, ymm2, ymm3
+    vpminsd ymm0, ymm0, ymm2
+    vextracti128 xmm1, ymm0, 1
+    vpminsd xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0x4E
+    vpminsd xmm0, xmm0, xmm1
+    vpshufd xmm1, xmm0, 0xB1        ; Swap dwords within each qword
+    vpminsd xmm0, xmm0, xmm1
+    vmovd   eax, xmm0
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    mov     edx, [rdi + rcx*4]
+    xor     edx, r9d
+    cmp     edx, eax
+    cmovl   eax, edx
+    inc     rcx
+    jmp     .tail
+
+.done:
+    xor     eax, r9d
+    movsxd  rax, eax
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: argmin_i64_avx2 / argmax_i64_avx2
+; Description: Index of the first smallest / largest element
+; Arguments: RDI = array address, RSI = element count
+; Returns: RAX = index, or -1 if the array is empty
+;
+; Each lane keeps its best value and the index it came from. The compare
+; is strict, so a lane keeps the first of equal values (indices only grow);
+; lanes are merged preferring the lower index on ties.
+; ============================================================================
+argmin_i64_avx2:
+    xor     r9d, r9d
+    jmp     argminmax_i64_avx2
+
+argmax_i64_avx2:
+    mov     r9, -1
+
+argminmax_i64_avx2:
+    push    rbp
+    mov     rbp, rsp
+    and     rsp, -32
+    sub     rsp, 64                 ; Spill area: 4 values, 4 indices
+
+    vmovq   xmm15, r9
+    vpbroadcastq ymm15, xmm15
+    mov     rax, 0x7FFFFFFFFFFFFFFF
+    vmovq   xmm0, rax
+    vpbroadcastq ymm0, xmm0         ; Best values, lanes 0-3
+    vmovdqa ymm1, ymm0              ; Best values, lanes 4-7
+    vpcmpeqq ymm2, ymm2, ymm2       ; Best indices (-1 = none yet)
+    vmovdqa ymm3, ymm2
+    vmovdqu ymm4, [lane_index]      ; Current indices 0,1,2,3
+    mov     eax, 4
+    vmovq   xmm5, rax
+    vpbroadcastq ymm5, xmm5
+    vpaddq  ymm5, ymm4, ymm5        ; Current indices 4,5,6,7
+    mov     eax, 8
+    vmovq   xmm6, rax
+    vpbroadcastq ymm6, xmm6         ; Index step
+
+    xor     ecx, ecx
+    mov     rdx, rsi
+    and     rdx, -8
+    jz      .reduce
+
+.loop:
+    vpxor   ymm7, ymm15, [rdi + rcx*8]
+    vpxor   ymm8, ymm15, [rdi + rcx*8 + 32]
+    vpcmpgtq ymm9, ymm0, ymm7       ; New strict minimum in this lane?
+    vpcmpgtq ymm10, ymm1, ymm8
+    vpblendvb ymm0, ymm0, ymm7, ymm9
+    vpblendvb ymm1, ymm1, ymm8, ymm10
+    vpblendvb ymm2, ymm2, ymm4, ymm9
+    vpblendvb ymm3, ymm3, ymm5, ymm10
+    vpaddq  ymm4, ymm4, ymm6
+    vpaddq  ymm5, ymm5, ymm6
+    add     rcx, 8
+    cmp     rcx, rdx
+    jb      .loop
+
+.reduce:
+    ; Merge lanes 4-7 into 0-3: take them if smaller, or equal with a
+    ; lower index (an index of -1 only pairs with the identity value)
+    vpcmpgtq ymm9, ymm0, ymm1
+    vpcmpeqq ymm10, ymm0, ymm1
+    vpcmpgtq ymm11, ymm2, ymm3
+    vpand   ymm10, ymm10, ymm11
+    vpor    ymm9, ymm9, ymm10
+    vpblendvb ymm0, ymm0, ymm1, ymm9
+    vpblendvb ymm2, ymm2, ymm3, ymm9
+    vmovdqa [rsp], ymm0
+    vmovdqa [rsp + 32], ymm2
+
+    mov     rax, [rsp]              ; Best value
+    mov     r8, [rsp + 32]          ; Its index
+    mov     r10d, 1
+.lanes:
+    mov     rdx, [rsp + r10*8]
+    mov     r11, [rsp + 32 + r10*8]
+    cmp     rdx, rax
+    jl      .take_lane
+    jne     .next_lane
+    cmp     r11, r8                 ; Equal: lower index wins (unsigned, so
+    jae     .next_lane              ; -1 never beats a real index)
+.take_lane:
+    mov     rax, rdx
+    mov     r8, r11
+.next_lane:
+    inc     r10d
+    cmp     r10d, 4
+    jb      .lanes
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    mov     rdx, [rdi + rcx*8]
+    xor     rdx, r9
+    cmp     rdx, rax
+    jge     .tail_next
+    mov     rax, rdx
+    mov     r8, rcx
+.tail_next:
+    inc     rcx
+    jmp     .tail
+
+.done:
+    ; All lanes still at the identity with index -1: either the array is
+    ; empty or every element equals the identity, found at index 0
+    test    r8, r8
+    jns     .found
+    test    rsi, rsi
+    jz      .found
+    xor     r8d, r8d
+.found:
+    mov     rax, r8
+    mov     rsp, rbp
+    pop     rbp
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: sum_i64_checked_avx2
+; Description: Exact sum of an int64 array with overflow detection
+; Arguments: RDI = array address, RSI = element count (below 2^34),
+;            RDX = int64 *result (receives the sum, wrapped on overflow)
+; Returns: RAX = 0 if the sum fits in int64, 1 if it overflowed
+;
+; Checking each vpaddq for overflow would be wrong: partial sums may
+; overflow while the total fits. Instead every element is split as
+;   x = lo + 2^32 * hi - 2^64 * neg
+; with lo, hi the unsigned 32-bit halves and neg = 1 if x < 0. Sums of lo
+; and hi cannot overflow a 64-bit lane below 2^34 elements and neg is
+; counted directly, so the three sums give the exact 128-bit total.
+; ============================================================================
+sum_i64_checked_avx2:
+    push    rbx
+    push    rbp
+    mov     rbp, rsp
+    and     rsp, -32
+    sub     rsp, 96                 ; Spill area for the three sums
+    mov     rbx, rdx                ; Result pointer
+
+    mov     eax, -1
+    vmovq   xmm15, rax
+    vpbroadcastq ymm15, xmm15       ; 0x00000000FFFFFFFF per lane
+    vpxor   xmm14, xmm14, xmm14     ; Zero, for the sign test
+    vpxor   xmm0, xmm0, xmm0        ; Sum of low halves (2 accumulators)
+    vpxor   xmm1, xmm1, xmm1
+    vpxor   xmm2, xmm2, xmm2        ; Sum of high halves
+    vpxor   xmm3, xmm3, xmm3
+    vpxor   xmm4, xmm4, xmm4        ; Minus the count of negatives
+    vpxor   xmm5, xmm5, xmm5
+    xor     ecx, ecx
+    mov     rdx, rsi
+    and     rdx, -8
+    jz      .reduce
+
+.loop:
+    vmovdqu ymm6, [rdi + rcx*8]
+    vmovdqu ymm7, [rdi + rcx*8 + 32]
+    vpand   ymm8, ymm6, ymm15
+    vpand   ymm9, ymm7, ymm15
+    vpaddq  ymm0, ymm0, ymm8
+    vpaddq  ymm1, ymm1, ymm9
+    vpsrlq  ymm8, ymm6, 32
+    vpsrlq  ymm9, ymm7, 32
+    vpaddq  ymm2, ymm2, ymm8
+    vpaddq  ymm3, ymm3, ymm9
+    vpcmpgtq ymm8, ymm14, ymm6      ; -1 where x < 0
+    vpcmpgtq ymm9, ymm14, ymm7
+    vpaddq  ymm4, ymm4, ymm8
+    vpaddq  ymm5, ymm5, ymm9
+    add     rcx, 8
+    cmp     rcx, rdx
+    jb      .loop
+
+.reduce:
+    vpaddq  ymm0, ymm0, ymm1
+    vpaddq  ymm2, ymm2, ymm3
+    vpaddq  ymm4, ymm4, ymm5
+    vmovdqa [rsp], ymm0
+    vmovdqa [rsp + 32], ymm2
+    vmovdqa [rsp + 64], ymm4
+
+    ; 128-bit total in R9:R8
+    xor     r8d, r8d
+    xor     r9d, r9d
+    xor     r10d, r10d              ; Sum of high halves in R11:R10
+    xor     r11d, r11d
+%assign lane 0
+%rep 4
+    add     r8, [rsp + lane*8]
+    adc     r9, 0
+    add     r10, [rsp + 32 + lane*8]
+    adc     r11, 0
+    add     r9, [rsp + 64 + lane*8] ; -neg * 2^64
+%assign lane lane+1
+%endrep
+    shld    r11, r10, 32            ; * 2^32
+    shl     r10, 32
+    add     r8, r10
+    adc     r9, r11
+
+.tail:
+    cmp     rcx, rsi
+    jae     .done
+    mov     rax, [rdi + rcx*8]
+    mov     rdx, rax
+    sar     rdx, 63                 ; Sign-extend to 128 bits
+    add     r8, rax
+    adc     r9, rdx
+    inc     rcx
+    jmp     .tail
+
+.done:
+    mov     [rbx], r8
+    mov     rax, r8
+    sar     rax, 63
+    cmp     rax, r9                 ; Fits if the high half is the sign
+    setne   al                      ; extension of the low half
+    movzx   eax, al
+    mov     rsp, rbp
+    pop     rbp
+    pop     rbx
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: reduce_i64_parallel
+; Description: Run sum/min/max_i64_avx2 on slices of a large array in
+;              parallel threads and combine the partial results
+; Arguments: RDI = array address, RSI = element count,
+;            EDX = REDUCE_SUM / REDUCE_MIN / REDUCE_MAX,
+;            ECX = thread count (0 = one per CPU the process may run on)
+; Returns: RAX = result, as the single-threaded routine would return
+;
+; Threads are created with the raw clone system call, no libc:
+;   CLONE_VM | FS | FILES | SIGHAND | THREAD | SYSVSEM - a thread that
+;       shares everything, like pthread_create
+;   CLONE_CHILD_CLEARTID - when the thread exits the kernel writes 0 to
+;       its tid word and does a futex wake on it; the parent waits there,
+;       which also guarantees the thread is off its stack before munmap
+; Each child starts with RSP pointing at its job record, calls the kernel,
+; stores the result and exits with SYS_exit (which ends only the thread).
+; The calling thread reduces the first slice itself. Slices are at least
+; 2^PARALLEL_MIN_SHIFT elements long: below that, thread start-up costs more than
+; it saves. If clone fails, that slice runs in the calling thread.
+; ============================================================================
+PARALLEL_MAX_THREADS    equ 64
+PARALLEL_MIN_SHIFT      equ 18      ; Slices of at least 2^18 int64 (2 MiB)
+THREAD_STACK_SHIFT      equ 16      ; 64 KiB stacks: room for a signal frame
+
+; Job record at the top of each thread's stack
+JOB_ARRAY               equ 0
+JOB_COUNT               equ 8
+JOB_KERNEL              equ 16
+JOB_RESULT              equ 24
+JOB_TID                 equ 32      ; dword, cleared by the kernel at exit
+JOB_SIZE                equ 64
+
+CLONE_THREAD_FLAGS      equ 0x100 | 0x200 | 0x400 | 0x800 | 0x10000 | 0x40000 | 0x200000
+
+reduce_i64_parallel:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 136                ; CPU mask (128 bytes), keeps alignment
+
+    mov     r12, rdi                ; Array
+    mov     r13, rsi                ; Count
+    mov     r14d, edx               ; Operation
+    mov     ebx, ecx                ; Threads
+
+    test    ebx, ebx
+    jnz     .have_threads
+    mov     eax, 204                ; sys_sched_getaffinity(0, 128, mask)
+    xor     edi, edi
+    mov     esi, 128
+    mov     rdx, rsp
+    syscall
+    mov     ebx, 1
+    test    rax, rax
+    jle     .have_threads
+    xor     ebx, ebx
+    xor     ecx, ecx
+.count_cpus:
+    mov     rdx, [rsp + rcx]
+    popcnt  rdx, rdx                ; Needs POPCNT; every AVX2 CPU has it
+    add     ebx, edx
+    add     rcx, 8
+    cmp     rcx, rax                ; RAX = bytes of mask the kernel wrote
+    jb      .count_cpus
+
+.have_threads:
+    ; threads = min(threads, count / 2^PARALLEL_MIN_SHIFT, MAX)
+    mov     rax, r13
+    shr     rax, PARALLEL_MIN_SHIFT
+    cmp     rbx, rax
+    cmova   rbx, rax
+    mov     eax, PARALLEL_MAX_THREADS
+    cmp     rbx, rax
+    cmova   rbx, rax
+    mov     r15, [reduce_kernels + r14*8]
+    cmp     rbx, 1
+    ja      .spawn
+
+    mov     rdi, r12                ; One thread: just run the kernel
+    mov     rsi, r13
+    call    r15
+    jmp     .return
+
+.spawn:
+    mov     rax, 9                  ; sys_mmap: one stack per thread
+    xor     edi, edi
+    mov     rsi, rbx
+    shl     rsi, THREAD_STACK_SHIFT
+    mov     edx, 3                  ; PROT_READ | PROT_WRITE
+    mov     r10d, 0x22              ; MAP_PRIVATE | MAP_ANONYMOUS
+    mov     r8, -1
+    xor     r9d, r9d
+    syscall
+    test    rax, rax
+    jns     .have_stacks
+    mov     rdi, r12                ; No memory for stacks: single thread
+    mov     rsi, r13
+    call    r15
+    jmp     .return
+
+.have_stacks:
+    mov     rbp, rax                ; Stacks base
+    mov     rax, r13
+    xor     edx, edx
+    div     rbx
+    and     rax, -16                ; Slice length, whole loop iterations
+    mov     [rsp], rax              ; (the CPU mask is no longer needed)
+
+    mov     ecx, 1                  ; Slices 1..threads-1 go to new threads
+.spawn_loop:
+    mov     [rsp + 8], rcx
+    mov     rsi, rcx
+    inc     rsi
+    shl     rsi, THREAD_STACK_SHIFT
+    add     rsi, rbp
+    sub     rsi, JOB_SIZE           ; Job record = top of this stack
+    mov     rax, [rsp]
+    imul    rax, rcx                ; First element of the slice
+    lea     rdx, [r12 + rax*8]
+    mov     [rsi + JOB_ARRAY], rdx
+    mov     rdx, [rsp]              ; Length: slice, or the rest if last
+    lea     rdi, [rcx + 1]
+    cmp     rdi, rbx
+    jb      .not_last
+    mov     rdx, r13
+    sub     rdx, rax
+.not_last:
+    mov     [rsi + JOB_COUNT], rdx
+    mov     [rsi + JOB_KERNEL], r15
+    mov     dword [rsi + JOB_TID], 1
+
+    mov     eax, 56                 ; sys_clone(flags, stack, ptid, ctid, tls)
+    mov     edi, CLONE_THREAD_FLAGS
+    ; RSI = new stack pointer
+    xor     edx, edx
+    lea     r10, [rsi + JOB_TID]
+    xor     r8d, r8d
+    syscall
+    test    rax, rax
+    jz      reduce_thread_start     ; Child: RSP = job record
+    jns     .spawned
+
+    ; clone failed: run this slice here and mark it finished
+    mov     [rsp + 16], rsi
+    mov     rdi, [rsi + JOB_ARRAY]
+    mov     rsi, [rsi + JOB_COUNT]
+    call    r15
+    mov     rsi, [rsp + 16]
+    mov     [rsi + JOB_RESULT], rax
+    mov     dword [rsi + JOB_TID], 0
+
+.spawned:
+    mov     rcx, [rsp + 8]
+    inc     rcx
+    cmp     rcx, rbx
+    jb      .spawn_loop
+
+    ; Slice 0 in this thread
+    mov     rdi, r12
+    mov     rsi, [rsp]
+    call    r15
+    mov     [rsp + 16], rax         ; Running result
+
+    ; Join every thread and combine
+    mov     ecx, 1
+.join_loop:
+    mov     [rsp + 8], rcx
+    mov     rsi, rcx
+    inc     rsi
+    shl     rsi, THREAD_STACK_SHIFT
+    lea     r12, [rbp + rsi - JOB_SIZE]
+.wait:
+    mov     edx, [r12 + JOB_TID]
+    test    edx, edx
+    jz      .joined
+    mov     eax, 202                ; sys_futex(&tid, FUTEX_WAIT, tid, NULL)
+    lea     rdi, [r12 + JOB_TID]
+    xor     esi, esi
+    xor     r10d, r10d
+    syscall                         ; Returns at once if tid already changed
+    jmp     .wait
+
+.joined:
+    mov     rax, [rsp + 16]
+    mov     rdx, [r12 + JOB_RESULT]
+    cmp     r14d, REDUCE_MIN
+    je      .combine_min
+    ja      .combine_max
+    add     rax, rdx
+    jmp     .combined
+.combine_min:
+    cmp     rdx, rax
+    cmovl   rax, rdx
+    jmp     .combined
+.combine_max:
+    cmp     rdx, rax
+    cmovg   rax, rdx
+.combined:
+    mov     [rsp + 16], rax
+    mov     rcx, [rsp + 8]
+    inc     rcx
+    cmp     rcx, rbx
+    jb      .join_loop
+
+    mov     eax, 11                 ; sys_munmap(stacks, threads * size)
+    mov     rdi, rbp
+    mov     rsi, rbx
+    shl     rsi, THREAD_STACK_SHIFT
+    syscall
+    mov     rax, [rsp + 16]
+
+.return:
+    add     rsp, 136
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+; Entry point of a reduce_i64_parallel thread: RSP = job record (64-byte
+; aligned, so the call below sees a 16-byte aligned stack)
+reduce_thread_start:
+    mov     rdi, [rsp + JOB_ARRAY]
+    mov     rsi, [rsp + JOB_COUNT]
+    call    [rsp + JOB_KERNEL]
+    mov     [rsp + JOB_RESULT], rax
+    mov     eax, 60                 ; sys_exit: ends this thread only
+    xor     edi, edi
+    syscall
+
+; ============================================================================
+; FUNCTION: verify_reductions
+; Description: Check the AVX2 reductions against scalar loops for lengths
+;              0-99 and the full test array (parallel version included)
+; Returns: RAX = 0 if every result matches, 1 otherwise
+; ============================================================================
+verify_reductions:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 8
+
+    ; Pseudo-random values in +-2^39 (xorshift), so no sum can overflow
+    mov     rax, 0x9E3779B97F4A7C15
+    xor     ecx, ecx
+.fill:
+    mov     rdx, rax
+    shl     rdx, 13
+    xor     rax, rdx
+    mov     rdx, rax
+    shr     rdx, 7
+    xor     rax, rdx
+    mov     rdx, rax
+    shl     rdx, 17
+    xor     rax, rdx
+    mov     rdx, rax
+    sar     rdx, 24
+    mov     [reduce_array + rcx*8], rdx
+    inc     rcx
+    cmp     rcx, REDUCE_TEST_COUNT
+    jb      .fill
+
+    xor     r12d, r12d              ; Length under test
+.len_loop:
+    lea     rbx, [reduce_array + 8] ; Odd start: unaligned loads
+
+    ; Scalar references: R13 = sum, R14 = min, R15 = max, RBP = argmin
+    xor     r13d, r13d
+    mov     r14, 0x7FFFFFFFFFFFFFFF
+    mov     r15, 0x8000000000000000
+    mov     rbp, -1
+    xor     ecx, ecx
+.ref_loop:
+    cmp     rcx, r12
+    jae     .ref_done
+    mov     rax, [rbx + rcx*8]
+    add     r13, rax
+    cmp     rax, r14
+    jge     .ref_not_min
+    mov     r14, rax
+    mov     rbp, rcx
+.ref_not_min:
+    cmp     rax, r15
+    cmovg   r15, rax
+    inc     rcx
+    jmp     .ref_loop
+.ref_done:
+
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    sum_i64_avx2
+    cmp     rax, r13
+    jne     .fail
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    array_sum
+    cmp     rax, r13
+    jne     .fail
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    min_i64_avx2
+    cmp     rax, r14
+    jne     .fail
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    max_i64_avx2
+    cmp     rax, r15
+    jne     .fail
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    argmin_i64_avx2
+    cmp     rax, rbp
+    jne     .fail
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    argmax_i64_avx2
+    test    r12, r12
+    jz      .argmax_empty
+    cmp     [rbx + rax*8], r15      ; Points at a maximum
+    jne     .fail
+    jmp     .checked
+.argmax_empty:
+    cmp     rax, -1
+    jne     .fail
+.checked:
+    mov     rdi, rbx
+    mov     rsi, r12
+    mov     rdx, rsp
+    call    sum_i64_checked_avx2
+    test    rax, rax
+    jnz     .fail
+    cmp     [rsp], r13
+    jne     .fail
+
+    ; Same memory as 2 * length int32 values: compare with a scalar sum
+    xor     r13d, r13d
+    xor     ecx, ecx
+    lea     rdx, [r12 + r12]
+.ref32_loop:
+    cmp     rcx, rdx
+    jae     .ref32_done
+    movsxd  rax, dword [rbx + rcx*4]
+    add     r13, rax
+    inc     rcx
+    jmp     .ref32_loop
+.ref32_done:
+    mov     rdi, rbx
+    lea     rsi, [r12 + r12]
+    call    sum_i32_avx2
+    cmp     rax, r13
+    jne     .fail
+
+    inc     r12
+    cmp     r12, 100
+    jb      .len_loop
+
+    ; Overflow: INT64_MAX + 1 must be reported, INT64_MAX + 1 - 1 not
+    mov     rax, 0x7FFFFFFFFFFFFFFF
+    mov     [reduce_array], rax
+    mov     qword [reduce_array + 8], 1
+    mov     qword [reduce_array + 16], -1
+    lea     rdi, [reduce_array]
+    mov     esi, 2
+    mov     rdx, rsp
+    call    sum_i64_checked_avx2
+    cmp     rax, 1
+    jne     .fail
+    lea     rdi, [reduce_array]
+    mov     esi, 3
+    mov     rdx, rsp
+    call    sum_i64_checked_avx2
+    test    rax, rax
+    jnz     .fail
+
+    ; Whole array: parallel result equals the single-threaded one
+    lea     rdi, [reduce_array]
+    mov     esi, REDUCE_TEST_COUNT
+    call    sum_i64_avx2
+    mov     r13, rax
+    lea     rdi, [reduce_array]
+    mov     esi, REDUCE_TEST_COUNT
+    mov     edx, REDUCE_SUM
+    mov     ecx, 4
+    call    reduce_i64_parallel
+    cmp     rax, r13
+    jne     .fail
+    lea     rdi, [reduce_array]
+    mov     esi, REDUCE_TEST_COUNT
+    call    max_i64_avx2
+    mov     r13, rax
+    lea     rdi, [reduce_array]
+    mov     esi, REDUCE_TEST_COUNT
+    mov     edx, REDUCE_MAX
+    xor     ecx, ecx                ; One thread per CPU
+    call    reduce_i64_parallel
+    cmp     rax, r13
+    jne     .fail
+
+    xor     eax, eax
+    jmp     .done
+
+.fail:
+    mov     eax, 1
+
+.done:
+    add     rsp, 8
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+; ============================================================================
+; AVX2 PERMUTATIONS
+; ============================================================================
+;
+; Reversal, byte swapping and (de)interleaving all move bytes to fixed
+; positions inside a 16-byte lane, which is exactly what VPSHUFB does: each
+; routine differs only in the shuffle mask. VPSHUFB cannot cross the two
+; 128-bit lanes of a YMM register, so moves between lanes use VPERMQ (any
+; qword order) or VPERM2I128 (pick lanes from two registers).
+;
+; Every routine takes its length in elements, turns it into bytes and
+; jumps to a shared body with the mask for its element size. Pieces
+; shorter than one block go through a 32/64-byte stack buffer and reuse
+; the vector step, so no element size needs its own scalar tail loop.
+;
+; All routines need AVX2 (see has_avx2) and end with VZEROUPPER.
+;
+; ============================================================================
+
+; ============================================================================
+; FUNCTION: reverse_u8_avx2 / reverse_u16_avx2 / reverse_u32_avx2 /
+;           reverse_u64_avx2
+; Description: Reverse an array of 1/2/4/8-byte elements in place
+; Arguments: RDI = array address, RSI = element count
+;
+; Whole 32-byte blocks are taken from both ends, reversed in registers
+; (VPSHUFB inside each lane, then VPERMQ 0x4E to swap the lanes) and
+; stored at the opposite end: 64 bytes per iteration instead of two
+; elements. The middle piece of under 32 bytes is reversed in a stack
+; buffer.
+; ============================================================================
+reverse_u8_avx2:
+    lea     rdx, [reverse_masks]
+    jmp     reverse_masked
+
+reverse_u16_avx2:
+    add     rsi, rsi
+    lea     rdx, [reverse_masks + 16]
+    jmp     reverse_masked
+
+reverse_u32_avx2:
+    shl     rsi, 2
+    lea     rdx, [reverse_masks + 32]
+    jmp     reverse_masked
+
+reverse_u64_avx2:
+    shl     rsi, 3
+    lea     rdx, [reverse_masks + 48]
+
+; RDI = address, RSI = length in bytes, RDX = 16-byte in-lane mask
+reverse_masked:
+    vbroadcasti128 ymm15, [rdx]
+    lea     rdx, [rdi + rsi]        ; RDX = end of the unreversed middle
+
+.blocks:
+    mov     rax, rdx
+    sub     rax, rdi
+    cmp     rax, 64
+    jb      .middle
+    vmovdqu ymm0, [rdi]             ; Front block
+    vmovdqu ymm1, [rdx - 32]        ; Back block
+    vpshufb ymm0, ymm0, ymm15
+    vpshufb ymm1, ymm1, ymm15
+    vpermq  ymm0, ymm0, 0x4E
+    vpermq  ymm1, ymm1, 0x4E
+    vmovdqu [rdx - 32], ymm0
+    vmovdqu [rdi], ymm1
+    add     rdi, 32
+    sub     rdx, 32
+    jmp     .blocks
+
+.middle:
+    ; RAX = 0-63 bytes left. Reversing the 32-byte buffer moves the RAX
+    ; valid bytes at its start, reversed, to its end.
+    test    rax, rax
+    jz      .done
+    cmp     rax, 32
+    jbe     .bounce
+    sub     rax, 32                 ; 33-63: swap 16-byte blocks first
+    vmovdqu xmm0, [rdi]
+    vmovdqu xmm1, [rdx - 16]
+    vpshufb xmm0, xmm0, xmm15
+    vpshufb xmm1, xmm1, xmm15
+    vmovdqu [rdx - 16], xmm0
+    vmovdqu [rdi], xmm1
+    add     rdi, 16
+    sub     rdx, 16
+    test    rax, rax
+    jz      .done
+
+.bounce:
+    sub     rsp, 40
+    mov     rdx, rdi                ; Middle start
+    mov     rsi, rdi
+    mov     rdi, rsp
+    mov     rcx, rax
+    rep     movsb                   ; Middle -> buffer
+    vmovdqu ymm0, [rsp]
+    vpshufb ymm0, ymm0, ymm15
+    vpermq  ymm0, ymm0, 0x4E
+    vmovdqu [rsp], ymm0
+    lea     rsi, [rsp + 32]
+    sub     rsi, rax                ; Reversed bytes sit at the end
+    mov     rdi, rdx
+    mov     rcx, rax
+    rep     movsb                   ; Buffer -> middle
+    add     rsp, 40
+
+.done:
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: rotate_left_avx2
+; Description: Rotate a buffer left in place: bytes [shift, len) move to
+;              the front, [0, shift) to the back
+; Arguments: RDI = address, RSI = length in bytes, RDX = shift in bytes
+;            (use element count * element size to rotate by elements)
+;
+; Three reversals: reverse [0, shift), reverse [shift, len), reverse all.
+; Each pass is a vector reversal, so the rotation streams the buffer three
+; times without any scratch memory.
+; ============================================================================
+rotate_left_avx2:
+    test    rsi, rsi
+    jz      .done
+    push    rbx
+    push    r12
+    push    r13
+    mov     rbx, rdi
+    mov     r12, rsi
+    mov     rax, rdx
+    xor     edx, edx
+    div     r12                     ; RDX = shift mod length
+    test    rdx, rdx
+    jz      .restore
+    mov     r13, rdx
+
+    mov     rdi, rbx
+    mov     rsi, r13
+    call    reverse_u8_avx2
+    lea     rdi, [rbx + r13]
+    mov     rsi, r12
+    sub     rsi, r13
+    call    reverse_u8_avx2
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    reverse_u8_avx2
+
+.restore:
+    pop     r13
+    pop     r12
+    pop     rbx
+.done:
+    ret
+
+; ============================================================================
+; FUNCTION: bswap16_avx2 / bswap32_avx2 / bswap64_avx2
+; Description: Byte-swap every element (big <-> little endian)
+; Arguments: RDI = destination, RSI = source (may equal RDI),
+;            RDX = element count
+;
+; 128 bytes per iteration. The last 32 bytes are loaded and swapped before
+; the loop writes anything, then stored last, overlapping the final loop
+; block: that covers any length of 32 bytes or more without a scalar
+; tail, in place or not.
+; ============================================================================
+bswap16_avx2:
+    add     rdx, rdx
+    lea     rcx, [bswap_masks]
+    jmp     bswap_masked
+
+bswap32_avx2:
+    shl     rdx, 2
+    lea     rcx, [bswap_masks + 16]
+    jmp     bswap_masked
+
+bswap64_avx2:
+    shl     rdx, 3
+    lea     rcx, [bswap_masks + 32]
+
+; RDI = destination, RSI = source, RDX = length in bytes, RCX = mask
+bswap_masked:
+    vbroadcasti128 ymm15, [rcx]
+    cmp     rdx, 32
+    jb      .small
+
+    vmovdqu ymm4, [rsi + rdx - 32]  ; Last block, before any store
+    vpshufb ymm4, ymm4, ymm15
+    xor     eax, eax
+    lea     rcx, [rdx - 128]
+
+.loop:
+    cmp     rax, rcx
+    jg      .by32                   ; Signed: RCX < 0 when under 128 bytes
+    vmovdqu ymm0, [rsi + rax]
+    vmovdqu ymm1, [rsi + rax + 32]
+    vmovdqu ymm2, [rsi + rax + 64]
+    vmovdqu ymm3, [rsi + rax + 96]
+    vpshufb ymm0, ymm0, ymm15
+    vpshufb ymm1, ymm1, ymm15
+    vpshufb ymm2, ymm2, ymm15
+    vpshufb ymm3, ymm3, ymm15
+    vmovdqu [rdi + rax], ymm0
+    vmovdqu [rdi + rax + 32], ymm1
+    vmovdqu [rdi + rax + 64], ymm2
+    vmovdqu [rdi + rax + 96], ymm3
+    add     rax, 128
+    jmp     .loop
+
+.by32:
+    lea     rcx, [rdx - 32]
+.loop32:
+    cmp     rax, rcx
+    jae     .last
+    vmovdqu ymm0, [rsi + rax]
+    vpshufb ymm0, ymm0, ymm15
+    vmovdqu [rdi + rax], ymm0
+    add     rax, 32
+    jmp     .loop32
+
+.last:
+    vmovdqu [rdi + rdx - 32], ymm4
+    vzeroupper
+    ret
+
+.small:
+    ; Under 32 bytes: swap in a stack buffer
+    test    rdx, rdx
+    jz      .small_done
+    sub     rsp, 40
+    mov     r8, rdi
+    mov     rdi, rsp
+    mov     rcx, rdx
+    rep     movsb
+    vmovdqu ymm0, [rsp]
+    vpshufb ymm0, ymm0, ymm15
+    vmovdqu [rsp], ymm0
+    mov     rsi, rsp
+    mov     rdi, r8
+    mov     rcx, rdx
+    rep     movsb
+    add     rsp, 40
+.small_done:
+    vzeroupper
+    ret
+
+; ============================================================================
+; FUNCTION: interleave_u8_avx2 / interleave_u16_avx2 / interleave_u32_avx2 /
+;           interleave_u64_avx2
+; Description: Merge two arrays element by element: dst = a0 b0 a1 b1 ...
+; Arguments: RDI = destination (2 * count elements), RSI = a, RDX = b,
+;            RCX = element count of a and of b
+;
+; Per 32 bytes of each input: VPERM2I128 pairs the low halves of a and b
+; (and the high halves), VPERMQ 0xD8 puts a and b qwords side by side in
+; each lane, and VPSHUFB merges the two qwords of a lane element by element.
+; ============================================================================
+interleave_u8_avx2:
+    lea     r8, [interleave_masks]
+    jmp     interleave_masked
+
+interleave_u16_avx2:
+    add     rcx, rcx
+    lea     r8, [interleave_masks + 16]
+    jmp     interleave_masked
+
+interleave_u32_avx2:
+    shl     rcx, 2
+    lea     r8, [interleave_masks + 32]
+    jmp     interleave_masked
+
+interleave_u64_avx2:
+    shl     rcx, 3
+    lea     r8, [interleave_masks + 48]
+
+; RDI = destination, RSI = a, RDX = b, RCX = bytes per input, R8 = mask
+interleave_masked:
+    vbroadcasti128 ymm15, [r8]
+    xor     eax, eax
+    lea     r8, [rcx - 32]
+
+.loop:
+    cmp     rax, r8
+    jg      .tail                   ; Fewer than 32 bytes left (signed)
+    vmovdqu ymm0, [rsi + rax]
+    vmovdqu ymm1, [rdx + rax]
+    call    .step
+    vmovdqu [rdi + rax*2], ymm2
+    vmovdqu [rdi + rax*2 + 32], ymm3
+    add     rax, 32
+    jmp     .loop
+
+.tail:
+    sub     rcx, rax                ; Bytes left in each input
+    jz      .done
+    push    rbp
+    mov     rbp, rsp
+    sub     rsp, 128                ; a[32], b[32], output[64]
+    vpxor   xmm0, xmm0, xmm0
+    vmovdqu [rsp], ymm0
+    vmovdqu [rsp + 32], ymm0
+    lea     r9, [rdi + rax*2]       ; Destination of the tail
+    lea     r10, [rdx + rax]
+    lea     rsi, [rsi + rax]
+    mov     rdi, rsp
+    mov     rdx, rcx
+    rep     movsb                   ; a tail
+    mov     rsi, r10
+    lea     rdi, [rsp + 32]
+    mov     rcx, rdx
+    rep     movsb                   ; b tail
+    vmovdqu ymm0, [rsp]
+    vmovdqu ymm1, [rsp + 32]
+    call    .step
+    vmovdqu [rsp + 64], ymm2
+    vmovdqu [rsp + 96], ymm3
+    lea     rsi, [rsp + 64]
+    mov     rdi, r9
+    lea     rcx, [rdx + rdx]
+    rep     movsb
+    mov     rsp, rbp
+    pop     rbp
+
+.done:
+    vzeroupper
+    ret
+
+; YMM0 = 32 bytes of a, YMM1 = 32 bytes of b -> YMM2, YMM3 = merged
+.step:
+    vperm2i128 ymm2, ymm0, ymm1, 0x20   ; a.lo | b.lo
+    vperm2i128 ymm3, ymm0, ymm1, 0x31   ; a.hi | b.hi
+    vpermq  ymm2, ymm2, 0xD8            ; [a.q0 b.q0 | a.q1 b.q1]
+    vpermq  ymm3, ymm3, 0xD8
+    vpshufb ymm2, ymm2, ymm15
+    vpshufb ymm3, ymm3, ymm15
+    ret
+
+; ============================================================================
+; FUNCTION: deinterleave_u8_avx2 / deinterleave_u16_avx2 /
+;           deinterleave_u32_avx2 / deinterleave_u64_avx2
+; Description: Split alternating elements: a = src[0, 2, 4...],
+;              b = src[1, 3, 5...]
+; Arguments: RDI = a, RSI = b, RDX = source (2 * count elements),
+;            RCX = element count of a and of b
+;
+; The inverse of interleave: VPSHUFB gathers the even elements of each
+; lane into its low qword and the odd ones into its high qword, VPERMQ
+; 0xD8 collects the evens in the low lane, VPERM2I128 joins two blocks.
+; ============================================================================
+deinterleave_u8_avx2:
+    lea     r8, [deinterleave_masks]
+    jmp     deinterleave_masked
+
+deinterleave_u16_avx2:
+    add     rcx, rcx
+    lea     r8, [deinterleave_masks + 16]
+    jmp     deinterleave_masked
+
+deinterleave_u32_avx2:
+    shl     rcx, 2
+    lea     r8, [deinterleave_masks + 32]
+    jmp     deinterleave_masked
+
+deinterleave_u64_avx2:
+    shl     rcx, 3
+    lea     r8, [deinterleave_masks + 48]
+
+; RDI = a, RSI = b, RDX = source, RCX = bytes per output, R8 = mask
+deinterleave_masked:
+    vbroadcasti128 ymm15, [r8]
+    xor     eax, eax
+    lea     r8, [rcx - 32]
+
+.loop:
+    cmp     rax, r8
+    jg      .tail
+    vmovdqu ymm0, [rdx + rax*2]
+    vmovdqu ymm1, [rdx + rax*2 + 32]
+    call    .step
+    vmovdqu [rdi + rax], ymm2
+    vmovdqu [rsi + rax], ymm3
+    add     rax, 32
+    jmp     .loop
+
+.tail:
+    sub     rcx, rax
+    jz      .done
+    push    rbp
+    mov     rbp, rsp
+    sub     rsp, 128                ; source[64], a[32], b[32]
+    lea     r9, [rdi + rax]         ; Tail destinations
+    lea     r10, [rsi + rax]
+    lea     rsi, [rdx + rax*2]
+    mov     rdi, rsp
+    mov     rdx, rcx
+    add     rcx, rcx
+    rep     movsb                   ; 2 * bytes of source
+    vmovdqu ymm0, [rsp]
+    vmovdqu ymm1, [rsp + 32]
+    call    .step
+    vmovdqu [rsp + 64], ymm2
+    vmovdqu [rsp + 96], ymm3
+    lea     rsi, [rsp + 64]
+    mov     rdi, r9
+    mov     rcx, rdx
+    rep     movsb                   ; a tail
+    lea     rsi, [rsp + 96]
+    mov     rdi, r10
+    mov     rcx, rdx
+    rep     movsb                   ; b tail
+    mov     rsp, rbp
+    pop     rbp
+
+.done:
+    vzeroupper
+    ret
+
+; YMM0, YMM1 = 64 bytes of source -> YMM2 = 32 bytes of a, YMM3 = of b
+.step:
+    vpshufb ymm0, ymm0, ymm15           ; Per lane: evens | odds
+    vpshufb ymm1, ymm1, ymm15
+    vpermq  ymm0, ymm0, 0xD8            ; Evens in the low lane
+    vpermq  ymm1, ymm1, 0xD8
+    vperm2i128 ymm2, ymm0, ymm1, 0x20
+    vperm2i128 ymm3, ymm0, ymm1, 0x31
+    ret
+
+; ============================================================================
+; FUNCTION: verify_permutations
+; Description: Check the AVX2 permutations against element-by-element
+;              copies for every element size and 0-99 elements
+; Returns: RAX = 0 if every result matches, 1 otherwise
+; ============================================================================
+verify_permutations:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 8
+
+    ; Source pattern: byte i = i * 7 + 3
+    xor     ecx, ecx
+.fill:
+    lea     eax, [rcx*8]
+    sub     eax, ecx
+    add     eax, 3
+    mov     [perm_src + rcx], al
+    inc     ecx
+    cmp     ecx, PERM_TEST_BYTES
+    jb      .fill
+
+    xor     r15d, r15d              ; log2(element size): 0-3
+.size_loop:
+    xor     r12d, r12d              ; Element count
+.count_loop:
+    mov     ecx, r15d
+    mov     r13d, 1
+    shl     r13d, cl                ; R13 = element size
+    mov     r14, r12
+    shl     r14, cl                 ; R14 = bytes
+
+    ; --- reverse: reference copies element n-1-i to slot i ---
+    xor     ebx, ebx
+.rev_ref:
+    cmp     rbx, r12
+    jae     .rev_test
+    mov     rax, r12
+    sub     rax, rbx
+    dec     rax
+    imul    rax, r13
+    lea     rsi, [perm_src + rax]
+    mov     rax, rbx
+    imul    rax, r13
+    lea     rdi, [perm_ref + rax]
+    mov     rcx, r13
+    rep     movsb
+    inc     rbx
+    jmp     .rev_ref
+.rev_test:
+    lea     rsi, [perm_src]
+    lea     rdi, [perm_dst]
+    mov     rcx, r14
+    rep     movsb
+    lea     rdi, [perm_dst]
+    mov     rsi, r12
+    call    [reverse_impls + r15*8]
+    call    .compare
+    jne     .fail
+
+    ; --- interleave src (a) with src + bytes (b), then split again ---
+    xor     ebx, ebx
+.int_ref:
+    cmp     rbx, r12
+    jae     .int_test
+    mov     rax, rbx
+    imul    rax, r13
+    lea     rsi, [perm_src + rax]
+    lea     rdi, [perm_ref + rax*2]
+    mov     rcx, r13
+    rep     movsb                   ; a[i]
+    lea     rsi, [perm_src + r14]
+    add     rsi, rax
+    mov     rcx, r13
+    rep     movsb                   ; b[i]
+    inc     rbx
+    jmp     .int_ref
+.int_test:
+    lea     rdi, [perm_dst]
+    lea     rsi, [perm_src]
+    lea     rdx, [perm_src + r14]
+    mov     rcx, r12
+    call    [interleave_impls + r15*8]
+    lea     rsi, [perm_ref]         ; Compare 2 * bytes
+    lea     rdi, [perm_dst]
+    lea     rcx, [r14 + r14]
+    repe    cmpsb
+    jne     .fail
+    lea     rdi, [perm_dst + PERM_TEST_BYTES]
+    lea     rsi, [perm_dst + PERM_TEST_BYTES + PERM_TEST_BYTES / 2]
+    lea     rdx, [perm_ref]
+    mov     rcx, r12
+    call    [deinterleave_impls + r15*8]
+    lea     rsi, [perm_src]         ; a, b back to back = the source
+    lea     rdi, [perm_dst + PERM_TEST_BYTES]
+    mov     rcx, r14
+    repe    cmpsb
+    jne     .fail
+    lea     rsi, [perm_src + r14]
+    lea     rdi, [perm_dst + PERM_TEST_BYTES + PERM_TEST_BYTES / 2]
+    mov     rcx, r14
+    repe    cmpsb
+    jne     .fail
+
+    ; --- byte swap (2/4/8-byte elements): reverse each element's bytes ---
+    test    r15d, r15d
+    jz      .rotate
+    xor     ebx, ebx
+.swap_ref:
+    cmp     rbx, r14
+    jae     .swap_test
+    lea     rax, [r13 - 1]          ; Byte j of an element <- byte size-1-j
+    xor     rax, rbx
+    mov     cl, [perm_src + rax]
+    mov     [perm_ref + rbx], cl
+    inc     rbx
+    jmp     .swap_ref
+.swap_test:
+    lea     rdi, [perm_dst]
+    lea     rsi, [perm_src]
+    mov     rdx, r12
+    call    [bswap_impls + r15*8]
+    call    .compare
+    jne     .fail
+
+.rotate:
+    ; --- rotate left by 3 elements: byte i comes from (i + shift) mod len ---
+    test    r14, r14
+    jz      .next
+    lea     rax, [r13*2 + r13]      ; Shift = 3 elements
+    xor     edx, edx
+    div     r14
+    mov     rbp, rdx                ; Effective shift
+    xor     ebx, ebx
+.rot_ref:
+    lea     rax, [rbx + rbp]
+    cmp     rax, r14
+    jb      .rot_in_range
+    sub     rax, r14
+.rot_in_range:
+    mov     cl, [perm_src + rax]
+    mov     [perm_ref + rbx], cl
+    inc     rbx
+    cmp     rbx, r14
+    jb      .rot_ref
+    lea     rsi, [perm_src]
+    lea     rdi, [perm_dst]
+    mov     rcx, r14
+    rep     movsb
+    lea     rdi, [perm_dst]
+    mov     rsi, r14
+    lea     rdx, [r13*2 + r13]
+    call    rotate_left_avx2
+    call    .compare
+    jne     .fail
+
+.next:
+    inc     r12
+    cmp     r12, 100
+    jb      .count_loop
+    inc     r15d
+    cmp     r15d, 4
+    jb      .size_loop
+
+    xor     eax, eax
+    jmp     .done
+
+.fail:
+    mov     eax, 1
+
+.done:
+    add     rsp, 8
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+; ZF = 1 if perm_dst matches perm_ref over R14 bytes
+.compare:
+    lea     rsi, [perm_ref]
+    lea     rdi, [perm_dst]
+    mov     rcx, r14
+    cmp     rcx, rcx                ; Set ZF for a zero-length compare
+    repe    cmpsb
+    ret
+
+; ============================================================================
+; NOTES:
+; ============================================================================
+;
+; String Instructions Summary:
+; ┌──────────┬────────────────────────────────────────────────────────┐
+; │ MOVSB/Q  │ Move [RSI] to [RDI], advance both                     │
+; │ STOSB/Q  │ Store AL/RAX to [RDI], advance RDI                    │
+; │ LODSB/Q  │ Load [RSI] to AL/RAX, advance RSI                     │
 ; │ SCASB/Q  │ Compare AL/RAX with [RDI], advance RDI                │
 ; │ CMPSB/Q  │ Compare [RSI] with [RDI], advance both                │
 ; └──────────┴────────────────────────────────────────────────────────┘
@@ -516,6 +4575,58 @@ array_reverse:
 ;   - For small copies, manual loops may be faster
 ;   - Keep frequently accessed arrays in cache
 ;   - Align arrays to cache line boundaries (64 bytes)
+;   - Scan strings 16/32 bytes at a time: PCMPEQB against zero + PMOVMSKB
+;     gives a bit per byte, BSF finds the first hit
+;   - Vector reads past the terminator are only safe if they stay inside
+;     the last page the string touches: align loads, or check the page
+;     offset before an unaligned load (see strlen/strcmp)
+;   - PCMPISTRI (SSE4.2) handles the terminator in one instruction but has
+;     higher latency than PCMPEQB/PMOVMSKB on current cores
+;
+; Searching:
+;   - REPNE SCASB / REPE CMPSB cost a microcode startup plus roughly a
+;     cycle per byte; VPCMPEQB + VPMOVMSKB + TZCNT checks 32 bytes in a few
+;     cycles, and OR-ing four compares per branch keeps the loop at the
+;     load rate.
+;   - With an explicit length, aligned loads keep a scan inside the pages
+;     the buffer touches; the bits outside the buffer are masked off. For
+;     unaligned pairs (mismatch), finish with a block that ends at the last
+;     byte instead of reading past it.
+;   - Substring search: filter 32 start positions by the needle's first
+;     and last bytes, verify the few survivors. PCMPESTRI's equal-ordered
+;     mode does the filtering on SSE4.2 only, 16 positions at a time and
+;     with an 11-cycle-class latency.
+;
+; ASCII transforms:
+;   - A per-byte branch on 'a' <= c <= 'z' mispredicts on mixed-case text;
+;     bias + one signed compare + AND/XOR maps 32 bytes with no branch.
+;   - Two 16-entry VPSHUFB tables (low and high nibble) hold a bit per
+;     class; AND of the two lookups classifies every byte at once.
+;   - A 256-entry table is 16 rows of 16 for VPSHUFB. Stepping the index
+;     down by 16 per row and XOR-ing row-to-row deltas leaves the right
+;     row (PSHUFB gives 0 once bit 7 is set); VPBLENDVB on bit 7 of the
+;     source picks the half. NEON's TBL/TBX read 64 bytes and need four.
+;   - Operations that are not idempotent (translation) cannot redo an
+;     overlapping tail in place: compute it first, store it last.
+;
+; Reductions:
+;   - One accumulator = one dependency chain: the loop runs at the latency
+;     of the add (or compare + blend), not at the load rate. Independent
+;     accumulators fix that; combine them only after the loop.
+;   - Large arrays are DRAM-bound: one core's vector loop can already use
+;     most of its bandwidth share, so threads help only until the memory
+;     channels are saturated (often 4-8 threads), not up to the core count.
+;   - Wrapping vector adds cannot report overflow reliably; sum exactly
+;     (split halves, or a 128-bit accumulator) and check once at the end.
+;
+; Permutations:
+;   - VPSHUFB reorders bytes within each 16-byte lane from a mask; one
+;     mask per element size covers reverse, byte swap and (de)interleave.
+;   - Crossing lanes needs VPERMQ / VPERM2I128 (3-cycle latency on most
+;     cores) - keep it to one per 32-byte block.
+;   - Rotation by three reversals is in place and streams the data three
+;     times; a rotation through a scratch buffer streams it twice but
+;     needs len - shift extra bytes.
 ;
 ; ============================================================================
 
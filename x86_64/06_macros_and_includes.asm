@@ -1,9 +1,11 @@
 ; ============================================================================
 ; File: 06_macros_and_includes.asm
 ; Description: Demonstrates macros, includes, and code organization
-; Topics: Macros, %include, multi-line macros, conditional assembly
+; Topics: Macros, %include, multi-line macros, conditional assembly,
+;         buffered output (ring buffer + writev), RDTSCP latency probes
 ; Assembler: NASM
 ; Build: nasm -f elf64 06_macros_and_includes.asm && ld -o 06_macros_and_includes 06_macros_and_includes.o
+;        (add -DPROBES to nasm to compile the probes in; C side: 06_probes.h)
 ; ============================================================================
 
 ; ============================================================================
@@ -13,7 +15,12 @@
 ; Define a simple macro (text substitution)
 %define SYS_EXIT    60
 %define SYS_WRITE   1
+%define SYS_WRITEV  20
 %define STDOUT      1
+%define EINTR       4
+%define EIO         5
+
+%define BW_SIZE     65536      ; Buffered writer ring size (power of two)
 
 ; Macro with parameters
 %define mov64(reg, val) mov reg, val
@@ -31,8 +38,9 @@
     syscall
 %endmacro
 
-; Macro for exiting program
+; Macro for exiting program (flushes buffered output first)
 %macro exit_program 1
+    call    bw_flush
     mov     rax, SYS_EXIT
     mov     rdi, %1            ; Exit code
     syscall
@@ -97,6 +105,25 @@
     %endrep
 %endmacro
 
+; Buffered print: copies into the bw_buffer ring instead of a syscall
+; bprint msg, len  - explicit length
+; bprint msg       - NUL-terminated (length from strlen)
+%macro bprint 1-2
+    mov     rdi, %1
+    %if %0 == 2
+        mov     rsi, %2
+    %else
+        call    strlen
+        mov     rsi, rax
+    %endif
+    call    bw_write
+%endmacro
+
+; Write out everything bprint has buffered
+%macro bflush 0
+    call    bw_flush
+%endmacro
+
 ; Conditional macro
 %macro debug_print 1
     %ifdef DEBUG               ; Only include if DEBUG is defined
@@ -225,6 +252,83 @@
     mov     [time_end + 4], edx
 %endmacro
 
+; ============================================================================
+; HOT-PATH PROBES
+; ============================================================================
+;
+; PROBE_BEGIN name / PROBE_END name time the code between them with RDTSCP
+; and add the delta to a histogram for that name. Without -DPROBES both
+; expand to nothing, as does PROBE_DUMP.
+;
+; Each PROBE_BEGIN defines its probe, so every name has exactly one
+; PROBE_BEGIN (and any number of PROBE_ENDs, e.g. one per exit path). It
+; emits:
+;   - the histogram in .bss (layout below)
+;   - the name as a string in .rodata
+;   - a {name, histogram} record in the "probes" section. The linker
+;     gathers the records of every object file between __start_probes and
+;     __stop_probes, which is how probe_dump finds them all.
+;
+; Both macros clobber RAX, RCX, RDX and the flags, like rdtsc_start.
+; PROBE_END calls probe_record, so it needs a usable stack. The state is
+; plain memory: one thread per probe name.
+
+%define PROBE_START     0       ; TSC at the last PROBE_BEGIN
+%define PROBE_COUNT     8
+%define PROBE_SUM       16      ; Total ticks
+%define PROBE_MIN       24      ; NOT of the minimum, so 0 means none yet
+%define PROBE_MAX       32
+%define PROBE_BUCKETS   40      ; 64 counts: [k] = deltas in [2^k, 2^(k+1))
+%define PROBE_SIZE      (PROBE_BUCKETS + 64 * 8)
+%define PROBE_META_SIZE 16      ; Record: dq name, histogram
+
+%ifdef PROBES
+
+; ..@ labels do not start a new scope for .local labels, so the macros can
+; be used in the middle of a function
+%macro PROBE_BEGIN 1
+    [section probes progbits alloc noexec write align=8]
+    dq      ..@probe_name_%1, ..@probe_hist_%1
+    [section .rodata]
+    %defstr probe_name_str %1
+..@probe_name_%1: db probe_name_str, 0
+    [section .bss]
+    alignb 64
+..@probe_hist_%1: resb PROBE_SIZE
+    __SECT__
+    rdtscp                     ; Waits for earlier instructions to finish
+    shl     rdx, 32
+    or      rax, rdx
+    mov     [..@probe_hist_%1 + PROBE_START], rax
+%endmacro
+
+%macro PROBE_END 1
+    rdtscp
+    shl     rdx, 32
+    or      rax, rdx
+    sub     rax, [..@probe_hist_%1 + PROBE_START]
+    lea     rcx, [..@probe_hist_%1]
+    call    probe_record
+%endmacro
+
+; Print every probe's histogram with bprint
+%macro PROBE_DUMP 0
+    call    probe_dump
+%endmacro
+
+%else
+
+%macro PROBE_BEGIN 1
+%endmacro
+
+%macro PROBE_END 1
+%endmacro
+
+%macro PROBE_DUMP 0
+%endmacro
+
+%endif
+
 ; ============================================================================
 ; DATA SECTION
 ; ============================================================================
@@ -248,10 +352,35 @@ section .data
     debug_msg_len: equ $ - debug_msg
     %endif
 
+    ; Buffered writer state
+    bw_fd:            dq STDOUT
+    bw_line_buffered: dq 0      ; 1 = flush whenever a newline is written
+
+    %ifdef PROBES
+    probe_count_msg:  db ": count="
+    probe_count_len:  equ $ - probe_count_msg
+    probe_sum_msg:    db " sum="
+    probe_sum_len:    equ $ - probe_sum_msg
+    probe_min_msg:    db " min="
+    probe_min_len:    equ $ - probe_min_msg
+    probe_max_msg:    db " max="
+    probe_max_len:    equ $ - probe_max_msg
+    probe_bucket_msg: db "  2^"
+    probe_bucket_len: equ $ - probe_bucket_msg
+    probe_colon_msg:  db ": "
+    probe_colon_len:  equ $ - probe_colon_msg
+    %endif
+
 section .bss
     time_start: resq 1
     time_end:   resq 1
     temp_buffer: resb 100
+    
+    bw_head:    resq 1          ; Bytes written out (free-running)
+    bw_tail:    resq 1          ; Bytes buffered (free-running)
+    bw_iov:     resq 6          ; Up to 3 struct iovec {base, len} for writev
+    alignb 64
+    bw_buffer:  resb BW_SIZE
 
 section .text
 
@@ -268,8 +397,10 @@ _start:
     ; USING PRINT MACRO
     ; ========================================================================
     
-    print_string msg1, msg1_len    ; Expand macro
-    print_string msg2, msg2_len
+    print_string msg1, msg1_len    ; Expand macro: one write syscall
+    
+    ; Buffered: stays in memory until the buffer fills, bflush, or exit
+    bprint  msg2, msg2_len
     
     ; ========================================================================
     ; USING REGISTER SAVE/RESTORE MACROS
@@ -358,6 +489,8 @@ _start:
     ; ========================================================================
     
     ; Write system call using wrapper
+    ; A direct write would overtake anything still buffered, so flush first
+    bflush
     syscall_wrapper SYS_WRITE, STDOUT, msg3, msg3_len
     
     ; ========================================================================
@@ -382,6 +515,25 @@ _start:
     sbb     edx, [time_start + 4]
     ; Result in EDX:EAX
     
+    ; ========================================================================
+    ; HOT-PATH PROBES (only with -DPROBES)
+    ; ========================================================================
+    
+    ; Same loop, timed 16 times into a histogram. PROBE_BEGIN is expanded
+    ; once, so it may sit inside a loop.
+    mov     r12, 16
+.probe_loop:
+    PROBE_BEGIN spin_loop
+    mov     rcx, 10000
+.spin:
+    dec     rcx
+    jnz     .spin
+    PROBE_END spin_loop
+    dec     r12
+    jnz     .probe_loop
+    
+    PROBE_DUMP                 ; exit_program flushes the output
+    
     ; ========================================================================
     ; EXIT
     ; ========================================================================
@@ -417,6 +569,279 @@ strlen:
     pop     rdi
     ret
 
+; ============================================================================
+; BUFFERED WRITER
+; ============================================================================
+;
+; bw_write appends to a ring buffer; nothing reaches the kernel until the
+; ring is full, a newline arrives in line-buffered mode, or bw_flush runs
+; (exit_program always calls it). The buffered bytes may wrap around the
+; end of the ring, so a flush is a writev of up to two ring pieces - plus,
+; when a message does not fit, the message itself, which is never copied.
+; The C version is bw_write in 09_inline_asm_c.c.
+
+; ============================================================================
+; FUNCTION: bw_write
+; Description: Buffer a message for bw_fd
+; Arguments: RDI = buffer, RSI = length
+; Returns: RAX = 0 on success, negative errno if a flush failed
+; ============================================================================
+bw_write:
+    mov     rax, [bw_tail]
+    mov     rcx, rax
+    sub     rcx, [bw_head]          ; Bytes buffered
+    mov     rdx, BW_SIZE
+    sub     rdx, rcx                ; Space left
+    cmp     rsi, rdx
+    ja      bw_drain                ; Too big: write ring + message together
+    
+    push    rdi
+    push    rsi
+    
+    ; Copy in up to two pieces: up to the end of the ring, then from the start
+    mov     rdx, rax
+    and     edx, BW_SIZE - 1        ; Ring offset of the tail
+    mov     rcx, BW_SIZE
+    sub     rcx, rdx
+    cmp     rcx, rsi
+    cmova   rcx, rsi                ; First piece
+    add     rax, rsi
+    mov     [bw_tail], rax
+    mov     r8, rsi
+    sub     r8, rcx                 ; Second piece
+    mov     rsi, rdi
+    lea     rdi, [bw_buffer + rdx]
+    rep     movsb
+    mov     rcx, r8
+    mov     rdi, bw_buffer
+    rep     movsb
+    
+    pop     rcx                     ; Length
+    pop     rdi                     ; Buffer
+    xor     eax, eax
+    cmp     qword [bw_line_buffered], 0
+    je      .done
+    test    rcx, rcx
+    jz      .done
+    
+    ; Line-buffered: flush if the message contains a newline
+    mov     al, 0x0a
+    repne   scasb
+    je      bw_flush
+    xor     eax, eax
+    
+.done:
+    ret
+
+; ============================================================================
+; FUNCTION: bw_flush
+; Description: Write out everything buffered
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+bw_flush:
+    xor     edi, edi
+    xor     esi, esi
+    ; Fall through
+
+; ============================================================================
+; FUNCTION: bw_drain
+; Description: Write the ring contents followed by an extra buffer, with
+;              writev, until everything is out
+; Arguments: RDI = extra buffer, RSI = extra length (0 for none)
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+bw_drain:
+    push    rbx
+    push    r12
+    push    r13
+    mov     r12, rdi
+    mov     r13, rsi
+    
+.next:
+    ; Build the iovec list: ring piece(s), then the extra buffer
+    xor     ebx, ebx                ; iovec count
+    mov     rax, [bw_head]
+    mov     rcx, [bw_tail]
+    sub     rcx, rax                ; Bytes buffered
+    jz      .extra
+    
+    mov     rdx, rax
+    and     edx, BW_SIZE - 1
+    lea     r8, [bw_buffer + rdx]
+    mov     r9, BW_SIZE
+    sub     r9, rdx
+    cmp     r9, rcx
+    cmova   r9, rcx
+    mov     [bw_iov], r8
+    mov     [bw_iov + 8], r9
+    mov     ebx, 1
+    sub     rcx, r9
+    jz      .extra
+    mov     qword [bw_iov + 16], bw_buffer  ; Wrapped part
+    mov     [bw_iov + 24], rcx
+    mov     ebx, 2
+    
+.extra:
+    test    r13, r13
+    jz      .write
+    mov     rdx, rbx
+    shl     rdx, 4
+    mov     [bw_iov + rdx], r12
+    mov     [bw_iov + rdx + 8], r13
+    inc     ebx
+    
+.write:
+    xor     eax, eax
+    test    ebx, ebx
+    jz      .done                   ; Nothing left
+    
+    mov     rax, SYS_WRITEV
+    mov     rdi, [bw_fd]
+    mov     rsi, bw_iov
+    mov     edx, ebx
+    syscall
+    
+    cmp     rax, -EINTR
+    je      .next
+    test    rax, rax
+    js      .done                   ; Error: unwritten data stays buffered
+    jz      .stalled
+    
+    ; Consume the bytes written: ring first, then the extra buffer
+    mov     rcx, [bw_tail]
+    sub     rcx, [bw_head]
+    cmp     rax, rcx
+    ja      .past_ring
+    add     [bw_head], rax
+    jmp     .next
+    
+.past_ring:
+    mov     rdx, [bw_tail]
+    mov     [bw_head], rdx
+    sub     rax, rcx
+    add     r12, rax
+    sub     r13, rax
+    jmp     .next
+    
+.stalled:
+    mov     rax, -EIO
+    
+.done:
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+%ifdef PROBES
+
+; ============================================================================
+; FUNCTION: probe_record
+; Description: Add one measurement to a probe histogram (PROBE_END)
+; Arguments: RAX = ticks, RCX = histogram
+; Returns: nothing; clobbers RDX and the flags
+; ============================================================================
+probe_record:
+    inc     qword [rcx + PROBE_COUNT]
+    add     [rcx + PROBE_SUM], rax
+    mov     rdx, rax
+    not     rdx
+    cmp     rdx, [rcx + PROBE_MIN]
+    jbe     .min_done               ; Taken almost always once warmed up
+    mov     [rcx + PROBE_MIN], rdx
+.min_done:
+    cmp     rax, [rcx + PROBE_MAX]
+    jbe     .max_done
+    mov     [rcx + PROBE_MAX], rax
+.max_done:
+    mov     rdx, rax
+    or      rdx, 1
+    bsr     rdx, rdx                ; floor(log2), 0 for 0 and 1
+    inc     qword [rcx + PROBE_BUCKETS + rdx*8]
+    ret
+
+; ============================================================================
+; FUNCTION: probe_dump
+; Description: bprint every probe in the program, one line per probe and
+;              one per non-empty bucket:
+;                name: count=N sum=T min=A max=B
+;                  2^k: n
+; Returns: nothing
+; ============================================================================
+extern __start_probes, __stop_probes
+
+probe_dump:
+    push    rbx
+    push    r12
+    push    r13
+    mov     rbx, __start_probes
+    
+.probe:
+    cmp     rbx, __stop_probes
+    jae     .done
+    mov     r12, [rbx + 8]          ; Histogram
+    bprint  [rbx]                   ; Name
+    bprint  probe_count_msg, probe_count_len
+    mov     rax, [r12 + PROBE_COUNT]
+    call    probe_print_u64
+    bprint  probe_sum_msg, probe_sum_len
+    mov     rax, [r12 + PROBE_SUM]
+    call    probe_print_u64
+    bprint  probe_min_msg, probe_min_len
+    mov     rax, [r12 + PROBE_MIN]
+    not     rax
+    cmp     qword [r12 + PROBE_COUNT], 0
+    cmove   rax, [r12 + PROBE_MIN]  ; No measurements: 0
+    call    probe_print_u64
+    bprint  probe_max_msg, probe_max_len
+    mov     rax, [r12 + PROBE_MAX]
+    call    probe_print_u64
+    bprint  newline, 1
+    
+    xor     r13d, r13d              ; Bucket
+.bucket:
+    cmp     qword [r12 + PROBE_BUCKETS + r13*8], 0
+    je      .next_bucket
+    bprint  probe_bucket_msg, probe_bucket_len
+    mov     rax, r13
+    call    probe_print_u64
+    bprint  probe_colon_msg, probe_colon_len
+    mov     rax, [r12 + PROBE_BUCKETS + r13*8]
+    call    probe_print_u64
+    bprint  newline, 1
+.next_bucket:
+    inc     r13d
+    cmp     r13d, 64
+    jb      .bucket
+    
+    add     rbx, PROBE_META_SIZE
+    jmp     .probe
+    
+.done:
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; probe_print_u64: bprint RAX in decimal (digits built backwards in
+; temp_buffer)
+probe_print_u64:
+    lea     rdi, [temp_buffer + 20]
+    mov     ecx, 10
+.digit:
+    xor     edx, edx
+    div     rcx
+    add     dl, '0'
+    dec     rdi
+    mov     [rdi], dl
+    test    rax, rax
+    jnz     .digit
+    lea     rsi, [temp_buffer + 20]
+    sub     rsi, rdi
+    call    bw_write
+    ret
+
+%endif
+
 ; ============================================================================
 ; EXAMPLE: FUNCTION-LIKE MACRO vs ACTUAL FUNCTION
 ; ============================================================================
@@ -484,6 +909,25 @@ square_function:
 ;   5. Consider using functions for complex logic
 ;   6. Use %ifdef for platform-specific code
 ;
+; Buffered Output (bprint / bflush):
+;   Each write syscall costs hundreds of cycles or more, whatever its size,
+;   so a program that logs many short lines spends most of its time
+;   entering the kernel. Buffering turns N messages into about
+;   N * avg_len / BW_SIZE syscalls. Mixing buffered and direct writes to
+;   the same fd reorders output unless you bflush before the direct write.
+;
+; Probes (PROBE_BEGIN / PROBE_END):
+;   The cost when compiled in is two RDTSCP (about 20-40 cycles each; it
+;   waits for earlier instructions, so the probe does not measure work
+;   that has not finished) plus a few cached adds. Branch-free min/max
+;   would store every time; the compares almost never branch once the
+;   extremes are known. Deltas are TSC ticks, which run at a fixed rate,
+;   not core cycles. A probe that migrates between cores may see a
+;   skewed delta; the log2 buckets keep such outliers from hiding the
+;   shape. Without -DPROBES nothing is emitted at all - no code, no
+;   .bss, no "probes" section - so the macros can stay in shipped code
+;   and be switched on per build.
+;
 ; Predefined Macros (NASM):
 ;   __NASM_VERSION__  - NASM version
 ;   __FILE__          - Current file name
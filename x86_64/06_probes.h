@@ -0,0 +1,104 @@
+/*
+ * ============================================================================
+ * File: 06_probes.h
+ * Description: C side of the PROBE_BEGIN / PROBE_END latency probes in
+ *              06_macros_and_includes.asm
+ * Build: gcc -O2 -DPROBES your_program.c   (without -DPROBES every macro
+ *        expands to nothing)
+ * ============================================================================
+ *
+ *   PROBE_BEGIN(name)  start timing; defines the probe, so once per name
+ *                      and in the same function as its PROBE_ENDs
+ *   PROBE_END(name)    add the RDTSCP delta since PROBE_BEGIN to the
+ *                      name's histogram (count, sum, min, max, log2 buckets)
+ *   probe_dump(f)      print every probe in the program
+ *
+ * The histograms and the {name, histogram} records use the same layout as
+ * the assembly macros, and the records of both land in the "probes"
+ * section, so probe_dump() also lists probes in linked .asm objects.
+ *
+ * The state is plain memory: one thread per probe name.
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#ifdef PROBES
+
+#include <stdint.h>
+#include <stdio.h>
+#include <x86intrin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bucket k counts deltas in [2^k, 2^(k+1)); 0 and 1 go to bucket 0
+struct probe_hist {
+    uint64_t start;             // TSC at the last PROBE_BEGIN
+    uint64_t count;
+    uint64_t sum;               // Total ticks
+    uint64_t min_not;           // ~minimum, so 0 means none yet
+    uint64_t max;
+    uint64_t buckets[64];
+} __attribute__((aligned(64)));
+
+struct probe_meta {
+    const char *name;
+    struct probe_hist *hist;
+};
+
+// Provided by the linker when at least one probe exists
+extern struct probe_meta __start_probes[] __attribute__((weak));
+extern struct probe_meta __stop_probes[] __attribute__((weak));
+
+static inline uint64_t probe_tsc(void) {
+    unsigned int aux;
+    return __rdtscp(&aux);
+}
+
+static inline void probe_record(struct probe_hist *h, uint64_t ticks) {
+    h->count++;
+    h->sum += ticks;
+    if (~ticks > h->min_not) h->min_not = ~ticks;
+    if (ticks > h->max) h->max = ticks;
+    h->buckets[63 - __builtin_clzll(ticks | 1)]++;
+}
+
+// The record is 8-byte aligned (not 16) so the section stays an array
+#define PROBE_BEGIN(name)                                                    \
+    static struct probe_hist probe_hist_##name;                              \
+    static struct probe_meta probe_meta_##name                               \
+        __attribute__((section("probes"), used, aligned(8))) =               \
+        { #name, &probe_hist_##name };                                       \
+    probe_hist_##name.start = probe_tsc()
+
+#define PROBE_END(name) \
+    probe_record(&probe_hist_##name, probe_tsc() - probe_hist_##name.start)
+
+static inline void probe_dump(FILE *f) {
+    for (struct probe_meta *p = __start_probes; p < __stop_probes; p++) {
+        const struct probe_hist *h = p->hist;
+        fprintf(f, "%s: count=%llu sum=%llu min=%llu max=%llu\n", p->name,
+                (unsigned long long)h->count, (unsigned long long)h->sum,
+                (unsigned long long)(h->count ? ~h->min_not : 0),
+                (unsigned long long)h->max);
+        for (int k = 0; k < 64; k++)
+            if (h->buckets[k])
+                fprintf(f, "  2^%d: %llu\n", k, (unsigned long long)h->buckets[k]);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+#define PROBE_BEGIN(name) ((void)0)
+#define PROBE_END(name)   ((void)0)
+#define probe_dump(f)     ((void)0)
+
+#endif // PROBES
+
+#endif // PROBES_H
@@ -5,9 +5,18 @@
 ; Assembler: NASM
 ; Build: nasm -f elf64 07_file_io.asm && ld -o 07_file_io 07_file_io.o
 ; Run: ./07_file_io
+; Library: nasm -f elf64 -DLIBRARY 07_file_io.asm -o 07_lib.o
 ; ============================================================================
 
+%ifdef LIBRARY
+    global copy_file, copy_fd, write_all, copy_buffer_size, copy_file_method
+    global file_size, read_entire_file, write_entire_file
+    global map_entire_file, unmap_file
+    global copy_file_checksum, copy_fd_checksum, write_entire_file_checksum
+    global checksum_chunk_size, crc32c_bitwise
+%else
 global _start
+%endif
 
 ; System call numbers (x86_64 Linux)
 %define SYS_READ    0
@@ -17,6 +26,18 @@ global _start
 %define SYS_CREAT   85
 %define SYS_EXIT    60
 
+; Zero-copy and memory system calls
+%define SYS_FSTAT           5
+%define SYS_MMAP            9
+%define SYS_MUNMAP          11
+%define SYS_MREMAP          25
+%define SYS_MADVISE         28
+%define SYS_SENDFILE        40
+%define SYS_FCNTL           72
+%define SYS_SPLICE          275
+%define SYS_PIPE2           293
+%define SYS_COPY_FILE_RANGE 326
+
 ; File access modes (open flags)
 %define O_RDONLY    0
 %define O_WRONLY    1
@@ -31,6 +52,33 @@ global _start
 %define S_IXUSR     0100    ; User execute
 %define S_IRWXU     0700    ; User rwx
 
+; Flags and limits for the copy paths
+%define O_CLOEXEC       0x80000
+%define F_GETFL         3
+%define F_SETPIPE_SZ    1031
+%define SPLICE_F_MOVE   1
+%define SPLICE_F_MORE   4
+%define PROT_READ       1
+%define PROT_WRITE      2
+%define MAP_PRIVATE     0x02
+%define MAP_ANONYMOUS   0x20
+%define MAP_POPULATE    0x8000
+%define MREMAP_MAYMOVE  1
+%define MADV_SEQUENTIAL 2
+%define MADV_HUGEPAGE   14
+%define MAX_RW_CHUNK    0x7ffff000  ; Largest transfer Linux does per call
+%define EINTR           4
+%define EIO             5
+%define EXDEV           18
+%define EINVAL          22
+%define ENOSYS          38
+%define EOPNOTSUPP      95
+
+; map_entire_file hint flags (RSI), may be OR'd together
+%define MAP_HINT_POPULATE   1   ; Fault every page in up front (MAP_POPULATE)
+%define MAP_HINT_SEQUENTIAL 2   ; madvise(MADV_SEQUENTIAL): aggressive readahead
+%define MAP_HINT_HUGEPAGE   4   ; madvise(MADV_HUGEPAGE): ask for 2 MiB pages
+
 %define STDIN       0
 %define STDOUT      1
 %define STDERR      2
@@ -62,10 +110,38 @@ section .data
                        "This is a test of file operations.", 0x0a, \
                        "Assembly is powerful!", 0x0a
     write_data_len: equ $ - write_data
+    
+    ; Buffer size of copy_fd's read/write fallback; callers may change it
+    copy_buffer_size: dq 1 << 20
+    
+    ; Bytes per checksum + write step of the *_checksum functions: small
+    ; enough to still be in L2 when write() copies them out
+    checksum_chunk_size: dq 1 << 17
+    
+    ; Names of the copy_fd methods, indexed by copy_file_method - 1
+    msg_method_cfr:     db "Copied with copy_file_range", 0x0a
+    msg_method_cfr_len: equ $ - msg_method_cfr
+    msg_method_sf:      db "Copied with sendfile", 0x0a
+    msg_method_sf_len:  equ $ - msg_method_sf
+    msg_method_sp:      db "Copied with splice", 0x0a
+    msg_method_sp_len:  equ $ - msg_method_sp
+    msg_method_rw:      db "Copied with read/write", 0x0a
+    msg_method_rw_len:  equ $ - msg_method_rw
+    
+    method_names:   dq msg_method_cfr, msg_method_sf, msg_method_sp, msg_method_rw
+    method_lens:    dq msg_method_cfr_len, msg_method_sf_len
+                    dq msg_method_sp_len, msg_method_rw_len
+    
+    msg_map:        db "Mapping output.txt...", 0x0a
+    msg_map_len:    equ $ - msg_map
+    
+    msg_crc_ok:     db "CRC32C of the mapped copy matches the one taken while copying", 0x0a
+    msg_crc_ok_len: equ $ - msg_crc_ok
 
 section .bss
     read_buffer:    resb 1024       ; Buffer for reading
     file_fd:        resq 1          ; File descriptor storage
+    copy_file_method: resq 1        ; Last method copy_fd used (1-4)
 
 section .text
 
@@ -220,9 +296,79 @@ _start:
     ; READ/WRITE LOOP EXAMPLE
     ; ========================================================================
     
-    ; Copy file contents (read and write in loop)
+    ; Copy test.txt to output.txt; the kernel moves the data if it can
+    mov     rdi, test_file
+    mov     rsi, output_file
     call    copy_file
     
+    cmp     rax, 0
+    jl      error_handler
+    
+    ; Report which method did the copy
+    mov     rcx, [copy_file_method]
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, [method_names + rcx*8 - 8]
+    mov     rdx, [method_lens + rcx*8 - 8]
+    syscall
+    
+    ; Copy it again, checksumming each chunk on its way through
+    mov     rdi, test_file
+    mov     rsi, output_file
+    mov     rdx, crc32c_bitwise
+    xor     rcx, rcx                ; Starting crc
+    call    copy_file_checksum
+    
+    cmp     rax, 0
+    jl      error_handler
+    mov     r14, rdx                ; CRC32C of everything copied
+    
+    ; ========================================================================
+    ; MAPPING A FILE
+    ; ========================================================================
+    
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_map
+    mov     rdx, msg_map_len
+    syscall
+    
+    ; Map the copy read-only; RAX = pointer, RDX = length
+    mov     rdi, output_file
+    mov     rsi, MAP_HINT_POPULATE | MAP_HINT_SEQUENTIAL
+    call    map_entire_file
+    
+    cmp     rax, 0
+    jl      error_handler
+    
+    mov     r12, rax                ; Mapping
+    mov     r13, rdx                ; Length
+    
+    ; The file contents are plain memory now: write them straight out
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, r12
+    mov     rdx, r13
+    syscall
+    
+    ; Checksum the mapped copy: it must match what copy_file_checksum saw
+    xor     rdi, rdi
+    mov     rsi, r12
+    mov     rdx, r13
+    call    crc32c_bitwise
+    cmp     rax, r14
+    jne     error_handler
+    
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_crc_ok
+    mov     rdx, msg_crc_ok_len
+    syscall
+    
+    mov     rdi, r12
+    mov     rsi, r13
+    call    unmap_file
+    
     ; ========================================================================
     ; SUCCESS - EXIT
     ; ========================================================================
@@ -253,77 +399,601 @@ error_handler:
 
 ; ============================================================================
 ; FUNCTION: copy_file
-; Description: Copy input.txt to output.txt
+; Description: Copy a file, letting the kernel move the data when it can
+; Arguments: RDI = source filename, RSI = destination filename
+; Returns: RAX = bytes copied, or negative errno
 ; ============================================================================
 copy_file:
-    push    rbp
-    mov     rbp, rsp
-    sub     rsp, 16                 ; Space for local variables
-    
+    push    rbx
+    push    r12
+    push    r13
+
+    mov     r13, rsi                ; Save destination name
+
     ; Open source file
     mov     rax, SYS_OPEN
-    mov     rdi, input_file
+    ; RDI already contains filename
     mov     rsi, O_RDONLY
     xor     rdx, rdx
     syscall
-    
+
     cmp     rax, 0
-    jl      .error
-    
-    mov     [rbp - 8], rax          ; Save source fd
-    
+    jl      .done                   ; RAX = -errno
+
+    mov     rbx, rax                ; Save source fd
+
     ; Open/create destination file
     mov     rax, SYS_OPEN
-    mov     rdi, output_file
+    mov     rdi, r13
     mov     rsi, O_WRONLY | O_CREAT | O_TRUNC
     mov     rdx, 0644o
     syscall
-    
+
     cmp     rax, 0
     jl      .close_src
-    
-    mov     [rbp - 16], rax         ; Save dest fd
-    
-.read_loop:
-    ; Read from source
-    mov     rax, SYS_READ
-    mov     rdi, [rbp - 8]          ; Source fd
-    mov     rsi, read_buffer
-    mov     rdx, 1024
+
+    mov     r12, rax                ; Save dest fd
+
+    mov     rdi, rbx
+    mov     rsi, r12
+    call    copy_fd
+    mov     r13, rax                ; Bytes copied or -errno
+
+    ; Close destination
+    mov     rax, SYS_CLOSE
+    mov     rdi, r12
     syscall
-    
+    mov     rax, r13
+
+.close_src:
+    ; Close source, keeping the result in RAX
+    mov     r13, rax
+    mov     rax, SYS_CLOSE
+    mov     rdi, rbx
+    syscall
+    mov     rax, r13
+
+.done:
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: copy_file_checksum
+; Description: Copy a file and checksum its contents in the same pass
+; Arguments: RDI = source filename, RSI = destination filename,
+;            RDX = checksum function, RCX = starting checksum
+; Returns: RAX = bytes copied, or negative errno; RDX = checksum
+; See copy_fd_checksum.
+; ============================================================================
+copy_file_checksum:
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+
+    mov     r13, rsi                ; Save destination name
+    mov     r14, rdx                ; Save checksum function
+    mov     r15, rcx                ; Checksum so far
+
+    ; Open source file
+    mov     rax, SYS_OPEN
+    ; RDI already contains filename
+    mov     rsi, O_RDONLY
+    xor     rdx, rdx
+    syscall
+
     cmp     rax, 0
-    jle     .done                   ; EOF or error
-    
-    mov     r12, rax                ; Save bytes read
-    
-    ; Write to destination
-    mov     rax, SYS_WRITE
-    mov     rdi, [rbp - 16]         ; Dest fd
-    mov     rsi, read_buffer
-    mov     rdx, r12
+    jl      .done                   ; RAX = -errno
+
+    mov     rbx, rax                ; Save source fd
+
+    ; Open/create destination file
+    mov     rax, SYS_OPEN
+    mov     rdi, r13
+    mov     rsi, O_WRONLY | O_CREAT | O_TRUNC
+    mov     rdx, 0644o
     syscall
-    
+
     cmp     rax, 0
-    jl      .done
-    
-    jmp     .read_loop
-    
-.done:
+    jl      .close_src
+
+    mov     r12, rax                ; Save dest fd
+
+    mov     rdi, rbx
+    mov     rsi, r12
+    mov     rdx, r14
+    mov     rcx, r15
+    call    copy_fd_checksum
+    mov     r13, rax                ; Bytes copied or -errno
+    mov     r15, rdx
+
     ; Close destination
     mov     rax, SYS_CLOSE
-    mov     rdi, [rbp - 16]
+    mov     rdi, r12
     syscall
-    
+    mov     rax, r13
+
 .close_src:
-    ; Close source
+    ; Close source, keeping the result in RAX
+    mov     r13, rax
     mov     rax, SYS_CLOSE
-    mov     rdi, [rbp - 8]
+    mov     rdi, rbx
     syscall
-    
+    mov     rax, r13
+
+.done:
+    mov     rdx, r15
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: copy_fd
+; Description: Copy from one file descriptor to another until EOF
+; Arguments: RDI = source fd, RSI = destination fd
+; Returns: RAX = bytes copied, or negative errno
+;
+; Tries each method in turn and keeps the first one the kernel accepts:
+;   1. copy_file_range - copy inside the kernel (reflink or server-side
+;                        copy on filesystems that support it)
+;   2. sendfile        - page cache to destination, no user-space copy
+;   3. splice          - source -> pipe -> destination, pages moved not copied
+;   4. read/write      - copy_buffer_size bytes per syscall pair
+; Every method advances the file offsets, so a later one resumes where an
+; earlier one stopped. copy_file_method records the one that finished.
+; Only "cannot do this" errors (ENOSYS, EXDEV, EINVAL, EOPNOTSUPP) move on
+; to the next method; EINTR repeats the call, and any other error (ENOSPC,
+; EIO, EBADF...) is returned as it is.
+; ============================================================================
+copy_fd:
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 16                 ; [rsp] = pipe read end, [rsp+4] = write end
+                                    ; [rsp+8] = bytes left in the pipe for
+                                    ; read/write to pass on
+    mov     rbx, rdi                ; Source fd
+    mov     r12, rsi                ; Destination fd
+    xor     r13, r13                ; Bytes copied so far
+    mov     qword [rsp + 8], 0
+
+    ; ------------------------------------------------------------------------
+    ; 1. copy_file_range(fd_in, NULL, fd_out, NULL, len, 0)
+    ; ------------------------------------------------------------------------
+    mov     qword [copy_file_method], 1
+
+    ; It rejects an O_APPEND destination with EBADF, the same error as a
+    ; bad fd, so check for that first
+    mov     rax, SYS_FCNTL
+    mov     rdi, r12
+    mov     rsi, F_GETFL
+    syscall
+    test    rax, rax
+    js      .return                 ; Bad destination fd
+    test    eax, O_APPEND
+    jnz     .sendfile
+
+.copy_range:
+    mov     rax, SYS_COPY_FILE_RANGE
+    mov     rdi, rbx
+    xor     rsi, rsi                ; NULL: use and advance the file offset
+    mov     rdx, r12
+    xor     r10, r10
+    mov     r8, MAX_RW_CHUNK
+    xor     r9, r9
+    syscall
+
+    test    rax, rax
+    jz      .done                   ; EOF
+    jns     .copy_range_ok
+    cmp     rax, -EINTR
+    je      .copy_range
+    call    .unsupported
+    je      .sendfile               ; ENOSYS, EXDEV, EINVAL...: next method
+    jmp     .return                 ; Real I/O error: RAX = -errno
+.copy_range_ok:
+    add     r13, rax
+    jmp     .copy_range
+
+    ; ------------------------------------------------------------------------
+    ; 2. sendfile(out_fd, in_fd, NULL, count)
+    ; ------------------------------------------------------------------------
+.sendfile:
+    mov     qword [copy_file_method], 2
+.sendfile_loop:
+    mov     rax, SYS_SENDFILE
+    mov     rdi, r12
+    mov     rsi, rbx
+    xor     rdx, rdx
+    mov     r10, MAX_RW_CHUNK
+    syscall
+
+    test    rax, rax
+    jz      .done
+    jns     .sendfile_ok
+    cmp     rax, -EINTR
+    je      .sendfile_loop
+    call    .unsupported
+    je      .splice
+    jmp     .return
+.sendfile_ok:
+    add     r13, rax
+    jmp     .sendfile_loop
+
+    ; ------------------------------------------------------------------------
+    ; 3. splice through a pipe
+    ; ------------------------------------------------------------------------
+.splice:
+    mov     qword [copy_file_method], 3
+    mov     rax, SYS_PIPE2
+    mov     rdi, rsp
+    mov     rsi, O_CLOEXEC
+    syscall
+    test    rax, rax
+    js      .read_write
+
+    ; Grow the pipe to 1 MiB so each splice moves more (best effort)
+    mov     rax, SYS_FCNTL
+    mov     edi, [rsp + 4]
+    mov     rsi, F_SETPIPE_SZ
+    mov     rdx, 1 << 20
+    syscall
+    test    rax, rax
+    jns     .pipe_sized
+    mov     rax, 65536              ; Default pipe capacity
+.pipe_sized:
+    mov     r15, rax                ; Bytes per splice
+
+.splice_in:
+    mov     rax, SYS_SPLICE         ; source -> pipe
+    mov     rdi, rbx
+    xor     rsi, rsi
+    mov     edx, [rsp + 4]
+    xor     r10, r10
+    mov     r8, r15
+    mov     r9, SPLICE_F_MOVE | SPLICE_F_MORE
+    syscall
+
+    test    rax, rax
+    jz      .splice_done            ; EOF
+    jns     .splice_in_ok
+    cmp     rax, -EINTR
+    je      .splice_in
+    call    .unsupported
+    je      .splice_unsupported
+    mov     r14, rax
+    jmp     .close_pipe_error
+.splice_in_ok:
+    mov     r14, rax                ; Bytes now in the pipe
+
+.splice_out:
+    mov     rax, SYS_SPLICE         ; pipe -> destination (may be partial)
+    mov     edi, [rsp]
+    xor     rsi, rsi
+    mov     rdx, r12
+    xor     r10, r10
+    mov     r8, r14
+    mov     r9, SPLICE_F_MOVE | SPLICE_F_MORE
+    syscall
+
+    cmp     rax, -EINTR
+    je      .splice_out
+    test    rax, rax
+    jz      .splice_error
+    jns     .splice_out_ok
+    call    .unsupported
+    jne     .splice_error
+    ; The destination takes no splice (O_APPEND, some devices): read/write
+    ; passes on what is already in the pipe, then carries on from the source
+    mov     [rsp + 8], r14
+    jmp     .read_write
+.splice_out_ok:
+    add     r13, rax
+    sub     r14, rax
+    jnz     .splice_out
+    jmp     .splice_in
+
+.splice_error:
+    mov     r14, rax
+    test    r14, r14
+    jnz     .close_pipe_error
+    mov     r14, -EIO               ; Zero-byte splice with data pending
+.close_pipe_error:
+    call    .close_pipe
+    mov     rax, r14
+    jmp     .return
+
+.splice_unsupported:
+    call    .close_pipe
+    jmp     .read_write
+
+.splice_done:
+    call    .close_pipe
+    jmp     .done
+
+.close_pipe:
+    mov     rax, SYS_CLOSE
+    mov     edi, [rsp + 8]          ; Pipe read end (past the return address)
+    syscall
+    mov     rax, SYS_CLOSE
+    mov     edi, [rsp + 12]         ; Pipe write end
+    syscall
+    ret
+
+    ; ZF = 1 if RAX (-errno) means the method cannot copy between these
+    ; fds, as opposed to an I/O error
+.unsupported:
+    cmp     rax, -ENOSYS
+    je      .unsupported_done
+    cmp     rax, -EXDEV
+    je      .unsupported_done
+    cmp     rax, -EINVAL
+    je      .unsupported_done
+    cmp     rax, -EOPNOTSUPP
+.unsupported_done:
+    ret
+
+    ; ------------------------------------------------------------------------
+    ; 4. read/write through an mmap'd buffer of copy_buffer_size bytes
+    ; ------------------------------------------------------------------------
+.read_write:
+    mov     qword [copy_file_method], 4
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, [copy_buffer_size]
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_PRIVATE | MAP_ANONYMOUS
+    mov     r8, -1
+    xor     r9, r9
+    syscall
+    test    rax, rax
+    js      .rw_no_buffer           ; RAX = -errno
+    mov     r15, rax                ; Buffer
+
+.rw_pipe:
+    mov     r14, [rsp + 8]          ; Left behind by a failed splice
+    test    r14, r14
+    jz      .rw_read
+    mov     rax, SYS_READ
+    mov     edi, [rsp]
+    mov     rsi, r15
+    mov     rdx, [copy_buffer_size]
+    cmp     rdx, r14
+    cmova   rdx, r14
+    syscall
+    cmp     rax, -EINTR
+    je      .rw_pipe
+    test    rax, rax
+    jle     .rw_pipe_error
+    mov     r14, rax
+    sub     [rsp + 8], rax
+    mov     rdi, r12
+    mov     rsi, r15
+    mov     rdx, r14
+    call    write_all
+    test    rax, rax
+    js      .rw_pipe_error
+    add     r13, r14
+    cmp     qword [rsp + 8], 0
+    jne     .rw_pipe
+    call    .close_pipe
+
+.rw_read:
+    mov     rax, SYS_READ
+    mov     rdi, rbx
+    mov     rsi, r15
+    mov     rdx, [copy_buffer_size]
+    syscall
+
+    cmp     rax, -EINTR
+    je      .rw_read
+    test    rax, rax
+    jz      .rw_done                ; EOF
+    js      .rw_error
+    mov     r14, rax                ; Bytes to write
+
+    mov     rdi, r12
+    mov     rsi, r15
+    mov     rdx, r14
+    call    write_all               ; Loops over short writes
+    test    rax, rax
+    js      .rw_error
+    add     r13, r14
+    jmp     .rw_read
+
+.rw_no_buffer:
+    cmp     qword [rsp + 8], 0
+    je      .return
+    mov     r14, rax
+    call    .close_pipe
+    mov     rax, r14
+    jmp     .return
+
+.rw_pipe_error:
+    mov     r14, rax
+    test    r14, r14
+    jnz     .rw_pipe_close
+    mov     r14, -EIO               ; Pipe ran dry with data pending
+.rw_pipe_close:
+    call    .close_pipe
+    mov     rax, r14
+
+.rw_error:
+    mov     r14, rax
+    mov     rax, SYS_MUNMAP
+    mov     rdi, r15
+    mov     rsi, [copy_buffer_size]
+    syscall
+    mov     rax, r14
+    jmp     .return
+
+.rw_done:
+    mov     rax, SYS_MUNMAP
+    mov     rdi, r15
+    mov     rsi, [copy_buffer_size]
+    syscall
+
+.done:
+    mov     rax, r13                ; Total bytes copied
+
+.return:
+    add     rsp, 16
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: write_all
+; Description: Write a whole buffer, retrying short and interrupted writes
+; Arguments: RDI = fd, RSI = buffer, RDX = count
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+write_all:
+    push    rbx
+    push    r12
+    push    r13
+
+    mov     rbx, rdi
+    mov     r12, rsi
+    mov     r13, rdx
+
+.loop:
+    test    r13, r13
+    jz      .success
+
+    mov     rax, SYS_WRITE
+    mov     rdi, rbx
+    mov     rsi, r12
+    mov     rdx, r13
+    syscall
+
+    cmp     rax, -EINTR
+    je      .loop
+    test    rax, rax
+    js      .done                   ; RAX = -errno
+    jz      .no_progress
+
+    add     r12, rax                ; Short write: advance and retry
+    sub     r13, rax
+    jmp     .loop
+
+.no_progress:
+    mov     rax, -EIO
+    jmp     .done
+
+.success:
+    xor     rax, rax
+
+.done:
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: copy_fd_checksum
+; Description: Copy from one file descriptor to another until EOF, and
+;              checksum the data on the way through
+; Arguments: RDI = source fd, RSI = destination fd,
+;            RDX = checksum function, RCX = starting checksum
+; Returns: RAX = bytes copied, or negative errno; RDX = checksum of the
+;          bytes copied (up to the error, if there was one)
+;
+; The checksum function is called as f(RDI = checksum, RSI = buffer,
+; RDX = length) and returns the updated checksum in RAX - crc32c,
+; crc32_ieee or crc64_xz from 16_crc32.asm fit, as does crc32c_bitwise
+; below. Each chunk of checksum_chunk_size bytes is read, checksummed and
+; written while it is still in the cache, so the data crosses the memory
+; bus once instead of twice (copy, then read the copy back to verify).
+; The zero-copy methods of copy_fd never bring the data into user space,
+; so this always uses read/write.
+; ============================================================================
+copy_fd_checksum:
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 16                 ; [rsp] = checksum, [rsp+8] = chunk length
+
+    mov     rbx, rdi                ; Source fd
+    mov     r12, rsi                ; Destination fd
+    mov     r14, rdx                ; Checksum function
+    mov     [rsp], rcx
+    xor     r13, r13                ; Bytes copied so far
+
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, [checksum_chunk_size]
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_PRIVATE | MAP_ANONYMOUS
+    mov     r8, -1
+    xor     r9, r9
+    syscall
+    test    rax, rax
+    js      .return                 ; RAX = -errno
+    mov     r15, rax                ; Buffer
+
+.read:
+    mov     rax, SYS_READ
+    mov     rdi, rbx
+    mov     rsi, r15
+    mov     rdx, [checksum_chunk_size]
+    syscall
+
+    cmp     rax, -EINTR
+    je      .read
+    test    rax, rax
+    jz      .eof
+    js      .error
+    mov     [rsp + 8], rax
+
+    ; Checksum the chunk while read() has just left it in the cache ...
+    mov     rdi, [rsp]
+    mov     rsi, r15
+    mov     rdx, rax
+    call    r14
+    mov     [rsp], rax
+
+    ; ... and write it out from there
+    mov     rdi, r12
+    mov     rsi, r15
+    mov     rdx, [rsp + 8]
+    call    write_all
+    test    rax, rax
+    js      .error
+    add     r13, [rsp + 8]
+    jmp     .read
+
 .error:
-    mov     rsp, rbp
-    pop     rbp
+    mov     r13, rax                ; Return -errno
+
+.eof:
+    mov     rax, SYS_MUNMAP
+    mov     rdi, r15
+    mov     rsi, [checksum_chunk_size]
+    syscall
+    mov     rax, r13
+
+.return:
+    mov     rdx, [rsp]
+    add     rsp, 16
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
     ret
 
 ; ============================================================================
@@ -384,6 +1054,7 @@ file_size:
 ; Description: Read entire file into buffer
 ; Arguments: RDI = filename, RSI = buffer, RDX = max_size
 ; Returns: RAX = bytes read (-1 on error)
+; Note: Reads until EOF or max_size; see map_entire_file to avoid the copy
 ; ============================================================================
 read_entire_file:
     push    rbp
@@ -406,15 +1077,35 @@ read_entire_file:
     jl      .error
     
     mov     rbx, rax                ; Save fd
+    xor     r8, r8                  ; Bytes read so far
+    
+.read_loop:
+    ; A single read may return less than asked for (pipes, signals,
+    ; network filesystems), so keep going until EOF or the buffer is full
+    mov     rdx, r13
+    sub     rdx, r8                 ; Space left
+    jz      .read_done
     
-    ; Read file
     mov     rax, SYS_READ
     mov     rdi, rbx                ; fd
-    mov     rsi, r12                ; buffer
-    mov     rdx, r13                ; max size
+    lea     rsi, [r12 + r8]         ; buffer + bytes read
+    push    r8
     syscall
+    pop     r8
+    
+    cmp     rax, -EINTR
+    je      .read_loop
+    test    rax, rax
+    jz      .read_done              ; EOF
+    js      .read_error
+    add     r8, rax
+    jmp     .read_loop
+    
+.read_error:
+    mov     r8, -1
     
-    push    rax                     ; Save bytes read
+.read_done:
+    push    r8                      ; Save bytes read
     
     ; Close file
     mov     rax, SYS_CLOSE
@@ -434,6 +1125,232 @@ read_entire_file:
     pop     rbp
     ret
 
+; ============================================================================
+; FUNCTION: map_entire_file
+; Description: Make a whole file readable in memory without copying it
+; Arguments: RDI = filename, RSI = MAP_HINT_* flags
+; Returns: RAX = pointer (or negative errno), RDX = length in bytes
+;          (from C: struct { const void *data; size_t size; } - both
+;          fields come back in RAX:RDX)
+;
+; Regular files are mapped read-only straight from the page cache, so the
+; data is never copied and its pages can be dropped under memory pressure
+; instead of being swapped. Pipes, sockets and /proc files have no usable
+; size (st_size is 0), so they are read in a loop into an anonymous mapping that doubles
+; (mremap) as it fills and is trimmed to the pages in use at EOF. Either
+; way unmap_file(pointer, length) releases it. An empty file returns a
+; NULL pointer with length 0.
+; ============================================================================
+%define STAT_SIZE       144     ; sizeof(struct stat) on x86_64
+%define ST_MODE         24      ; offsetof(struct stat, st_mode)
+%define ST_SIZE         48      ; offsetof(struct stat, st_size)
+%define S_IFMT          0170000
+%define S_IFREG         0100000
+%define READ_INITIAL    65536   ; First buffer for the read fallback
+
+map_entire_file:
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, STAT_SIZE
+    
+    mov     r12, rsi                ; Save hint flags
+    
+    ; Open file
+    mov     rax, SYS_OPEN
+    ; RDI already contains filename
+    mov     rsi, O_RDONLY | O_CLOEXEC
+    xor     rdx, rdx
+    syscall
+    
+    test    rax, rax
+    js      .open_error
+    
+    mov     rbx, rax                ; Save fd
+    
+    ; fstat(fd, &st) for the file type and size
+    mov     rax, SYS_FSTAT
+    mov     rdi, rbx
+    mov     rsi, rsp
+    syscall
+    
+    test    rax, rax
+    js      .error
+    
+    mov     eax, [rsp + ST_MODE]
+    and     eax, S_IFMT
+    cmp     eax, S_IFREG
+    jne     .read_fallback
+    
+    mov     r14, [rsp + ST_SIZE]
+    test    r14, r14
+    jz      .read_fallback          ; Empty, or a /proc or /sys file that
+                                    ; reports size 0 but has contents
+    
+    ; mmap(NULL, size, PROT_READ, MAP_PRIVATE [| MAP_POPULATE], fd, 0)
+    mov     r10, MAP_PRIVATE
+    test    r12, MAP_HINT_POPULATE
+    jz      .map
+    or      r10, MAP_POPULATE       ; Prefault: no page faults while scanning
+.map:
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, r14
+    mov     rdx, PROT_READ
+    mov     r8, rbx
+    xor     r9, r9
+    syscall
+    
+    test    rax, rax
+    js      .error
+    mov     r13, rax                ; The mapping outlives the fd
+    
+    ; madvise() is only a hint: its result is deliberately ignored
+    test    r12, MAP_HINT_SEQUENTIAL
+    jz      .no_sequential
+    mov     rax, SYS_MADVISE
+    mov     rdi, r13
+    mov     rsi, r14
+    mov     rdx, MADV_SEQUENTIAL    ; Read ahead harder, drop pages behind us
+    syscall
+.no_sequential:
+    test    r12, MAP_HINT_HUGEPAGE
+    jz      .close
+    mov     rax, SYS_MADVISE
+    mov     rdi, r13
+    mov     rsi, r14
+    mov     rdx, MADV_HUGEPAGE      ; Needs THP support for file mappings
+    syscall
+    jmp     .close
+    
+    ; ------------------------------------------------------------------------
+    ; Not a regular file: read until EOF into a growing anonymous mapping
+    ; ------------------------------------------------------------------------
+.read_fallback:
+    mov     r15, READ_INITIAL       ; Capacity
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, r15
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_PRIVATE | MAP_ANONYMOUS
+    mov     r8, -1
+    xor     r9, r9
+    syscall
+    
+    test    rax, rax
+    js      .error
+    mov     r13, rax                ; Buffer
+    xor     r14, r14                ; Length
+    
+.read_more:
+    cmp     r14, r15
+    jb      .read
+    
+    ; Full: double the capacity (the kernel may move the pages, not copy them)
+    mov     rax, SYS_MREMAP
+    mov     rdi, r13
+    mov     rsi, r15
+    lea     rdx, [r15 * 2]
+    mov     r10, MREMAP_MAYMOVE
+    syscall
+    
+    test    rax, rax
+    js      .free_error
+    mov     r13, rax
+    shl     r15, 1
+    
+.read:
+    mov     rax, SYS_READ
+    mov     rdi, rbx
+    lea     rsi, [r13 + r14]
+    mov     rdx, r15
+    sub     rdx, r14
+    syscall
+    
+    cmp     rax, -EINTR
+    je      .read
+    test    rax, rax
+    jz      .read_eof
+    js      .free_error
+    add     r14, rax
+    jmp     .read_more
+    
+.read_eof:
+    test    r14, r14
+    jz      .free_empty
+    
+    ; Trim to the pages in use so that munmap(pointer, length) frees it all
+    lea     rdx, [r14 + 4095]
+    and     rdx, -4096
+    cmp     rdx, r15
+    je      .close
+    mov     rax, SYS_MREMAP         ; Shrinking in place cannot fail
+    mov     rdi, r13
+    mov     rsi, r15
+    xor     r10, r10
+    syscall
+    jmp     .close
+    
+.free_empty:
+    mov     rax, SYS_MUNMAP
+    mov     rdi, r13
+    mov     rsi, r15
+    syscall
+    xor     r13, r13
+    jmp     .close
+    
+.free_error:
+    mov     r14, rax                ; Save -errno
+    mov     rax, SYS_MUNMAP
+    mov     rdi, r13
+    mov     rsi, r15
+    syscall
+    mov     rax, r14
+    
+.error:
+    mov     r13, rax                ; Return -errno ...
+    xor     r14, r14                ; ... with length 0
+    
+.close:
+    mov     rax, SYS_CLOSE
+    mov     rdi, rbx
+    syscall
+    
+    mov     rax, r13
+    mov     rdx, r14
+    jmp     .done
+    
+.open_error:
+    xor     rdx, rdx                ; RAX = -errno
+    
+.done:
+    add     rsp, STAT_SIZE
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: unmap_file
+; Description: Release a buffer returned by map_entire_file
+; Arguments: RDI = pointer, RSI = length
+; Returns: RAX = 0 on success, negative errno on error
+; ============================================================================
+unmap_file:
+    xor     rax, rax
+    test    rsi, rsi                ; Empty file: nothing was mapped
+    jz      .done
+    
+    mov     rax, SYS_MUNMAP
+    syscall
+    
+.done:
+    ret
+
 ; ============================================================================
 ; FUNCTION: write_entire_file
 ; Description: Write buffer to file
@@ -462,12 +1379,11 @@ write_entire_file:
     
     mov     rbx, rax                ; Save fd
     
-    ; Write to file
-    mov     rax, SYS_WRITE
+    ; Write to file (write_all retries short writes)
     mov     rdi, rbx                ; fd
     mov     rsi, r12                ; buffer
     mov     rdx, r13                ; size
-    syscall
+    call    write_all
     
     cmp     rax, 0
     jl      .close_error
@@ -498,6 +1414,129 @@ write_entire_file:
     pop     rbp
     ret
 
+; ============================================================================
+; FUNCTION: write_entire_file_checksum
+; Description: Write buffer to file and checksum it in the same pass
+; Arguments: RDI = filename, RSI = buffer, RDX = size,
+;            RCX = checksum function, R8 = starting checksum
+; Returns: RAX = 0 on success, -1 on error; RDX = checksum of the bytes
+;          written
+; Checksums and writes checksum_chunk_size bytes at a time, so write()
+; copies each chunk out of the cache (see copy_fd_checksum).
+; ============================================================================
+write_entire_file_checksum:
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    
+    mov     r12, rsi                ; Save buffer
+    mov     r13, rdx                ; Save size
+    mov     r14, rcx                ; Save checksum function
+    mov     r15, r8                 ; Checksum so far
+    
+    ; Create/open file
+    mov     rax, SYS_OPEN
+    ; RDI already contains filename
+    mov     rsi, O_WRONLY | O_CREAT | O_TRUNC
+    mov     rdx, 0644o
+    syscall
+    
+    cmp     rax, 0
+    jl      .error
+    
+    mov     rbx, rax                ; Save fd
+    
+.chunk:
+    test    r13, r13
+    jz      .close
+    
+    mov     rdx, [checksum_chunk_size]
+    cmp     rdx, r13
+    cmova   rdx, r13                ; Last chunk may be short
+    push    rdx
+    push    rdx                     ; (twice: keeps RSP 16-byte aligned)
+    
+    mov     rdi, r15
+    mov     rsi, r12
+    call    r14
+    mov     r15, rax
+    
+    mov     rdi, rbx
+    mov     rsi, r12
+    mov     rdx, [rsp]
+    call    write_all
+    pop     rdx
+    pop     rdx
+    
+    cmp     rax, 0
+    jl      .close_error
+    add     r12, rdx
+    sub     r13, rdx
+    jmp     .chunk
+    
+.close:
+    mov     rax, SYS_CLOSE
+    mov     rdi, rbx
+    syscall
+    
+    xor     rax, rax                ; Success
+    jmp     .done
+    
+.close_error:
+    ; Close file even on error
+    mov     rax, SYS_CLOSE
+    mov     rdi, rbx
+    syscall
+    
+.error:
+    mov     rax, -1
+    
+.done:
+    mov     rdx, r15
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: crc32c_bitwise
+; Description: CRC-32C (Castagnoli) of a buffer, one bit at a time
+; Arguments: RDI = crc (0 to start), RSI = buffer, RDX = length
+; Returns: RAX = updated crc
+; Note: Small and slow; a checksum function for the *_checksum routines
+;       when 16_crc32.asm (8+ bytes per cycle) is not linked in
+; ============================================================================
+crc32c_bitwise:
+    mov     eax, edi
+    not     eax                     ; Initial inversion (undone at the end)
+    test    rdx, rdx
+    jz      .done
+    
+.byte:
+    xor     al, [rsi]
+    mov     ecx, 8
+.bit:
+    mov     r8d, eax
+    and     r8d, 1
+    neg     r8d                     ; All ones if the low bit is set
+    and     r8d, 0x82F63B78         ; Reflected polynomial
+    shr     eax, 1
+    xor     eax, r8d
+    dec     ecx
+    jnz     .bit
+    
+    inc     rsi
+    dec     rdx
+    jnz     .byte
+    
+.done:
+    not     eax
+    ret
+
 ; ============================================================================
 ; NOTES: File I/O System Calls
 ; ============================================================================
@@ -509,8 +1548,19 @@ write_entire_file:
 ; │ write    │ rax=1, rdi=fd, rsi=buffer, rdx=count                  │
 ; │ close    │ rax=3, rdi=fd                                         │
 ; │ lseek    │ rax=8, rdi=fd, rsi=offset, rdx=whence                 │
+; │ fstat    │ rax=5, rdi=fd, rsi=struct stat* (144 bytes)           │
+; │ mmap     │ rax=9, rdi=addr, rsi=len, rdx=prot, r10=flags, r8=fd, │
+; │          │        r9=offset                                      │
+; │ madvise  │ rax=28, rdi=addr, rsi=len, rdx=advice                 │
 ; │ creat    │ rax=85, rdi=filename, rsi=mode                        │
+; │ sendfile │ rax=40, rdi=out_fd, rsi=in_fd, rdx=offset*, r10=count │
+; │ splice   │ rax=275, rdi=fd_in, rsi=off_in*, rdx=fd_out,          │
+; │          │          r10=off_out*, r8=len, r9=flags               │
+; │ pipe2    │ rax=293, rdi=int fds[2], rsi=flags                    │
+; │ copy_file│ rax=326, rdi=fd_in, rsi=off_in*, rdx=fd_out,          │
+; │  _range  │          r10=off_out*, r8=len, r9=flags (0)           │
 ; └──────────┴────────────────────────────────────────────────────────┘
+;   (* NULL = use and advance the file offset)
 ;
 ; Open Flags (can be OR'd together):
 ;   O_RDONLY    (0)     - Read only
@@ -544,9 +1594,39 @@ write_entire_file:
 ;   1. Always check return values for errors
 ;   2. Close files when done
 ;   3. Use appropriate buffer sizes (4KB or multiples)
-;   4. Handle partial reads/writes in loops
+;   4. Handle partial reads/writes in loops (see write_all)
 ;   5. Set appropriate file permissions
 ;   6. Use error handling consistently
 ;
+; Zero-copy Copying (copy_fd):
+;   A read/write loop copies every byte twice (page cache -> buffer -> page
+;   cache) and costs two syscalls per buffer. copy_file_range and sendfile
+;   keep the data in the kernel, and each call can move up to ~2 GiB.
+;   splice needs a pipe on one side, so it goes source -> pipe -> dest.
+;   Not every pair of file types supports every call (copy_file_range needs
+;   two regular files), so copy_fd falls back in order and resumes from the
+;   current file offsets. The fallback is taken only for errors that mean
+;   "not for these fds" - an ENOSPC or EIO would fail the same way in every
+;   method, so it is returned at once. If the destination refuses splice
+;   after data is already in the pipe, read/write passes that data on.
+;
+; Mapping Instead of Reading (map_entire_file):
+;   read() copies the file out of the page cache into a private buffer, so
+;   a large file loaded once costs a full copy and is then resident twice
+;   (cache + buffer). A read-only MAP_PRIVATE mapping points at the cached
+;   pages themselves. MAP_POPULATE takes all the page faults in one
+;   syscall; MADV_SEQUENTIAL doubles readahead for a front-to-back scan.
+;   Mappings pay for page-table setup and TLB misses, so for small files
+;   (a few pages) a plain read is just as fast.
+;
+; Checksummed Copies (copy_file_checksum, write_entire_file_checksum):
+;   Verifying a copy by checksumming it afterwards reads every byte a
+;   second time, from memory once the file is larger than the caches.
+;   Checksumming each 128 KiB chunk between read() and write() uses the
+;   data while it is in L2, so the check costs only the CRC itself. With
+;   crc32c from 16_crc32.asm that is ~8 bytes/cycle, faster than the
+;   syscalls can move the data; crc32c_bitwise is ~100x slower and only
+;   meant for small files and tests.
+;
 ; ============================================================================
 
@@ -4,10 +4,16 @@
 ; Topics: XMM registers, packed operations, vectorization
 ; Assembler: NASM
 ; Build: nasm -f elf64 08_simd_sse.asm && ld -o 08_simd_sse 08_simd_sse.o
+; Library: nasm -f elf64 -DLIBRARY 08_simd_sse.asm -o 08_lib.o
 ; Note: Requires CPU with SSE/AVX support
 ; ============================================================================
 
+%ifdef LIBRARY
+    ; Export the SIMD routines for C callers (see 11_benchmark_harness.c)
+    global vector_add_simd, dot_product_simd, scalar_multiply_simd
+%else
 global _start
+%endif
 
 section .data
     ; Aligned data (16-byte alignment required for aligned loads/stores)
@@ -384,6 +390,8 @@ dot_product_simd:
 ; FUNCTION: scalar_multiply_simd
 ; Description: Multiply vector by scalar
 ; Arguments: RDI = array, RCX = count, XMM0 = scalar
+; Requires a 16-byte aligned array and count % 4 == 0; blas_sscal in
+; 14_blas1.asm handles any length and alignment.
 ; ============================================================================
 scalar_multiply_simd:
     push    rbp
@@ -436,6 +444,9 @@ scalar_multiply_simd:
 ;   - Keep data 16-byte aligned for best performance
 ;   - Use aligned loads/stores (movaps) when possible
 ;   - Process multiple elements per iteration
+;   - Split reductions over several accumulators: dot_product_simd's single
+;     XMM2 chain waits on addps latency every iteration (see the 4-accumulator
+;     FMA kernels in 09_inline_asm_c.c)
 ;   - Avoid frequent scalar-vector conversions
 ;   - Use horizontal operations sparingly (slower)
 ;
@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <unistd.h>
 
 /*
  * ============================================================================
@@ -115,12 +116,129 @@ uint64_t subtract_intel(uint64_t a, uint64_t b) {
  * ============================================================================
  * MEMORY OPERATIONS - Intel Syntax
  * ============================================================================
+ *
+ * Same size tiers as copy_memory_asm/fill_memory_asm in 09_inline_asm_c.c:
+ * overlapping moves up to 32 bytes, an AVX2 loop for mid sizes, rep movsb
+ * above the ERMS threshold and movntdq + sfence beyond the LLC size. The
+ * thresholds are set by a constructor from CPUID leaf 7 (AVX2, ERMS, FSRM)
+ * and the L3 size glibc reports.
  */
 
-void copy_memory_intel(void *dest, const void *src, size_t n) {
-    __asm__ (
+struct memory_tuning_intel {
+    size_t rep_threshold;
+    size_t nontemporal_threshold;
+    int use_avx2;
+};
+
+struct memory_tuning_intel memory_tuning_intel = {
+    .rep_threshold         = 33,
+    .nontemporal_threshold = SIZE_MAX,
+    .use_avx2              = 0,
+};
+
+void copy_memory_small_intel(void *dest, const void *src, size_t n) {
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "cmp %2, 16\n\t"
+        "jb 1f\n\t"
+        "movdqu xmm0, [%1]\n\t"               // 16-32: first and last 16
+        "movdqu xmm1, [%1 + %2 - 16]\n\t"
+        "movdqu [%0], xmm0\n\t"
+        "movdqu [%0 + %2 - 16], xmm1\n\t"
+        "jmp 5f\n"
+        "1:\n\t"
+        "cmp %2, 8\n\t"
+        "jb 2f\n\t"
+        "mov rax, [%1]\n\t"                   // 8-15
+        "mov rcx, [%1 + %2 - 8]\n\t"
+        "mov [%0], rax\n\t"
+        "mov [%0 + %2 - 8], rcx\n\t"
+        "jmp 5f\n"
+        "2:\n\t"
+        "cmp %2, 4\n\t"
+        "jb 3f\n\t"
+        "mov eax, [%1]\n\t"                   // 4-7
+        "mov ecx, [%1 + %2 - 4]\n\t"
+        "mov [%0], eax\n\t"
+        "mov [%0 + %2 - 4], ecx\n\t"
+        "jmp 5f\n"
+        "3:\n\t"
+        "cmp %2, 2\n\t"
+        "jb 4f\n\t"
+        "movzx eax, WORD PTR [%1]\n\t"        // 2-3
+        "movzx ecx, WORD PTR [%1 + %2 - 2]\n\t"
+        "mov [%0], ax\n\t"
+        "mov [%0 + %2 - 2], cx\n\t"
+        "jmp 5f\n"
+        "4:\n\t"
+        "test %2, %2\n\t"
+        "jz 5f\n\t"
+        "movzx eax, BYTE PTR [%1]\n\t"        // 1
+        "mov [%0], al\n"
+        "5:\n\t"
+        ".att_syntax prefix"
+        :
+        : "r" (dest), "r" (src), "r" (n)
+        : "rax", "rcx", "xmm0", "xmm1", "memory"
+    );
+}
+
+void copy_memory_avx2_intel(void *dest, const void *src, size_t n) {
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "vmovdqu ymm4, [%1]\n\t"              // Head
+        "vmovdqu ymm5, [%1 + %2 - 32]\n\t"    // Tail
+        "mov r8, %0\n\t"
+        "lea r9, [%0 + %2 - 32]\n\t"
+        
+        "mov rax, %0\n\t"                     // Skip to a 32-byte aligned dest
+        "and rax, 31\n\t"
+        "mov ecx, 32\n\t"
+        "sub rcx, rax\n\t"
+        "add %0, rcx\n\t"
+        "add %1, rcx\n\t"
+        "sub %2, rcx\n\t"
+        
+        "cmp %2, 128\n\t"
+        "jbe 2f\n"
+        "1:\n\t"
+        "vmovdqu ymm0, [%1]\n\t"
+        "vmovdqu ymm1, [%1 + 32]\n\t"
+        "vmovdqu ymm2, [%1 + 64]\n\t"
+        "vmovdqu ymm3, [%1 + 96]\n\t"
+        "vmovdqa [%0], ymm0\n\t"
+        "vmovdqa [%0 + 32], ymm1\n\t"
+        "vmovdqa [%0 + 64], ymm2\n\t"
+        "vmovdqa [%0 + 96], ymm3\n\t"
+        "add %0, 128\n\t"
+        "add %1, 128\n\t"
+        "sub %2, 128\n\t"
+        "cmp %2, 128\n\t"
+        "ja 1b\n"
+        "2:\n\t"
+        "cmp %2, 32\n\t"
+        "jbe 3f\n\t"
+        "vmovdqu ymm0, [%1]\n\t"
+        "vmovdqa [%0], ymm0\n\t"
+        "add %0, 32\n\t"
+        "add %1, 32\n\t"
+        "sub %2, 32\n\t"
+        "jmp 2b\n"
+        "3:\n\t"
+        "vmovdqu [r8], ymm4\n\t"
+        "vmovdqu [r9], ymm5\n\t"
+        "vzeroupper\n\t"
+        ".att_syntax prefix"
+        : "+r" (dest), "+r" (src), "+r" (n)
+        :
+        : "rax", "rcx", "r8", "r9",
+          "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "memory"
+    );
+}
+
+void copy_memory_rep_movsb_intel(void *dest, const void *src, size_t n) {
+    __asm__ __volatile__ (
         ".intel_syntax noprefix\n\t"
-        "cld\n\t"                     // Clear direction flag
         "rep movsb\n\t"               // Repeat move string byte
         ".att_syntax prefix"
         : "+D" (dest), "+S" (src), "+c" (n)  // RDI, RSI, RCX modified
@@ -129,10 +247,162 @@ void copy_memory_intel(void *dest, const void *src, size_t n) {
     );
 }
 
-void fill_memory_intel(void *dest, uint8_t value, size_t n) {
-    __asm__ (
+void copy_memory_nontemporal_intel(void *dest, const void *src, size_t n) {
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "movdqu xmm4, [%1]\n\t"               // Head: first 64 bytes
+        "movdqu xmm5, [%1 + 16]\n\t"
+        "movdqu xmm6, [%1 + 32]\n\t"
+        "movdqu xmm7, [%1 + 48]\n\t"
+        "movdqu [%0], xmm4\n\t"
+        "movdqu [%0 + 16], xmm5\n\t"
+        "movdqu [%0 + 32], xmm6\n\t"
+        "movdqu [%0 + 48], xmm7\n\t"
+        "lea r8, [%1 + %2 - 64]\n\t"
+        "lea r9, [%0 + %2 - 64]\n\t"
+        
+        "mov rax, %0\n\t"
+        "and rax, 63\n\t"
+        "mov ecx, 64\n\t"
+        "sub rcx, rax\n\t"
+        "add %0, rcx\n\t"
+        "add %1, rcx\n\t"
+        "sub %2, rcx\n\t"
+        
+        "cmp %2, 64\n\t"
+        "jb 2f\n"
+        "1:\n\t"
+        "movdqu xmm0, [%1]\n\t"
+        "movdqu xmm1, [%1 + 16]\n\t"
+        "movdqu xmm2, [%1 + 32]\n\t"
+        "movdqu xmm3, [%1 + 48]\n\t"
+        "movntdq [%0], xmm0\n\t"              // Streaming store, bypasses cache
+        "movntdq [%0 + 16], xmm1\n\t"
+        "movntdq [%0 + 32], xmm2\n\t"
+        "movntdq [%0 + 48], xmm3\n\t"
+        "add %0, 64\n\t"
+        "add %1, 64\n\t"
+        "sub %2, 64\n\t"
+        "cmp %2, 64\n\t"
+        "jae 1b\n"
+        "2:\n\t"
+        "sfence\n\t"                          // Order streaming stores
+        "movdqu xmm4, [r8]\n\t"               // Tail: last 64 bytes
+        "movdqu xmm5, [r8 + 16]\n\t"
+        "movdqu xmm6, [r8 + 32]\n\t"
+        "movdqu xmm7, [r8 + 48]\n\t"
+        "movdqu [r9], xmm4\n\t"
+        "movdqu [r9 + 16], xmm5\n\t"
+        "movdqu [r9 + 32], xmm6\n\t"
+        "movdqu [r9 + 48], xmm7\n\t"
+        ".att_syntax prefix"
+        : "+r" (dest), "+r" (src), "+r" (n)
+        :
+        : "rax", "rcx", "r8", "r9", "xmm0", "xmm1", "xmm2", "xmm3",
+          "xmm4", "xmm5", "xmm6", "xmm7", "memory"
+    );
+}
+
+void copy_memory_intel(void *dest, const void *src, size_t n) {
+    if (n <= 32)
+        copy_memory_small_intel(dest, src, n);
+    else if (n >= memory_tuning_intel.nontemporal_threshold)
+        copy_memory_nontemporal_intel(dest, src, n);
+    else if (n >= memory_tuning_intel.rep_threshold ||
+             !memory_tuning_intel.use_avx2)
+        copy_memory_rep_movsb_intel(dest, src, n);
+    else
+        copy_memory_avx2_intel(dest, src, n);
+}
+
+void fill_memory_small_intel(void *dest, uint8_t value, size_t n) {
+    uint64_t pattern = 0x0101010101010101ULL * value;
+    
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "cmp %2, 16\n\t"
+        "jb 1f\n\t"
+        "movq xmm0, %1\n\t"                   // 16-32
+        "punpcklqdq xmm0, xmm0\n\t"
+        "movdqu [%0], xmm0\n\t"
+        "movdqu [%0 + %2 - 16], xmm0\n\t"
+        "jmp 5f\n"
+        "1:\n\t"
+        "cmp %2, 8\n\t"
+        "jb 2f\n\t"
+        "mov [%0], %1\n\t"                    // 8-15
+        "mov [%0 + %2 - 8], %1\n\t"
+        "jmp 5f\n"
+        "2:\n\t"
+        "cmp %2, 4\n\t"
+        "jb 3f\n\t"
+        "mov [%0], %k1\n\t"                   // 4-7
+        "mov [%0 + %2 - 4], %k1\n\t"
+        "jmp 5f\n"
+        "3:\n\t"
+        "cmp %2, 2\n\t"
+        "jb 4f\n\t"
+        "mov [%0], %w1\n\t"                   // 2-3
+        "mov [%0 + %2 - 2], %w1\n\t"
+        "jmp 5f\n"
+        "4:\n\t"
+        "test %2, %2\n\t"
+        "jz 5f\n\t"
+        "mov [%0], %b1\n"                     // 1
+        "5:\n\t"
+        ".att_syntax prefix"
+        :
+        : "r" (dest), "r" (pattern), "r" (n)
+        : "xmm0", "memory"
+    );
+}
+
+void fill_memory_avx2_intel(void *dest, uint8_t value, size_t n) {
+    uint64_t v = value;
+    
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "vmovd xmm0, %k1\n\t"
+        "vpbroadcastb ymm0, xmm0\n\t"         // 32 copies of the byte
+        "vmovdqu [%0], ymm0\n\t"              // Head
+        "vmovdqu [%0 + %2 - 32], ymm0\n\t"    // Tail
+        
+        "mov %1, %0\n\t"                      // Skip to a 32-byte aligned dest
+        "and %1, 31\n\t"
+        "sub %1, 32\n\t"
+        "sub %0, %1\n\t"
+        "add %2, %1\n\t"
+        
+        "cmp %2, 128\n\t"
+        "jbe 2f\n"
+        "1:\n\t"
+        "vmovdqa [%0], ymm0\n\t"
+        "vmovdqa [%0 + 32], ymm0\n\t"
+        "vmovdqa [%0 + 64], ymm0\n\t"
+        "vmovdqa [%0 + 96], ymm0\n\t"
+        "add %0, 128\n\t"
+        "sub %2, 128\n\t"
+        "cmp %2, 128\n\t"
+        "ja 1b\n"
+        "2:\n\t"
+        "cmp %2, 32\n\t"
+        "jbe 3f\n\t"
+        "vmovdqa [%0], ymm0\n\t"
+        "add %0, 32\n\t"
+        "sub %2, 32\n\t"
+        "jmp 2b\n"
+        "3:\n\t"
+        "vzeroupper\n\t"
+        ".att_syntax prefix"
+        : "+r" (dest), "+r" (v), "+r" (n)
+        :
+        : "xmm0", "memory"
+    );
+}
+
+void fill_memory_rep_stosb_intel(void *dest, uint8_t value, size_t n) {
+    __asm__ __volatile__ (
         ".intel_syntax noprefix\n\t"
-        "cld\n\t"
         "rep stosb\n\t"               // Repeat store string byte
         ".att_syntax prefix"
         : "+D" (dest), "+c" (n)
@@ -141,6 +411,120 @@ void fill_memory_intel(void *dest, uint8_t value, size_t n) {
     );
 }
 
+void fill_memory_nontemporal_intel(void *dest, uint8_t value, size_t n) {
+    uint64_t pattern = 0x0101010101010101ULL * value;
+    
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "movq xmm0, %1\n\t"
+        "punpcklqdq xmm0, xmm0\n\t"
+        "movdqu [%0], xmm0\n\t"               // Head
+        "movdqu [%0 + 16], xmm0\n\t"
+        "movdqu [%0 + 32], xmm0\n\t"
+        "movdqu [%0 + 48], xmm0\n\t"
+        "lea %1, [%0 + %2 - 64]\n\t"          // Tail address
+        
+        "mov rax, %0\n\t"
+        "and rax, 63\n\t"
+        "sub rax, 64\n\t"
+        "sub %0, rax\n\t"
+        "add %2, rax\n\t"
+        
+        "cmp %2, 64\n\t"
+        "jb 2f\n"
+        "1:\n\t"
+        "movntdq [%0], xmm0\n\t"
+        "movntdq [%0 + 16], xmm0\n\t"
+        "movntdq [%0 + 32], xmm0\n\t"
+        "movntdq [%0 + 48], xmm0\n\t"
+        "add %0, 64\n\t"
+        "sub %2, 64\n\t"
+        "cmp %2, 64\n\t"
+        "jae 1b\n"
+        "2:\n\t"
+        "sfence\n\t"
+        "movdqu [%1], xmm0\n\t"               // Tail
+        "movdqu [%1 + 16], xmm0\n\t"
+        "movdqu [%1 + 32], xmm0\n\t"
+        "movdqu [%1 + 48], xmm0\n\t"
+        ".att_syntax prefix"
+        : "+r" (dest), "+r" (pattern), "+r" (n)
+        :
+        : "rax", "xmm0", "memory"
+    );
+}
+
+void fill_memory_intel(void *dest, uint8_t value, size_t n) {
+    if (n <= 32)
+        fill_memory_small_intel(dest, value, n);
+    else if (n >= memory_tuning_intel.nontemporal_threshold)
+        fill_memory_nontemporal_intel(dest, value, n);
+    else if (n >= memory_tuning_intel.rep_threshold ||
+             !memory_tuning_intel.use_avx2)
+        fill_memory_rep_stosb_intel(dest, value, n);
+    else
+        fill_memory_avx2_intel(dest, value, n);
+}
+
+/*
+ * Thresholds: CPUID.7.0:EBX bit 5 = AVX2, bit 9 = ERMS; EDX bit 4 = FSRM.
+ * AVX2 also needs the OS to save YMM state (CPUID.1:ECX.OSXSAVE, XCR0[2:1]).
+ */
+__attribute__((constructor))
+void init_memory_tuning_intel(void) {
+    uint32_t eax, ebx, ecx, edx, max_leaf;
+    uint32_t xcr0_lo = 0, xcr0_hi;
+    int avx2 = 0, erms = 0, fsrm = 0;
+    
+    __asm__ (
+        ".intel_syntax noprefix\n\t"
+        "cpuid\n\t"
+        ".att_syntax prefix"
+        : "=a" (max_leaf), "=b" (ebx), "=c" (ecx), "=d" (edx)
+        : "a" (0)
+    );
+    __asm__ (
+        ".intel_syntax noprefix\n\t"
+        "cpuid\n\t"
+        ".att_syntax prefix"
+        : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+        : "a" (1), "c" (0)
+    );
+    if ((ecx >> 27) & 1) {
+        __asm__ (
+            ".intel_syntax noprefix\n\t"
+            "xgetbv\n\t"                      // EDX:EAX = XCR0
+            ".att_syntax prefix"
+            : "=a" (xcr0_lo), "=d" (xcr0_hi)
+            : "c" (0)
+        );
+    }
+    if (max_leaf >= 7) {
+        __asm__ (
+            ".intel_syntax noprefix\n\t"
+            "cpuid\n\t"
+            ".att_syntax prefix"
+            : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+            : "a" (7), "c" (0)                // Leaf 7 is indexed by ECX
+        );
+        avx2 = ((xcr0_lo & 0x06) == 0x06) && ((ebx >> 5) & 1);
+        erms = (ebx >> 9) & 1;
+        fsrm = (edx >> 4) & 1;
+    }
+    
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    
+    memory_tuning_intel.use_avx2 = avx2;
+    memory_tuning_intel.nontemporal_threshold =
+        llc > 0 ? (size_t)llc : (size_t)8 << 20;
+    if (!avx2)
+        memory_tuning_intel.rep_threshold = 33;
+    else if (erms)
+        memory_tuning_intel.rep_threshold = fsrm ? 2048 : 4096;
+    else
+        memory_tuning_intel.rep_threshold = SIZE_MAX;
+}
+
 /*
  * ============================================================================
  * BIT MANIPULATION - Intel Syntax
@@ -148,7 +532,7 @@ void fill_memory_intel(void *dest, uint8_t value, size_t n) {
  */
 
 int count_leading_zeros_intel(uint64_t x) {
-    int count;
+    uint64_t count;                   // bsr needs a 64-bit destination here
     
     if (x == 0)
         return 64;
@@ -165,8 +549,24 @@ int count_leading_zeros_intel(uint64_t x) {
     return count;
 }
 
+// lzcnt needs no zero check (it returns 64), but it decodes as rep bsr:
+// check CPUID 80000001H:ECX bit 5 first (see leading_zeros in 09)
+int count_leading_zeros_lzcnt_intel(uint64_t x) {
+    uint64_t count;
+    
+    __asm__ (
+        ".intel_syntax noprefix\n\t"
+        "lzcnt %0, %1\n\t"            // Leading zero count: dest, src
+        ".att_syntax prefix"
+        : "=r" (count)
+        : "r" (x)
+    );
+    
+    return count;
+}
+
 int popcount_intel(uint64_t x) {
-    int count;
+    uint64_t count;
     
     __asm__ (
         ".intel_syntax noprefix\n\t"
@@ -185,13 +585,15 @@ int popcount_intel(uint64_t x) {
  * ============================================================================
  */
 
+// __volatile__ so GCC never merges or hoists them (see 09)
+
 void atomic_increment_intel(int64_t *ptr) {
-    __asm__ (
+    __asm__ __volatile__ (
         ".intel_syntax noprefix\n\t"
-        "lock inc QWORD PTR [%0]\n\t" // Atomic increment memory
+        "lock inc QWORD PTR [%1]\n\t" // Atomic increment memory
         ".att_syntax prefix"
-        : "+r" (ptr)                  // Read-write pointer
-        :
+        : "+m" (*ptr)                 // The counter is the real output
+        : "r" (ptr)                   // Pointer in a register for [%1]
         : "memory"
     );
 }
@@ -199,28 +601,42 @@ void atomic_increment_intel(int64_t *ptr) {
 int compare_and_swap_intel(uint64_t *ptr, uint64_t old_val, uint64_t new_val) {
     uint8_t result;
     
-    __asm__ (
+    __asm__ __volatile__ (
         ".intel_syntax noprefix\n\t"
-        "lock cmpxchg [%1], %3\n\t"   // Compare RAX with [ptr], swap if equal
+        "lock cmpxchg [%2], %4\n\t"   // Compare RAX with [ptr], swap if equal
         "sete %0\n\t"                 // Set byte if equal (ZF=1)
         ".att_syntax prefix"
-        : "=q" (result), "+m" (*ptr)
-        : "a" (old_val), "r" (new_val)
+        : "=q" (result), "+m" (*ptr)  // "m" operands print in AT&T form, so
+        : "r" (ptr), "a" (old_val),   // address [%2] through a register
+          "r" (new_val)
         : "memory"
     );
     
     return result;
 }
 
+uint64_t atomic_fetch_add_intel(uint64_t *ptr, uint64_t delta) {
+    __asm__ __volatile__ (
+        ".intel_syntax noprefix\n\t"
+        "lock xadd [%2], %0\n\t"      // tmp = [ptr]; [ptr] += delta; delta = tmp
+        ".att_syntax prefix"
+        : "+r" (delta), "+m" (*ptr)
+        : "r" (ptr)
+        : "memory"
+    );
+    
+    return delta;
+}
+
 uint64_t atomic_exchange_intel(uint64_t *ptr, uint64_t new_val) {
     uint64_t old_val = new_val;
     
-    __asm__ (
+    __asm__ __volatile__ (
         ".intel_syntax noprefix\n\t"
-        "xchg [%1], %0\n\t"           // Exchange (implicitly locked)
+        "xchg [%2], %0\n\t"           // Exchange (implicitly locked)
         ".att_syntax prefix"
         : "+r" (old_val), "+m" (*ptr)
-        :
+        : "r" (ptr)
         : "memory"
     );
     
@@ -348,7 +764,7 @@ float dot_product_intel(const float *a, const float *b, size_t n) {
         "addps xmm2, xmm0\n\t"
         "movss %3, xmm2\n\t"          // Extract result
         ".att_syntax prefix"
-        : "+r" (a), "+r" (b), "+r" (n), "=m" (result)
+        : "+r" (a), "+r" (b), "+r" (n), "=x" (result)
         :
         : "xmm0", "xmm1", "xmm2", "memory"
     );
@@ -452,6 +868,8 @@ int min_intel(int a, int b) {
  * ============================================================================
  */
 
+// Define INLINE_ASM_NO_MAIN to #include this file as a library of kernels
+#ifndef INLINE_ASM_NO_MAIN
 int main(void) {
     printf("=== Intel Syntax Inline Assembly Demonstrations ===\n\n");
     
@@ -528,6 +946,7 @@ int main(void) {
     
     return 0;
 }
+#endif /* INLINE_ASM_NO_MAIN */
 
 /*
  * ============================================================================
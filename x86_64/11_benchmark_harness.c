@@ -0,0 +1,1042 @@
+/*
+ * ============================================================================
+ * File: 11_benchmark_harness.c
+ * Description: Cycle-accurate benchmark harness for the tutorial kernels
+ * Topics: TSC timing, calibration, cache-level sweeps, statistics
+ * Compiler: GCC
+ * Build: gcc -O2 11_benchmark_harness.c -o 11_benchmark_harness
+ * Build (with the NASM routines from 05, 08, 14, 15 and 16):
+ *   nasm -f elf64 -DLIBRARY 05_strings_and_arrays.asm -o 05_lib.o
+ *   nasm -f elf64 -DLIBRARY 08_simd_sse.asm -o 08_lib.o
+ *   nasm -f elf64 -DLIBRARY 14_blas1.asm -o 14_lib.o
+ *   nasm -f elf64 -DLIBRARY 15_sgemm.asm -o 15_lib.o
+ *   nasm -f elf64 -DLIBRARY 16_crc32.asm -o 16_lib.o
+ *   gcc -O2 -no-pie -DWITH_ASM_ROUTINES 11_benchmark_harness.c \
+ *       05_lib.o 08_lib.o 14_lib.o 15_lib.o 16_lib.o -o 11_benchmark_harness
+ * Usage: ./11_benchmark_harness [--quick] [--filter SUBSTR] [--list]
+ *                               [--json FILE] [--csv FILE]   (FILE "-" = stdout)
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Pull in the kernels from 09 and 10 without their demo main()
+#define INLINE_ASM_NO_MAIN
+#include "09_inline_asm_c.c"
+#include "10_inline_asm_intel.c"
+
+/*
+ * ============================================================================
+ * NASM ROUTINES (05, 08, 14, 15, 16) - linked only when built with -DWITH_ASM_ROUTINES
+ * ============================================================================
+ *
+ * The LIBRARY build of 05 renames its routines to asm_* so they do not clash
+ * with libc. The 08 routines keep their register conventions, so the C
+ * prototypes carry dummy arguments to land the count in RCX:
+ *   dot_product_simd:     RDI = a, RSI = b, RCX = count
+ *   scalar_multiply_simd: RDI = array, RCX = count, XMM0 = scalar
+ * Both 08 routines use movaps: arrays must be 16-byte aligned and the count
+ * a multiple of 4 (the harness rounds every element count to 64).
+ * The 14 kernels take any length and alignment; their prototypes are in
+ * 14_blas1.h. SGEMM (15_sgemm.h) is reported separately in GFLOP/s. The
+ * CRC kernels (16_crc32.h) checksum the first buffer as bytes.
+ */
+#ifdef WITH_ASM_ROUTINES
+#include "14_blas1.h"
+#include "15_sgemm.h"
+#include "16_crc32.h"
+
+size_t   asm_strlen(const char *s);
+char    *asm_strcpy(char *dest, const char *src);
+long     asm_strcmp(const char *s1, const char *s2);
+size_t   strlen_avx2(const char *s);
+char    *strcpy_avx2(char *dest, const char *src);
+long     strcmp_avx2(const char *s1, const char *s2);
+size_t   strlen_byte(const char *s);
+char    *strcpy_byte(char *dest, const char *src);
+long     strcmp_byte(const char *s1, const char *s2);
+void    *memchr_avx2(const void *buf, int c, size_t len);
+void    *memrchr_avx2(const void *buf, int c, size_t len);
+size_t   mismatch_avx2(const void *a, const void *b, size_t len);
+void    *memmem_avx2(const void *hay, size_t hay_len, const void *needle, size_t len);
+void    *memmem_sse42(const void *hay, size_t hay_len, const void *needle, size_t len);
+void    *memchr_scasb(const void *buf, int c, size_t len);
+void    *memrchr_scasb(const void *buf, int c, size_t len);
+size_t   mismatch_cmpsb(const void *a, const void *b, size_t len);
+void    *ascii_toupper_avx2(void *dst, const void *src, size_t len);
+void    *ascii_toupper_byte(void *dst, const void *src, size_t len);
+long     ascii_casecmp_avx2(const void *a, const void *b, size_t len);
+long     ascii_casecmp_byte(const void *a, const void *b, size_t len);
+void     ascii_classify_avx2(const void *src, size_t len, uint32_t *digit,
+                             uint32_t *alpha, uint32_t *space);
+void     ascii_classify_byte(const void *src, size_t len, uint32_t *digit,
+                             uint32_t *alpha, uint32_t *space);
+void    *ascii_translate_avx2(void *dst, const void *src, size_t len, const uint8_t *table);
+void    *ascii_translate_byte(void *dst, const void *src, size_t len, const uint8_t *table);
+int64_t  asm_array_sum(const int64_t *array, size_t n);
+void     asm_array_reverse(int64_t *array, size_t n);
+int64_t  sum_i64_avx2(const int64_t *array, size_t n);
+int64_t  sum_i32_avx2(const int32_t *array, size_t n);
+int64_t  min_i64_avx2(const int64_t *array, size_t n);
+int64_t  max_i64_avx2(const int64_t *array, size_t n);
+int32_t  min_i32_avx2(const int32_t *array, size_t n);
+int32_t  max_i32_avx2(const int32_t *array, size_t n);
+int64_t  argmin_i64_avx2(const int64_t *array, size_t n);
+int64_t  argmax_i64_avx2(const int64_t *array, size_t n);
+int      sum_i64_checked_avx2(const int64_t *array, size_t n, int64_t *result);
+int64_t  reduce_i64_parallel(const int64_t *array, size_t n, int op, int threads);
+void     reverse_u8_avx2(uint8_t *array, size_t n);
+void     reverse_u64_avx2(uint64_t *array, size_t n);
+void     rotate_left_avx2(void *buf, size_t len, size_t shift);
+void     bswap32_avx2(uint32_t *dst, const uint32_t *src, size_t n);
+void     interleave_u16_avx2(uint16_t *dst, const uint16_t *a, const uint16_t *b, size_t n);
+void     deinterleave_u16_avx2(uint16_t *a, uint16_t *b, const uint16_t *src, size_t n);
+
+void  vector_add_simd(const float *a, const float *b, float *result, size_t n);
+float dot_product_simd(const float *a, const float *b, size_t unused, size_t n);
+void  scalar_multiply_simd(float *array, size_t unused_rsi, size_t unused_rdx,
+                           size_t n, float scalar);
+#endif
+
+/*
+ * ============================================================================
+ * KERNEL TABLE
+ * ============================================================================
+ *
+ * Each kernel sees three 64-byte aligned buffers and an element count. It
+ * declares how many bytes it moves per element (reads + writes); that sets
+ * the element count for a given working set and converts ticks to GB/s.
+ */
+
+struct bench_ctx {
+    void  *a, *b, *c;
+    size_t n;
+};
+
+enum {
+    NEED_NONE    = 0,
+    NEED_POPCNT  = 1 << 0,
+    NEED_AVX2FMA = 1 << 1,
+    NEED_AVX512  = 1 << 2,
+    NEED_AVX2    = 1 << 3,
+    NEED_VPOPCNT = 1 << 4,
+    NEED_LZCNT   = 1 << 5,
+    NEED_BMI1    = 1 << 6,
+    NEED_BMI2    = 1 << 7,
+    NEED_SSE42   = 1 << 8,
+    NEED_PCLMUL  = 1 << 9,
+};
+
+struct kernel {
+    const char *name;
+    const char *source;                     // tutorial file it comes from
+    size_t bytes_per_elem;
+    unsigned need;
+    void (*prepare)(struct bench_ctx *);    // NULL = default float fill
+    void (*run)(struct bench_ctx *);
+};
+
+static volatile uint64_t sink_u64;
+static volatile float    sink_f32;
+static volatile double   sink_f64;
+
+// --- 09: memory ---
+static void run_copy_memory_asm(struct bench_ctx *c) { copy_memory_asm(c->c, c->a, c->n); }
+static void run_fill_memory_asm(struct bench_ctx *c) { fill_memory_asm(c->c, 0x5A, c->n); }
+static void run_copy_memory_avx2(struct bench_ctx *c) { copy_memory_avx2(c->c, c->a, c->n); }
+static void run_copy_memory_rep(struct bench_ctx *c)  { copy_memory_rep_movsb(c->c, c->a, c->n); }
+static void run_copy_memory_nt(struct bench_ctx *c)   { copy_memory_nontemporal(c->c, c->a, c->n); }
+static void run_fill_memory_avx2(struct bench_ctx *c) { fill_memory_avx2(c->c, 0x5A, c->n); }
+static void run_fill_memory_rep(struct bench_ctx *c)  { fill_memory_rep_stosb(c->c, 0x5A, c->n); }
+static void run_fill_memory_nt(struct bench_ctx *c)   { fill_memory_nontemporal(c->c, 0x5A, c->n); }
+
+// --- 09: SIMD ---
+static void run_vector_add_sse(struct bench_ctx *c)    { vector_add_sse(c->c, c->a, c->b, c->n); }
+static void run_vector_add_avx2(struct bench_ctx *c)   { vector_add_avx2(c->c, c->a, c->b, c->n); }
+static void run_vector_add_avx512(struct bench_ctx *c) { vector_add_avx512(c->c, c->a, c->b, c->n); }
+static void run_vector_add(struct bench_ctx *c)        { vector_add(c->c, c->a, c->b, c->n); }
+static void run_dot_product_sse(struct bench_ctx *c)    { sink_f32 = dot_product_sse(c->a, c->b, c->n); }
+static void run_dot_product_avx2(struct bench_ctx *c)   { sink_f32 = dot_product_avx2(c->a, c->b, c->n); }
+static void run_dot_product_avx512(struct bench_ctx *c) { sink_f32 = dot_product_avx512(c->a, c->b, c->n); }
+static void run_dot_product(struct bench_ctx *c)        { sink_f32 = dot_product(c->a, c->b, c->n); }
+static void run_dot_f64_scalar(struct bench_ctx *c)      { sink_f64 = dot_product_f64_scalar(c->a, c->b, c->n); }
+static void run_dot_f64_avx2(struct bench_ctx *c)        { sink_f64 = dot_product_f64_avx2(c->a, c->b, c->n); }
+static void run_dot_f64_kahan_scalar(struct bench_ctx *c) { sink_f64 = dot_product_f64_kahan_scalar(c->a, c->b, c->n); }
+static void run_dot_f64_kahan_avx2(struct bench_ctx *c)  { sink_f64 = dot_product_f64_kahan_avx2(c->a, c->b, c->n); }
+
+// --- 09: scalar instructions applied over a uint64_t array ---
+#define SCALAR_OVER_ARRAY(fn, expr)                        \
+    static void fn(struct bench_ctx *c) {                  \
+        const uint64_t *v = c->a;                          \
+        uint64_t acc = 0;                                  \
+        for (size_t i = 0; i < c->n; i++)                  \
+            acc = (expr);                                  \
+        sink_u64 = acc;                                    \
+    }
+
+SCALAR_OVER_ARRAY(run_basic_add,      basic_add(acc, v[i]))
+SCALAR_OVER_ARRAY(run_multiply_rax,   multiply_rax(acc | 1, v[i]))
+SCALAR_OVER_ARRAY(run_clz,            acc + count_leading_zeros(v[i] | 1))
+SCALAR_OVER_ARRAY(run_ctz,            acc + count_trailing_zeros(v[i] | 1))
+SCALAR_OVER_ARRAY(run_popcount,       acc + popcount(v[i]))
+SCALAR_OVER_ARRAY(run_clz_lzcnt,      acc + count_leading_zeros_lzcnt(v[i]))
+SCALAR_OVER_ARRAY(run_ctz_tzcnt,      acc + count_trailing_zeros_tzcnt(v[i]))
+SCALAR_OVER_ARRAY(run_leading_zeros,  acc + leading_zeros(v[i]))
+SCALAR_OVER_ARRAY(run_select_pdep,    acc + select_in_word_pdep(v[i] | 1, (unsigned)acc & 1))
+SCALAR_OVER_ARRAY(run_select_broadword, acc + select_in_word_broadword(v[i] | 1, (unsigned)acc & 1))
+SCALAR_OVER_ARRAY(run_clz_lzcnt_intel, acc + count_leading_zeros_lzcnt_intel(v[i]))
+SCALAR_OVER_ARRAY(run_add_intel,      add_intel_explicit(acc, v[i]))
+SCALAR_OVER_ARRAY(run_multiply_intel, multiply_intel(acc | 1, v[i]))
+SCALAR_OVER_ARRAY(run_clz_intel,      acc + count_leading_zeros_intel(v[i] | 1))
+SCALAR_OVER_ARRAY(run_popcount_intel, acc + popcount_intel(v[i]))
+SCALAR_OVER_ARRAY(run_max_intel,      acc + max_intel((int)v[i], (int)acc))
+SCALAR_OVER_ARRAY(run_min_intel,      acc + min_intel((int)v[i], (int)acc))
+
+// --- 09: bitmap popcount, one or two uint64_t bitmaps ---
+static void run_popcount_array_popcnt(struct bench_ctx *c) { sink_u64 = popcount_array_popcnt(c->a, c->a, c->n); }
+static void run_popcount_array_lut(struct bench_ctx *c)    { sink_u64 = popcount_array_avx2_lut(c->a, c->a, c->n); }
+static void run_popcount_array_hs(struct bench_ctx *c)     { sink_u64 = popcount_array_avx2(c->a, c->a, c->n); }
+static void run_popcount_array_avx512(struct bench_ctx *c) { sink_u64 = popcount_array_avx512(c->a, c->a, c->n); }
+static void run_popcount_array(struct bench_ctx *c)        { sink_u64 = popcount_array(c->a, c->n); }
+static void run_popcount_and_popcnt(struct bench_ctx *c)   { sink_u64 = popcount_and_popcnt(c->a, c->b, c->n); }
+static void run_popcount_and_hs(struct bench_ctx *c)       { sink_u64 = popcount_and_avx2(c->a, c->b, c->n); }
+static void run_popcount_and_avx512(struct bench_ctx *c)   { sink_u64 = popcount_and_avx512(c->a, c->b, c->n); }
+static void run_popcount_xor(struct bench_ctx *c)          { sink_u64 = popcount_xor(c->a, c->b, c->n); }
+
+// --- 09: rank/select, one query per word at scattered positions ---
+static struct bitvector bench_bv;
+
+static void prepare_bitvector(struct bench_ctx *c) {
+    bitvector_destroy(&bench_bv);
+    if (bitvector_init(&bench_bv, c->a, c->n * 64) != 0)
+        memset(&bench_bv, 0, sizeof(bench_bv));
+}
+static void run_bitvector_rank1(struct bench_ctx *c) {
+    uint64_t acc = 0;
+    if (bench_bv.nbits == 0)
+        return;
+    for (size_t i = 0; i < c->n; i++)
+        acc += bitvector_rank1(&bench_bv, (i * 0x9E3779B97F4A7C15ULL) % bench_bv.nbits);
+    sink_u64 = acc;
+}
+static void run_bitvector_select1(struct bench_ctx *c) {
+    uint64_t acc = 0;
+    if (bench_bv.ones == 0)
+        return;
+    for (size_t i = 0; i < c->n; i++)
+        acc += bitvector_select1(&bench_bv, (i * 0x9E3779B97F4A7C15ULL) % bench_bv.ones);
+    sink_u64 = acc;
+}
+
+// --- 09/10: atomics, one locked RMW per array slot ---
+static void run_atomic_increment(struct bench_ctx *c) {
+    int64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_increment(&v[i]);
+}
+static void run_compare_and_swap(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        compare_and_swap(&v[i], v[i], v[i] + 1);
+}
+static void run_atomic_exchange(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_exchange(&v[i], i);
+}
+static void run_atomic_fetch_add(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_fetch_add(&v[i], i);
+}
+static void run_atomic_increment_intel(struct bench_ctx *c) {
+    int64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_increment_intel(&v[i]);
+}
+static void run_compare_and_swap_intel(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        compare_and_swap_intel(&v[i], v[i], v[i] + 1);
+}
+static void run_atomic_exchange_intel(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_exchange_intel(&v[i], i);
+}
+static void run_atomic_fetch_add_intel(struct bench_ctx *c) {
+    uint64_t *v = c->c;
+    for (size_t i = 0; i < c->n; i++)
+        atomic_fetch_add_intel(&v[i], i);
+}
+
+// --- 09: memory ordering, a store then a load from another array ---
+// The load may pass the store unless a seq_cst barrier drains the store
+// buffer in between; that drain is what these rows measure.
+#define ORDERING_OVER_ARRAY(fn, store, fence, load)        \
+    static void fn(struct bench_ctx *c) {                  \
+        const uint64_t *in = c->a;                         \
+        uint64_t *out = c->c;                              \
+        uint64_t acc = 0;                                  \
+        for (size_t i = 0; i < c->n; i++) {                \
+            store(&out[i], acc);                           \
+            fence;                                         \
+            acc += load(&in[i]);                           \
+        }                                                  \
+        sink_u64 = acc;                                    \
+    }
+
+ORDERING_OVER_ARRAY(run_order_relaxed, store_relaxed, (void)0,           load_relaxed)
+ORDERING_OVER_ARRAY(run_order_acq_rel, store_release, (void)0,           load_acquire)
+ORDERING_OVER_ARRAY(run_order_lock_or, store_release, fence_seq_cst(),   load_acquire)
+ORDERING_OVER_ARRAY(run_order_mfence,  store_release, memory_barrier(),  load_acquire)
+ORDERING_OVER_ARRAY(run_order_xchg,    store_seq_cst, (void)0,           load_acquire)
+
+// --- 10: memory and SIMD ---
+static void run_copy_memory_intel(struct bench_ctx *c) { copy_memory_intel(c->c, c->a, c->n); }
+static void run_fill_memory_intel(struct bench_ctx *c) { fill_memory_intel(c->c, 0x5A, c->n); }
+static void run_vector_add_intel(struct bench_ctx *c)  { vector_add_intel(c->c, c->a, c->b, c->n); }
+static void run_dot_product_intel(struct bench_ctx *c) { sink_f32 = dot_product_intel(c->a, c->b, c->n); }
+
+#ifdef WITH_ASM_ROUTINES
+// --- 05: strings and arrays ---
+static void prepare_string(struct bench_ctx *c) {
+    memset(c->a, 'x', c->n);
+    ((char *)c->a)[c->n - 1] = '\0';
+}
+static void prepare_string_pair(struct bench_ctx *c) {
+    prepare_string(c);
+    memcpy(c->b, c->a, c->n);
+}
+static void run_asm_strlen(struct bench_ctx *c)  { sink_u64 = asm_strlen(c->a); }
+static void run_asm_strcpy(struct bench_ctx *c)  { asm_strcpy(c->c, c->a); }
+static void run_asm_strcmp(struct bench_ctx *c)  { sink_u64 = (uint64_t)asm_strcmp(c->a, c->b); }
+static void run_strlen_avx2(struct bench_ctx *c) { sink_u64 = strlen_avx2(c->a); }
+static void run_strcpy_avx2(struct bench_ctx *c) { strcpy_avx2(c->c, c->a); }
+static void run_strcmp_avx2(struct bench_ctx *c) { sink_u64 = (uint64_t)strcmp_avx2(c->a, c->b); }
+static void run_strlen_byte(struct bench_ctx *c) { sink_u64 = strlen_byte(c->a); }
+static void run_strcpy_byte(struct bench_ctx *c) { strcpy_byte(c->c, c->a); }
+static void run_strcmp_byte(struct bench_ctx *c) { sink_u64 = (uint64_t)strcmp_byte(c->a, c->b); }
+static void run_memchr_avx2(struct bench_ctx *c)    { sink_u64 = (uintptr_t)memchr_avx2(c->a, '\n', c->n); }
+static void run_memchr_scasb(struct bench_ctx *c)   { sink_u64 = (uintptr_t)memchr_scasb(c->a, '\n', c->n); }
+static void run_memrchr_avx2(struct bench_ctx *c)   { sink_u64 = (uintptr_t)memrchr_avx2(c->a, '\n', c->n); }
+static void run_memrchr_scasb(struct bench_ctx *c)  { sink_u64 = (uintptr_t)memrchr_scasb(c->a, '\n', c->n); }
+static void run_mismatch_avx2(struct bench_ctx *c)  { sink_u64 = mismatch_avx2(c->a, c->b, c->n); }
+static void run_mismatch_cmpsb(struct bench_ctx *c) { sink_u64 = mismatch_cmpsb(c->a, c->b, c->n); }
+static void run_memmem_avx2(struct bench_ctx *c)    { sink_u64 = (uintptr_t)memmem_avx2(c->a, c->n, "ERROR:", 6); }
+static void run_memmem_sse42(struct bench_ctx *c)   { sink_u64 = (uintptr_t)memmem_sse42(c->a, c->n, "ERROR:", 6); }
+static uint8_t ascii_rot13[256];
+static void prepare_ascii(struct bench_ctx *c) {
+    // Mixed-case text with digits and spaces, and a ROT13 table
+    static const char text[] = "Content-Type: Text/HTML; charset=UTF-8\r\n"
+                               "X-Request-Id: 4F2A9C07 \t";
+    for (size_t i = 0; i < c->n; i++)
+        ((char *)c->a)[i] = text[i % (sizeof(text) - 1)];
+    memcpy(c->b, c->a, c->n);
+    for (int i = 0; i < 256; i++) {
+        int base = (i >= 'a' && i <= 'z') ? 'a' : (i >= 'A' && i <= 'Z') ? 'A' : -1;
+        ascii_rot13[i] = base < 0 ? i : base + (i - base + 13) % 26;
+    }
+}
+static void run_ascii_toupper_avx2(struct bench_ctx *c) { ascii_toupper_avx2(c->c, c->a, c->n); }
+static void run_ascii_toupper_byte(struct bench_ctx *c) { ascii_toupper_byte(c->c, c->a, c->n); }
+static void run_ascii_casecmp_avx2(struct bench_ctx *c) { sink_u64 = (uint64_t)ascii_casecmp_avx2(c->a, c->b, c->n); }
+static void run_ascii_casecmp_byte(struct bench_ctx *c) { sink_u64 = (uint64_t)ascii_casecmp_byte(c->a, c->b, c->n); }
+static void run_ascii_classify(struct bench_ctx *c, void (*fn)(const void *, size_t,
+                               uint32_t *, uint32_t *, uint32_t *)) {
+    uint32_t *maps = c->c;                  // 3 bitmaps of n / 32 dwords
+    size_t words = (c->n + 31) / 32;
+    fn(c->a, c->n, maps, maps + words, maps + 2 * words);
+}
+static void run_ascii_classify_avx2(struct bench_ctx *c) { run_ascii_classify(c, ascii_classify_avx2); }
+static void run_ascii_classify_byte(struct bench_ctx *c) { run_ascii_classify(c, ascii_classify_byte); }
+static void run_ascii_translate_avx2(struct bench_ctx *c) { ascii_translate_avx2(c->c, c->a, c->n, ascii_rot13); }
+static void run_ascii_translate_byte(struct bench_ctx *c) { ascii_translate_byte(c->c, c->a, c->n, ascii_rot13); }
+static void run_asm_array_sum(struct bench_ctx *c) { sink_u64 = (uint64_t)asm_array_sum(c->a, c->n); }
+static void run_asm_array_reverse(struct bench_ctx *c) { asm_array_reverse(c->c, c->n); }
+static void run_sum_i64_avx2(struct bench_ctx *c)    { sink_u64 = (uint64_t)sum_i64_avx2(c->a, c->n); }
+static void run_sum_i32_avx2(struct bench_ctx *c)    { sink_u64 = (uint64_t)sum_i32_avx2(c->a, c->n); }
+static void run_min_i64_avx2(struct bench_ctx *c)    { sink_u64 = (uint64_t)min_i64_avx2(c->a, c->n); }
+static void run_max_i32_avx2(struct bench_ctx *c)    { sink_u64 = (uint64_t)max_i32_avx2(c->a, c->n); }
+static void run_argmin_i64_avx2(struct bench_ctx *c) { sink_u64 = (uint64_t)argmin_i64_avx2(c->a, c->n); }
+static void run_sum_i64_checked(struct bench_ctx *c) {
+    int64_t sum;
+    sink_u64 = (uint64_t)sum_i64_checked_avx2(c->a, c->n, &sum) + (uint64_t)sum;
+}
+static void run_sum_i64_parallel(struct bench_ctx *c) { sink_u64 = (uint64_t)reduce_i64_parallel(c->a, c->n, 0, 0); }
+static void run_reverse_u8_avx2(struct bench_ctx *c)  { reverse_u8_avx2(c->c, c->n); }
+static void run_reverse_u64_avx2(struct bench_ctx *c) { reverse_u64_avx2(c->c, c->n); }
+static void run_rotate_left_avx2(struct bench_ctx *c) { rotate_left_avx2(c->c, c->n * 8, 24); }
+static void run_bswap32_avx2(struct bench_ctx *c)     { bswap32_avx2(c->c, c->a, c->n); }
+static void run_interleave_u16(struct bench_ctx *c)   { interleave_u16_avx2(c->c, c->a, c->b, c->n); }
+static void run_deinterleave_u16(struct bench_ctx *c) {
+    deinterleave_u16_avx2(c->c, (uint16_t *)c->c + c->n, c->a, c->n);
+}
+
+// --- 14: BLAS-1 ---
+static void run_saxpy_sse(struct bench_ctx *c)   { blas_saxpy_sse(c->n, 1e-3f, c->a, c->c); }
+static void run_saxpy_avx2(struct bench_ctx *c)  { blas_saxpy_avx2(c->n, 1e-3f, c->a, c->c); }
+static void run_saxpy_avx2_odd(struct bench_ctx *c) {
+    // Misaligned arrays and a length that needs both a head and a tail
+    blas_saxpy_avx2(c->n - 5, 1e-3f, (const float *)c->a + 1, (float *)c->c + 3);
+}
+static void run_daxpy_avx2(struct bench_ctx *c)  { blas_daxpy_avx2(c->n, 1e-3, c->a, c->c); }
+static void run_sscal_avx2(struct bench_ctx *c)  { blas_sscal_avx2(c->n, 1.0f, c->c); }
+static void run_sasum_avx2(struct bench_ctx *c)  { sink_f32 = blas_sasum_avx2(c->n, c->a); }
+static void run_snrm2_avx2(struct bench_ctx *c)  { sink_f32 = blas_snrm2_avx2(c->n, c->a); }
+static void run_dnrm2_sse(struct bench_ctx *c)   { sink_f64 = blas_dnrm2_sse(c->n, c->a); }
+static void run_dnrm2_avx2(struct bench_ctx *c)  { sink_f64 = blas_dnrm2_avx2(c->n, c->a); }
+static void run_isamax_avx2(struct bench_ctx *c) { sink_u64 = blas_isamax_avx2(c->n, c->a); }
+static void run_idamax_avx2(struct bench_ctx *c) { sink_u64 = blas_idamax_avx2(c->n, c->a); }
+
+// --- 16: CRC ---
+static void run_crc32c_sw(struct bench_ctx *c)     { sink_u64 = crc32c_sw(0, c->a, c->n); }
+static void run_crc32c_sse42(struct bench_ctx *c)  { sink_u64 = crc32c_sse42(0, c->a, c->n); }
+static void run_crc32c_3way(struct bench_ctx *c)   { sink_u64 = crc32c_3way(0, c->a, c->n); }
+static void run_crc32c_pclmul(struct bench_ctx *c) { sink_u64 = crc32c_pclmul(0, c->a, c->n); }
+static void run_crc32_ieee_pclmul(struct bench_ctx *c) { sink_u64 = crc32_ieee_pclmul(0, c->a, c->n); }
+static void run_crc64_xz_pclmul(struct bench_ctx *c)   { sink_u64 = crc64_xz_pclmul(0, c->a, c->n); }
+static void run_crc32c_copy_3way(struct bench_ctx *c)  { sink_u64 = crc32c_copy_3way(0, c->c, c->a, c->n); }
+static void run_memcpy_then_crc32c(struct bench_ctx *c) {
+    // The two-pass version crc32c_copy replaces
+    memcpy(c->c, c->a, c->n);
+    sink_u64 = crc32c_3way(0, c->c, c->n);
+}
+
+// --- 08: SSE ---
+static void run_vector_add_simd(struct bench_ctx *c) { vector_add_simd(c->a, c->b, c->c, c->n); }
+static void run_dot_product_simd(struct bench_ctx *c) { sink_f32 = dot_product_simd(c->a, c->b, 0, c->n); }
+static void run_scalar_multiply_simd(struct bench_ctx *c) { scalar_multiply_simd(c->c, 0, 0, c->n, 1.0f); }
+#endif
+
+static const struct kernel kernels[] = {
+    // name                     source  bytes  need          prepare  run
+    { "copy_memory_asm",          "09",  2,  NEED_NONE,    NULL, run_copy_memory_asm },
+    { "fill_memory_asm",          "09",  1,  NEED_NONE,    NULL, run_fill_memory_asm },
+    { "copy_memory_avx2",         "09",  2,  NEED_AVX2,    NULL, run_copy_memory_avx2 },
+    { "copy_memory_rep_movsb",    "09",  2,  NEED_NONE,    NULL, run_copy_memory_rep },
+    { "copy_memory_nontemporal",  "09",  2,  NEED_NONE,    NULL, run_copy_memory_nt },
+    { "fill_memory_avx2",         "09",  1,  NEED_AVX2,    NULL, run_fill_memory_avx2 },
+    { "fill_memory_rep_stosb",    "09",  1,  NEED_NONE,    NULL, run_fill_memory_rep },
+    { "fill_memory_nontemporal",  "09",  1,  NEED_NONE,    NULL, run_fill_memory_nt },
+    { "vector_add_sse",           "09", 12,  NEED_NONE,    NULL, run_vector_add_sse },
+    { "vector_add_avx2",          "09", 12,  NEED_AVX2FMA, NULL, run_vector_add_avx2 },
+    { "vector_add_avx512",        "09", 12,  NEED_AVX512,  NULL, run_vector_add_avx512 },
+    { "vector_add (dispatched)",  "09", 12,  NEED_NONE,    NULL, run_vector_add },
+    { "dot_product_sse",          "09",  8,  NEED_NONE,    NULL, run_dot_product_sse },
+    { "dot_product_avx2",         "09",  8,  NEED_AVX2FMA, NULL, run_dot_product_avx2 },
+    { "dot_product_avx512",       "09",  8,  NEED_AVX512,  NULL, run_dot_product_avx512 },
+    { "dot_product (dispatched)", "09",  8,  NEED_NONE,    NULL, run_dot_product },
+    { "dot_product_f64_scalar",   "09", 16,  NEED_NONE,    NULL, run_dot_f64_scalar },
+    { "dot_product_f64_avx2",     "09", 16,  NEED_AVX2FMA, NULL, run_dot_f64_avx2 },
+    { "dot_f64_kahan_scalar",     "09", 16,  NEED_NONE,    NULL, run_dot_f64_kahan_scalar },
+    { "dot_f64_kahan_avx2",       "09", 16,  NEED_AVX2FMA, NULL, run_dot_f64_kahan_avx2 },
+    { "basic_add",                "09",  8,  NEED_NONE,    NULL, run_basic_add },
+    { "multiply_rax",             "09",  8,  NEED_NONE,    NULL, run_multiply_rax },
+    { "count_leading_zeros",      "09",  8,  NEED_NONE,    NULL, run_clz },
+    { "count_trailing_zeros",     "09",  8,  NEED_NONE,    NULL, run_ctz },
+    { "popcount",                 "09",  8,  NEED_POPCNT,  NULL, run_popcount },
+    { "count_leading_zeros_lzcnt","09",  8,  NEED_LZCNT,   NULL, run_clz_lzcnt },
+    { "count_trailing_zeros_tzcnt","09", 8,  NEED_BMI1,    NULL, run_ctz_tzcnt },
+    { "leading_zeros (dispatched)","09", 8,  NEED_NONE,    NULL, run_leading_zeros },
+    { "select_in_word_pdep",      "09",  8,  NEED_BMI2,    NULL, run_select_pdep },
+    { "select_in_word_broadword", "09",  8,  NEED_NONE,    NULL, run_select_broadword },
+    { "bitvector_rank1",          "09",  8,  NEED_NONE,    prepare_bitvector, run_bitvector_rank1 },
+    { "bitvector_select1",        "09",  8,  NEED_NONE,    prepare_bitvector, run_bitvector_select1 },
+    { "popcount_array_popcnt",    "09",  8,  NEED_POPCNT,  NULL, run_popcount_array_popcnt },
+    { "popcount_array_avx2_lut",  "09",  8,  NEED_POPCNT | NEED_AVX2, NULL, run_popcount_array_lut },
+    { "popcount_array_avx2 (H-S)","09",  8,  NEED_POPCNT | NEED_AVX2, NULL, run_popcount_array_hs },
+    { "popcount_array_avx512",    "09",  8,  NEED_VPOPCNT, NULL, run_popcount_array_avx512 },
+    { "popcount_array",           "09",  8,  NEED_NONE,    NULL, run_popcount_array },
+    { "popcount_and_popcnt",      "09", 16,  NEED_POPCNT,  NULL, run_popcount_and_popcnt },
+    { "popcount_and_avx2 (H-S)",  "09", 16,  NEED_POPCNT | NEED_AVX2, NULL, run_popcount_and_hs },
+    { "popcount_and_avx512",      "09", 16,  NEED_VPOPCNT, NULL, run_popcount_and_avx512 },
+    { "popcount_xor",             "09", 16,  NEED_NONE,    NULL, run_popcount_xor },
+    { "atomic_increment",         "09", 16,  NEED_NONE,    NULL, run_atomic_increment },
+    { "compare_and_swap",         "09", 16,  NEED_NONE,    NULL, run_compare_and_swap },
+    { "atomic_exchange",          "09", 16,  NEED_NONE,    NULL, run_atomic_exchange },
+    { "atomic_fetch_add",         "09", 16,  NEED_NONE,    NULL, run_atomic_fetch_add },
+    { "order: relaxed",           "09", 16,  NEED_NONE,    NULL, run_order_relaxed },
+    { "order: acquire/release",   "09", 16,  NEED_NONE,    NULL, run_order_acq_rel },
+    { "order: seq_cst lock or",   "09", 16,  NEED_NONE,    NULL, run_order_lock_or },
+    { "order: seq_cst mfence",    "09", 16,  NEED_NONE,    NULL, run_order_mfence },
+    { "order: seq_cst xchg",      "09", 16,  NEED_NONE,    NULL, run_order_xchg },
+    { "copy_memory_intel",        "10",  2,  NEED_NONE,    NULL, run_copy_memory_intel },
+    { "fill_memory_intel",        "10",  1,  NEED_NONE,    NULL, run_fill_memory_intel },
+    { "vector_add_intel",         "10", 12,  NEED_NONE,    NULL, run_vector_add_intel },
+    { "dot_product_intel",        "10",  8,  NEED_NONE,    NULL, run_dot_product_intel },
+    { "add_intel_explicit",       "10",  8,  NEED_NONE,    NULL, run_add_intel },
+    { "multiply_intel",           "10",  8,  NEED_NONE,    NULL, run_multiply_intel },
+    { "count_leading_zeros_intel","10",  8,  NEED_NONE,    NULL, run_clz_intel },
+    { "popcount_intel",           "10",  8,  NEED_POPCNT,  NULL, run_popcount_intel },
+    { "clz_lzcnt_intel",          "10",  8,  NEED_LZCNT,   NULL, run_clz_lzcnt_intel },
+    { "max_intel",                "10",  8,  NEED_NONE,    NULL, run_max_intel },
+    { "min_intel",                "10",  8,  NEED_NONE,    NULL, run_min_intel },
+    { "atomic_increment_intel",   "10", 16,  NEED_NONE,    NULL, run_atomic_increment_intel },
+    { "compare_and_swap_intel",   "10", 16,  NEED_NONE,    NULL, run_compare_and_swap_intel },
+    { "atomic_exchange_intel",    "10", 16,  NEED_NONE,    NULL, run_atomic_exchange_intel },
+    { "atomic_fetch_add_intel",   "10", 16,  NEED_NONE,    NULL, run_atomic_fetch_add_intel },
+#ifdef WITH_ASM_ROUTINES
+    { "asm_strlen",               "05",  1,  NEED_NONE,    prepare_string, run_asm_strlen },
+    { "asm_strcpy",               "05",  2,  NEED_NONE,    prepare_string, run_asm_strcpy },
+    { "asm_strcmp",               "05",  2,  NEED_NONE,    prepare_string_pair, run_asm_strcmp },
+    { "strlen_avx2",              "05",  1,  NEED_AVX2,    prepare_string, run_strlen_avx2 },
+    { "strcpy_avx2",              "05",  2,  NEED_AVX2,    prepare_string, run_strcpy_avx2 },
+    { "strcmp_avx2",              "05",  2,  NEED_AVX2,    prepare_string_pair, run_strcmp_avx2 },
+    { "strlen_byte",              "05",  1,  NEED_NONE,    prepare_string, run_strlen_byte },
+    { "strcpy_byte",              "05",  2,  NEED_NONE,    prepare_string, run_strcpy_byte },
+    { "strcmp_byte",              "05",  2,  NEED_NONE,    prepare_string_pair, run_strcmp_byte },
+    { "memchr_avx2",              "05",  1,  NEED_AVX2,    prepare_string, run_memchr_avx2 },
+    { "memchr_scasb",             "05",  1,  NEED_NONE,    prepare_string, run_memchr_scasb },
+    { "memrchr_avx2",             "05",  1,  NEED_AVX2,    prepare_string, run_memrchr_avx2 },
+    { "memrchr_scasb",            "05",  1,  NEED_NONE,    prepare_string, run_memrchr_scasb },
+    { "mismatch_avx2",            "05",  2,  NEED_AVX2,    prepare_string_pair, run_mismatch_avx2 },
+    { "mismatch_cmpsb",           "05",  2,  NEED_NONE,    prepare_string_pair, run_mismatch_cmpsb },
+    { "memmem_avx2",              "05",  1,  NEED_AVX2,    prepare_string, run_memmem_avx2 },
+    { "memmem_sse42",             "05",  1,  NEED_SSE42,   prepare_string, run_memmem_sse42 },
+    { "ascii_toupper_avx2",       "05",  2,  NEED_AVX2,    prepare_ascii, run_ascii_toupper_avx2 },
+    { "ascii_toupper_byte",       "05",  2,  NEED_NONE,    prepare_ascii, run_ascii_toupper_byte },
+    { "ascii_casecmp_avx2",       "05",  2,  NEED_AVX2,    prepare_ascii, run_ascii_casecmp_avx2 },
+    { "ascii_casecmp_byte",       "05",  2,  NEED_NONE,    prepare_ascii, run_ascii_casecmp_byte },
+    { "ascii_classify_avx2",      "05",  1,  NEED_AVX2,    prepare_ascii, run_ascii_classify_avx2 },
+    { "ascii_classify_byte",      "05",  1,  NEED_NONE,    prepare_ascii, run_ascii_classify_byte },
+    { "ascii_translate_avx2",     "05",  2,  NEED_AVX2,    prepare_ascii, run_ascii_translate_avx2 },
+    { "ascii_translate_byte",     "05",  2,  NEED_NONE,    prepare_ascii, run_ascii_translate_byte },
+    { "asm_array_sum",            "05",  8,  NEED_NONE,    NULL, run_asm_array_sum },
+    { "asm_array_reverse",        "05", 16,  NEED_NONE,    NULL, run_asm_array_reverse },
+    { "sum_i64_avx2",             "05",  8,  NEED_AVX2,    NULL, run_sum_i64_avx2 },
+    { "sum_i32_avx2",             "05",  4,  NEED_AVX2,    NULL, run_sum_i32_avx2 },
+    { "min_i64_avx2",             "05",  8,  NEED_AVX2,    NULL, run_min_i64_avx2 },
+    { "max_i32_avx2",             "05",  4,  NEED_AVX2,    NULL, run_max_i32_avx2 },
+    { "argmin_i64_avx2",          "05",  8,  NEED_AVX2,    NULL, run_argmin_i64_avx2 },
+    { "sum_i64_checked_avx2",     "05",  8,  NEED_AVX2,    NULL, run_sum_i64_checked },
+    { "reduce_i64_parallel (sum)","05",  8,  NEED_AVX2,    NULL, run_sum_i64_parallel },
+    { "reverse_u8_avx2",          "05",  2,  NEED_AVX2,    NULL, run_reverse_u8_avx2 },
+    { "reverse_u64_avx2",         "05", 16,  NEED_AVX2,    NULL, run_reverse_u64_avx2 },
+    { "rotate_left_avx2 (3 rev)", "05", 48,  NEED_AVX2,    NULL, run_rotate_left_avx2 },
+    { "bswap32_avx2",             "05",  8,  NEED_AVX2,    NULL, run_bswap32_avx2 },
+    { "interleave_u16_avx2",      "05",  8,  NEED_AVX2,    NULL, run_interleave_u16 },
+    { "deinterleave_u16_avx2",    "05",  8,  NEED_AVX2,    NULL, run_deinterleave_u16 },
+    { "blas_saxpy_sse",           "14", 12,  NEED_NONE,    NULL, run_saxpy_sse },
+    { "blas_saxpy_avx2",          "14", 12,  NEED_AVX2FMA, NULL, run_saxpy_avx2 },
+    { "blas_saxpy_avx2 (odd)",    "14", 12,  NEED_AVX2FMA, NULL, run_saxpy_avx2_odd },
+    { "blas_daxpy_avx2",          "14", 24,  NEED_AVX2FMA, NULL, run_daxpy_avx2 },
+    { "blas_sscal_avx2",          "14",  8,  NEED_AVX2FMA, NULL, run_sscal_avx2 },
+    { "blas_sasum_avx2",          "14",  4,  NEED_AVX2FMA, NULL, run_sasum_avx2 },
+    { "blas_snrm2_avx2",          "14",  4,  NEED_AVX2FMA, NULL, run_snrm2_avx2 },
+    { "blas_dnrm2_sse (2 pass)",  "14", 16,  NEED_NONE,    NULL, run_dnrm2_sse },
+    { "blas_dnrm2_avx2 (2 pass)", "14", 16,  NEED_AVX2FMA, NULL, run_dnrm2_avx2 },
+    { "blas_isamax_avx2",         "14",  4,  NEED_AVX2FMA, NULL, run_isamax_avx2 },
+    { "blas_idamax_avx2",         "14",  8,  NEED_AVX2FMA, NULL, run_idamax_avx2 },
+    { "crc32c_sw",                "16",  1,  NEED_NONE,    NULL, run_crc32c_sw },
+    { "crc32c_sse42",             "16",  1,  NEED_SSE42,   NULL, run_crc32c_sse42 },
+    { "crc32c_3way",              "16",  1,  NEED_SSE42 | NEED_PCLMUL, NULL, run_crc32c_3way },
+    { "crc32c_pclmul",            "16",  1,  NEED_SSE42 | NEED_PCLMUL, NULL, run_crc32c_pclmul },
+    { "crc32_ieee_pclmul",        "16",  1,  NEED_SSE42 | NEED_PCLMUL, NULL, run_crc32_ieee_pclmul },
+    { "crc64_xz_pclmul",          "16",  1,  NEED_SSE42 | NEED_PCLMUL, NULL, run_crc64_xz_pclmul },
+    { "crc32c_copy_3way",         "16",  2,  NEED_SSE42 | NEED_PCLMUL, NULL, run_crc32c_copy_3way },
+    { "memcpy + crc32c_3way",     "16",  2,  NEED_SSE42 | NEED_PCLMUL, NULL, run_memcpy_then_crc32c },
+    { "vector_add_simd",          "08", 12,  NEED_NONE,    NULL, run_vector_add_simd },
+    { "dot_product_simd",         "08",  8,  NEED_NONE,    NULL, run_dot_product_simd },
+    { "scalar_multiply_simd",     "08",  8,  NEED_NONE,    NULL, run_scalar_multiply_simd },
+#endif
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static int kernel_supported(const struct kernel *k) {
+    if ((k->need & NEED_POPCNT) && !cpu_features.popcnt) return 0;
+    if ((k->need & NEED_AVX2FMA) && !(cpu_features.avx2 && cpu_features.fma)) return 0;
+    if ((k->need & NEED_AVX512) && !cpu_features.avx512f) return 0;
+    if ((k->need & NEED_AVX2) && !cpu_features.avx2) return 0;
+    if ((k->need & NEED_VPOPCNT) && !cpu_features.avx512vpopcntdq) return 0;
+    if ((k->need & NEED_LZCNT) && !cpu_features.lzcnt) return 0;
+    if ((k->need & NEED_BMI1) && !cpu_features.bmi1) return 0;
+    if ((k->need & NEED_BMI2) && !(cpu_features.bmi1 && cpu_features.bmi2)) return 0;
+    if ((k->need & NEED_SSE42) && !cpu_features.sse42) return 0;
+    if ((k->need & NEED_PCLMUL) && !(cpu_features.sse41 && cpu_features.pclmulqdq)) return 0;
+    return 1;
+}
+
+/*
+ * ============================================================================
+ * TSC CALIBRATION
+ * ============================================================================
+ *
+ * Ticks only convert to time if the TSC runs at a constant rate regardless
+ * of P-states and C-states: CPUID.80000007H:EDX bit 8 (invariant TSC).
+ * The rate is measured against CLOCK_MONOTONIC rather than trusting the
+ * nominal frequency, since leaf 15H is missing on many parts.
+ */
+
+static int tsc_is_invariant(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000007)
+        return 0;
+    cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double calibrate_tsc_hz(double seconds) {
+    double best = 0.0;
+
+    // Three rounds; keep the one with the least wall-clock slack
+    for (int round = 0; round < 3; round++) {
+        double t0 = now_seconds();
+        uint64_t c0 = rdtsc_begin();
+        double t1;
+        do {
+            t1 = now_seconds();
+        } while (t1 - t0 < seconds);
+        uint64_t c1 = rdtsc_end();
+        double hz = (double)(c1 - c0) / (t1 - t0);
+        if (round == 0 || hz < best)
+            best = hz;
+    }
+    return best;
+}
+
+// Cost of an empty rdtsc_begin/rdtsc_end pair: subtracted from every sample
+static uint64_t measure_overhead(void) {
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < 2000; i++) {
+        uint64_t t0 = rdtsc_begin();
+        uint64_t t1 = rdtsc_end();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    return best;
+}
+
+/*
+ * ============================================================================
+ * CACHE TOPOLOGY
+ * ============================================================================
+ *
+ * Working sets are chosen relative to the data-cache sizes so each kernel is
+ * timed with its data resident in L1, L2, L3 and DRAM. Sizes come from
+ * sysconf when glibc knows them, otherwise from the CPUID cache-parameter
+ * leaf (cpuid_cache_sizes in 09), otherwise from typical defaults.
+ */
+
+static void detect_cache_sizes(struct cache_sizes *cs) {
+    long v;
+
+    *cs = (struct cache_sizes){0};
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if ((v = sysconf(_SC_LEVEL1_DCACHE_SIZE)) > 0) cs->l1 = (size_t)v;
+    if ((v = sysconf(_SC_LEVEL2_CACHE_SIZE)) > 0)  cs->l2 = (size_t)v;
+    if ((v = sysconf(_SC_LEVEL3_CACHE_SIZE)) > 0)  cs->l3 = (size_t)v;
+#endif
+    if (!cs->l1 || !cs->l2 || !cs->l3) {
+        struct cache_sizes id = {0};
+        cpuid_cache_sizes(&id);
+        if (!cs->l1) cs->l1 = id.l1;
+        if (!cs->l2) cs->l2 = id.l2;
+        if (!cs->l3) cs->l3 = id.l3;
+    }
+    if (!cs->l1) cs->l1 = 32 << 10;
+    if (!cs->l2) cs->l2 = 1 << 20;
+    if (!cs->l3) cs->l3 = 8 << 20;
+}
+
+/*
+ * ============================================================================
+ * MEASUREMENT
+ * ============================================================================
+ *
+ * One sample = `reps` back-to-back calls between fenced TSC reads, with the
+ * pair overhead subtracted. reps is sized during warmup so a sample spans at
+ * least MIN_SAMPLE_TICKS, which keeps small-working-set timings well above
+ * the TSC's resolution. Samples are collected until the per-point time
+ * budget runs out or MAX_SAMPLES is reached (never fewer than MIN_SAMPLES).
+ * Min is the best-case estimate, the median the typical cost, and p99 shows
+ * interference (interrupts, frequency changes, page faults).
+ */
+
+#define MAX_SAMPLES      101
+#define MIN_SAMPLES      5
+#define MIN_SAMPLE_TICKS 20000
+
+struct options {
+    int quick;
+    int list;
+    const char *filter;
+    const char *json_path;
+    const char *csv_path;
+};
+
+struct result {
+    const struct kernel *k;
+    size_t working_set;
+    size_t n;
+    int samples;
+    double min, median, p99;        // TSC ticks per element
+    double gbps;                    // from the min
+};
+
+static uint64_t tsc_overhead;
+static double tsc_hz;
+
+static int cmp_double(const void *x, const void *y) {
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+static void prepare_default(struct bench_ctx *c, size_t bytes) {
+    float *a = c->a, *b = c->b, *r = c->c;
+
+    // Finite values in every interpretation (float, double, integer)
+    for (size_t i = 0; i < bytes / sizeof(float); i++) {
+        a[i] = 1.0f + (float)(i & 7);
+        b[i] = 0.5f;
+        r[i] = 0.0f;
+    }
+}
+
+static void measure(const struct kernel *k, struct bench_ctx *ctx,
+                    size_t working_set, const struct options *opt,
+                    struct result *res) {
+    double samples[MAX_SAMPLES];
+    double budget = opt->quick ? 0.02 : 0.25;
+    int max_samples = opt->quick ? 21 : MAX_SAMPLES;
+    uint64_t reps = 1;
+    int count = 0;
+
+    ctx->n = working_set / k->bytes_per_elem;
+    ctx->n &= ~(size_t)63;                  // SIMD-friendly multiple of 64
+    if (ctx->n == 0)
+        ctx->n = 64;
+
+    prepare_default(ctx, working_set);
+    if (k->prepare)
+        k->prepare(ctx);
+
+    // Warmup: fault in pages, train predictors, then size the repetitions
+    k->run(ctx);
+    uint64_t t0 = rdtsc_begin();
+    k->run(ctx);
+    uint64_t t1 = rdtsc_end();
+    uint64_t one = t1 - t0 > tsc_overhead ? t1 - t0 - tsc_overhead : 1;
+    if (one < MIN_SAMPLE_TICKS)
+        reps = (MIN_SAMPLE_TICKS + one - 1) / one;
+
+    double start = now_seconds();
+    while (count < max_samples) {
+        t0 = rdtsc_begin();
+        for (uint64_t r = 0; r < reps; r++)
+            k->run(ctx);
+        t1 = rdtsc_end();
+
+        uint64_t ticks = t1 - t0 > tsc_overhead ? t1 - t0 - tsc_overhead : 0;
+        samples[count++] = (double)ticks / (double)reps / (double)ctx->n;
+
+        if (count >= MIN_SAMPLES && now_seconds() - start > budget)
+            break;
+    }
+
+    qsort(samples, count, sizeof(double), cmp_double);
+    res->k = k;
+    res->working_set = working_set;
+    res->n = ctx->n;
+    res->samples = count;
+    res->min = samples[0];
+    res->median = samples[count / 2];
+    res->p99 = samples[(count * 99) / 100 < count ? (count * 99) / 100 : count - 1];
+    res->gbps = res->min > 0.0
+              ? (double)k->bytes_per_elem * tsc_hz / res->min / 1e9 : 0.0;
+}
+
+/*
+ * ============================================================================
+ * REPORTING
+ * ============================================================================
+ */
+
+static FILE *open_output(const char *path) {
+    if (strcmp(path, "-") == 0)
+        return stdout;
+    FILE *f = fopen(path, "w");
+    if (!f)
+        perror(path);
+    return f;
+}
+
+static void close_output(FILE *f) {
+    if (f && f != stdout)
+        fclose(f);
+}
+
+static void write_json(FILE *f, const struct result *r, size_t count,
+                       const struct cache_sizes *cs) {
+    fprintf(f, "{\n");
+    fprintf(f, "  \"tsc_hz\": %.0f,\n", tsc_hz);
+    fprintf(f, "  \"invariant_tsc\": %d,\n", tsc_is_invariant());
+    fprintf(f, "  \"tsc_overhead_ticks\": %llu,\n",
+            (unsigned long long)tsc_overhead);
+    fprintf(f, "  \"cache_bytes\": {\"l1\": %zu, \"l2\": %zu, \"l3\": %zu},\n",
+            cs->l1, cs->l2, cs->l3);
+    fprintf(f, "  \"simd_level\": \"%s\",\n", simd_level);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(f, "    {\"kernel\": \"%s\", \"source\": \"%s\", "
+                   "\"working_set_bytes\": %zu, \"elements\": %zu, "
+                   "\"samples\": %d, \"min_ticks_per_elem\": %.4f, "
+                   "\"median_ticks_per_elem\": %.4f, "
+                   "\"p99_ticks_per_elem\": %.4f, \"gb_per_s\": %.3f}%s\n",
+                r[i].k->name, r[i].k->source, r[i].working_set, r[i].n,
+                r[i].samples, r[i].min, r[i].median, r[i].p99, r[i].gbps,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+static void write_csv(FILE *f, const struct result *r, size_t count) {
+    fprintf(f, "kernel,source,working_set_bytes,elements,samples,"
+               "min_ticks_per_elem,median_ticks_per_elem,p99_ticks_per_elem,"
+               "gb_per_s\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(f, "%s,%s,%zu,%zu,%d,%.4f,%.4f,%.4f,%.3f\n",
+                r[i].k->name, r[i].k->source, r[i].working_set, r[i].n,
+                r[i].samples, r[i].min, r[i].median, r[i].p99, r[i].gbps);
+    }
+}
+
+static const char *size_label(size_t bytes, char *buf, size_t len) {
+    if (bytes >= (1 << 20))
+        snprintf(buf, len, "%zuMiB", bytes >> 20);
+    else
+        snprintf(buf, len, "%zuKiB", bytes >> 10);
+    return buf;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [--quick] [--filter SUBSTR] [--list] "
+            "[--json FILE] [--csv FILE]\n", prog);
+}
+
+#ifdef WITH_ASM_ROUTINES
+/*
+ * ============================================================================
+ * SGEMM THROUGHPUT
+ * ============================================================================
+ *
+ * A matrix multiply does 2*n^3 flops on 3*n^2 elements, so ticks per element
+ * says little; square products are reported in GFLOP/s instead (best run
+ * within the time budget), on one thread and on every online CPU.
+ */
+
+static double time_sgemm(size_t d, const float *a, const float *b, float *c,
+                         size_t threads, double budget) {
+    double best = 1e30;
+    double start = now_seconds();
+    int runs = 0;
+
+    do {
+        double t0 = now_seconds();
+        sgemm_mt(d, d, d, 1.0f, a, d, b, d, 0.0f, c, d, threads);
+        double t = now_seconds() - t0;
+        if (t < best)
+            best = t;
+        runs++;
+    } while (runs < 3 || now_seconds() - start < budget);
+    return 2.0 * (double)d * (double)d * (double)d / best * 1e-9;
+}
+
+static void gemm_sweep(FILE *table, const struct options *opt) {
+    static const size_t dims[] = { 64, 128, 256, 512, 1024 };
+    double budget = opt->quick ? 0.05 : 0.3;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus < 1) cpus = 1;
+    if (cpus > 16) cpus = 16;
+    int avx = sgemm_init();
+
+    fprintf(table, "\nsgemm (%s microkernel), GFLOP/s\n",
+            avx ? "AVX2/FMA 6x16" : "SSE2 6x16");
+    fprintf(table, "%6s %12s %9ld threads\n", "n", "1 thread", cpus);
+
+    for (size_t i = 0; i < sizeof(dims) / sizeof(dims[0]); i++) {
+        size_t d = dims[i];
+        float *a = aligned_alloc(64, d * d * sizeof(float));
+        float *b = aligned_alloc(64, d * d * sizeof(float));
+        float *c = aligned_alloc(64, d * d * sizeof(float));
+        if (!a || !b || !c) {
+            fprintf(stderr, "out of memory\n");
+            free(a);
+            free(b);
+            free(c);
+            return;
+        }
+        for (size_t j = 0; j < d * d; j++) {
+            a[j] = 1.0f + (float)(j & 7);
+            b[j] = 0.5f;
+        }
+        double one = time_sgemm(d, a, b, c, 1, budget);
+        double all = time_sgemm(d, a, b, c, (size_t)cpus, budget);
+        fprintf(table, "%6zu %12.1f %17.1f\n", d, one, all);
+        free(a);
+        free(b);
+        free(c);
+    }
+}
+#endif
+
+/*
+ * ============================================================================
+ * MAIN
+ * ============================================================================
+ */
+
+int main(int argc, char **argv) {
+    struct options opt = {0};
+    struct cache_sizes cs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            opt.quick = 1;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            opt.list = 1;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            opt.filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json_path = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            opt.csv_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opt.list) {
+        for (size_t i = 0; i < NUM_KERNELS; i++)
+            printf("%-26s %s%s\n", kernels[i].name, kernels[i].source,
+                   kernel_supported(&kernels[i]) ? "" : "  (unsupported)");
+        return 0;
+    }
+
+    // Machine-readable output on stdout moves the table to stderr
+    FILE *table = stdout;
+    if ((opt.json_path && strcmp(opt.json_path, "-") == 0) ||
+        (opt.csv_path && strcmp(opt.csv_path, "-") == 0))
+        table = stderr;
+
+    detect_cache_sizes(&cs);
+    tsc_overhead = measure_overhead();
+    tsc_hz = calibrate_tsc_hz(opt.quick ? 0.01 : 0.05);
+
+    fprintf(table, "TSC: %.3f GHz (%s), pair overhead %llu ticks\n",
+            tsc_hz / 1e9, tsc_is_invariant() ? "invariant" : "NOT invariant",
+            (unsigned long long)tsc_overhead);
+    fprintf(table, "Caches: L1d %zu KiB, L2 %zu KiB, L3 %zu KiB; SIMD: %s\n\n",
+            cs.l1 >> 10, cs.l2 >> 10, cs.l3 >> 10, simd_level);
+
+    // Half of each level leaves room for stack, code and the other buffers;
+    // DRAM is 4x L3, at least 64 MiB and capped so three buffers fit easily
+    size_t dram = cs.l3 * 4;
+    if (dram < ((size_t)64 << 20)) dram = (size_t)64 << 20;
+    if (dram > ((size_t)256 << 20)) dram = (size_t)256 << 20;
+    size_t sets[4] = { cs.l1 / 2, cs.l2 / 2, cs.l3 / 2, dram };
+    if (sets[2] > dram) sets[2] = dram;
+    const char *levels[4] = { "L1", "L2", "L3", "DRAM" };
+
+    struct bench_ctx ctx;
+    ctx.a = aligned_alloc(64, dram);
+    ctx.b = aligned_alloc(64, dram);
+    ctx.c = aligned_alloc(64, dram);
+    struct result *results = calloc(NUM_KERNELS * 4, sizeof(*results));
+    if (!ctx.a || !ctx.b || !ctx.c || !results) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    fprintf(table, "%-26s %-4s %9s %11s %11s %11s %9s\n", "kernel", "set",
+            "size", "min t/el", "median t/el", "p99 t/el", "GB/s");
+
+    size_t count = 0;
+    for (size_t i = 0; i < NUM_KERNELS; i++) {
+        const struct kernel *k = &kernels[i];
+        if (opt.filter && !strstr(k->name, opt.filter))
+            continue;
+        if (!kernel_supported(k)) {
+            fprintf(table, "%-26s (skipped: CPU lacks required features)\n",
+                    k->name);
+            continue;
+        }
+        for (int s = 0; s < 4; s++) {
+            struct result *r = &results[count++];
+            char buf[32];
+            measure(k, &ctx, sets[s], &opt, r);
+            fprintf(table, "%-26s %-4s %9s %11.3f %11.3f %11.3f %9.2f\n",
+                    k->name, levels[s], size_label(sets[s], buf, sizeof(buf)),
+                    r->min, r->median, r->p99, r->gbps);
+        }
+    }
+
+#ifdef WITH_ASM_ROUTINES
+    if (!opt.filter || strstr("sgemm", opt.filter))
+        gemm_sweep(table, &opt);
+#endif
+
+    if (opt.json_path) {
+        FILE *f = open_output(opt.json_path);
+        if (f) write_json(f, results, count, &cs);
+        close_output(f);
+    }
+    if (opt.csv_path) {
+        FILE *f = open_output(opt.csv_path);
+        if (f) write_csv(f, results, count);
+        close_output(f);
+    }
+
+    free(results);
+    free(ctx.a);
+    free(ctx.b);
+    free(ctx.c);
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * NOTES ON BENCHMARKING
+ * ============================================================================
+ *
+ * Reading the numbers:
+ *   - ticks/element is in TSC ticks, i.e. reference cycles at the nominal
+ *     frequency, not core clock cycles. With turbo the core runs faster than
+ *     the TSC, so a 1-cycle instruction can show as < 1 tick.
+ *   - GB/s counts bytes read + written per element (the table's bytes column)
+ *     and is computed from the minimum, the least disturbed sample.
+ *   - A wide min/p99 gap means interference: pin the process (taskset -c 2),
+ *     disable turbo/frequency scaling, and close other workloads.
+ *
+ * Pitfalls this harness avoids:
+ *   - Dead-code elimination: results go to volatile sinks
+ *   - Cold-start effects: one warmup call before sampling
+ *   - Timer cost: the empty-pair overhead is subtracted
+ *   - TSC resolution: short kernels are repeated per sample
+ *
+ * Adding a kernel:
+ *   1. Write a run_xxx(struct bench_ctx *) wrapper
+ *   2. Add a row to kernels[] with its bytes moved per element
+ *   3. Set `need` if it requires an ISA extension
+ *
+ * ============================================================================
+ */
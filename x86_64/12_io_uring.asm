@@ -0,0 +1,1068 @@
+; ============================================================================
+; File: 12_io_uring.asm
+; Description: Batched file I/O with io_uring, using raw system calls
+; Topics: io_uring_setup/enter/register, shared rings, linked SQEs,
+;         direct (fixed) file descriptors, completion reaping
+; Assembler: NASM
+; Build: nasm -f elf64 12_io_uring.asm && ld -o 12_io_uring 12_io_uring.o
+; Run: ./12_io_uring
+; Library: nasm -f elf64 -DLIBRARY 12_io_uring.asm -o 12_lib.o
+; Requires: Linux 5.18+ (a fixed-file op linked after an openat into a
+;           direct descriptor); uring_init checks and fails with -ENOSYS
+; ============================================================================
+;
+; The routines in 07_file_io.asm spend one blocking syscall per step: open,
+; read, close - three round-trips per file. Here every file becomes a chain
+; of three linked SQEs (submission queue entries):
+;
+;     OPENAT -> slot k   ==link==>   READ/WRITE slot k   ==hardlink==>   CLOSE slot k
+;
+; The opened file goes into slot k of a registered ("fixed") file table
+; instead of a normal fd, so the READ can name it before it exists. Up to
+; URING_FILES chains are queued and handed to the kernel with a single
+; io_uring_enter, which also waits for all of their completions.
+;
+; Requests are arrays of 32-byte records:
+;
+;   struct uring_request {
+;       const char *path;       // +0  NUL-terminated file name
+;       void       *buf;        // +8  data to write / space to read into
+;       uint64_t    len;        // +16 bytes to write / buffer size
+;       int64_t     result;     // +24 bytes read, written or file size,
+;   };                          //     or negative errno for this file
+;
+; ============================================================================
+
+%ifdef LIBRARY
+    global uring_init, uring_exit, uring_enter_calls
+    global uring_read_files, uring_write_files, uring_file_sizes
+%else
+global _start
+%endif
+
+; System call numbers (x86_64 Linux)
+%define SYS_WRITE               1
+%define SYS_CLOSE               3
+%define SYS_MMAP                9
+%define SYS_MUNMAP              11
+%define SYS_EXIT                60
+%define SYS_UNLINK              87
+%define SYS_IO_URING_SETUP      425
+%define SYS_IO_URING_ENTER      426
+%define SYS_IO_URING_REGISTER   427
+
+; Flags and constants
+%define O_RDONLY        0
+%define O_WRONLY        1
+%define O_CREAT         64
+%define O_TRUNC         512
+%define AT_FDCWD        -100
+%define PROT_READ       1
+%define PROT_WRITE      2
+%define MAP_SHARED      0x01
+%define MAP_POPULATE    0x8000
+%define STATX_SIZE      0x200
+%define MAX_RW_CHUNK    0x7ffff000
+%define EINTR           4
+%define EAGAIN          11
+%define EBUSY           16
+%define ENOSYS          38
+%define ECANCELED       125
+
+%define STDOUT          1
+
+; io_uring ABI (include/uapi/linux/io_uring.h)
+%define IORING_OFF_SQ_RING      0
+%define IORING_OFF_CQ_RING      0x8000000
+%define IORING_OFF_SQES         0x10000000
+%define IORING_FEAT_SINGLE_MMAP 1
+%define IORING_FEAT_LINKED_FILE 0x1000  ; 5.18: linked ops get their file late
+%define IORING_ENTER_GETEVENTS  1
+%define IORING_REGISTER_FILES   2
+%define IORING_REGISTER_PROBE   8
+%define IO_URING_OP_SUPPORTED   1
+
+%define IORING_OP_OPENAT        18
+%define IORING_OP_CLOSE         19
+%define IORING_OP_STATX         21
+%define IORING_OP_READ          22
+%define IORING_OP_WRITE         23      ; = IORING_OP_READ + 1
+
+%define IOSQE_FIXED_FILE        1       ; fd field is a slot in the file table
+%define IOSQE_IO_LINK           4       ; Next SQE waits; cancelled on failure
+%define IOSQE_IO_HARDLINK       8       ; Next SQE waits; runs even on failure
+
+; struct io_uring_params (120 bytes)
+%define P_SQ_ENTRIES    0
+%define P_CQ_ENTRIES    4
+%define P_FEATURES      20
+%define P_SQ_OFF        40              ; struct io_sqring_offsets
+%define P_CQ_OFF        80              ; struct io_cqring_offsets
+%define P_SIZE          120
+
+; Field offsets within io_sqring_offsets / io_cqring_offsets
+%define RING_HEAD       0
+%define RING_TAIL       4
+%define RING_MASK       8
+%define SQ_ARRAY        24
+%define CQ_CQES         20
+
+; struct io_uring_sqe (64 bytes)
+%define SQE_OPCODE      0
+%define SQE_FLAGS       1
+%define SQE_FD          4
+%define SQE_OFF         8               ; Also addr2 (statx buffer)
+%define SQE_ADDR        16
+%define SQE_LEN         24              ; Also the openat mode / statx mask
+%define SQE_OP_FLAGS    28              ; open_flags, rw_flags, statx_flags...
+%define SQE_USER_DATA   32
+%define SQE_FILE_INDEX  44              ; Direct descriptor slot + 1
+%define SQE_SIZE        64
+
+; struct io_uring_cqe (16 bytes)
+%define CQE_USER_DATA   0
+%define CQE_RES         8
+%define CQE_SIZE        16
+
+; struct uring_request
+%define REQ_PATH        0
+%define REQ_BUF         8
+%define REQ_LEN         16
+%define REQ_RESULT      24
+%define REQ_SIZE        32
+
+; struct io_uring_probe: 16-byte header, then 8 bytes per opcode
+%define PROBE_OPS_LEN   1               ; u8: opcodes the kernel filled in
+%define PROBE_OPS       16
+%define PROBE_OP_FLAGS  2               ; u16 within each op
+%define PROBE_MAX_OPS   64
+%define PROBE_SIZE      (PROBE_OPS + 8 * PROBE_MAX_OPS)
+
+; struct statx
+%define STX_SIZE        40
+%define STATX_BUF_SIZE  256
+
+; Ring sizing: every file needs at most 3 SQEs
+%define URING_ENTRIES   256
+%define URING_FILES     64              ; Files per io_uring_enter (and slots)
+
+; Operations for uring_batch
+%define URING_OP_READ   0
+%define URING_OP_WRITE  1
+%define URING_OP_STAT   2
+
+; user_data = request index << 8 | slot << 2 | kind
+%define KIND_OPEN       0
+%define KIND_RW         1
+%define KIND_CLOSE      2
+%define KIND_STATX      3
+
+%define DEMO_FILES      16
+%define DEMO_NAME_LEN   11              ; "uring_X.tmp"
+
+section .data
+    uring_fd:           dq -1           ; Ring file descriptor (-1 = not set up)
+    uring_enter_calls:  dq 0            ; io_uring_enter syscalls made so far
+
+    ; uring_init opens, reads and closes this through a slot to test the kernel
+    uring_test_path:    db "/dev/null", 0
+
+    ; Opcodes uring_batch uses (0-terminated)
+    uring_needed_ops:   db IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_READ
+                        db IORING_OP_WRITE, IORING_OP_STATX, 0
+
+    demo_template:  db "uring_X.tmp", 0
+
+    msg_setup_fail: db "io_uring is not available", 0x0a
+    msg_setup_fail_len: equ $ - msg_setup_fail
+
+    msg_write:      db "Wrote 16 files", 0x0a
+    msg_write_len:  equ $ - msg_write
+
+    msg_read:       db "Read back 16 files", 0x0a
+    msg_read_len:   equ $ - msg_read
+
+    msg_stat:       db "Checked 16 file sizes", 0x0a
+    msg_stat_len:   equ $ - msg_stat
+
+    msg_calls:      db "io_uring_enter calls: "
+    msg_calls_len:  equ $ - msg_calls
+
+    msg_error:      db "Error occurred!", 0x0a
+    msg_error_len:  equ $ - msg_error
+
+section .bss
+    uring_params:       resb P_SIZE
+
+    uring_sq_ring:      resq 1          ; SQ ring mapping (and CQ if shared)
+    uring_sq_ring_size: resq 1
+    uring_cq_ring:      resq 1
+    uring_cq_ring_size: resq 1          ; 0 when the CQ shares the SQ mapping
+    uring_sqes:         resq 1          ; SQE array mapping
+    uring_sqes_size:    resq 1
+
+    uring_sq_tail:      resq 1          ; Pointers into the shared rings
+    uring_cq_head:      resq 1
+    uring_cq_tail:      resq 1
+    uring_cqes:         resq 1
+    uring_sq_mask:      resd 1
+    uring_cq_mask:      resd 1
+
+    uring_slots:        resd URING_FILES    ; Registered file table (all -1)
+    uring_probe:        resb PROBE_SIZE
+    uring_test_request: resb REQ_SIZE
+
+    alignb 64
+    uring_statx:        resb STATX_BUF_SIZE * URING_FILES
+
+    demo_names:         resb 16 * DEMO_FILES
+    demo_bufs:          resb 64 * DEMO_FILES
+    demo_requests:      resb REQ_SIZE * DEMO_FILES
+    number_buffer:      resb 24
+
+section .text
+
+%ifndef LIBRARY
+_start:
+    ; ========================================================================
+    ; SETTING UP THE RING
+    ; ========================================================================
+
+    call    uring_init
+    test    rax, rax
+    jns     .ring_ready
+
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_setup_fail
+    mov     rdx, msg_setup_fail_len
+    syscall
+
+    mov     rax, SYS_EXIT
+    mov     rdi, 1
+    syscall
+
+.ring_ready:
+    ; ========================================================================
+    ; BUILDING REQUESTS: uring_0.tmp ... uring_f.tmp, each holding its name
+    ; ========================================================================
+
+    xor     ecx, ecx
+.build:
+    mov     rdi, rcx
+    shl     rdi, 4
+    add     rdi, demo_names         ; Name i
+    mov     rax, [demo_template]
+    mov     [rdi], rax
+    mov     eax, [demo_template + 8]
+    mov     [rdi + 8], eax
+
+    mov     eax, ecx                ; Hex digit for X
+    add     eax, '0'
+    cmp     eax, '9'
+    jbe     .digit
+    add     eax, 'a' - '9' - 1
+.digit:
+    mov     [rdi + 6], al
+
+    mov     rsi, rcx
+    shl     rsi, 5
+    add     rsi, demo_requests      ; Request i
+    mov     [rsi + REQ_PATH], rdi
+    mov     [rsi + REQ_BUF], rdi    ; Write the name as the contents
+    mov     qword [rsi + REQ_LEN], DEMO_NAME_LEN
+
+    inc     ecx
+    cmp     ecx, DEMO_FILES
+    jb      .build
+
+    ; ========================================================================
+    ; WRITING: 16 x (openat, write, close) in one batch
+    ; ========================================================================
+
+    mov     rdi, demo_requests
+    mov     rsi, DEMO_FILES
+    call    uring_write_files
+    test    rax, rax
+    js      .error
+
+    mov     rdx, DEMO_NAME_LEN
+    call    check_results
+    jne     .error
+
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_write
+    mov     rdx, msg_write_len
+    syscall
+
+    ; ========================================================================
+    ; READING: 16 x (openat, read, close) into separate buffers
+    ; ========================================================================
+
+    xor     ecx, ecx
+.point_bufs:
+    mov     rsi, rcx
+    shl     rsi, 5
+    add     rsi, demo_requests
+    mov     rax, rcx
+    shl     rax, 6
+    add     rax, demo_bufs
+    mov     [rsi + REQ_BUF], rax
+    mov     qword [rsi + REQ_LEN], 64
+    inc     ecx
+    cmp     ecx, DEMO_FILES
+    jb      .point_bufs
+
+    mov     rdi, demo_requests
+    mov     rsi, DEMO_FILES
+    call    uring_read_files
+    test    rax, rax
+    js      .error
+
+    mov     rdx, DEMO_NAME_LEN
+    call    check_results
+    jne     .error
+
+    ; Each buffer must hold its own file name
+    xor     ecx, ecx
+.compare:
+    mov     rsi, rcx
+    shl     rsi, 4
+    add     rsi, demo_names
+    mov     rdi, rcx
+    shl     rdi, 6
+    add     rdi, demo_bufs
+    mov     rax, [rsi]
+    cmp     rax, [rdi]
+    jne     .error
+    mov     eax, [rsi + 7]          ; Last 4 bytes (overlapping)
+    cmp     eax, [rdi + 7]
+    jne     .error
+    inc     ecx
+    cmp     ecx, DEMO_FILES
+    jb      .compare
+
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_read
+    mov     rdx, msg_read_len
+    syscall
+
+    ; ========================================================================
+    ; FILE SIZES: 16 x statx, no open needed
+    ; ========================================================================
+
+    mov     rdi, demo_requests
+    mov     rsi, DEMO_FILES
+    call    uring_file_sizes
+    test    rax, rax
+    js      .error
+
+    mov     rdx, DEMO_NAME_LEN
+    call    check_results
+    jne     .error
+
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_stat
+    mov     rdx, msg_stat_len
+    syscall
+
+    ; Three batches of 16 files, plus the test chain in uring_init: four
+    ; io_uring_enter calls in total
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_calls
+    mov     rdx, msg_calls_len
+    syscall
+
+    mov     rdi, [uring_enter_calls]
+    call    print_decimal
+
+    ; ========================================================================
+    ; CLEAN UP
+    ; ========================================================================
+
+    xor     ebx, ebx
+.unlink:
+    mov     rdi, rbx
+    shl     rdi, 4
+    add     rdi, demo_names
+    mov     rax, SYS_UNLINK
+    syscall
+    inc     ebx
+    cmp     ebx, DEMO_FILES
+    jb      .unlink
+
+    call    uring_exit
+
+    mov     rax, SYS_EXIT
+    xor     rdi, rdi
+    syscall
+
+.error:
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    mov     rsi, msg_error
+    mov     rdx, msg_error_len
+    syscall
+
+    mov     rax, SYS_EXIT
+    mov     rdi, 1
+    syscall
+
+; ----------------------------------------------------------------------------
+; check_results: ZF set if every demo request has result == RDX
+; ----------------------------------------------------------------------------
+check_results:
+    xor     ecx, ecx
+.loop:
+    mov     rsi, rcx
+    shl     rsi, 5
+    cmp     [demo_requests + rsi + REQ_RESULT], rdx
+    jne     .done
+    inc     ecx
+    cmp     ecx, DEMO_FILES
+    jb      .loop
+    cmp     ecx, ecx                ; ZF = 1
+.done:
+    ret
+
+; ----------------------------------------------------------------------------
+; print_decimal: write RDI as an unsigned decimal number and a newline
+; ----------------------------------------------------------------------------
+print_decimal:
+    lea     rsi, [number_buffer + 23]
+    mov     byte [rsi], 0x0a
+    mov     rax, rdi
+    mov     ecx, 10
+.digit:
+    xor     edx, edx
+    div     rcx
+    add     dl, '0'
+    dec     rsi
+    mov     [rsi], dl
+    test    rax, rax
+    jnz     .digit
+
+    lea     rdx, [number_buffer + 24]
+    sub     rdx, rsi
+    mov     rax, SYS_WRITE
+    mov     rdi, STDOUT
+    syscall
+    ret
+%endif
+
+; ============================================================================
+; FUNCTION: uring_init
+; Description: Create the ring, map it and register the direct file table
+; Arguments: None
+; Returns: RAX = 0 on success, negative errno on error: -ENOSYS when
+;          the kernel cannot run the openat -> fixed-file chains (then use
+;          the 07_file_io.asm routines), -EINVAL/-ENOSYS from io_uring_setup
+;          or the opcode probe on kernels without them
+; Note: Called automatically by the batch routines; safe to call twice
+;
+; Besides the feature flag and an IORING_REGISTER_PROBE of every opcode
+; used, it runs one openat -> read -> close chain on /dev/null through
+; slot 0, so a kernel that accepts the SQEs but mishandles them is caught
+; here rather than in the caller's first batch.
+; ============================================================================
+uring_init:
+    push    rbx
+    push    r12
+
+    xor     eax, eax
+    cmp     qword [uring_fd], 0
+    jge     .return                 ; Already set up
+
+    ; io_uring_setup(entries, &params); params are in/out and must start zeroed
+    mov     rdi, uring_params
+    mov     ecx, P_SIZE
+    rep     stosb
+
+    mov     rax, SYS_IO_URING_SETUP
+    mov     rdi, URING_ENTRIES
+    mov     rsi, uring_params
+    syscall
+
+    test    rax, rax
+    js      .return
+    mov     [uring_fd], rax
+
+    ; The batches link a fixed-file READ/WRITE after an openat that fills
+    ; the slot. Older kernels look the slot up when the READ is queued,
+    ; find it empty and fail with -EBADF; before 5.15 they even ignore
+    ; file_index and open a normal fd. IORING_FEAT_LINKED_FILE (5.18) is
+    ; the flag for "looked up when the READ runs".
+    mov     rax, -ENOSYS
+    test    dword [uring_params + P_FEATURES], IORING_FEAT_LINKED_FILE
+    jz      .fail
+
+    ; SQ ring: header + u32 index array; CQ ring: header + 16-byte CQEs
+    mov     eax, [uring_params + P_SQ_OFF + SQ_ARRAY]
+    mov     ecx, [uring_params + P_SQ_ENTRIES]
+    lea     rbx, [rax + rcx * 4]
+    mov     eax, [uring_params + P_CQ_OFF + CQ_CQES]
+    mov     ecx, [uring_params + P_CQ_ENTRIES]
+    shl     rcx, 4
+    lea     r12, [rax + rcx]
+
+    ; Since 5.4 one mapping covers both rings
+    test    dword [uring_params + P_FEATURES], IORING_FEAT_SINGLE_MMAP
+    jz      .map_sq
+    cmp     r12, rbx
+    cmova   rbx, r12
+    xor     r12, r12
+
+.map_sq:
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, rbx
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_SHARED | MAP_POPULATE
+    mov     r8, [uring_fd]
+    mov     r9, IORING_OFF_SQ_RING
+    syscall
+
+    test    rax, rax
+    js      .fail
+    mov     [uring_sq_ring], rax
+    mov     [uring_sq_ring_size], rbx
+    mov     [uring_cq_ring], rax
+
+    test    r12, r12
+    jz      .map_sqes
+
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rsi, r12
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_SHARED | MAP_POPULATE
+    mov     r8, [uring_fd]
+    mov     r9, IORING_OFF_CQ_RING
+    syscall
+
+    test    rax, rax
+    js      .fail
+    mov     [uring_cq_ring], rax
+    mov     [uring_cq_ring_size], r12
+
+.map_sqes:
+    mov     esi, [uring_params + P_SQ_ENTRIES]
+    shl     rsi, 6                  ; * SQE_SIZE
+    mov     rbx, rsi
+    mov     rax, SYS_MMAP
+    xor     rdi, rdi
+    mov     rdx, PROT_READ | PROT_WRITE
+    mov     r10, MAP_SHARED | MAP_POPULATE
+    mov     r8, [uring_fd]
+    mov     r9, IORING_OFF_SQES
+    syscall
+
+    test    rax, rax
+    js      .fail
+    mov     [uring_sqes], rax
+    mov     [uring_sqes_size], rbx
+
+    ; Pointers into the SQ ring
+    mov     rax, [uring_sq_ring]
+    mov     ecx, [uring_params + P_SQ_OFF + RING_TAIL]
+    add     rcx, rax
+    mov     [uring_sq_tail], rcx
+    mov     ecx, [uring_params + P_SQ_OFF + RING_MASK]
+    mov     ecx, [rax + rcx]
+    mov     [uring_sq_mask], ecx
+
+    ; The index array maps ring positions to SQEs; keep it the identity
+    mov     edi, [uring_params + P_SQ_OFF + SQ_ARRAY]
+    add     rdi, rax
+    mov     ecx, [uring_params + P_SQ_ENTRIES]
+    xor     edx, edx
+.identity:
+    mov     [rdi + rdx * 4], edx
+    inc     edx
+    cmp     edx, ecx
+    jb      .identity
+
+    ; Pointers into the CQ ring
+    mov     rax, [uring_cq_ring]
+    mov     ecx, [uring_params + P_CQ_OFF + RING_HEAD]
+    add     rcx, rax
+    mov     [uring_cq_head], rcx
+    mov     ecx, [uring_params + P_CQ_OFF + RING_TAIL]
+    add     rcx, rax
+    mov     [uring_cq_tail], rcx
+    mov     ecx, [uring_params + P_CQ_OFF + RING_MASK]
+    mov     ecx, [rax + rcx]
+    mov     [uring_cq_mask], ecx
+    mov     ecx, [uring_params + P_CQ_OFF + CQ_CQES]
+    add     rcx, rax
+    mov     [uring_cqes], rcx
+
+    ; Register URING_FILES empty slots for openat to fill
+    mov     rdi, uring_slots
+    mov     eax, -1
+    mov     ecx, URING_FILES
+    rep     stosd
+
+    mov     rax, SYS_IO_URING_REGISTER
+    mov     rdi, [uring_fd]
+    mov     rsi, IORING_REGISTER_FILES
+    mov     rdx, uring_slots
+    mov     r10, URING_FILES
+    syscall
+
+    test    rax, rax
+    js      .fail
+
+    ; Every opcode we queue must be supported: seccomp or a restricted
+    ; ring can turn some off. The probe buffer must start zeroed.
+    mov     rdi, uring_probe
+    xor     eax, eax
+    mov     ecx, PROBE_SIZE
+    rep     stosb
+
+    mov     rax, SYS_IO_URING_REGISTER
+    mov     rdi, [uring_fd]
+    mov     rsi, IORING_REGISTER_PROBE
+    mov     rdx, uring_probe
+    mov     r10, PROBE_MAX_OPS
+    syscall
+
+    test    rax, rax
+    js      .fail
+    mov     rsi, uring_needed_ops
+.check_op:
+    movzx   ecx, byte [rsi]
+    test    ecx, ecx
+    jz      .test_chain
+    mov     rax, -ENOSYS
+    cmp     cl, [uring_probe + PROBE_OPS_LEN]
+    jae     .fail                   ; Newer than the kernel
+    test    word [uring_probe + PROBE_OPS + rcx * 8 + PROBE_OP_FLAGS], IO_URING_OP_SUPPORTED
+    jz      .fail
+    inc     rsi
+    jmp     .check_op
+
+.test_chain:
+    ; One real openat -> read -> close chain through slot 0, checked
+    ; end to end (its io_uring_enter counts in uring_enter_calls)
+    mov     qword [uring_test_request + REQ_PATH], uring_test_path
+    mov     qword [uring_test_request + REQ_BUF], uring_probe
+    mov     qword [uring_test_request + REQ_LEN], 1
+    mov     rdi, uring_test_request
+    mov     rsi, 1
+    mov     edx, URING_OP_READ
+    call    uring_batch
+    test    rax, rax
+    js      .fail
+    mov     rax, -ENOSYS
+    cmp     qword [uring_test_request + REQ_RESULT], 0
+    jne     .fail                   ; /dev/null reads 0 bytes
+
+    xor     eax, eax
+    jmp     .return
+
+.fail:
+    mov     rbx, rax                ; Save -errno
+    call    uring_exit
+    mov     rax, rbx
+
+.return:
+    pop     r12
+    pop     rbx
+    ret
+
+; ============================================================================
+; FUNCTION: uring_exit
+; Description: Unmap the rings and close the ring (and its file table)
+; Arguments: None
+; Returns: RAX = 0
+; ============================================================================
+uring_exit:
+    mov     rdi, [uring_sqes]
+    test    rdi, rdi
+    jz      .cq
+    mov     rax, SYS_MUNMAP
+    mov     rsi, [uring_sqes_size]
+    syscall
+
+.cq:
+    mov     rsi, [uring_cq_ring_size]
+    test    rsi, rsi
+    jz      .sq                     ; Shared with the SQ ring
+    mov     rax, SYS_MUNMAP
+    mov     rdi, [uring_cq_ring]
+    syscall
+
+.sq:
+    mov     rdi, [uring_sq_ring]
+    test    rdi, rdi
+    jz      .close
+    mov     rax, SYS_MUNMAP
+    mov     rsi, [uring_sq_ring_size]
+    syscall
+
+.close:
+    mov     rdi, [uring_fd]
+    test    rdi, rdi
+    js      .reset
+    mov     rax, SYS_CLOSE
+    syscall
+
+.reset:
+    xor     eax, eax
+    mov     qword [uring_fd], -1
+    mov     [uring_sq_ring], rax
+    mov     [uring_sq_ring_size], rax
+    mov     [uring_cq_ring], rax
+    mov     [uring_cq_ring_size], rax
+    mov     [uring_sqes], rax
+    mov     [uring_sqes_size], rax
+    ret
+
+; ============================================================================
+; FUNCTION: uring_read_files / uring_write_files / uring_file_sizes
+; Description: Batched versions of read_entire_file, write_entire_file and
+;              file_size from 07_file_io.asm
+; Arguments: RDI = struct uring_request array, RSI = count
+; Returns: RAX = 0, or negative errno if the ring itself failed;
+;          per-file outcomes are in each request's result field
+;
+; read:  openat(O_RDONLY), one read of up to len bytes at offset 0, close
+; write: openat(O_WRONLY|O_CREAT|O_TRUNC, 0644), one write of len bytes, close
+; sizes: statx(STATX_SIZE) - buf and len are ignored
+; ============================================================================
+uring_read_files:
+    mov     edx, URING_OP_READ
+    jmp     uring_batch
+
+uring_write_files:
+    mov     edx, URING_OP_WRITE
+    jmp     uring_batch
+
+uring_file_sizes:
+    mov     edx, URING_OP_STAT
+    jmp     uring_batch
+
+; ============================================================================
+; FUNCTION: uring_batch
+; Description: Queue up to URING_FILES chains, submit and wait with one
+;              io_uring_enter, record the results, repeat
+; Arguments: RDI = requests, RSI = count, EDX = URING_OP_*
+; Returns: RAX = 0, or negative errno; after an io_uring_enter error the
+;          ring has been torn down (uring_exit) and is set up again by the
+;          next call
+; ============================================================================
+uring_batch:
+    push    rbx
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+
+    mov     rbx, rdi                ; Requests
+    mov     r12, rsi                ; Count
+    mov     r13d, edx               ; Operation
+    xor     r14, r14                ; First request of the current batch
+
+    cmp     qword [uring_fd], 0
+    jge     .next_batch
+    call    uring_init
+    test    rax, rax
+    js      .return
+
+.next_batch:
+    cmp     r14, r12
+    jae     .success
+
+    mov     r15, r12
+    sub     r15, r14
+    cmp     r15, URING_FILES
+    jbe     .batch_sized
+    mov     r15, URING_FILES        ; Files in this batch
+.batch_sized:
+
+    ; ------------------------------------------------------------------------
+    ; Queue one chain per file. RCX = slot, RSI = request, R10 = user_data
+    ; ------------------------------------------------------------------------
+    mov     r8, [uring_sq_tail]
+    mov     r9d, [r8]               ; Private copy of the SQ tail
+    xor     ebp, ebp                ; SQEs queued
+    xor     ecx, ecx
+.queue:
+    lea     r10, [r14 + rcx]
+    mov     rsi, r10
+    shl     rsi, 5
+    add     rsi, rbx
+    shl     r10, 8
+    lea     r10, [r10 + rcx * 4]
+
+    cmp     r13d, URING_OP_STAT
+    je      .queue_statx
+
+    ; openat(AT_FDCWD, path, flags, 0644) into direct descriptor slot RCX
+    call    .get_sqe
+    mov     byte [rdi + SQE_OPCODE], IORING_OP_OPENAT
+    mov     byte [rdi + SQE_FLAGS], IOSQE_IO_LINK
+    mov     dword [rdi + SQE_FD], AT_FDCWD
+    mov     rax, [rsi + REQ_PATH]
+    mov     [rdi + SQE_ADDR], rax
+    mov     dword [rdi + SQE_LEN], 0644o
+    mov     dword [rdi + SQE_OP_FLAGS], O_RDONLY
+    cmp     r13d, URING_OP_WRITE
+    jne     .open_flags_set
+    mov     dword [rdi + SQE_OP_FLAGS], O_WRONLY | O_CREAT | O_TRUNC
+.open_flags_set:
+    lea     eax, [rcx + 1]
+    mov     [rdi + SQE_FILE_INDEX], eax
+    mov     [rdi + SQE_USER_DATA], r10  ; KIND_OPEN
+
+    ; read/write(slot, buf, len, offset 0); hardlinked so close always runs
+    call    .get_sqe
+    lea     eax, [r13 + IORING_OP_READ]
+    mov     [rdi + SQE_OPCODE], al
+    mov     byte [rdi + SQE_FLAGS], IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK
+    mov     [rdi + SQE_FD], ecx
+    mov     rax, [rsi + REQ_BUF]
+    mov     [rdi + SQE_ADDR], rax
+    mov     rax, [rsi + REQ_LEN]
+    mov     edx, MAX_RW_CHUNK
+    cmp     rax, rdx
+    cmova   rax, rdx
+    mov     [rdi + SQE_LEN], eax
+    lea     rax, [r10 + KIND_RW]
+    mov     [rdi + SQE_USER_DATA], rax
+
+    ; close(slot)
+    call    .get_sqe
+    mov     byte [rdi + SQE_OPCODE], IORING_OP_CLOSE
+    lea     eax, [rcx + 1]
+    mov     [rdi + SQE_FILE_INDEX], eax
+    lea     rax, [r10 + KIND_CLOSE]
+    mov     [rdi + SQE_USER_DATA], rax
+    jmp     .queued
+
+.queue_statx:
+    ; statx(AT_FDCWD, path, 0, STATX_SIZE, &uring_statx[slot])
+    call    .get_sqe
+    mov     byte [rdi + SQE_OPCODE], IORING_OP_STATX
+    mov     dword [rdi + SQE_FD], AT_FDCWD
+    mov     rax, [rsi + REQ_PATH]
+    mov     [rdi + SQE_ADDR], rax
+    mov     dword [rdi + SQE_LEN], STATX_SIZE
+    mov     rax, rcx
+    shl     rax, 8                  ; * STATX_BUF_SIZE
+    add     rax, uring_statx
+    mov     [rdi + SQE_OFF], rax
+    lea     rax, [r10 + KIND_STATX]
+    mov     [rdi + SQE_USER_DATA], rax
+
+.queued:
+    inc     ecx
+    cmp     rcx, r15
+    jb      .queue
+
+    ; Publish the new tail. x86 does not reorder stores, so the kernel
+    ; sees the SQE contents before it sees the tail move.
+    mov     [r8], r9d
+    add     r14, r15
+
+    ; ------------------------------------------------------------------------
+    ; Submit and wait. R15 = SQEs not yet accepted, RBP = CQEs outstanding
+    ; ------------------------------------------------------------------------
+    mov     r15, rbp
+.enter:
+    mov     rax, SYS_IO_URING_ENTER
+    mov     rdi, [uring_fd]
+    mov     rsi, r15                ; to_submit
+    mov     rdx, rbp                ; min_complete
+    mov     r10, IORING_ENTER_GETEVENTS
+    xor     r8, r8
+    xor     r9, r9
+    syscall
+    inc     qword [uring_enter_calls]
+
+    test    rax, rax
+    js      .enter_error
+    sub     r15, rax                ; Accepted SQEs leave the SQ ring
+    jmp     .reap
+
+.enter_error:
+    cmp     rax, -EINTR             ; Signal, or the kernel is short of
+    je      .reap                   ; memory/CQ space: reap and retry
+    cmp     rax, -EAGAIN
+    je      .reap
+    cmp     rax, -EBUSY
+    je      .reap
+
+    ; Anything else is fatal. The SQEs the kernel has not taken are still
+    ; in the SQ ring and chains it did take may still complete, so neither
+    ; the tail nor the CQ ring can be trusted by a later batch: drop the
+    ; ring and let the next call build a fresh one.
+    mov     r15, rax
+    call    uring_exit
+    mov     rax, r15
+    jmp     .return
+
+    ; ------------------------------------------------------------------------
+    ; Reap every completion that is ready
+    ; ------------------------------------------------------------------------
+.reap:
+    mov     r8, [uring_cq_head]
+    mov     r9, [uring_cq_tail]
+    mov     ecx, [r8]
+.reap_next:
+    cmp     ecx, [r9]               ; Kernel advances the tail
+    je      .reaped
+
+    mov     eax, ecx
+    and     eax, [uring_cq_mask]
+    shl     eax, 4                  ; * CQE_SIZE
+    add     rax, [uring_cqes]
+    mov     rdx, [rax + CQE_USER_DATA]
+    movsxd  r10, dword [rax + CQE_RES]
+    inc     ecx
+    dec     ebp
+
+    mov     rsi, rdx
+    shr     rsi, 8
+    shl     rsi, 5
+    add     rsi, rbx                ; Request
+    mov     eax, edx
+    and     eax, 3
+    cmp     eax, KIND_RW
+    je      .cqe_rw
+    cmp     eax, KIND_CLOSE
+    je      .cqe_close
+    cmp     eax, KIND_STATX
+    je      .cqe_statx
+
+    ; openat: only a failure is worth recording (the rest of the chain
+    ; then completes with -ECANCELED)
+    test    r10, r10
+    jns     .reap_next
+    jmp     .store
+
+.cqe_rw:
+    cmp     r10, -ECANCELED
+    je      .reap_next
+    jmp     .store
+
+.cqe_close:
+    test    r10, r10
+    jns     .reap_next
+    cmp     r10, -ECANCELED
+    je      .reap_next
+    cmp     qword [rsi + REQ_RESULT], 0
+    jl      .reap_next              ; Keep the earlier error
+    jmp     .store
+
+.cqe_statx:
+    test    r10, r10
+    js      .store
+    shr     edx, 2
+    and     edx, URING_FILES - 1    ; Slot
+    shl     edx, 8
+    mov     r10, [uring_statx + rdx + STX_SIZE]
+
+.store:
+    mov     [rsi + REQ_RESULT], r10
+    jmp     .reap_next
+
+.reaped:
+    mov     [r8], ecx               ; Hand the CQEs back to the kernel
+    test    ebp, ebp
+    jnz     .enter                  ; Still waiting (or submitting)
+    jmp     .next_batch
+
+.success:
+    xor     eax, eax
+
+.return:
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    pop     rbx
+    ret
+
+    ; Next free SQE, zeroed, in RDI (advances R9D and RBP)
+.get_sqe:
+    mov     eax, r9d
+    and     eax, [uring_sq_mask]
+    shl     eax, 6                  ; * SQE_SIZE
+    add     rax, [uring_sqes]
+    mov     rdi, rax
+    pxor    xmm0, xmm0
+    movdqa  [rdi], xmm0
+    movdqa  [rdi + 16], xmm0
+    movdqa  [rdi + 32], xmm0
+    movdqa  [rdi + 48], xmm0
+    inc     r9d
+    inc     ebp
+    ret
+
+; ============================================================================
+; NOTES: io_uring
+; ============================================================================
+;
+; System Calls:
+; ┌──────────────────┬──────────────────────────────────────────────────┐
+; │ io_uring_setup   │ rax=425, rdi=entries, rsi=struct io_uring_params*│
+; │ io_uring_enter   │ rax=426, rdi=fd, rsi=to_submit, rdx=min_complete,│
+; │                  │          r10=flags, r8=sigset*, r9=sigset size   │
+; │ io_uring_register│ rax=427, rdi=fd, rsi=opcode, rdx=arg, r10=nr_args│
+; └──────────────────┴──────────────────────────────────────────────────┘
+;
+; Shared Memory (mmap on the ring fd):
+;   offset 0           SQ ring: head, tail, mask, ..., u32 array[entries]
+;   offset 0x8000000   CQ ring: head, tail, mask, ..., cqes[cq_entries]
+;                      (same mapping as the SQ ring with FEAT_SINGLE_MMAP)
+;   offset 0x10000000  SQE array: entries x 64 bytes
+;
+;   We own the SQ tail and the CQ head; the kernel owns the SQ head and
+;   the CQ tail. On x86 plain loads and stores already have acquire and
+;   release ordering, so no fences are needed. ARM64 would need ldar/stlr.
+;
+; SQE (64 bytes) fields used here:
+;   +0 opcode  +1 flags  +4 fd  +8 off/addr2  +16 addr  +24 len
+;   +28 open_flags/rw_flags  +32 user_data  +44 file_index
+;
+; CQE (16 bytes): +0 user_data (copied from the SQE), +8 res (result or
+;   -errno), +12 flags. Completions may arrive in any order; user_data is
+;   how they are matched back to requests.
+;
+; Links:
+;   IOSQE_IO_LINK      - next SQE starts after this one; if this one fails
+;                        the rest of the chain completes with -ECANCELED
+;   IOSQE_IO_HARDLINK  - next SQE starts after this one, even if it failed
+;   A failed open cancels its read and close; a failed read still closes.
+;
+; Syscall Count for N files (N <= 64 per batch):
+;   07_file_io.asm:  3N syscalls (open, read, close each)
+;   this file:       1 io_uring_enter per 64 files
+;   The kernel still does the same work per file, but the user/kernel
+;   transitions (and the Spectre/Meltdown mitigation cost on each one)
+;   are gone, which dominates for small files.
+;
+; Limitations:
+;   - Each file gets a single read or write (up to len bytes). Size the
+;     buffers from uring_file_sizes first when reading whole files.
+;   - To copy files, run a read batch, set each write len to the read
+;     result, then run a write batch.
+;   - Direct-descriptor openat/close arrived in 5.15, but a fixed-file op
+;     linked after the openat only finds the new slot from 5.18
+;     (IORING_FEAT_LINKED_FILE). uring_init checks that flag, probes the
+;     opcodes and runs one test chain; on failure it returns -ENOSYS (or
+;     the -EINVAL of a kernel without the probe) and callers should fall
+;     back to the 07_file_io.asm routines.
+;   - An io_uring_enter error other than EINTR/EAGAIN/EBUSY ends the batch
+;     and tears the ring down; requests after the failing batch keep their
+;     old result fields. The next call starts over with a fresh ring.
+;
+; ============================================================================
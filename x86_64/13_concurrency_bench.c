@@ -0,0 +1,679 @@
+/*
+ * ============================================================================
+ * File: 13_concurrency_bench.c
+ * Description: Multi-threaded benchmarks for the lock-free code in 09
+ * Topics: SPSC/MPMC queues vs a mutex, throughput, round-trip latency,
+ *         spinlocks vs pthread locks under contention, sharded vs shared
+ *         counters, thread pinning, spin-then-yield waiting
+ * Compiler: GCC
+ * Build: gcc -O2 -pthread 13_concurrency_bench.c -o 13_concurrency_bench
+ * Usage: ./13_concurrency_bench [--quick] [--threads N]
+ * ============================================================================
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Pull in the primitives and queues from 09 without its demo main()
+#define INLINE_ASM_NO_MAIN
+#include "09_inline_asm_c.c"
+
+/*
+ * ============================================================================
+ * THREAD HELPERS
+ * ============================================================================
+ */
+
+static int num_cpus;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Pin the calling thread so the scheduler does not migrate it mid-run
+static void pin_thread(int index) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % num_cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Spin briefly with pause, then give the CPU away: with more threads than
+// cores a pure spin would burn the waiter's whole time slice
+static inline void backoff(unsigned *spins) {
+    if (++*spins < 64) {
+        cpu_relax();
+    } else {
+        sched_yield();
+        *spins = 0;
+    }
+}
+
+/*
+ * ============================================================================
+ * BASELINE: MUTEX-PROTECTED RING
+ * ============================================================================
+ */
+
+struct mutex_queue {
+    pthread_mutex_t lock;
+    void   **slots;
+    uint64_t head, tail, mask;
+};
+
+static int mutex_queue_init(struct mutex_queue *q, size_t capacity) {
+    pthread_mutex_init(&q->lock, NULL);
+    q->slots = calloc(capacity, sizeof(void *));
+    q->head = q->tail = 0;
+    q->mask = capacity - 1;
+    return q->slots ? 0 : -1;
+}
+
+static void mutex_queue_destroy(struct mutex_queue *q) {
+    pthread_mutex_destroy(&q->lock);
+    free(q->slots);
+}
+
+static int mutex_queue_push(struct mutex_queue *q, void *item) {
+    int ok = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail - q->head <= q->mask) {
+        q->slots[q->tail++ & q->mask] = item;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+static int mutex_queue_pop(struct mutex_queue *q, void **item) {
+    int ok = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->head != q->tail) {
+        *item = q->slots[q->head++ & q->mask];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+/*
+ * ============================================================================
+ * QUEUE TABLE
+ * ============================================================================
+ */
+
+struct queue_ops {
+    const char *name;
+    size_t size;                    // sizeof the queue object
+    int single_producer;            // SPSC: at most one thread per side
+    int  (*init)(void *q, size_t capacity);
+    void (*destroy)(void *q);
+    int  (*push)(void *q, void *item);
+    int  (*pop)(void *q, void **item);
+};
+
+#define OPS(name, type, single, prefix)                                     \
+    { name, sizeof(struct type), single,                                    \
+      (int (*)(void *, size_t))prefix##_init,                               \
+      (void (*)(void *))prefix##_destroy,                                   \
+      (int (*)(void *, void *))prefix##_push,                               \
+      (int (*)(void *, void **))prefix##_pop }
+
+static const struct queue_ops queues[] = {
+    OPS("spsc",  spsc_queue,  1, spsc),
+    OPS("mpmc",  mpmc_queue,  0, mpmc),
+    OPS("mutex", mutex_queue, 0, mutex_queue),
+};
+
+#define NUM_QUEUES (sizeof(queues) / sizeof(queues[0]))
+#define QUEUE_CAPACITY 1024
+#define STOP ((void *)UINTPTR_MAX)
+
+static void *queue_new(const struct queue_ops *ops) {
+    void *q = aligned_alloc(CACHE_LINE, (ops->size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1));
+    if (q && ops->init(q, QUEUE_CAPACITY) != 0) {
+        free(q);
+        q = NULL;
+    }
+    return q;
+}
+
+static void queue_free(const struct queue_ops *ops, void *q) {
+    ops->destroy(q);
+    free(q);
+}
+
+static void push_wait(const struct queue_ops *ops, void *q, void *item) {
+    unsigned spins = 0;
+    while (!ops->push(q, item))
+        backoff(&spins);
+}
+
+static void *pop_wait(const struct queue_ops *ops, void *q) {
+    unsigned spins = 0;
+    void *item;
+    while (!ops->pop(q, &item))
+        backoff(&spins);
+    return item;
+}
+
+/*
+ * ============================================================================
+ * THROUGHPUT
+ * ============================================================================
+ *
+ * P producers each push `items` values; C consumers pop until they see a
+ * STOP marker (one per consumer, pushed after every producer finished).
+ * Each value is unique and nonzero, so the sum of everything popped checks
+ * that nothing was lost or duplicated.
+ */
+
+struct throughput_run {
+    const struct queue_ops *ops;
+    void *q;
+    uint64_t items;
+    pthread_barrier_t start;
+};
+
+struct worker {
+    struct throughput_run *run;
+    int index;
+    uint64_t sum;
+    pthread_t thread;
+};
+
+static void *producer_main(void *arg) {
+    struct worker *w = arg;
+    struct throughput_run *r = w->run;
+    uint64_t base = (uint64_t)w->index << 40;
+
+    pin_thread(w->index);
+    pthread_barrier_wait(&r->start);
+    for (uint64_t i = 1; i <= r->items; i++)
+        push_wait(r->ops, r->q, (void *)(uintptr_t)(base + i));
+    return NULL;
+}
+
+static void *consumer_main(void *arg) {
+    struct worker *w = arg;
+    struct throughput_run *r = w->run;
+    uint64_t sum = 0;
+
+    pin_thread(w->index);
+    pthread_barrier_wait(&r->start);
+    for (;;) {
+        void *item = pop_wait(r->ops, r->q);
+        if (item == STOP)
+            break;
+        sum += (uint64_t)(uintptr_t)item;
+    }
+    w->sum = sum;
+    return NULL;
+}
+
+static void bench_throughput(const struct queue_ops *ops, int producers,
+                             int consumers, uint64_t items) {
+    struct throughput_run run = { .ops = ops, .items = items };
+    struct worker workers[16];
+    uint64_t expect = 0, got = 0;
+
+    run.q = queue_new(ops);
+    if (!run.q)
+        return;
+    pthread_barrier_init(&run.start, NULL, (unsigned)(producers + consumers + 1));
+
+    for (int i = 0; i < producers + consumers; i++) {
+        workers[i] = (struct worker){ .run = &run, .index = i };
+        pthread_create(&workers[i].thread, NULL,
+                       i < producers ? producer_main : consumer_main, &workers[i]);
+    }
+
+    pthread_barrier_wait(&run.start);
+    double t0 = now_seconds();
+    for (int i = 0; i < producers; i++)
+        pthread_join(workers[i].thread, NULL);
+    for (int i = 0; i < consumers; i++)
+        push_wait(ops, run.q, STOP);
+    for (int i = producers; i < producers + consumers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        got += workers[i].sum;
+    }
+    double seconds = now_seconds() - t0;
+
+    for (int p = 0; p < producers; p++)
+        expect += ((uint64_t)p << 40) * items + items * (items + 1) / 2;
+
+    double total = (double)items * producers;
+    printf("  %-6s %2d %2d  %9.2f  %8.1f   %s\n", ops->name, producers, consumers,
+           total / seconds * 1e-6, seconds * 1e9 / total,
+           got == expect ? "ok" : "MISMATCH");
+
+    pthread_barrier_destroy(&run.start);
+    queue_free(ops, run.q);
+}
+
+/*
+ * ============================================================================
+ * LATENCY
+ * ============================================================================
+ *
+ * Ping-pong: the main thread pushes a token into one queue and waits for
+ * the echo thread to push it back through a second queue. One round trip
+ * is two handoffs, so it measures how fast a stalled consumer notices new
+ * data - the cost of moving a cache line between cores and back.
+ */
+
+struct pingpong {
+    const struct queue_ops *ops;
+    void *to_echo, *from_echo;
+};
+
+static void *echo_main(void *arg) {
+    struct pingpong *pp = arg;
+
+    pin_thread(1);
+    for (;;) {
+        void *item = pop_wait(pp->ops, pp->to_echo);
+        push_wait(pp->ops, pp->from_echo, item);
+        if (item == STOP)
+            return NULL;
+    }
+}
+
+static int cmp_u64(const void *x, const void *y) {
+    uint64_t a = *(const uint64_t *)x, b = *(const uint64_t *)y;
+    return (a > b) - (a < b);
+}
+
+static void bench_latency(const struct queue_ops *ops, int rounds) {
+    struct pingpong pp = { .ops = ops };
+    uint64_t *ticks = malloc((size_t)rounds * sizeof(uint64_t));
+    pthread_t echo;
+
+    pp.to_echo = queue_new(ops);
+    pp.from_echo = queue_new(ops);
+    if (!ticks || !pp.to_echo || !pp.from_echo) {
+        if (pp.to_echo)
+            queue_free(ops, pp.to_echo);
+        if (pp.from_echo)
+            queue_free(ops, pp.from_echo);
+        free(ticks);
+        return;
+    }
+
+    pin_thread(0);
+    pthread_create(&echo, NULL, echo_main, &pp);
+
+    double t0 = now_seconds();
+    uint64_t c0 = rdtsc_begin();
+    for (int i = 0; i < rounds; i++) {
+        uint64_t start = rdtsc_begin();
+        push_wait(ops, pp.to_echo, (void *)(uintptr_t)(i + 1));
+        pop_wait(ops, pp.from_echo);
+        ticks[i] = rdtsc_end() - start;
+    }
+    uint64_t c1 = rdtsc_end();
+    double ns_per_tick = (now_seconds() - t0) * 1e9 / (double)(c1 - c0);
+
+    push_wait(ops, pp.to_echo, STOP);
+    pop_wait(ops, pp.from_echo);
+    pthread_join(echo, NULL);
+
+    // Drop the first 10% as warmup, then report the distribution
+    int skip = rounds / 10;
+    qsort(ticks + skip, (size_t)(rounds - skip), sizeof(uint64_t), cmp_u64);
+    int n = rounds - skip;
+    printf("  %-6s  %9.0f  %9.0f  %9.0f\n", ops->name,
+           (double)ticks[skip] * ns_per_tick,
+           (double)ticks[skip + n / 2] * ns_per_tick,
+           (double)ticks[skip + n * 99 / 100] * ns_per_tick);
+
+    queue_free(ops, pp.to_echo);
+    queue_free(ops, pp.from_echo);
+    free(ticks);
+}
+
+/*
+ * ============================================================================
+ * LOCK CONTENTION
+ * ============================================================================
+ *
+ * Every thread loops: take the lock, update a few shared cache lines (a
+ * short critical section), release, then do a little private work. Runs
+ * are time-based, so a lock that starves some threads cannot stretch the
+ * run; the min/max per-thread counts show how fair it was. The shared
+ * counter must equal the total acquisitions, which checks mutual
+ * exclusion.
+ */
+
+#define CS_LINES 4                  // Cache lines written inside the lock
+
+struct lock_ops {
+    const char *name;
+    size_t size;
+    void (*init)(void *lock);
+    void (*acquire)(void *lock, struct mcs_node *node);
+    void (*release)(void *lock, struct mcs_node *node);
+};
+
+static void pmutex_init(void *l) { pthread_mutex_init(l, NULL); }
+static void pmutex_acquire(void *l, struct mcs_node *n) { (void)n; pthread_mutex_lock(l); }
+static void pmutex_release(void *l, struct mcs_node *n) { (void)n; pthread_mutex_unlock(l); }
+static void pspin_init(void *l) { pthread_spin_init(l, PTHREAD_PROCESS_PRIVATE); }
+static void pspin_acquire(void *l, struct mcs_node *n) { (void)n; pthread_spin_lock(l); }
+static void pspin_release(void *l, struct mcs_node *n) { (void)n; pthread_spin_unlock(l); }
+static void tas_init(void *l) { tas_lock_init(l); }
+static void tas_acquire(void *l, struct mcs_node *n) { (void)n; tas_lock_acquire(l); }
+static void tas_release(void *l, struct mcs_node *n) { (void)n; tas_lock_release(l); }
+static void ticket_init(void *l) { ticket_lock_init(l); }
+static void ticket_acquire(void *l, struct mcs_node *n) { (void)n; ticket_lock_acquire(l); }
+static void ticket_release(void *l, struct mcs_node *n) { (void)n; ticket_lock_release(l); }
+static void mcs_init(void *l) { mcs_lock_init(l); }
+static void mcs_acquire(void *l, struct mcs_node *n) { mcs_lock_acquire(l, n); }
+static void mcs_release(void *l, struct mcs_node *n) { mcs_lock_release(l, n); }
+
+static const struct lock_ops locks[] = {
+    { "pthread_mutex", sizeof(pthread_mutex_t),    pmutex_init, pmutex_acquire, pmutex_release },
+    { "pthread_spin",  sizeof(pthread_spinlock_t), pspin_init,  pspin_acquire,  pspin_release },
+    { "tas",           sizeof(struct tas_lock),    tas_init,    tas_acquire,    tas_release },
+    { "ticket",        sizeof(struct ticket_lock), ticket_init, ticket_acquire, ticket_release },
+    { "mcs",           sizeof(struct mcs_lock),    mcs_init,    mcs_acquire,    mcs_release },
+};
+
+#define NUM_LOCKS (sizeof(locks) / sizeof(locks[0]))
+#define MAX_THREADS 64
+
+struct lock_run {
+    const struct lock_ops *ops;
+    void *lock;
+    uint64_t shared[CS_LINES][CACHE_LINE / sizeof(uint64_t)] __attribute__((aligned(CACHE_LINE)));
+    int stop __attribute__((aligned(CACHE_LINE)));
+    pthread_barrier_t start;
+};
+
+struct lock_worker {
+    struct lock_run *run;
+    int index;
+    uint64_t count;
+    pthread_t thread;
+} __attribute__((aligned(CACHE_LINE)));
+
+static void *lock_worker_main(void *arg) {
+    struct lock_worker *w = arg;
+    struct lock_run *r = w->run;
+    struct mcs_node node;
+    uint64_t count = 0;
+
+    pin_thread(w->index);
+    pthread_barrier_wait(&r->start);
+    while (!LOAD_SHARED(r->stop)) {
+        r->ops->acquire(r->lock, &node);
+        for (int i = 0; i < CS_LINES; i++)
+            r->shared[i][0]++;
+        r->ops->release(r->lock, &node);
+        count++;
+
+        // Private work between acquisitions: 32 steps of a volatile counter,
+        // each a load, add and store the compiler cannot fold away. At 2-6
+        // cycles a step (store forwarding) that is roughly 60-200 cycles
+        for (volatile int i = 0; i < 32; i++)
+            ;
+    }
+    w->count = count;
+    return NULL;
+}
+
+static void bench_lock(const struct lock_ops *ops, int threads, double seconds) {
+    static struct lock_worker workers[MAX_THREADS];
+    struct lock_run *run = aligned_alloc(CACHE_LINE, sizeof(*run));
+    uint64_t total = 0, lo = UINT64_MAX, hi = 0;
+
+    if (!run)
+        return;
+    memset(run, 0, sizeof(*run));
+    run->ops = ops;
+    run->lock = aligned_alloc(CACHE_LINE, (ops->size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1));
+    if (!run->lock) {
+        free(run);
+        return;
+    }
+    ops->init(run->lock);
+    pthread_barrier_init(&run->start, NULL, (unsigned)threads + 1);
+
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (struct lock_worker){ .run = run, .index = i };
+        pthread_create(&workers[i].thread, NULL, lock_worker_main, &workers[i]);
+    }
+    pthread_barrier_wait(&run->start);
+    double t0 = now_seconds();
+    struct timespec nap = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+    nanosleep(&nap, NULL);
+    STORE_SHARED(run->stop, 1);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        total += workers[i].count;
+        if (workers[i].count < lo) lo = workers[i].count;
+        if (workers[i].count > hi) hi = workers[i].count;
+    }
+    double elapsed = now_seconds() - t0;
+
+    int ok = 1;
+    for (int i = 0; i < CS_LINES; i++)
+        ok &= run->shared[i][0] == total;
+    printf("  %-14s %3d  %9.2f  %8.1f  %10.2f   %s\n", ops->name, threads,
+           (double)total / elapsed * 1e-6, elapsed * 1e9 / (double)total,
+           hi ? (double)lo / (double)hi : 0.0, ok ? "ok" : "BROKEN");
+
+    pthread_barrier_destroy(&run->start);
+    free(run->lock);
+    free(run);
+}
+
+/*
+ * ============================================================================
+ * COUNTER SCALING
+ * ============================================================================
+ *
+ * Every thread adds 1 to the same statistic `incs` times: once with
+ * atomic_increment on one shared word, once with a sharded counter. The
+ * final value must be threads * incs either way.
+ */
+
+struct counter_run {
+    int sharded;
+    uint64_t incs;
+    int64_t shared __attribute__((aligned(CACHE_LINE)));
+    struct sharded_counter counter;
+    pthread_barrier_t start;
+};
+
+struct counter_worker {
+    struct counter_run *run;
+    int index;
+    pthread_t thread;
+};
+
+static void *counter_worker_main(void *arg) {
+    struct counter_worker *w = arg;
+    struct counter_run *r = w->run;
+
+    pin_thread(w->index);
+    pthread_barrier_wait(&r->start);
+    if (r->sharded) {
+        for (uint64_t i = 0; i < r->incs; i++)
+            sharded_counter_add(&r->counter, 1);
+    } else {
+        for (uint64_t i = 0; i < r->incs; i++)
+            atomic_increment(&r->shared);
+    }
+    return NULL;
+}
+
+static void bench_counter(int sharded, int threads, uint64_t incs) {
+    struct counter_worker workers[MAX_THREADS];
+    struct counter_run *run = aligned_alloc(CACHE_LINE, sizeof(*run));
+
+    if (!run)
+        return;
+    memset(run, 0, sizeof(*run));
+    run->sharded = sharded;
+    run->incs = incs;
+    if (sharded && sharded_counter_init(&run->counter) != 0) {
+        free(run);
+        return;
+    }
+    pthread_barrier_init(&run->start, NULL, (unsigned)threads + 1);
+
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (struct counter_worker){ .run = run, .index = i };
+        pthread_create(&workers[i].thread, NULL, counter_worker_main, &workers[i]);
+    }
+    pthread_barrier_wait(&run->start);
+    double t0 = now_seconds();
+    for (int i = 0; i < threads; i++)
+        pthread_join(workers[i].thread, NULL);
+    double elapsed = now_seconds() - t0;
+
+    uint64_t total = (uint64_t)threads * incs;
+    uint64_t value = sharded ? sharded_counter_read(&run->counter) : (uint64_t)run->shared;
+    printf("  %-16s %3d  %9.2f  %8.2f   %s\n",
+           sharded ? "sharded_counter" : "atomic_increment", threads,
+           (double)total / elapsed * 1e-6, elapsed * 1e9 / (double)incs,
+           value == total ? "ok" : "WRONG");
+
+    pthread_barrier_destroy(&run->start);
+    if (sharded)
+        sharded_counter_destroy(&run->counter);
+    free(run);
+}
+
+// Thread counts to sweep: 1, 2, 4, ... and finally max itself
+static int next_thread_count(int t, int max) {
+    return t * 2 > max && t < max ? max : t * 2;
+}
+
+/*
+ * ============================================================================
+ * MAIN
+ * ============================================================================
+ */
+
+int main(int argc, char **argv) {
+    int quick = 0, max_threads = 0;
+    static const int configs[][2] = { {1, 1}, {2, 2}, {4, 4} };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--threads N]\n", argv[0]);
+            return 1;
+        }
+    }
+    uint64_t items = quick ? 200000 : 2000000;
+    int rounds = quick ? 20000 : 200000;
+    double lock_seconds = quick ? 0.05 : 0.5;
+    uint64_t counter_incs = quick ? 2000000 : 20000000;
+
+    num_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1)
+        num_cpus = 1;
+    // Default sweep: up to one thread per CPU, but always show contention
+    if (max_threads <= 0)
+        max_threads = num_cpus < 2 ? 2 : num_cpus;
+    if (max_threads > MAX_THREADS)
+        max_threads = MAX_THREADS;
+    printf("=== Concurrency benchmarks (%d CPUs%s) ===\n", num_cpus,
+           num_cpus < 2 ? ", threads time-share one core" : "");
+
+    printf("\nQueue throughput (capacity %d, %lu items per producer)\n",
+           QUEUE_CAPACITY, (unsigned long)items);
+    printf("  queue   P  C     Mops/s   ns/item   check\n");
+    for (size_t q = 0; q < NUM_QUEUES; q++) {
+        for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+            if (queues[q].single_producer && configs[c][0] > 1)
+                continue;
+            bench_throughput(&queues[q], configs[c][0], configs[c][1], items);
+        }
+    }
+
+    printf("\nQueue round-trip latency (%d ping-pongs, ns)\n", rounds);
+    printf("  queue         min     median        p99\n");
+    for (size_t q = 0; q < NUM_QUEUES; q++)
+        bench_latency(&queues[q], rounds);
+
+    printf("\nLock contention (%d-line critical section, %.2f s per point)\n",
+           CS_LINES, lock_seconds);
+    printf("  lock       threads  Macq/s    ns/acq   fairness   check\n");
+    for (size_t l = 0; l < NUM_LOCKS; l++) {
+        for (int t = 1; ; t = next_thread_count(t, max_threads)) {
+            bench_lock(&locks[l], t, lock_seconds);
+            if (t >= max_threads)
+                break;
+        }
+    }
+
+    printf("\nCounter scaling (%lu increments per thread, slot via %s)\n",
+           counter_incs, cpu_features.rdtscp ? "RDTSCP" : "getcpu");
+    printf("  counter          threads  Minc/s    ns/inc*   check\n");
+    for (int sharded = 0; sharded <= 1; sharded++) {
+        for (int t = 1; ; t = next_thread_count(t, max_threads)) {
+            bench_counter(sharded, t, counter_incs);
+            if (t >= max_threads)
+                break;
+        }
+    }
+    printf("  * wall time per increment of one thread\n");
+
+    return 0;
+}
+
+/*
+ * ============================================================================
+ * NOTES
+ * ============================================================================
+ *
+ * Reading the results:
+ *   - SPSC needs no locked instruction, so one producer/consumer pair is
+ *     limited only by cache-line transfers; batching (the cached indices)
+ *     lets each transfer carry many items.
+ *   - MPMC pays one lock cmpxchg per push and per pop, and the shared
+ *     enqueue/dequeue positions become hot lines as threads are added.
+ *   - The mutex queue serializes everything; under contention the lock
+ *     line bounces and futex sleeps/wakeups add microseconds.
+ *   - On a machine with fewer cores than threads every handoff waits for
+ *     a context switch, so latencies are scheduler-bound, not cache-bound.
+ *   - Locks: fairness is min/max acquisitions per thread (1.00 = equal).
+ *     TAS is fast but unfair (the releasing core often wins again, its
+ *     line is still hot); ticket and MCS are FIFO. Ticket throughput
+ *     drops as waiters grow because each release invalidates every
+ *     waiter's copy of the line; MCS touches only the next waiter.
+ *     pthread_mutex spins briefly, then sleeps in futex(): cheap when
+ *     uncontended, microseconds per handoff when contended.
+ *   - With more threads than cores, spinlocks collapse: a preempted
+ *     holder (or, for ticket/MCS, a preempted next-in-line waiter) stalls
+ *     everyone for a time slice. That is where a mutex wins.
+ *   - Counters: atomic_increment's total rate stays flat or drops as
+ *     threads are added (one line, one core at a time); the sharded
+ *     counter's rate grows with the number of cores, until threads
+ *     outnumber cores. On one core both are limited to that core's rate.
+ *
+ * Pitfalls:
+ *   - Put indices written by different threads on different cache lines.
+ *   - Never spin without pause, and never spin forever when threads can
+ *     outnumber cores - yield after a bounded number of tries.
+ *   - Pin threads when comparing runs; migrations add noise.
+ *
+ * ============================================================================
+ */
@@ -0,0 +1,1674 @@
+; ============================================================================
+; File: 14_blas1.asm
+; Description: BLAS level-1 kernels (axpy, scal, copy, asum, nrm2, iamax)
+;              for float and double, with SSE2 and AVX2/FMA code paths
+; Topics: Runtime dispatch, alignment peeling, VMASKMOV tails, FMA,
+;         overflow-safe norms, vector argmax
+; Assembler: NASM
+; Build: nasm -f elf64 14_blas1.asm && ld -o 14_blas1 14_blas1.o
+; Run: ./14_blas1   (checks every kernel against exact results)
+; Library: nasm -f elf64 -DLIBRARY 14_blas1.asm -o 14_lib.o
+;          (C interface: 14_blas1.h)
+; ============================================================================
+;
+; scalar_multiply_simd in 08_simd_sse.asm shows the idea: broadcast a
+; scalar, multiply 4 floats per instruction. Production kernels also have
+; to handle any length, any alignment and both precisions. This file does
+; that for the BLAS-1 operations (unit stride):
+;
+;   axpy   y[i] += alpha * x[i]
+;   scal   x[i] *= alpha
+;   copy   y[i]  = x[i]
+;   asum   sum |x[i]|
+;   nrm2   sqrt(sum x[i]^2), without overflow or underflow
+;   iamax  index of the first largest |x[i]| (0-based)
+;
+; Every operation exists as blas_<s|d><op>_sse and blas_<s|d><op>_avx2.
+; The plain names (blas_saxpy, ...) jump through blas1_dispatch, which
+; starts out pointing at the SSE2 versions (always present on x86-64);
+; blas1_init switches it to AVX2/FMA when the CPU and OS support it.
+;
+; Arguments follow the System V ABI:
+;   RDI = n (elements), XMM0 = alpha, RSI = x, RDX = y
+;   Results: XMM0 (asum, nrm2), RAX (iamax; 0 when n = 0)
+;
+; Loop structure (the AVX2 versions):
+;   head - elements up to the first 32-byte boundary of the array that is
+;          written (x for reductions), done as one VMASKMOV step
+;   main - 128 bytes per iteration, aligned stores
+;   step - 32 bytes at a time
+;   tail - the last 0-31 bytes, one more VMASKMOV step
+; The SSE2 versions peel and finish with scalar loops instead: SSE has no
+; masked load/store that is usable here (MASKMOVDQU is a non-temporal
+; byte store).
+;
+; ============================================================================
+
+%ifdef LIBRARY
+    global blas1_init
+    global blas_saxpy, blas_sscal, blas_scopy, blas_sasum, blas_snrm2, blas_isamax
+    global blas_daxpy, blas_dscal, blas_dcopy, blas_dasum, blas_dnrm2, blas_idamax
+    global blas_saxpy_sse, blas_sscal_sse, blas_scopy_sse
+    global blas_sasum_sse, blas_snrm2_sse, blas_isamax_sse
+    global blas_daxpy_sse, blas_dscal_sse, blas_dcopy_sse
+    global blas_dasum_sse, blas_dnrm2_sse, blas_idamax_sse
+    global blas_saxpy_avx2, blas_sscal_avx2, blas_scopy_avx2
+    global blas_sasum_avx2, blas_snrm2_avx2, blas_isamax_avx2
+    global blas_daxpy_avx2, blas_dscal_avx2, blas_dcopy_avx2
+    global blas_dasum_avx2, blas_dnrm2_avx2, blas_idamax_avx2
+%else
+global _start
+%endif
+
+BLAS1_SLOTS     equ 12              ; Entry points per table
+VERIFY_MAX_N    equ 70              ; Lengths 0..VERIFY_MAX_N are checked
+VERIFY_GUARD    equ 12345           ; Value after the last element of y
+
+section .data
+    ; Entry points in slot order: s axpy, scal, copy, asum, nrm2, iamax,
+    ; then the same for d
+    blas1_dispatch:
+                    dq blas_saxpy_sse, blas_sscal_sse, blas_scopy_sse
+                    dq blas_sasum_sse, blas_snrm2_sse, blas_isamax_sse
+                    dq blas_daxpy_sse, blas_dscal_sse, blas_dcopy_sse
+                    dq blas_dasum_sse, blas_dnrm2_sse, blas_idamax_sse
+    blas1_sse_table:
+                    dq blas_saxpy_sse, blas_sscal_sse, blas_scopy_sse
+                    dq blas_sasum_sse, blas_snrm2_sse, blas_isamax_sse
+                    dq blas_daxpy_sse, blas_dscal_sse, blas_dcopy_sse
+                    dq blas_dasum_sse, blas_dnrm2_sse, blas_idamax_sse
+    blas1_avx2_table:
+                    dq blas_saxpy_avx2, blas_sscal_avx2, blas_scopy_avx2
+                    dq blas_sasum_avx2, blas_snrm2_avx2, blas_isamax_avx2
+                    dq blas_daxpy_avx2, blas_dscal_avx2, blas_dcopy_avx2
+                    dq blas_dasum_avx2, blas_dnrm2_avx2, blas_idamax_avx2
+
+    align 32
+    ; Sliding window: a 32-byte load from [blas_mask + 32 - k] enables the
+    ; first k bytes (k = 0..32) for VMASKMOVPS/PD
+    blas_mask:      times 8 dd -1
+                    times 8 dd 0
+    blas_abs_ps:    times 8 dd 0x7FFFFFFF
+    blas_abs_pd:    times 4 dq 0x7FFFFFFFFFFFFFFF
+    blas_lane_d:    dd 0, 1, 2, 3, 4, 5, 6, 7   ; Starting indices for iamax
+    blas_lane_q:    dq 0, 1, 2, 3
+    blas_neg_one_s: dd -1.0
+    blas_neg_one_d: dq -1.0
+
+    msg_sse_ok:     db "SSE2 BLAS-1 kernels match the exact results", 0x0a
+    msg_sse_ok_len: equ $ - msg_sse_ok
+    msg_sse_bad:    db "SSE2 BLAS-1 kernels MISMATCH", 0x0a
+    msg_sse_bad_len: equ $ - msg_sse_bad
+    msg_avx_ok:     db "AVX2/FMA BLAS-1 kernels match the exact results", 0x0a
+    msg_avx_ok_len: equ $ - msg_avx_ok
+    msg_avx_bad:    db "AVX2/FMA BLAS-1 kernels MISMATCH", 0x0a
+    msg_avx_bad_len: equ $ - msg_avx_bad
+    msg_no_avx:     db "AVX2/FMA not available: only the SSE2 kernels were checked", 0x0a
+    msg_no_avx_len: equ $ - msg_no_avx
+
+section .bss
+    alignb 64
+    verify_x:       resq VERIFY_MAX_N + 8
+    verify_y:       resq VERIFY_MAX_N + 8
+
+section .text
+
+; ============================================================================
+; SHARED PIECES
+; ============================================================================
+
+; BLAS_HEAD ptr, alignment, element bytes
+; RAX = bytes to process before ptr reaches the alignment, at most RDI.
+; 0 if ptr is not a multiple of the element size (it can never be aligned).
+; Clobbers RCX.
+%macro BLAS_HEAD 3
+    mov     rax, %1
+    neg     rax
+    and     eax, %2 - 1             ; Bytes to the next boundary
+    xor     ecx, ecx
+    test    eax, %3 - 1
+    cmovnz  eax, ecx                ; Not element-aligned: no head
+    cmp     rax, rdi
+    cmova   rax, rdi
+%endmacro
+
+; BLAS_MASK reg, bytes: YMM reg enables the first `bytes` bytes (0-32).
+; Clobbers RCX.
+%macro BLAS_MASK 2
+    lea     rcx, [blas_mask + 32]
+    sub     rcx, %2
+    vmovdqu %1, [rcx]
+%endmacro
+
+; Macro arguments shared by all kernel macros below:
+;   %1 = s/d (BLAS prefix), %2 = ps/pd, %3 = ss/sd, %4 = element bytes,
+;   %5 = log2(element bytes), %6 = d/q (integer lanes of the same width)
+
+; ============================================================================
+; AVX2/FMA KERNELS
+; ============================================================================
+
+; ----------------------------------------------------------------------------
+; axpy: y[i] += alpha * x[i]
+; RDI = n, XMM0 = alpha, RSI = x, RDX = y
+; ----------------------------------------------------------------------------
+%macro AXPY_AVX2 6
+blas_%1axpy_avx2:
+    shl     rdi, %5                 ; RDI = bytes left
+    jz      .done
+    vbroadcast%3 ymm0, xmm0         ; YMM0 = alpha in every lane
+
+    BLAS_HEAD rdx, 32, %4           ; Align the stores to y
+    test    rax, rax
+    jz      .main
+    BLAS_MASK ymm5, rax
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmaskmov%2 ymm2, ymm5, [rdx]
+    vfmadd231%2 ymm2, ymm0, ymm1    ; y + alpha * x
+    vmaskmov%2 [rdx], ymm5, ymm2
+    add     rsi, rax
+    add     rdx, rax
+    sub     rdi, rax
+
+.main:
+    cmp     rdi, 128
+    jb      .step
+.loop:
+    vmovu%2 ymm1, [rsi]
+    vmovu%2 ymm2, [rsi + 32]
+    vmovu%2 ymm3, [rsi + 64]
+    vmovu%2 ymm4, [rsi + 96]
+    vfmadd213%2 ymm1, ymm0, [rdx]   ; alpha * x + y
+    vfmadd213%2 ymm2, ymm0, [rdx + 32]
+    vfmadd213%2 ymm3, ymm0, [rdx + 64]
+    vfmadd213%2 ymm4, ymm0, [rdx + 96]
+    vmovu%2 [rdx], ymm1
+    vmovu%2 [rdx + 32], ymm2
+    vmovu%2 [rdx + 64], ymm3
+    vmovu%2 [rdx + 96], ymm4
+    add     rsi, 128
+    add     rdx, 128
+    sub     rdi, 128
+    cmp     rdi, 128
+    jae     .loop
+
+.step:
+    cmp     rdi, 32
+    jb      .tail
+    vmovu%2 ymm1, [rsi]
+    vfmadd213%2 ymm1, ymm0, [rdx]
+    vmovu%2 [rdx], ymm1
+    add     rsi, 32
+    add     rdx, 32
+    sub     rdi, 32
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    BLAS_MASK ymm5, rdi
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmaskmov%2 ymm2, ymm5, [rdx]
+    vfmadd231%2 ymm2, ymm0, ymm1
+    vmaskmov%2 [rdx], ymm5, ymm2
+
+.done:
+    vzeroupper
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; scal: x[i] *= alpha
+; RDI = n, XMM0 = alpha, RSI = x
+; ----------------------------------------------------------------------------
+%macro SCAL_AVX2 6
+blas_%1scal_avx2:
+    shl     rdi, %5
+    jz      .done
+    vbroadcast%3 ymm0, xmm0
+
+    BLAS_HEAD rsi, 32, %4
+    test    rax, rax
+    jz      .main
+    BLAS_MASK ymm5, rax
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmul%2  ymm1, ymm1, ymm0
+    vmaskmov%2 [rsi], ymm5, ymm1
+    add     rsi, rax
+    sub     rdi, rax
+
+.main:
+    cmp     rdi, 128
+    jb      .step
+.loop:
+    vmul%2  ymm1, ymm0, [rsi]
+    vmul%2  ymm2, ymm0, [rsi + 32]
+    vmul%2  ymm3, ymm0, [rsi + 64]
+    vmul%2  ymm4, ymm0, [rsi + 96]
+    vmovu%2 [rsi], ymm1
+    vmovu%2 [rsi + 32], ymm2
+    vmovu%2 [rsi + 64], ymm3
+    vmovu%2 [rsi + 96], ymm4
+    add     rsi, 128
+    sub     rdi, 128
+    cmp     rdi, 128
+    jae     .loop
+
+.step:
+    cmp     rdi, 32
+    jb      .tail
+    vmul%2  ymm1, ymm0, [rsi]
+    vmovu%2 [rsi], ymm1
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    BLAS_MASK ymm5, rdi
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmul%2  ymm1, ymm1, ymm0
+    vmaskmov%2 [rsi], ymm5, ymm1
+
+.done:
+    vzeroupper
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; copy: y[i] = x[i]
+; RDI = n, RSI = x, RDX = y
+; ----------------------------------------------------------------------------
+%macro COPY_AVX2 6
+blas_%1copy_avx2:
+    shl     rdi, %5
+    jz      .done
+
+    BLAS_HEAD rdx, 32, %4
+    test    rax, rax
+    jz      .main
+    BLAS_MASK ymm5, rax
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmaskmov%2 [rdx], ymm5, ymm1
+    add     rsi, rax
+    add     rdx, rax
+    sub     rdi, rax
+
+.main:
+    cmp     rdi, 128
+    jb      .step
+.loop:
+    vmovu%2 ymm1, [rsi]
+    vmovu%2 ymm2, [rsi + 32]
+    vmovu%2 ymm3, [rsi + 64]
+    vmovu%2 ymm4, [rsi + 96]
+    vmovu%2 [rdx], ymm1
+    vmovu%2 [rdx + 32], ymm2
+    vmovu%2 [rdx + 64], ymm3
+    vmovu%2 [rdx + 96], ymm4
+    add     rsi, 128
+    add     rdx, 128
+    sub     rdi, 128
+    cmp     rdi, 128
+    jae     .loop
+
+.step:
+    cmp     rdi, 32
+    jb      .tail
+    vmovu%2 ymm1, [rsi]
+    vmovu%2 [rdx], ymm1
+    add     rsi, 32
+    add     rdx, 32
+    sub     rdi, 32
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    BLAS_MASK ymm5, rdi
+    vmaskmov%2 ymm1, ymm5, [rsi]
+    vmaskmov%2 [rdx], ymm5, ymm1
+
+.done:
+    vzeroupper
+    ret
+%endmacro
+
+; HSUM_AVX2 ps|pd: XMM0 = sum of the lanes of YMM1 (clobbers YMM1, XMM2)
+%macro HSUM_AVX2 1
+    vextractf128 xmm2, ymm1, 1
+    vadd%1  xmm1, xmm1, xmm2
+    vunpckhpd xmm2, xmm1, xmm1      ; High 8 bytes
+    vadd%1  xmm1, xmm1, xmm2
+%ifidn %1, ps
+    vmovshdup xmm2, xmm1            ; Lane 1
+    vaddss  xmm1, xmm1, xmm2
+%endif
+    vmovaps xmm0, xmm1
+%endmacro
+
+; ----------------------------------------------------------------------------
+; asum: sum |x[i]|
+; RDI = n, RSI = x. Returns XMM0.
+; ----------------------------------------------------------------------------
+%macro ASUM_AVX2 6
+blas_%1asum_avx2:
+    vxorps  xmm1, xmm1, xmm1        ; Four accumulators
+    vxorps  xmm2, xmm2, xmm2
+    vxorps  xmm3, xmm3, xmm3
+    vxorps  xmm4, xmm4, xmm4
+    vmovu%2 ymm6, [blas_abs_%2]     ; Clears the sign bits
+    shl     rdi, %5
+    jz      .reduce
+
+    BLAS_HEAD rsi, 32, %4           ; Masked-off lanes load as 0
+    test    rax, rax
+    jz      .main
+    BLAS_MASK ymm5, rax
+    vmaskmov%2 ymm7, ymm5, [rsi]
+    vand%2  ymm1, ymm7, ymm6
+    add     rsi, rax
+    sub     rdi, rax
+
+.main:
+    cmp     rdi, 128
+    jb      .step
+.loop:
+    vand%2  ymm7, ymm6, [rsi]
+    vand%2  ymm8, ymm6, [rsi + 32]
+    vand%2  ymm9, ymm6, [rsi + 64]
+    vand%2  ymm10, ymm6, [rsi + 96]
+    vadd%2  ymm1, ymm1, ymm7
+    vadd%2  ymm2, ymm2, ymm8
+    vadd%2  ymm3, ymm3, ymm9
+    vadd%2  ymm4, ymm4, ymm10
+    add     rsi, 128
+    sub     rdi, 128
+    cmp     rdi, 128
+    jae     .loop
+
+.step:
+    cmp     rdi, 32
+    jb      .tail
+    vand%2  ymm7, ymm6, [rsi]
+    vadd%2  ymm1, ymm1, ymm7
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .reduce
+    BLAS_MASK ymm5, rdi
+    vmaskmov%2 ymm7, ymm5, [rsi]
+    vand%2  ymm7, ymm7, ymm6
+    vadd%2  ymm1, ymm1, ymm7
+
+.reduce:
+    vadd%2  ymm1, ymm1, ymm2
+    vadd%2  ymm3, ymm3, ymm4
+    vadd%2  ymm1, ymm1, ymm3
+    HSUM_AVX2 %2
+    vzeroupper
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; iamax: index of the first largest |x[i]|
+; RDI = n, RSI = x. Returns RAX (0 when n = 0).
+;
+; Each lane keeps its best |x| and that element's index; a lane is updated
+; only when |x| is strictly greater, and the ordered compare never lets a
+; NaN win. Lanes past the end of the tail are forced to -1 so they can
+; never win either. The compare + blend chain limits one set of lanes to
+; a vector every ~6 cycles, so the main loop keeps two independent sets
+; and merges them at the end. The lanes are then scanned in scalar code:
+; the largest value wins, ties go to the smaller index. isamax keeps
+; 32-bit indices, so n must be below 2^31 (the LP64 BLAS limit).
+; ----------------------------------------------------------------------------
+%macro IAMAX_AVX2 6
+blas_i%1amax_avx2:
+    xor     eax, eax
+    shl     rdi, %5
+    jz      .ret
+
+    vmovu%2 ymm6, [blas_abs_%2]
+    vbroadcast%3 ymm8, [blas_neg_one_%1]
+    vmova%2 ymm1, ymm8              ; YMM1 = best |x| per lane
+    vpxor   xmm2, xmm2, xmm2        ; YMM2 = index of the best per lane
+    vmovdqu ymm3, [blas_lane_%6]    ; YMM3 = indices of the current lanes
+    mov     eax, 32 / %4
+    vmovd   xmm4, eax
+    vpbroadcast%6 ymm4, xmm4        ; YMM4 = lanes per vector
+    vmova%2 ymm9, ymm8              ; Second set: YMM9 = best, YMM10 = index,
+    vpxor   xmm10, xmm10, xmm10     ; YMM11 = indices of its lanes
+    vpadd%6 ymm11, ymm3, ymm4
+    vpadd%6 ymm12, ymm4, ymm4       ; YMM12 = lanes per pair of vectors
+
+.pair:
+    cmp     rdi, 64
+    jb      .loop
+    vand%2  ymm0, ymm6, [rsi]
+    vand%2  ymm13, ymm6, [rsi + 32]
+    vcmp%2  ymm5, ymm0, ymm1, 0x1E
+    vcmp%2  ymm14, ymm13, ymm9, 0x1E
+    vblendv%2 ymm1, ymm1, ymm0, ymm5
+    vblendv%2 ymm9, ymm9, ymm13, ymm14
+    vpblendvb ymm2, ymm2, ymm3, ymm5
+    vpblendvb ymm10, ymm10, ymm11, ymm14
+    vpadd%6 ymm3, ymm3, ymm12
+    vpadd%6 ymm11, ymm11, ymm12
+    add     rsi, 64
+    sub     rdi, 64
+    jmp     .pair
+
+.loop:
+    cmp     rdi, 32
+    jb      .tail
+    vand%2  ymm0, ymm6, [rsi]
+.update:
+    vcmp%2  ymm5, ymm0, ymm1, 0x1E  ; |x| > best (GT_OQ: false for NaN)
+    vblendv%2 ymm1, ymm1, ymm0, ymm5
+    vpblendvb ymm2, ymm2, ymm3, ymm5
+    vpadd%6 ymm3, ymm3, ymm4
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .loop
+
+.tail:
+    test    rdi, rdi
+    jz      .scan
+    BLAS_MASK ymm7, rdi
+    vmaskmov%2 ymm0, ymm7, [rsi]
+    vand%2  ymm0, ymm0, ymm6
+    vblendv%2 ymm0, ymm8, ymm0, ymm7 ; Lanes past the end = -1
+    mov     edi, 32                 ; One last pass through .update
+    jmp     .update
+
+.scan:
+    ; Merge the second set: take its lane if larger, or equal with a
+    ; smaller index
+    vcmp%2  ymm5, ymm9, ymm1, 0x1E
+    vcmp%2  ymm13, ymm9, ymm1, 0x00 ; EQ_OQ
+    vpcmpgt%6 ymm14, ymm2, ymm10
+    vpand   ymm13, ymm13, ymm14
+    vpor    ymm5, ymm5, ymm13
+    vblendv%2 ymm1, ymm1, ymm9, ymm5
+    vpblendvb ymm2, ymm2, ymm10, ymm5
+
+    sub     rsp, 64
+    vmovu%2 [rsp], ymm1
+    vmovdqu [rsp + 32], ymm2
+    IAMAX_SCAN 32, %3, %4
+    add     rsp, 64
+    vzeroupper
+.ret:
+    ret
+%endmacro
+
+; IAMAX_SCAN vector bytes, ss|sd, element bytes
+; Pick the best lane from [rsp] (values) and [rsp + vector bytes]
+; (indices, same width as the values). Returns XMM0 = value, RAX = index.
+%macro IAMAX_SCAN 3
+    mov%2   xmm0, [rsp]
+%if %3 == 4
+    mov     eax, [rsp + %1]
+%else
+    mov     rax, [rsp + %1]
+%endif
+    mov     ecx, %3                 ; Byte offset of lane 1
+%%scan:
+    mov%2   xmm1, [rsp + rcx]
+%if %3 == 4
+    mov     r8d, [rsp + rcx + %1]
+%else
+    mov     r8, [rsp + rcx + %1]
+%endif
+    ucomi%2 xmm1, xmm0
+    jb      %%next                  ; Smaller (lanes never hold NaN)
+    ja      %%take
+    cmp     r8, rax                 ; Equal: keep the smaller index
+    jae     %%next
+%%take:
+    movaps  xmm0, xmm1
+    mov     rax, r8
+%%next:
+    add     ecx, %3
+    cmp     ecx, %1
+    jb      %%scan
+%endmacro
+
+; ----------------------------------------------------------------------------
+; snrm2: sqrt(sum x[i]^2) for floats
+; RDI = n, RSI = x. Returns XMM0.
+;
+; The squares are summed in double precision: the square of any float fits
+; a double with room to spare (FLT_MAX^2 ~ 1e77), so nothing overflows or
+; underflows, one pass is enough, and the sum is more accurate than a float
+; sum. The loads need no alignment, so there is no head.
+; ----------------------------------------------------------------------------
+blas_snrm2_avx2:
+    vxorpd  xmm1, xmm1, xmm1
+    vxorpd  xmm2, xmm2, xmm2
+    vxorpd  xmm3, xmm3, xmm3
+    vxorpd  xmm4, xmm4, xmm4
+    shl     rdi, 2
+    jz      .reduce
+
+    cmp     rdi, 64
+    jb      .step
+.loop:
+    vcvtps2pd ymm5, [rsi]           ; 4 floats -> 4 doubles
+    vcvtps2pd ymm6, [rsi + 16]
+    vcvtps2pd ymm7, [rsi + 32]
+    vcvtps2pd ymm8, [rsi + 48]
+    vfmadd231pd ymm1, ymm5, ymm5
+    vfmadd231pd ymm2, ymm6, ymm6
+    vfmadd231pd ymm3, ymm7, ymm7
+    vfmadd231pd ymm4, ymm8, ymm8
+    add     rsi, 64
+    sub     rdi, 64
+    cmp     rdi, 64
+    jae     .loop
+
+.step:
+    cmp     rdi, 16
+    jb      .tail
+    vcvtps2pd ymm5, [rsi]
+    vfmadd231pd ymm1, ymm5, ymm5
+    add     rsi, 16
+    sub     rdi, 16
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .reduce
+    BLAS_MASK ymm9, rdi             ; 1-3 floats
+    vmaskmovps xmm5, xmm9, [rsi]
+    vcvtps2pd ymm5, xmm5
+    vfmadd231pd ymm1, ymm5, ymm5
+
+.reduce:
+    vaddpd  ymm1, ymm1, ymm2
+    vaddpd  ymm3, ymm3, ymm4
+    vaddpd  ymm1, ymm1, ymm3
+    HSUM_AVX2 pd
+    vsqrtsd xmm0, xmm0, xmm0
+    vcvtsd2ss xmm0, xmm0, xmm0
+    vzeroupper
+    ret
+
+; ----------------------------------------------------------------------------
+; dnrm2: sqrt(sum x[i]^2) for doubles
+; RDI = n, RSI = x. Returns XMM0.
+;
+; Squaring a double overflows above ~1e154 and underflows below ~1e-162,
+; and there is no wider type to sum in. Two passes instead:
+;   1. m = max |x[i]|
+;   2. s = a power of two with m * s in [2, 4), sum (x[i] * s)^2,
+;      result = sqrt(sum) / s
+; Multiplying by a power of two is exact, so the scaling adds no rounding
+; error, and the scaled squares are at most 16 each. Infinities and NaNs
+; reach the sum in pass 2 and come out as inf / NaN.
+; ----------------------------------------------------------------------------
+blas_dnrm2_avx2:
+    vxorpd  xmm0, xmm0, xmm0
+    shl     rdi, 3
+    jz      .ret
+    mov     r8, rsi                 ; Start and length again for pass 2
+    mov     r9, rdi
+
+    ; --- pass 1: largest |x| (masked-off lanes load as 0) ---
+    vmovupd ymm6, [blas_abs_pd]
+    vxorpd  xmm1, xmm1, xmm1
+    vxorpd  xmm2, xmm2, xmm2
+.max_loop:
+    cmp     rdi, 64
+    jb      .max_tail
+    vandpd  ymm7, ymm6, [rsi]
+    vandpd  ymm8, ymm6, [rsi + 32]
+    vmaxpd  ymm1, ymm1, ymm7
+    vmaxpd  ymm2, ymm2, ymm8
+    add     rsi, 64
+    sub     rdi, 64
+    jmp     .max_loop
+.max_tail:
+    cmp     rdi, 32
+    jb      .max_last
+    vandpd  ymm7, ymm6, [rsi]
+    vmaxpd  ymm1, ymm1, ymm7
+    add     rsi, 32
+    sub     rdi, 32
+.max_last:
+    test    rdi, rdi
+    jz      .max_reduce
+    BLAS_MASK ymm5, rdi
+    vmaskmovpd ymm7, ymm5, [rsi]
+    vandpd  ymm7, ymm7, ymm6
+    vmaxpd  ymm2, ymm2, ymm7
+.max_reduce:
+    vmaxpd  ymm1, ymm1, ymm2
+    vextractf128 xmm2, ymm1, 1
+    vmaxpd  xmm1, xmm1, xmm2
+    vunpckhpd xmm2, xmm1, xmm1
+    vmaxsd  xmm1, xmm1, xmm2        ; XMM1 = m
+
+    ; --- scale: s = 2^(1 - exponent(m)), biased exponent 2047 - e ---
+    vmovq   rax, xmm1
+    shr     rax, 52                 ; Biased exponent e (sign is clear)
+    mov     ecx, 2047
+    sub     ecx, eax
+    mov     eax, 1                  ; m = inf/NaN: any normal scale will do
+    cmp     ecx, eax
+    cmovl   ecx, eax
+    mov     eax, 2046               ; m subnormal or 0: largest scale
+    cmp     ecx, eax
+    cmovg   ecx, eax
+    shl     rcx, 52
+    vmovq   xmm5, rcx
+    vbroadcastsd ymm5, xmm5         ; YMM5 = s
+
+    ; --- pass 2: sum (x * s)^2 ---
+    mov     rsi, r8
+    mov     rdi, r9
+    vxorpd  xmm1, xmm1, xmm1
+    vxorpd  xmm2, xmm2, xmm2
+    vxorpd  xmm3, xmm3, xmm3
+    vxorpd  xmm4, xmm4, xmm4
+.sum_loop:
+    cmp     rdi, 128
+    jb      .sum_step
+    vmulpd  ymm7, ymm5, [rsi]
+    vmulpd  ymm8, ymm5, [rsi + 32]
+    vmulpd  ymm9, ymm5, [rsi + 64]
+    vmulpd  ymm10, ymm5, [rsi + 96]
+    vfmadd231pd ymm1, ymm7, ymm7
+    vfmadd231pd ymm2, ymm8, ymm8
+    vfmadd231pd ymm3, ymm9, ymm9
+    vfmadd231pd ymm4, ymm10, ymm10
+    add     rsi, 128
+    sub     rdi, 128
+    jmp     .sum_loop
+.sum_step:
+    cmp     rdi, 32
+    jb      .sum_tail
+    vmulpd  ymm7, ymm5, [rsi]
+    vfmadd231pd ymm1, ymm7, ymm7
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .sum_step
+.sum_tail:
+    test    rdi, rdi
+    jz      .sum_reduce
+    BLAS_MASK ymm6, rdi
+    vmaskmovpd ymm7, ymm6, [rsi]
+    vmulpd  ymm7, ymm7, ymm5
+    vfmadd231pd ymm1, ymm7, ymm7
+.sum_reduce:
+    vaddpd  ymm1, ymm1, ymm2
+    vaddpd  ymm3, ymm3, ymm4
+    vaddpd  ymm1, ymm1, ymm3
+    HSUM_AVX2 pd
+    vsqrtsd xmm0, xmm0, xmm0
+    vdivsd  xmm0, xmm0, xmm5        ; Exact: s is a power of two
+    vzeroupper
+.ret:
+    ret
+
+AXPY_AVX2  s, ps, ss, 4, 2, d
+AXPY_AVX2  d, pd, sd, 8, 3, q
+SCAL_AVX2  s, ps, ss, 4, 2, d
+SCAL_AVX2  d, pd, sd, 8, 3, q
+COPY_AVX2  s, ps, ss, 4, 2, d
+COPY_AVX2  d, pd, sd, 8, 3, q
+ASUM_AVX2  s, ps, ss, 4, 2, d
+ASUM_AVX2  d, pd, sd, 8, 3, q
+IAMAX_AVX2 s, ps, ss, 4, 2, d
+IAMAX_AVX2 d, pd, sd, 8, 3, q
+
+; ============================================================================
+; SSE2 KERNELS
+; ============================================================================
+;
+; Same structure with 16-byte vectors. The head runs scalar until the
+; written array is 16-byte aligned, the main loop does 64 bytes, and a
+; scalar loop finishes the last 0-15 bytes. Loads use MOVUPS/MOVUPD: on
+; current cores they cost the same as aligned loads when the data happens
+; to be aligned, and legacy-SSE memory operands would fault when it is not.
+;
+; ============================================================================
+
+; SSE_BCAST ps|pd, reg: copy the low element of reg to every lane
+%macro SSE_BCAST 2
+%ifidn %1, ps
+    shufps  %2, %2, 0
+%else
+    unpcklpd %2, %2
+%endif
+%endmacro
+
+; ----------------------------------------------------------------------------
+; axpy: y[i] += alpha * x[i]
+; ----------------------------------------------------------------------------
+%macro AXPY_SSE 6
+blas_%1axpy_sse:
+    shl     rdi, %5
+    jz      .done
+    SSE_BCAST %2, xmm0
+
+    BLAS_HEAD rdx, 16, %4
+    test    rax, rax
+    jz      .main
+.head:
+    mov%3   xmm1, [rsi]
+    mul%3   xmm1, xmm0
+    add%3   xmm1, [rdx]
+    mov%3   [rdx], xmm1
+    add     rsi, %4
+    add     rdx, %4
+    sub     rdi, %4
+    sub     rax, %4
+    jnz     .head
+
+.main:
+    cmp     rdi, 64
+    jb      .step
+.loop:
+    movu%2  xmm1, [rsi]
+    movu%2  xmm2, [rsi + 16]
+    movu%2  xmm3, [rsi + 32]
+    movu%2  xmm4, [rsi + 48]
+    movu%2  xmm5, [rdx]
+    movu%2  xmm6, [rdx + 16]
+    movu%2  xmm7, [rdx + 32]
+    movu%2  xmm8, [rdx + 48]
+    mul%2   xmm1, xmm0
+    mul%2   xmm2, xmm0
+    mul%2   xmm3, xmm0
+    mul%2   xmm4, xmm0
+    add%2   xmm1, xmm5
+    add%2   xmm2, xmm6
+    add%2   xmm3, xmm7
+    add%2   xmm4, xmm8
+    movu%2  [rdx], xmm1
+    movu%2  [rdx + 16], xmm2
+    movu%2  [rdx + 32], xmm3
+    movu%2  [rdx + 48], xmm4
+    add     rsi, 64
+    add     rdx, 64
+    sub     rdi, 64
+    cmp     rdi, 64
+    jae     .loop
+
+.step:
+    cmp     rdi, 16
+    jb      .tail
+    movu%2  xmm1, [rsi]
+    movu%2  xmm5, [rdx]
+    mul%2   xmm1, xmm0
+    add%2   xmm1, xmm5
+    movu%2  [rdx], xmm1
+    add     rsi, 16
+    add     rdx, 16
+    sub     rdi, 16
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    mov%3   xmm1, [rsi]
+    mul%3   xmm1, xmm0
+    add%3   xmm1, [rdx]
+    mov%3   [rdx], xmm1
+    add     rsi, %4
+    add     rdx, %4
+    sub     rdi, %4
+    jmp     .tail
+
+.done:
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; scal: x[i] *= alpha
+; ----------------------------------------------------------------------------
+%macro SCAL_SSE 6
+blas_%1scal_sse:
+    shl     rdi, %5
+    jz      .done
+    SSE_BCAST %2, xmm0
+
+    BLAS_HEAD rsi, 16, %4
+    test    rax, rax
+    jz      .main
+.head:
+    mov%3   xmm1, [rsi]
+    mul%3   xmm1, xmm0
+    mov%3   [rsi], xmm1
+    add     rsi, %4
+    sub     rdi, %4
+    sub     rax, %4
+    jnz     .head
+
+.main:
+    cmp     rdi, 64
+    jb      .step
+.loop:
+    movu%2  xmm1, [rsi]
+    movu%2  xmm2, [rsi + 16]
+    movu%2  xmm3, [rsi + 32]
+    movu%2  xmm4, [rsi + 48]
+    mul%2   xmm1, xmm0
+    mul%2   xmm2, xmm0
+    mul%2   xmm3, xmm0
+    mul%2   xmm4, xmm0
+    movu%2  [rsi], xmm1
+    movu%2  [rsi + 16], xmm2
+    movu%2  [rsi + 32], xmm3
+    movu%2  [rsi + 48], xmm4
+    add     rsi, 64
+    sub     rdi, 64
+    cmp     rdi, 64
+    jae     .loop
+
+.step:
+    cmp     rdi, 16
+    jb      .tail
+    movu%2  xmm1, [rsi]
+    mul%2   xmm1, xmm0
+    movu%2  [rsi], xmm1
+    add     rsi, 16
+    sub     rdi, 16
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    mov%3   xmm1, [rsi]
+    mul%3   xmm1, xmm0
+    mov%3   [rsi], xmm1
+    add     rsi, %4
+    sub     rdi, %4
+    jmp     .tail
+
+.done:
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; copy: y[i] = x[i]
+; ----------------------------------------------------------------------------
+%macro COPY_SSE 6
+blas_%1copy_sse:
+    shl     rdi, %5
+    jz      .done
+
+    BLAS_HEAD rdx, 16, %4
+    test    rax, rax
+    jz      .main
+.head:
+    mov%3   xmm1, [rsi]
+    mov%3   [rdx], xmm1
+    add     rsi, %4
+    add     rdx, %4
+    sub     rdi, %4
+    sub     rax, %4
+    jnz     .head
+
+.main:
+    cmp     rdi, 64
+    jb      .step
+.loop:
+    movu%2  xmm1, [rsi]
+    movu%2  xmm2, [rsi + 16]
+    movu%2  xmm3, [rsi + 32]
+    movu%2  xmm4, [rsi + 48]
+    movu%2  [rdx], xmm1
+    movu%2  [rdx + 16], xmm2
+    movu%2  [rdx + 32], xmm3
+    movu%2  [rdx + 48], xmm4
+    add     rsi, 64
+    add     rdx, 64
+    sub     rdi, 64
+    cmp     rdi, 64
+    jae     .loop
+
+.step:
+    cmp     rdi, 16
+    jb      .tail
+    movu%2  xmm1, [rsi]
+    movu%2  [rdx], xmm1
+    add     rsi, 16
+    add     rdx, 16
+    sub     rdi, 16
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .done
+    mov%3   xmm1, [rsi]
+    mov%3   [rdx], xmm1
+    add     rsi, %4
+    add     rdx, %4
+    sub     rdi, %4
+    jmp     .tail
+
+.done:
+    ret
+%endmacro
+
+; HSUM_SSE ps|pd: XMM0 = sum of the lanes of XMM1 (clobbers XMM1, XMM2)
+%macro HSUM_SSE 1
+    movhlps xmm2, xmm1              ; High 8 bytes
+    add%1   xmm1, xmm2
+%ifidn %1, ps
+    movaps  xmm2, xmm1
+    shufps  xmm2, xmm2, 0x55        ; Lane 1
+    addss   xmm1, xmm2
+%endif
+    movaps  xmm0, xmm1
+%endmacro
+
+; ----------------------------------------------------------------------------
+; asum: sum |x[i]|
+; ----------------------------------------------------------------------------
+%macro ASUM_SSE 6
+blas_%1asum_sse:
+    xorps   xmm1, xmm1
+    xorps   xmm2, xmm2
+    xorps   xmm3, xmm3
+    xorps   xmm4, xmm4
+    movu%2  xmm6, [blas_abs_%2]
+    shl     rdi, %5
+    jz      .reduce
+
+    BLAS_HEAD rsi, 16, %4
+    test    rax, rax
+    jz      .main
+.head:
+    mov%3   xmm7, [rsi]
+    and%2   xmm7, xmm6
+    add%3   xmm1, xmm7
+    add     rsi, %4
+    sub     rdi, %4
+    sub     rax, %4
+    jnz     .head
+
+.main:
+    cmp     rdi, 64
+    jb      .step
+.loop:
+    movu%2  xmm7, [rsi]
+    movu%2  xmm8, [rsi + 16]
+    movu%2  xmm9, [rsi + 32]
+    movu%2  xmm10, [rsi + 48]
+    and%2   xmm7, xmm6
+    and%2   xmm8, xmm6
+    and%2   xmm9, xmm6
+    and%2   xmm10, xmm6
+    add%2   xmm1, xmm7
+    add%2   xmm2, xmm8
+    add%2   xmm3, xmm9
+    add%2   xmm4, xmm10
+    add     rsi, 64
+    sub     rdi, 64
+    cmp     rdi, 64
+    jae     .loop
+
+.step:
+    cmp     rdi, 16
+    jb      .tail
+    movu%2  xmm7, [rsi]
+    and%2   xmm7, xmm6
+    add%2   xmm1, xmm7
+    add     rsi, 16
+    sub     rdi, 16
+    jmp     .step
+
+.tail:
+    test    rdi, rdi
+    jz      .reduce
+    mov%3   xmm7, [rsi]
+    and%2   xmm7, xmm6
+    add%3   xmm1, xmm7
+    add     rsi, %4
+    sub     rdi, %4
+    jmp     .tail
+
+.reduce:
+    add%2   xmm1, xmm2
+    add%2   xmm3, xmm4
+    add%2   xmm1, xmm3
+    HSUM_SSE %2
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; iamax: index of the first largest |x[i]| (see IAMAX_AVX2)
+; SSE2 has no BLENDV; lanes are selected with best ^ ((best ^ new) & mask).
+; The last 0-15 bytes are compared in scalar code after the lane scan.
+; ----------------------------------------------------------------------------
+%macro IAMAX_SSE 6
+blas_i%1amax_sse:
+    xor     eax, eax
+    shl     rdi, %5
+    jz      .ret
+    mov     r9, rsi                 ; Start, for the tail indices
+
+    movu%2  xmm6, [blas_abs_%2]
+    mov%3   xmm1, [blas_neg_one_%1]
+    SSE_BCAST %2, xmm1              ; XMM1 = best |x| per lane
+    pxor    xmm2, xmm2              ; XMM2 = index of the best per lane
+    movdqu  xmm3, [blas_lane_%6]    ; XMM3 = indices of the current lanes
+    mov     eax, 16 / %4
+    movd    xmm4, eax
+%ifidn %6, d
+    pshufd  xmm4, xmm4, 0           ; XMM4 = lanes per vector
+%else
+    punpcklqdq xmm4, xmm4
+%endif
+
+.loop:
+    cmp     rdi, 16
+    jb      .scan
+    movu%2  xmm0, [rsi]
+    and%2   xmm0, xmm6
+    movaps  xmm5, xmm1
+    cmplt%2 xmm5, xmm0              ; best < |x| (false for NaN)
+    xorps   xmm0, xmm1
+    andps   xmm0, xmm5
+    xorps   xmm1, xmm0              ; best = mask ? |x| : best
+    movdqa  xmm7, xmm3
+    pxor    xmm7, xmm2
+    pand    xmm7, xmm5
+    pxor    xmm2, xmm7              ; index = mask ? lane index : index
+    padd%6  xmm3, xmm4
+    add     rsi, 16
+    sub     rdi, 16
+    jmp     .loop
+
+.scan:
+    sub     rsp, 32
+    movu%2  [rsp], xmm1
+    movdqu  [rsp + 16], xmm2
+    IAMAX_SCAN 16, %3, %4
+    add     rsp, 32
+
+.tail:
+    test    rdi, rdi
+    jz      .ret
+    mov%3   xmm1, [rsi]
+    and%2   xmm1, xmm6
+    ucomi%3 xmm1, xmm0
+    jbe     .tail_next              ; Not greater, or NaN
+    movaps  xmm0, xmm1
+    mov     rax, rsi
+    sub     rax, r9
+    shr     rax, %5                 ; Element index
+.tail_next:
+    add     rsi, %4
+    sub     rdi, %4
+    jmp     .tail
+
+.ret:
+    ret
+%endmacro
+
+; ----------------------------------------------------------------------------
+; snrm2: sum of squares in double precision (see blas_snrm2_avx2)
+; ----------------------------------------------------------------------------
+blas_snrm2_sse:
+    xorpd   xmm1, xmm1
+    xorpd   xmm2, xmm2
+    xorpd   xmm3, xmm3
+    xorpd   xmm4, xmm4
+    shl     rdi, 2
+    jz      .reduce
+
+.loop:
+    cmp     rdi, 32
+    jb      .tail
+    cvtps2pd xmm5, [rsi]            ; 2 floats -> 2 doubles
+    cvtps2pd xmm6, [rsi + 8]
+    cvtps2pd xmm7, [rsi + 16]
+    cvtps2pd xmm8, [rsi + 24]
+    mulpd   xmm5, xmm5
+    mulpd   xmm6, xmm6
+    mulpd   xmm7, xmm7
+    mulpd   xmm8, xmm8
+    addpd   xmm1, xmm5
+    addpd   xmm2, xmm6
+    addpd   xmm3, xmm7
+    addpd   xmm4, xmm8
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .loop
+
+.tail:
+    test    rdi, rdi
+    jz      .reduce
+    cvtss2sd xmm5, [rsi]
+    mulsd   xmm5, xmm5
+    addsd   xmm1, xmm5
+    add     rsi, 4
+    sub     rdi, 4
+    jmp     .tail
+
+.reduce:
+    addpd   xmm1, xmm2
+    addpd   xmm3, xmm4
+    addpd   xmm1, xmm3
+    HSUM_SSE pd
+    sqrtsd  xmm0, xmm0
+    cvtsd2ss xmm0, xmm0
+    ret
+
+; ----------------------------------------------------------------------------
+; dnrm2: two passes with a power-of-two scale (see blas_dnrm2_avx2)
+; ----------------------------------------------------------------------------
+blas_dnrm2_sse:
+    xorpd   xmm0, xmm0
+    shl     rdi, 3
+    jz      .ret
+    mov     r8, rsi
+    mov     r9, rdi
+
+    ; --- pass 1: largest |x| ---
+    movupd  xmm6, [blas_abs_pd]
+    xorpd   xmm1, xmm1
+    xorpd   xmm2, xmm2
+.max_loop:
+    cmp     rdi, 32
+    jb      .max_tail
+    movupd  xmm7, [rsi]
+    movupd  xmm8, [rsi + 16]
+    andpd   xmm7, xmm6
+    andpd   xmm8, xmm6
+    maxpd   xmm1, xmm7
+    maxpd   xmm2, xmm8
+    add     rsi, 32
+    sub     rdi, 32
+    jmp     .max_loop
+.max_tail:
+    test    rdi, rdi
+    jz      .max_reduce
+    movsd   xmm7, [rsi]
+    andpd   xmm7, xmm6
+    maxsd   xmm1, xmm7
+    add     rsi, 8
+    sub     rdi, 8
+    jmp     .max_tail
+.max_reduce:
+    maxpd   xmm1, xmm2
+    movhlps xmm2, xmm1
+    maxsd   xmm1, xmm2              ; XMM1 = m
+
+    ; --- scale: s = 2^(1 - exponent(m)) ---
+    movq    rax, xmm1
+    shr     rax, 52
+    mov     ecx, 2047
+    sub     ecx, eax
+    mov     eax, 1
+    cmp     ecx, eax
+    cmovl   ecx, eax
+    mov     eax, 2046
+    cmp     ecx, eax
+    cmovg   ecx, eax
+    shl     rcx, 52
+    movq    xmm5, rcx
+    unpcklpd xmm5, xmm5             ; XMM5 = s
+
+    ; --- pass 2: sum (x * s)^2 ---
+    mov     rsi, r8
+    mov     rdi, r9
+    xorpd   xmm1, xmm1
+    xorpd   xmm2, xmm2
+    xorpd   xmm3, xmm3
+    xorpd   xmm4, xmm4
+.sum_loop:
+    cmp     rdi, 64
+    jb      .sum_tail
+    movupd  xmm7, [rsi]
+    movupd  xmm8, [rsi + 16]
+    movupd  xmm9, [rsi + 32]
+    movupd  xmm10, [rsi + 48]
+    mulpd   xmm7, xmm5
+    mulpd   xmm8, xmm5
+    mulpd   xmm9, xmm5
+    mulpd   xmm10, xmm5
+    mulpd   xmm7, xmm7
+    mulpd   xmm8, xmm8
+    mulpd   xmm9, xmm9
+    mulpd   xmm10, xmm10
+    addpd   xmm1, xmm7
+    addpd   xmm2, xmm8
+    addpd   xmm3, xmm9
+    addpd   xmm4, xmm10
+    add     rsi, 64
+    sub     rdi, 64
+    jmp     .sum_loop
+.sum_tail:
+    test    rdi, rdi
+    jz      .sum_reduce
+    movsd   xmm7, [rsi]
+    mulsd   xmm7, xmm5
+    mulsd   xmm7, xmm7
+    addsd   xmm1, xmm7
+    add     rsi, 8
+    sub     rdi, 8
+    jmp     .sum_tail
+.sum_reduce:
+    addpd   xmm1, xmm2
+    addpd   xmm3, xmm4
+    addpd   xmm1, xmm3
+    HSUM_SSE pd
+    sqrtsd  xmm0, xmm0
+    divsd   xmm0, xmm5
+.ret:
+    ret
+
+AXPY_SSE   s, ps, ss, 4, 2, d
+AXPY_SSE   d, pd, sd, 8, 3, q
+SCAL_SSE   s, ps, ss, 4, 2, d
+SCAL_SSE   d, pd, sd, 8, 3, q
+COPY_SSE   s, ps, ss, 4, 2, d
+COPY_SSE   d, pd, sd, 8, 3, q
+ASUM_SSE   s, ps, ss, 4, 2, d
+ASUM_SSE   d, pd, sd, 8, 3, q
+IAMAX_SSE  s, ps, ss, 4, 2, d
+IAMAX_SSE  d, pd, sd, 8, 3, q
+
+; ============================================================================
+; DISPATCH
+; ============================================================================
+
+; BLAS1_ENTRY name, slot: public entry point that jumps to the selected
+; implementation (arguments are passed through untouched)
+%macro BLAS1_ENTRY 2
+%1:
+    jmp     [blas1_dispatch + %2 * 8]
+%endmacro
+
+BLAS1_ENTRY blas_saxpy, 0
+BLAS1_ENTRY blas_sscal, 1
+BLAS1_ENTRY blas_scopy, 2
+BLAS1_ENTRY blas_sasum, 3
+BLAS1_ENTRY blas_snrm2, 4
+BLAS1_ENTRY blas_isamax, 5
+BLAS1_ENTRY blas_daxpy, 6
+BLAS1_ENTRY blas_dscal, 7
+BLAS1_ENTRY blas_dcopy, 8
+BLAS1_ENTRY blas_dasum, 9
+BLAS1_ENTRY blas_dnrm2, 10
+BLAS1_ENTRY blas_idamax, 11
+
+; ============================================================================
+; FUNCTION: blas1_init
+; Description: Select the AVX2/FMA kernels if the CPU and OS support them
+;              (call once, before other threads use the blas_* entries)
+; Returns: RAX = 1 if the AVX2/FMA kernels were selected, 0 for SSE2
+; ============================================================================
+blas1_init:
+    push    rbx                     ; CPUID writes EBX (callee-saved)
+
+    xor     eax, eax
+    cpuid
+    cmp     eax, 7
+    jb      .no
+
+    mov     eax, 1
+    cpuid
+    bt      ecx, 12                 ; FMA
+    jnc     .no
+    bt      ecx, 27                 ; OSXSAVE: XGETBV usable
+    jnc     .no
+    bt      ecx, 28                 ; AVX
+    jnc     .no
+    xor     ecx, ecx
+    xgetbv
+    and     eax, 0x06
+    cmp     eax, 0x06               ; XMM and YMM state saved by the OS
+    jne     .no
+
+    mov     eax, 7
+    xor     ecx, ecx
+    cpuid
+    bt      ebx, 5                  ; AVX2
+    jnc     .no
+
+    lea     rsi, [blas1_avx2_table]
+    lea     rdi, [blas1_dispatch]
+    mov     ecx, BLAS1_SLOTS
+    rep     movsq
+    mov     eax, 1
+    pop     rbx
+    ret
+
+.no:
+    xor     eax, eax
+    pop     rbx
+    ret
+
+; ============================================================================
+; SELF-CHECK
+; ============================================================================
+;
+; x[i] = i mod 7 - 3 and y[i] = i keep every result a small integer (or
+; the square root of one), which both precisions represent exactly, so
+; each kernel must match bit for bit whatever order it sums in. Every
+; length from 0 to VERIFY_MAX_N runs with the arrays aligned and shifted
+; by one element, which exercises every head/main/tail combination.
+;
+; ============================================================================
+
+; VERIFY_TYPE: builds verify_s / verify_d
+; RBX = the six entry points of one type (axpy, scal, copy, asum, nrm2,
+; iamax). Returns RAX = 0 if every result matches, 1 otherwise.
+%macro VERIFY_TYPE 6
+verify_%1:
+    push    rbp
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+
+    xor     r13d, r13d              ; Shift in elements: 0 or 1
+.shift_loop:
+    xor     r12d, r12d              ; n
+.n_loop:
+    lea     r14, [verify_x + r13*%4]
+    lea     r15, [verify_y + r13*%4]
+
+    ; --- axpy with alpha = 2: y = i + 2e ---
+    call    .fill
+    mov     rdi, r12
+    mov     eax, 2
+    cvtsi2%3 xmm0, eax
+    mov     rsi, r14
+    mov     rdx, r15
+    call    [rbx]
+    xor     r8d, r8d
+    call    .check_y
+    test    eax, eax
+    jnz     .fail
+
+    ; --- scal with alpha = -2: y = -2 (i + 2e) ---
+    mov     rdi, r12
+    mov     eax, -2
+    cvtsi2%3 xmm0, eax
+    mov     rsi, r15
+    call    [rbx + 8]
+    mov     r8d, 1
+    call    .check_y
+    test    eax, eax
+    jnz     .fail
+
+    ; --- copy: y = e ---
+    mov     rdi, r12
+    mov     rsi, r14
+    mov     rdx, r15
+    call    [rbx + 16]
+    mov     r8d, 2
+    call    .check_y
+    test    eax, eax
+    jnz     .fail
+
+    ; --- asum = sum |e| ---
+    mov     rdi, r12
+    mov     rsi, r14
+    call    [rbx + 24]
+    call    .sums
+    cvtsi2%3 xmm1, rax
+    ucomi%3 xmm0, xmm1
+    jne     .fail
+    jp      .fail
+
+    ; --- nrm2 = sqrt(sum e^2), rounded like the kernels do ---
+    mov     rdi, r12
+    mov     rsi, r14
+    call    [rbx + 32]
+    call    .sums
+    cvtsi2sd xmm1, rdx
+    sqrtsd  xmm1, xmm1
+%if %4 == 4
+    cvtsd2ss xmm1, xmm1
+%endif
+    ucomi%3 xmm0, xmm1
+    jne     .fail
+    jp      .fail
+
+    ; --- iamax: |x[0]| = 3 is the first maximum ---
+    mov     rdi, r12
+    mov     rsi, r14
+    call    [rbx + 40]
+    test    rax, rax
+    jnz     .fail
+
+    ; --- iamax with x[5n/8] = -100 ---
+    test    r12, r12
+    jz      .next
+    lea     rbp, [r12*4 + r12]
+    shr     rbp, 3
+    mov     eax, -100
+    cvtsi2%3 xmm1, eax
+    mov%3   [r14 + rbp*%4], xmm1
+    mov     rdi, r12
+    mov     rsi, r14
+    call    [rbx + 40]
+    cmp     rax, rbp
+    jne     .fail
+
+.next:
+    inc     r12
+    cmp     r12, VERIFY_MAX_N
+    jbe     .n_loop
+    inc     r13
+    cmp     r13, 2
+    jb      .shift_loop
+
+    xor     eax, eax
+    jmp     .done
+.fail:
+    mov     eax, 1
+.done:
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbp
+    ret
+
+; x[i] = e = i mod 7 - 3, y[i] = i, y[n] = VERIFY_GUARD
+.fill:
+    xor     ecx, ecx
+    xor     edx, edx                ; i mod 7
+.fill_loop:
+    cmp     rcx, r12
+    jae     .fill_guard
+    lea     rax, [rdx - 3]
+    cvtsi2%3 xmm1, rax
+    mov%3   [r14 + rcx*%4], xmm1
+    cvtsi2%3 xmm1, rcx
+    mov%3   [r15 + rcx*%4], xmm1
+    inc     edx
+    cmp     edx, 7
+    jb      .fill_next
+    xor     edx, edx
+.fill_next:
+    inc     rcx
+    jmp     .fill_loop
+.fill_guard:
+    mov     eax, VERIFY_GUARD
+    cvtsi2%3 xmm1, eax
+    mov%3   [r15 + r12*%4], xmm1
+    ret
+
+; RAX = 0 if y matches pattern R8 (0: i + 2e, 1: -2 (i + 2e), 2: e) and
+; the guard is intact, 1 otherwise
+.check_y:
+    xor     ecx, ecx
+    xor     edx, edx
+.check_loop:
+    cmp     rcx, r12
+    jae     .check_guard
+    lea     rax, [rdx - 3]          ; e
+    cmp     r8d, 2
+    je      .check_elem
+    lea     rax, [rcx + rax*2]      ; i + 2e
+    cmp     r8d, 1
+    jne     .check_elem
+    imul    rax, rax, -2
+.check_elem:
+    cvtsi2%3 xmm1, rax
+    ucomi%3 xmm1, [r15 + rcx*%4]
+    jne     .check_bad
+    jp      .check_bad
+    inc     edx
+    cmp     edx, 7
+    jb      .check_next
+    xor     edx, edx
+.check_next:
+    inc     rcx
+    jmp     .check_loop
+.check_guard:
+    mov     eax, VERIFY_GUARD
+    cvtsi2%3 xmm1, eax
+    ucomi%3 xmm1, [r15 + r12*%4]
+    jne     .check_bad
+    jp      .check_bad
+    xor     eax, eax
+    ret
+.check_bad:
+    mov     eax, 1
+    ret
+
+; RAX = sum |e|, RDX = sum e^2 over the first n elements
+.sums:
+    xor     eax, eax
+    xor     edx, edx
+    xor     ecx, ecx
+    xor     r8d, r8d                ; i mod 7
+.sums_loop:
+    cmp     rcx, r12
+    jae     .sums_done
+    lea     r9, [r8 - 3]
+    mov     r10, r9
+    imul    r10, r9
+    add     rdx, r10
+    mov     r10, r9
+    neg     r10
+    cmovs   r10, r9                 ; |e|
+    add     rax, r10
+    inc     r8d
+    cmp     r8d, 7
+    jb      .sums_next
+    xor     r8d, r8d
+.sums_next:
+    inc     rcx
+    jmp     .sums_loop
+.sums_done:
+    ret
+%endmacro
+
+VERIFY_TYPE s, ps, ss, 4, 2, d
+VERIFY_TYPE d, pd, sd, 8, 3, q
+
+%ifndef LIBRARY
+; ============================================================================
+; MAIN PROGRAM
+; ============================================================================
+
+_start:
+    ; SSE2 kernels (always available on x86-64)
+    lea     rbx, [blas1_sse_table]
+    call    verify_s
+    mov     r12, rax
+    lea     rbx, [blas1_sse_table + 6*8]
+    call    verify_d
+    or      r12, rax
+
+    mov     rsi, msg_sse_ok
+    mov     rdx, msg_sse_ok_len
+    test    r12, r12
+    jz      print_sse
+    mov     rsi, msg_sse_bad
+    mov     rdx, msg_sse_bad_len
+print_sse:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+
+    ; AVX2/FMA kernels, if blas1_init selects them
+    call    blas1_init
+    mov     rsi, msg_no_avx
+    mov     rdx, msg_no_avx_len
+    test    rax, rax
+    jz      print_avx
+
+    lea     rbx, [blas1_avx2_table]
+    call    verify_s
+    mov     r12, rax
+    lea     rbx, [blas1_avx2_table + 6*8]
+    call    verify_d
+    or      r12, rax
+
+    mov     rsi, msg_avx_ok
+    mov     rdx, msg_avx_ok_len
+    test    r12, r12
+    jz      print_avx
+    mov     rsi, msg_avx_bad
+    mov     rdx, msg_avx_bad_len
+print_avx:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+
+    ; Exit with 1 if anything mismatched
+    mov     rax, 60
+    mov     rdi, r12
+    syscall
+%endif
+
+; ============================================================================
+; NOTES: BLAS-1 Kernels
+; ============================================================================
+;
+; Why these kernels are memory-bound:
+;   axpy reads 2 and writes 1 element per FMA; asum and nrm2 read 1 per
+;   add. Beyond L2 they run at memory bandwidth, so the AVX2 path mostly
+;   wins for data in L1/L2. Four independent accumulators (asum, nrm2)
+;   keep the add latency from limiting even the in-cache case.
+;
+; Alignment peeling:
+;   An unaligned 32-byte store that crosses a cache line costs two line
+;   accesses. Peeling the head so the written array is aligned removes
+;   all line splits on the store side; the other array's loads may still
+;   split (arrays with different misalignment cannot both be aligned).
+;   The head is skipped when the pointer is not a multiple of the element
+;   size - such an array can never become aligned.
+;
+; Masked head and tail (VMASKMOVPS/PD):
+;   - Masked-off lanes are not read or written, and do not fault even if
+;     they fall on an unmapped page
+;   - Masked-off loaded lanes read as 0.0, which is harmless for sums and
+;     maxima; iamax blends them to -1 so they can never be selected
+;   - A masked store is slower than a plain one (several uops), which is
+;     why it is used only for the at most two partial blocks
+;
+; Overflow-safe nrm2:
+;   The naive sqrt(sum x*x) overflows for |x| > ~1e154 (double) and loses
+;   everything below ~1e-162. Reference BLAS rescales on every element
+;   (a division per element); scaling by a power of two computed once from
+;   max |x| costs a second pass but keeps the loops branch-free and exact.
+;   Floats need none of this: their squares always fit in a double.
+;
+; Differences from reference BLAS:
+;   - Unit stride only (no incx/incy)
+;   - iamax returns a 0-based index, and 0 for n = 0
+;   - scal with alpha = 0 multiplies (NaN * 0 stays NaN) instead of
+;     storing zeros
+;   - Vector sums add in a different order than a sequential loop, so the
+;     last bits of asum (and of nrm2 for doubles) can differ from it
+;
+; ============================================================================
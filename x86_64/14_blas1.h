@@ -0,0 +1,86 @@
+/*
+ * ============================================================================
+ * File: 14_blas1.h
+ * Description: C interface to the BLAS-1 kernels in 14_blas1.asm
+ * Build: nasm -f elf64 -DLIBRARY 14_blas1.asm -o 14_lib.o
+ *        gcc -O2 -no-pie your_program.c 14_lib.o
+ * ============================================================================
+ *
+ * Unit-stride BLAS level-1 operations for float (s) and double (d):
+ *
+ *   axpy   y[i] += alpha * x[i]
+ *   scal   x[i] *= alpha
+ *   copy   y[i]  = x[i]
+ *   asum   sum |x[i]|
+ *   nrm2   sqrt(sum x[i]^2), computed without overflow or underflow
+ *   iamax  0-based index of the first largest |x[i]| (0 when n == 0;
+ *          NaN elements are never selected)
+ *
+ * The plain names dispatch to the SSE2 kernels until blas1_init() has
+ * selected the AVX2/FMA ones. Call it once at startup, before any other
+ * thread calls into the library. The _sse / _avx2 variants bypass the
+ * dispatch (the _avx2 ones need a CPU with AVX2 and FMA).
+ *
+ * Any alignment and any n are accepted. blas_isamax and its variants need
+ * n < 2^31.
+ */
+
+#ifndef BLAS1_H
+#define BLAS1_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns 1 if the AVX2/FMA kernels were selected, 0 if SSE2 stays in use
+int blas1_init(void);
+
+void   blas_saxpy(size_t n, float alpha, const float *x, float *y);
+void   blas_sscal(size_t n, float alpha, float *x);
+void   blas_scopy(size_t n, const float *x, float *y);
+float  blas_sasum(size_t n, const float *x);
+float  blas_snrm2(size_t n, const float *x);
+size_t blas_isamax(size_t n, const float *x);
+
+void   blas_daxpy(size_t n, double alpha, const double *x, double *y);
+void   blas_dscal(size_t n, double alpha, double *x);
+void   blas_dcopy(size_t n, const double *x, double *y);
+double blas_dasum(size_t n, const double *x);
+double blas_dnrm2(size_t n, const double *x);
+size_t blas_idamax(size_t n, const double *x);
+
+// --- Fixed code paths ---
+
+void   blas_saxpy_sse(size_t n, float alpha, const float *x, float *y);
+void   blas_sscal_sse(size_t n, float alpha, float *x);
+void   blas_scopy_sse(size_t n, const float *x, float *y);
+float  blas_sasum_sse(size_t n, const float *x);
+float  blas_snrm2_sse(size_t n, const float *x);
+size_t blas_isamax_sse(size_t n, const float *x);
+void   blas_daxpy_sse(size_t n, double alpha, const double *x, double *y);
+void   blas_dscal_sse(size_t n, double alpha, double *x);
+void   blas_dcopy_sse(size_t n, const double *x, double *y);
+double blas_dasum_sse(size_t n, const double *x);
+double blas_dnrm2_sse(size_t n, const double *x);
+size_t blas_idamax_sse(size_t n, const double *x);
+
+void   blas_saxpy_avx2(size_t n, float alpha, const float *x, float *y);
+void   blas_sscal_avx2(size_t n, float alpha, float *x);
+void   blas_scopy_avx2(size_t n, const float *x, float *y);
+float  blas_sasum_avx2(size_t n, const float *x);
+float  blas_snrm2_avx2(size_t n, const float *x);
+size_t blas_isamax_avx2(size_t n, const float *x);
+void   blas_daxpy_avx2(size_t n, double alpha, const double *x, double *y);
+void   blas_dscal_avx2(size_t n, double alpha, double *x);
+void   blas_dcopy_avx2(size_t n, const double *x, double *y);
+double blas_dasum_avx2(size_t n, const double *x);
+double blas_dnrm2_avx2(size_t n, const double *x);
+size_t blas_idamax_avx2(size_t n, const double *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLAS1_H
@@ -0,0 +1,1285 @@
+; ============================================================================
+; File: 15_sgemm.asm
+; Description: Single-precision matrix multiply (SGEMM) with a 6x16 AVX2/FMA
+;              register-blocked microkernel, panel packing, cache blocking
+;              and an optional multi-threaded outer loop
+; Topics: Register blocking, packing, L1/L2/L3 blocking, raw clone threads,
+;         futex join, runtime dispatch
+; Assembler: NASM
+; Build: nasm -f elf64 15_sgemm.asm && ld -o 15_sgemm 15_sgemm.o
+; Run: ./15_sgemm   (checks every code path against a naive triple loop)
+; Library: nasm -f elf64 -DLIBRARY 15_sgemm.asm -o 15_lib.o
+;          (C interface: 15_sgemm.h)
+; ============================================================================
+;
+; dot_product_simd (08) and the BLAS-1 kernels (14) load two values for
+; every multiply-add, so they run at memory speed. A matrix multiply does
+; K multiply-adds per loaded element, and the code below is arranged so
+; almost all of them come from registers:
+;
+;     C (M x N)  =  alpha * A (M x K) * B (K x N)  +  beta * C
+;
+; All matrices are row-major with leading dimensions lda/ldb/ldc (in
+; elements, >= the row length). beta = 0 never reads C, so C may start
+; uninitialised.
+;
+; Loop nest (as in BLIS / GotoBLAS):
+;
+;   for jc in 0..N step NC            B panel K x NC          -> L3
+;     for pc in 0..K step KC          packed B block KC x NC  -> L3
+;       pack_b
+;       for ic in 0..M step MC        packed A block MC x KC  -> L2
+;         pack_a
+;         for jr in 0..NC step NR     B micro-panel KC x NR   -> L1
+;           for ir in 0..MC step MR   A micro-panel MR x KC
+;             microkernel: C[MR x NR] += A micro-panel * B micro-panel
+;
+; The microkernel keeps the whole 6x16 block of C in 12 YMM accumulators.
+; One k step loads 2 vectors of B and broadcasts 6 values of A for 12
+; FMAs - enough independent FMAs to cover their latency on two FMA ports
+; (2 ports x 4-5 cycles latency needs >= 8-10 accumulators).
+;
+; Packing copies each block into the exact order the microkernel reads it:
+; contiguous, 64-byte aligned, padded with zeros to whole MR/NR tiles, and
+; with alpha already applied to A. The copy costs O(MK + KN) per block
+; against O(MNK) multiply-adds and removes TLB misses, cache-set conflicts
+; and every edge case from the inner loop.
+;
+; Arguments (System V):
+;   RDI = M, RSI = N, RDX = K, XMM0 = alpha, RCX = A, R8 = lda, R9 = B,
+;   [rsp+8] = ldb, XMM1 = beta, [rsp+16] = C, [rsp+24] = ldc,
+;   [rsp+32] = threads (sgemm_mt only)
+;
+; ============================================================================
+
+%ifdef LIBRARY
+    global sgemm_init, sgemm, sgemm_mt
+    global sgemm_kernel_6x16_sse, sgemm_kernel_6x16_avx2
+    global sgemm_pack_a, sgemm_pack_b
+%else
+global _start
+%endif
+
+%define SYS_WRITE       1
+%define SYS_CLONE       56
+%define SYS_EXIT        60
+%define SYS_FUTEX       202
+%define FUTEX_WAIT      0
+
+; Threads share everything a pthread does; the kernel stores the new TID
+; in job.tid and clears it (plus a futex wake) when the thread exits
+%define CLONE_THREAD_FLAGS  0x350F00    ; VM|FS|FILES|SIGHAND|THREAD|SYSVSEM
+                                        ; |PARENT_SETTID|CHILD_CLEARTID
+
+SGEMM_MR        equ 6               ; Microkernel rows
+SGEMM_NR        equ 16              ; Microkernel columns (2 YMM)
+SGEMM_KC        equ 256             ; B micro-panel KC*NR*4 = 16 KiB in L1
+SGEMM_MC        equ 144             ; A block MC*KC*4 = 144 KiB in L2
+SGEMM_NC        equ 2048            ; B block KC*NC*4 = 2 MiB in L3
+SGEMM_MAX_THREADS equ 16
+SGEMM_STACK     equ 65536           ; Per worker thread
+
+ABUF_BYTES      equ SGEMM_MC * SGEMM_KC * 4
+BBUF_BYTES      equ SGEMM_KC * SGEMM_NC * 4
+
+; One unit of work: a sub-matrix of C computed by one thread
+; (leading dimensions in bytes)
+JOB_M           equ 0
+JOB_N           equ 8
+JOB_K           equ 16
+JOB_A           equ 24
+JOB_LDA         equ 32
+JOB_B           equ 40
+JOB_LDB         equ 48
+JOB_C           equ 56
+JOB_LDC         equ 64
+JOB_ALPHA       equ 72              ; float
+JOB_BETA        equ 76              ; float
+JOB_ABUF        equ 80
+JOB_BBUF        equ 88
+JOB_TID         equ 96              ; dword, nonzero while the thread runs
+JOB_SIZE        equ 128
+
+VERIFY_FLOATS   equ 16384           ; Per test matrix
+VERIFY_CASE     equ 40              ; Bytes per test case
+
+section .data
+    ; Microkernel used by the driver; sgemm_init may switch it to AVX2
+    sgemm_kernel:   dq sgemm_kernel_6x16_sse
+
+    ; Test cases: M, N, K, threads, beta (float bits, 0x7FC00000 = beta 0
+    ; with C filled with NaN). Chosen to cross every edge and block size.
+    verify_cases:
+                    dq 1,    1,    1,   1, 0x3F800000
+                    dq 6,    16,   4,   1, 0x7FC00000
+                    dq 7,    17,   3,   1, 0xBF800000
+                    dq 5,    3,    0,   1, 0xBF800000   ; K = 0: C = beta*C
+                    dq 13,   33,   257, 1, 0x3F800000   ; K > KC
+                    dq 150,  40,   20,  1, 0x7FC00000   ; M > MC
+                    dq 3,    2100, 2,   1, 0x3F800000   ; N > NC
+                    dq 50,   70,   30,  4, 0xBF800000   ; Threads split N
+                    dq 200,  20,   10,  3, 0x7FC00000   ; Threads split M
+                    dq 37,   45,   19,  16, 0x3F800000  ; More threads than tiles
+                    dq 0,    5,    5,   2, 0x3F800000   ; Empty
+    verify_count:   equ ($ - verify_cases) / VERIFY_CASE
+
+    msg_sse_ok:     db "SSE2 SGEMM matches the reference", 0x0a
+    msg_sse_ok_len: equ $ - msg_sse_ok
+    msg_sse_bad:    db "SSE2 SGEMM MISMATCH", 0x0a
+    msg_sse_bad_len: equ $ - msg_sse_bad
+    msg_avx_ok:     db "AVX2/FMA SGEMM matches the reference", 0x0a
+    msg_avx_ok_len: equ $ - msg_avx_ok
+    msg_avx_bad:    db "AVX2/FMA SGEMM MISMATCH", 0x0a
+    msg_avx_bad_len: equ $ - msg_avx_bad
+    msg_no_avx:     db "AVX2/FMA not available: only the SSE2 kernel was checked", 0x0a
+    msg_no_avx_len: equ $ - msg_no_avx
+
+section .bss
+    alignb 64
+    sgemm_jobs:     resb SGEMM_MAX_THREADS * JOB_SIZE
+    sgemm_abuf:     resb SGEMM_MAX_THREADS * ABUF_BYTES
+    sgemm_bbuf:     resb SGEMM_MAX_THREADS * BBUF_BYTES
+    sgemm_stacks:   resb SGEMM_MAX_THREADS * SGEMM_STACK
+
+%ifndef LIBRARY
+    verify_a:       resd VERIFY_FLOATS
+    verify_b:       resd VERIFY_FLOATS
+    verify_c:       resd VERIFY_FLOATS
+    verify_ref:     resd VERIFY_FLOATS
+%endif
+
+section .text
+
+; ============================================================================
+; MICROKERNELS
+; ============================================================================
+;
+; C[6 x 16] = A micro-panel * B micro-panel + beta * C
+;   RDI = k, RSI = packed A (6 floats per k), RDX = packed B (16 floats
+;   per k, 64-byte aligned), RCX = C, R8 = ldc in bytes, XMM0 = beta
+;   (beta = +-0 does not read C)
+; Clobbers: RAX, RDI, RSI, RDX, R9, R10, R11, all vector registers
+;
+; ============================================================================
+
+; One k step of the AVX2 kernel; %1 = step within the unrolled loop
+%macro AVX_KSTEP 1
+    vmovaps ymm0, [rdx + %1*64]
+    vmovaps ymm1, [rdx + %1*64 + 32]
+    vbroadcastss ymm2, [rsi + %1*24]
+    vfmadd231ps ymm4, ymm0, ymm2
+    vfmadd231ps ymm5, ymm1, ymm2
+    vbroadcastss ymm3, [rsi + %1*24 + 4]
+    vfmadd231ps ymm6, ymm0, ymm3
+    vfmadd231ps ymm7, ymm1, ymm3
+    vbroadcastss ymm2, [rsi + %1*24 + 8]
+    vfmadd231ps ymm8, ymm0, ymm2
+    vfmadd231ps ymm9, ymm1, ymm2
+    vbroadcastss ymm3, [rsi + %1*24 + 12]
+    vfmadd231ps ymm10, ymm0, ymm3
+    vfmadd231ps ymm11, ymm1, ymm3
+    vbroadcastss ymm2, [rsi + %1*24 + 16]
+    vfmadd231ps ymm12, ymm0, ymm2
+    vfmadd231ps ymm13, ymm1, ymm2
+    vbroadcastss ymm3, [rsi + %1*24 + 20]
+    vfmadd231ps ymm14, ymm0, ymm3
+    vfmadd231ps ymm15, ymm1, ymm3
+%endmacro
+
+; AVX_ROW row address, low accumulator, high accumulator
+%macro AVX_ROW 3
+    vfmadd231ps %2, ymm0, [%1]
+    vfmadd231ps %3, ymm0, [%1 + 32]
+%endmacro
+
+%macro AVX_STORE 3
+    vmovups [%1], %2
+    vmovups [%1 + 32], %3
+%endmacro
+
+; ============================================================================
+; FUNCTION: sgemm_kernel_6x16_avx2
+; Description: 6x16 microkernel, 12 YMM accumulators, FMA (k unrolled by 4)
+; ============================================================================
+sgemm_kernel_6x16_avx2:
+    vmovd   r9d, xmm0               ; Keep beta while YMM0 holds B
+
+    ; Start pulling the C tile in while the k loop runs
+    lea     r10, [r8 + r8*2]        ; R10 = 3 * ldc
+    lea     rax, [rcx + r8*4]
+    prefetcht0 [rcx]
+    prefetcht0 [rcx + 63]
+    prefetcht0 [rcx + r8]
+    prefetcht0 [rcx + r8 + 63]
+    prefetcht0 [rcx + r8*2]
+    prefetcht0 [rcx + r8*2 + 63]
+    prefetcht0 [rcx + r10]
+    prefetcht0 [rcx + r10 + 63]
+    prefetcht0 [rax]
+    prefetcht0 [rax + 63]
+    prefetcht0 [rax + r8]
+    prefetcht0 [rax + r8 + 63]
+
+    vxorps  xmm4, xmm4, xmm4        ; VEX zeroes the upper halves too
+    vxorps  xmm5, xmm5, xmm5
+    vxorps  xmm6, xmm6, xmm6
+    vxorps  xmm7, xmm7, xmm7
+    vxorps  xmm8, xmm8, xmm8
+    vxorps  xmm9, xmm9, xmm9
+    vxorps  xmm10, xmm10, xmm10
+    vxorps  xmm11, xmm11, xmm11
+    vxorps  xmm12, xmm12, xmm12
+    vxorps  xmm13, xmm13, xmm13
+    vxorps  xmm14, xmm14, xmm14
+    vxorps  xmm15, xmm15, xmm15
+
+    mov     r11, rdi
+    shr     r11, 2
+    jz      .rest
+.loop4:
+    AVX_KSTEP 0
+    AVX_KSTEP 1
+    AVX_KSTEP 2
+    AVX_KSTEP 3
+    add     rsi, 4*24
+    add     rdx, 4*64
+    dec     r11
+    jnz     .loop4
+
+.rest:
+    and     edi, 3
+    jz      .store
+.loop1:
+    AVX_KSTEP 0
+    add     rsi, 24
+    add     rdx, 64
+    dec     edi
+    jnz     .loop1
+
+.store:
+    test    r9d, 0x7FFFFFFF
+    jz      .write                  ; beta = 0: C is not read
+
+    vmovd   xmm0, r9d
+    vbroadcastss ymm0, xmm0
+    AVX_ROW rcx, ymm4, ymm5
+    AVX_ROW rcx + r8, ymm6, ymm7
+    AVX_ROW rcx + r8*2, ymm8, ymm9
+    AVX_ROW rcx + r10, ymm10, ymm11
+    AVX_ROW rax, ymm12, ymm13
+    AVX_ROW rax + r8, ymm14, ymm15
+
+.write:
+    AVX_STORE rcx, ymm4, ymm5
+    AVX_STORE rcx + r8, ymm6, ymm7
+    AVX_STORE rcx + r8*2, ymm8, ymm9
+    AVX_STORE rcx + r10, ymm10, ymm11
+    AVX_STORE rax, ymm12, ymm13
+    AVX_STORE rax + r8, ymm14, ymm15
+    vzeroupper
+    ret
+
+; SSE_KSTEP A offset, low accumulator, high accumulator
+; XMM0/XMM1 = 8 floats of B; XMM2/XMM3 are scratch
+%macro SSE_KSTEP 3
+    movss   xmm2, [rsi + %1]
+    shufps  xmm2, xmm2, 0
+    movaps  xmm3, xmm2
+    mulps   xmm3, xmm0
+    addps   %2, xmm3
+    mulps   xmm2, xmm1
+    addps   %3, xmm2
+%endmacro
+
+; SSE_ROW row address, low accumulator, high accumulator (XMM0 = beta)
+%macro SSE_ROW 3
+    movups  xmm1, [%1]
+    mulps   xmm1, xmm0
+    addps   %2, xmm1
+    movups  xmm1, [%1 + 16]
+    mulps   xmm1, xmm0
+    addps   %3, xmm1
+%endmacro
+
+%macro SSE_STORE 3
+    movups  [%1], %2
+    movups  [%1 + 16], %3
+%endmacro
+
+; SSE_HALF: 6x8 half of the tile, columns %1..%1+7 (%1 = 0 or 8).
+; 16 XMM registers hold 12 accumulators, 2 B vectors and 2 temporaries -
+; the full 6x16 tile needs 24 accumulators, so it is done in two halves.
+%macro SSE_HALF 1
+    mov     rdi, r10
+    mov     rsi, r11
+    lea     rdx, [rax + %1*4]
+    xorps   xmm4, xmm4
+    xorps   xmm5, xmm5
+    xorps   xmm6, xmm6
+    xorps   xmm7, xmm7
+    xorps   xmm8, xmm8
+    xorps   xmm9, xmm9
+    xorps   xmm10, xmm10
+    xorps   xmm11, xmm11
+    xorps   xmm12, xmm12
+    xorps   xmm13, xmm13
+    xorps   xmm14, xmm14
+    xorps   xmm15, xmm15
+    test    rdi, rdi
+    jz      %%store
+%%loop:
+    movaps  xmm0, [rdx]
+    movaps  xmm1, [rdx + 16]
+    SSE_KSTEP 0, xmm4, xmm5
+    SSE_KSTEP 4, xmm6, xmm7
+    SSE_KSTEP 8, xmm8, xmm9
+    SSE_KSTEP 12, xmm10, xmm11
+    SSE_KSTEP 16, xmm12, xmm13
+    SSE_KSTEP 20, xmm14, xmm15
+    add     rsi, 24
+    add     rdx, 64
+    dec     rdi
+    jnz     %%loop
+
+%%store:
+    lea     rdi, [rcx + %1*4]       ; Rows 0-2
+    lea     rdx, [r8 + r8*2]
+    add     rdx, rdi                ; Rows 3-5
+    test    r9d, 0x7FFFFFFF
+    jz      %%write
+    movd    xmm0, r9d
+    shufps  xmm0, xmm0, 0
+    SSE_ROW rdi, xmm4, xmm5
+    SSE_ROW rdi + r8, xmm6, xmm7
+    SSE_ROW rdi + r8*2, xmm8, xmm9
+    SSE_ROW rdx, xmm10, xmm11
+    SSE_ROW rdx + r8, xmm12, xmm13
+    SSE_ROW rdx + r8*2, xmm14, xmm15
+%%write:
+    SSE_STORE rdi, xmm4, xmm5
+    SSE_STORE rdi + r8, xmm6, xmm7
+    SSE_STORE rdi + r8*2, xmm8, xmm9
+    SSE_STORE rdx, xmm10, xmm11
+    SSE_STORE rdx + r8, xmm12, xmm13
+    SSE_STORE rdx + r8*2, xmm14, xmm15
+%endmacro
+
+; ============================================================================
+; FUNCTION: sgemm_kernel_6x16_sse
+; Description: 6x16 microkernel for CPUs without AVX2/FMA (two 6x8 halves)
+; ============================================================================
+sgemm_kernel_6x16_sse:
+    movd    r9d, xmm0
+    mov     r10, rdi                ; Each half restarts k, A and B
+    mov     r11, rsi
+    mov     rax, rdx
+    SSE_HALF 0
+    SSE_HALF 8
+    ret
+
+; ============================================================================
+; FUNCTION: sgemm_merge_tile
+; Description: C[mr x nr] = tile + beta * C for a partial edge tile (the
+;              microkernel wrote the full 6x16 result to the tile)
+; Arguments: RDI = mr, RSI = nr, RDX = tile (row stride 64 bytes),
+;            RCX = C, R8 = ldc in bytes, XMM0 = beta
+; Clobbers: RAX, RDI, RDX, RCX, R9, R10, XMM1, XMM2
+; ============================================================================
+sgemm_merge_tile:
+    movd    r9d, xmm0
+    and     r9d, 0x7FFFFFFF         ; Zero if beta = +-0
+.row:
+    xor     r10d, r10d
+.col:
+    movss   xmm1, [rdx + r10*4]
+    test    r9d, r9d
+    jz      .put
+    movss   xmm2, [rcx + r10*4]
+    mulss   xmm2, xmm0
+    addss   xmm1, xmm2
+.put:
+    movss   [rcx + r10*4], xmm1
+    inc     r10
+    cmp     r10, rsi
+    jb      .col
+    add     rdx, SGEMM_NR*4
+    add     rcx, r8
+    dec     rdi
+    jnz     .row
+    ret
+
+; ============================================================================
+; PACKING
+; ============================================================================
+
+; ============================================================================
+; FUNCTION: sgemm_pack_a
+; Description: Pack an mc x kc block of A into micro-panels of 6 rows:
+;              panel i holds alpha * A[6i + r][p] at (p*6 + r), rows past
+;              mc are zero
+; Arguments: RDI = mc, RSI = kc, RDX = A block, RCX = lda in bytes,
+;            R8 = destination, XMM0 = alpha
+; Clobbers: RAX, RDI, RDX, R8, R9, R10, R11, XMM0-XMM2
+; ============================================================================
+sgemm_pack_a:
+    test    rsi, rsi
+    jz      .done
+    shufps  xmm0, xmm0, 0
+.panel:
+    xor     r9d, r9d                ; Row within the panel
+.row:
+    lea     r11, [r8 + r9*4]        ; Column r of the panel
+    mov     rax, rsi
+    cmp     r9, rdi
+    jae     .zero_row
+    mov     r10, r9
+    imul    r10, rcx
+    add     r10, rdx                ; Source row
+
+    ; Four elements of the row = four k steps of the panel
+.quad:
+    cmp     rax, 4
+    jb      .single
+    movups  xmm1, [r10]
+    mulps   xmm1, xmm0
+    movss   [r11], xmm1
+    pshufd  xmm2, xmm1, 0x55
+    movss   [r11 + 24], xmm2
+    pshufd  xmm2, xmm1, 0xAA
+    movss   [r11 + 48], xmm2
+    pshufd  xmm2, xmm1, 0xFF
+    movss   [r11 + 72], xmm2
+    add     r10, 16
+    add     r11, 4*24
+    sub     rax, 4
+    jmp     .quad
+.single:
+    test    rax, rax
+    jz      .next_row
+    movss   xmm1, [r10]
+    mulss   xmm1, xmm0
+    movss   [r11], xmm1
+    add     r10, 4
+    add     r11, 24
+    dec     rax
+    jmp     .single
+
+.zero_row:
+    xorps   xmm1, xmm1
+.zero:
+    movss   [r11], xmm1
+    add     r11, 24
+    dec     rax
+    jnz     .zero
+
+.next_row:
+    inc     r9
+    cmp     r9, SGEMM_MR
+    jb      .row
+
+    lea     rax, [rsi + rsi*2]
+    lea     r8, [r8 + rax*8]        ; Next panel: 24 bytes per k
+    lea     rax, [rcx + rcx*2]
+    lea     rdx, [rdx + rax*2]      ; 6 rows down
+    sub     rdi, SGEMM_MR
+    ja      .panel
+.done:
+    ret
+
+; ============================================================================
+; FUNCTION: sgemm_pack_b
+; Description: Pack a kc x nc block of B into micro-panels of 16 columns:
+;              panel j holds B[p][16j + c] at (p*16 + c), columns past nc
+;              are zero. The destination must be 16-byte aligned.
+; Arguments: RDI = kc, RSI = nc, RDX = B block, RCX = ldb in bytes,
+;            R8 = destination
+; Clobbers: RSI, RDX, R8, R9, R10, R11, XMM0-XMM4
+; ============================================================================
+sgemm_pack_b:
+    test    rdi, rdi
+    jz      .done
+    xorps   xmm4, xmm4
+.panel:
+    mov     r9, rdx
+    mov     r10, rdi
+    cmp     rsi, SGEMM_NR
+    jb      .partial
+.full:
+    movups  xmm0, [r9]
+    movups  xmm1, [r9 + 16]
+    movups  xmm2, [r9 + 32]
+    movups  xmm3, [r9 + 48]
+    movaps  [r8], xmm0
+    movaps  [r8 + 16], xmm1
+    movaps  [r8 + 32], xmm2
+    movaps  [r8 + 48], xmm3
+    add     r9, rcx
+    add     r8, 64
+    dec     r10
+    jnz     .full
+    add     rdx, SGEMM_NR*4
+    sub     rsi, SGEMM_NR
+    jnz     .panel
+.done:
+    ret
+
+    ; Last panel, 1-15 columns
+.partial:
+    movaps  [r8], xmm4
+    movaps  [r8 + 16], xmm4
+    movaps  [r8 + 32], xmm4
+    movaps  [r8 + 48], xmm4
+    xor     r11d, r11d
+.partial_col:
+    movss   xmm0, [r9 + r11*4]
+    movss   [r8 + r11*4], xmm0
+    inc     r11
+    cmp     r11, rsi
+    jb      .partial_col
+    add     r9, rcx
+    add     r8, 64
+    dec     r10
+    jnz     .partial
+    ret
+
+; ============================================================================
+; BLOCKED DRIVER
+; ============================================================================
+
+; Locals of sgemm_block (RSP is 64-byte aligned)
+L_NC            equ 0
+L_PC            equ 8
+L_KC            equ 16
+L_MC            equ 24
+L_NR            equ 32
+L_MR            equ 40
+L_BPANEL        equ 48
+L_CPTR          equ 56
+L_BETA          equ 64              ; float
+L_TILE          equ 128             ; 6 x 16 floats for edge tiles
+
+; ============================================================================
+; FUNCTION: sgemm_block
+; Description: Compute one job (a whole product or one thread's share)
+; Arguments: RDI = job
+; Clobbers: RAX, RCX, RDX, RSI, RDI, R8-R11, all vector registers
+; ============================================================================
+sgemm_block:
+    push    rbp
+    mov     rbp, rsp
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, 512
+    and     rsp, -64
+
+    mov     rbx, rdi
+    cmp     qword [rbx + JOB_M], 0
+    je      .done
+    cmp     qword [rbx + JOB_N], 0
+    je      .done
+
+    xor     r15d, r15d              ; R15 = jc
+.jc_loop:
+    mov     rax, [rbx + JOB_N]
+    sub     rax, r15
+    mov     ecx, SGEMM_NC
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + L_NC], rax
+    mov     qword [rsp + L_PC], 0
+
+    ; Runs at least once: with K = 0 the kernel still applies beta
+.pc_loop:
+    mov     rax, [rbx + JOB_K]
+    sub     rax, [rsp + L_PC]
+    mov     ecx, SGEMM_KC
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + L_KC], rax
+
+    ; The first KC slice applies the caller's beta, later ones accumulate
+    mov     eax, [rbx + JOB_BETA]
+    mov     ecx, 0x3F800000         ; 1.0f
+    cmp     qword [rsp + L_PC], 0
+    cmovne  eax, ecx
+    mov     [rsp + L_BETA], eax
+
+    mov     rdi, [rsp + L_KC]
+    mov     rsi, [rsp + L_NC]
+    mov     rdx, [rsp + L_PC]
+    imul    rdx, [rbx + JOB_LDB]
+    lea     rdx, [rdx + r15*4]
+    add     rdx, [rbx + JOB_B]
+    mov     rcx, [rbx + JOB_LDB]
+    mov     r8, [rbx + JOB_BBUF]
+    call    sgemm_pack_b
+
+    xor     r14d, r14d              ; R14 = ic
+.ic_loop:
+    mov     rax, [rbx + JOB_M]
+    sub     rax, r14
+    mov     ecx, SGEMM_MC
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + L_MC], rax
+
+    mov     rdi, rax
+    mov     rsi, [rsp + L_KC]
+    mov     rdx, r14
+    imul    rdx, [rbx + JOB_LDA]
+    mov     rax, [rsp + L_PC]
+    lea     rdx, [rdx + rax*4]
+    add     rdx, [rbx + JOB_A]
+    mov     rcx, [rbx + JOB_LDA]
+    mov     r8, [rbx + JOB_ABUF]
+    movss   xmm0, [rbx + JOB_ALPHA]
+    call    sgemm_pack_a
+
+    xor     r13d, r13d              ; R13 = jr
+.jr_loop:
+    mov     rax, [rsp + L_NC]
+    sub     rax, r13
+    mov     ecx, SGEMM_NR
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + L_NR], rax
+    mov     rax, r13
+    imul    rax, [rsp + L_KC]
+    shl     rax, 2
+    add     rax, [rbx + JOB_BBUF]
+    mov     [rsp + L_BPANEL], rax
+
+    xor     r12d, r12d              ; R12 = ir
+.ir_loop:
+    mov     rax, [rsp + L_MC]
+    sub     rax, r12
+    mov     ecx, SGEMM_MR
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + L_MR], rax
+
+    lea     rcx, [r14 + r12]        ; C + (ic + ir)*ldc + (jc + jr)*4
+    imul    rcx, [rbx + JOB_LDC]
+    lea     rax, [r15 + r13]
+    lea     rcx, [rcx + rax*4]
+    add     rcx, [rbx + JOB_C]
+    mov     rdi, [rsp + L_KC]
+    mov     rsi, r12
+    imul    rsi, rdi
+    shl     rsi, 2
+    add     rsi, [rbx + JOB_ABUF]
+    mov     rdx, [rsp + L_BPANEL]
+    mov     r8, [rbx + JOB_LDC]
+    movss   xmm0, [rsp + L_BETA]
+
+    cmp     qword [rsp + L_MR], SGEMM_MR
+    jne     .edge
+    cmp     qword [rsp + L_NR], SGEMM_NR
+    jne     .edge
+    call    [sgemm_kernel]
+    jmp     .ir_next
+
+    ; Partial tile: full 6x16 product into the tile, then merge
+.edge:
+    mov     [rsp + L_CPTR], rcx
+    lea     rcx, [rsp + L_TILE]
+    mov     r8d, SGEMM_NR*4
+    xorps   xmm0, xmm0
+    call    [sgemm_kernel]
+    mov     rdi, [rsp + L_MR]
+    mov     rsi, [rsp + L_NR]
+    lea     rdx, [rsp + L_TILE]
+    mov     rcx, [rsp + L_CPTR]
+    mov     r8, [rbx + JOB_LDC]
+    movss   xmm0, [rsp + L_BETA]
+    call    sgemm_merge_tile
+
+.ir_next:
+    add     r12, SGEMM_MR
+    cmp     r12, [rsp + L_MC]
+    jb      .ir_loop
+    add     r13, SGEMM_NR
+    cmp     r13, [rsp + L_NC]
+    jb      .jr_loop
+    add     r14, SGEMM_MC
+    cmp     r14, [rbx + JOB_M]
+    jb      .ic_loop
+    mov     rax, [rsp + L_PC]
+    add     rax, SGEMM_KC
+    mov     [rsp + L_PC], rax
+    cmp     rax, [rbx + JOB_K]
+    jb      .pc_loop
+    add     r15, SGEMM_NC
+    cmp     r15, [rbx + JOB_N]
+    jb      .jc_loop
+
+.done:
+    lea     rsp, [rbp - 40]
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    pop     rbp
+    ret
+
+; ============================================================================
+; PUBLIC ENTRY POINTS
+; ============================================================================
+
+; ============================================================================
+; FUNCTION: sgemm
+; Description: C = alpha * A * B + beta * C on the calling thread
+; ============================================================================
+sgemm:
+    mov     eax, 1
+    jmp     sgemm_run
+
+; ============================================================================
+; FUNCTION: sgemm_mt
+; Description: Same as sgemm, split over up to [rsp+32] threads
+;              (at most SGEMM_MAX_THREADS; the caller is one of them)
+; ============================================================================
+sgemm_mt:
+    mov     rax, [rsp + 32]
+    ; Fall through
+
+; ----------------------------------------------------------------------------
+; sgemm_run: RAX = requested threads, other arguments as for sgemm.
+;
+; C is cut into independent blocks - column strips when N >= M, row strips
+; otherwise, in whole 16-column / 6-row tiles - and every thread runs the
+; full blocked algorithm on its strip with its own packing buffers. No
+; synchronisation is needed until the final join. Worker threads are raw
+; clone()s on static stacks: no libc, and the caller does the first strip.
+; ----------------------------------------------------------------------------
+; Locals (RSP-relative): template job (JOB_SIZE), then
+S_THREADS       equ JOB_SIZE
+S_STEP          equ JOB_SIZE + 8    ; Rows or columns per strip
+S_COUNT         equ JOB_SIZE + 16   ; Jobs created
+S_FRAME         equ JOB_SIZE + 32
+
+sgemm_run:
+    push    rbp
+    mov     rbp, rsp
+    push    rbx
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    sub     rsp, S_FRAME + 8        ; Keeps RSP 16-byte aligned
+
+    test    rdi, rdi
+    jz      .done
+    test    rsi, rsi
+    jz      .done
+
+    ; Template job for the whole product (leading dimensions in bytes)
+    mov     [rsp + JOB_M], rdi
+    mov     [rsp + JOB_N], rsi
+    mov     [rsp + JOB_K], rdx
+    mov     [rsp + JOB_A], rcx
+    shl     r8, 2
+    mov     [rsp + JOB_LDA], r8
+    mov     [rsp + JOB_B], r9
+    mov     r10, [rbp + 16]
+    shl     r10, 2
+    mov     [rsp + JOB_LDB], r10
+    mov     r10, [rbp + 24]
+    mov     [rsp + JOB_C], r10
+    mov     r10, [rbp + 32]
+    shl     r10, 2
+    mov     [rsp + JOB_LDC], r10
+    movss   [rsp + JOB_ALPHA], xmm0
+    movss   [rsp + JOB_BETA], xmm1
+
+    ; Threads: 1..SGEMM_MAX_THREADS
+    mov     ecx, 1
+    test    rax, rax
+    cmovz   rax, rcx
+    mov     ecx, SGEMM_MAX_THREADS
+    cmp     rax, rcx
+    cmova   rax, rcx
+    mov     [rsp + S_THREADS], rax
+
+    ; Strip size: ceil(tiles / threads) whole tiles along the longer side
+    mov     r12d, SGEMM_NR          ; R12 = tile size along the split
+    mov     r13, rsi                ; R13 = length of the split side
+    cmp     rsi, rdi
+    jae     .split
+    mov     r12d, SGEMM_MR
+    mov     r13, rdi
+.split:
+    lea     rax, [r13 + r12 - 1]
+    xor     edx, edx
+    div     r12                     ; RAX = tiles
+    add     rax, [rsp + S_THREADS]
+    dec     rax
+    xor     edx, edx
+    div     qword [rsp + S_THREADS] ; RAX = tiles per strip
+    imul    rax, r12
+    mov     [rsp + S_STEP], rax
+
+    ; Build the jobs: job t covers [t*step, min((t+1)*step, length))
+    xor     r14d, r14d              ; R14 = t
+    xor     r15d, r15d              ; R15 = start of the strip
+.build:
+    mov     rbx, r14
+    shl     rbx, 7                  ; * JOB_SIZE
+    lea     rdi, [sgemm_jobs]
+    add     rbx, rdi
+    mov     rdi, rbx
+    mov     rsi, rsp
+    mov     ecx, JOB_SIZE / 8
+    rep     movsq
+
+    mov     rax, r13
+    sub     rax, r15
+    mov     rcx, [rsp + S_STEP]
+    cmp     rax, rcx
+    cmova   rax, rcx                ; RAX = strip length
+    cmp     r12d, SGEMM_NR
+    jne     .rows
+    mov     [rbx + JOB_N], rax
+    lea     rax, [r15*4]
+    add     [rbx + JOB_B], rax
+    add     [rbx + JOB_C], rax
+    jmp     .buffers
+.rows:
+    mov     [rbx + JOB_M], rax
+    mov     rax, r15
+    imul    rax, [rsp + JOB_LDA]
+    add     [rbx + JOB_A], rax
+    mov     rax, r15
+    imul    rax, [rsp + JOB_LDC]
+    add     [rbx + JOB_C], rax
+.buffers:
+    mov     rax, r14
+    imul    rax, rax, ABUF_BYTES
+    lea     rcx, [sgemm_abuf]
+    add     rax, rcx
+    mov     [rbx + JOB_ABUF], rax
+    mov     rax, r14
+    imul    rax, rax, BBUF_BYTES
+    lea     rcx, [sgemm_bbuf]
+    add     rax, rcx
+    mov     [rbx + JOB_BBUF], rax
+    mov     dword [rbx + JOB_TID], 0
+
+    inc     r14
+    add     r15, [rsp + S_STEP]
+    cmp     r15, r13
+    jb      .build
+    mov     [rsp + S_COUNT], r14
+
+    ; Start jobs 1.. on new threads
+    mov     r14d, 1
+.spawn:
+    cmp     r14, [rsp + S_COUNT]
+    jae     .own
+    mov     rbx, r14
+    shl     rbx, 7
+    lea     rax, [sgemm_jobs]
+    add     rbx, rax
+
+    mov     rsi, r14                ; Stack of thread t: slot t - 1
+    imul    rsi, rsi, SGEMM_STACK
+    lea     rax, [sgemm_stacks]
+    lea     rsi, [rsi + rax - 16]
+    mov     [rsi], rbx              ; The child finds its job at [rsp]
+
+    mov     edi, CLONE_THREAD_FLAGS
+    lea     rdx, [rbx + JOB_TID]    ; Parent TID slot
+    mov     r10, rdx                ; Child-cleared TID slot
+    xor     r8d, r8d
+    mov     eax, SYS_CLONE
+    syscall
+    test    rax, rax
+    jz      .child
+    jns     .spawned
+
+    ; clone failed: do the job here instead
+    mov     rdi, rbx
+    call    sgemm_block
+.spawned:
+    inc     r14
+    jmp     .spawn
+
+.own:
+    lea     rdi, [sgemm_jobs]
+    call    sgemm_block
+
+    ; Join: each TID word drops to 0 (with a futex wake) when its thread
+    ; has exited
+    mov     r14d, 1
+.join:
+    cmp     r14, [rsp + S_COUNT]
+    jae     .done
+    mov     rbx, r14
+    shl     rbx, 7
+    lea     rax, [sgemm_jobs + JOB_TID]
+    add     rbx, rax
+.wait:
+    mov     edx, [rbx]
+    test    edx, edx
+    jz      .joined
+    mov     rdi, rbx
+    mov     esi, FUTEX_WAIT         ; Sleeps only while *rdi == EDX
+    xor     r10d, r10d
+    mov     eax, SYS_FUTEX
+    syscall
+    jmp     .wait
+.joined:
+    inc     r14
+    jmp     .join
+
+.done:
+    lea     rsp, [rbp - 40]
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    pop     rbx
+    pop     rbp
+    ret
+
+    ; New thread: RSP = its stack, [rsp] = job; exit only this thread
+.child:
+    mov     rdi, [rsp]
+    call    sgemm_block
+    mov     eax, SYS_EXIT
+    xor     edi, edi
+    syscall
+
+; ============================================================================
+; FUNCTION: sgemm_init
+; Description: Use the AVX2/FMA microkernel if the CPU and OS support it
+;              (call once, before any thread calls sgemm)
+; Returns: RAX = 1 if the AVX2/FMA kernel was selected, 0 for SSE2
+; ============================================================================
+sgemm_init:
+    push    rbx                     ; CPUID writes EBX (callee-saved)
+
+    xor     eax, eax
+    cpuid
+    cmp     eax, 7
+    jb      .no
+
+    mov     eax, 1
+    cpuid
+    bt      ecx, 12                 ; FMA
+    jnc     .no
+    bt      ecx, 27                 ; OSXSAVE: XGETBV usable
+    jnc     .no
+    bt      ecx, 28                 ; AVX
+    jnc     .no
+    xor     ecx, ecx
+    xgetbv
+    and     eax, 0x06
+    cmp     eax, 0x06               ; XMM and YMM state saved by the OS
+    jne     .no
+
+    mov     eax, 7
+    xor     ecx, ecx
+    cpuid
+    bt      ebx, 5                  ; AVX2
+    jnc     .no
+
+    lea     rax, [sgemm_kernel_6x16_avx2]
+    mov     [sgemm_kernel], rax
+    mov     eax, 1
+    pop     rbx
+    ret
+
+.no:
+    xor     eax, eax
+    pop     rbx
+    ret
+
+%ifndef LIBRARY
+; ============================================================================
+; SELF-CHECK
+; ============================================================================
+;
+; Small integers in [-3, 3] with alpha = 2 keep every partial sum exact in
+; float, so the blocked, packed and threaded product must match a naive
+; triple loop bit for bit whatever order it adds in. The leading
+; dimensions exceed the row lengths (lda = K+1, ldb = N+2, ldc = N+3):
+; the padding columns of C must come back untouched.
+;
+; ============================================================================
+
+; verify_fill: RDI = floats, RSI = count, EDX = seed -> small integers
+verify_fill:
+    test    rsi, rsi
+    jz      .done
+.loop:
+    imul    edx, edx, 1103515245
+    add     edx, 12345
+    mov     eax, edx
+    shr     eax, 16
+    mov     r8d, 7
+    push    rdx
+    xor     edx, edx
+    div     r8d
+    lea     eax, [rdx - 3]
+    pop     rdx
+    cvtsi2ss xmm0, eax
+    movss   [rdi], xmm0
+    add     rdi, 4
+    dec     rsi
+    jnz     .loop
+.done:
+    ret
+
+; verify_case: RBX = case -> RAX = 0 if sgemm_mt matches the reference
+verify_case:
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    push    rbp
+
+    mov     r12, [rbx]              ; M
+    mov     r13, [rbx + 8]          ; N
+    mov     r14, [rbx + 16]         ; K
+
+    ; A: M x (K+1), B: K x (N+2), C and ref: M x (N+3)
+    lea     rdi, [verify_a]
+    lea     rsi, [r14 + 1]
+    imul    rsi, r12
+    mov     edx, 1
+    call    verify_fill
+    lea     rdi, [verify_b]
+    lea     rsi, [r13 + 2]
+    imul    rsi, r14
+    mov     edx, 2
+    call    verify_fill
+    lea     rdi, [verify_c]
+    lea     rsi, [r13 + 3]
+    imul    rsi, r12
+    mov     rbp, rsi                ; RBP = floats in C
+    mov     edx, 3
+    call    verify_fill
+
+    ; beta 0 is encoded as NaN: C becomes NaN and must not be read
+    xorps   xmm5, xmm5              ; XMM5 = beta
+    cmp     dword [rbx + 32], 0x7FC00000
+    je      .nan_c
+    movss   xmm5, [rbx + 32]
+    jmp     .ref
+.nan_c:
+    xor     ecx, ecx
+.nan_loop:
+    cmp     rcx, rbp
+    jae     .ref
+    mov     dword [verify_c + rcx*4], 0x7FC00000
+    inc     rcx
+    jmp     .nan_loop
+
+    ; ref = C, then ref[i][j] = sum(2*a*b) + beta*C for the M x N part
+.ref:
+    xor     ecx, ecx
+.copy:
+    cmp     rcx, rbp
+    jae     .ref_rows
+    mov     eax, [verify_c + rcx*4]
+    mov     [verify_ref + rcx*4], eax
+    inc     rcx
+    jmp     .copy
+.ref_rows:
+    mov     eax, 2
+    cvtsi2ss xmm4, eax              ; XMM4 = alpha
+    xor     r8d, r8d                ; i
+.ref_i:
+    cmp     r8, r12
+    jae     .run
+    xor     r9d, r9d                ; j
+.ref_j:
+    cmp     r9, r13
+    jae     .ref_i_next
+    xorps   xmm0, xmm0
+    xor     r10d, r10d              ; p
+.ref_p:
+    cmp     r10, r14
+    jae     .ref_store
+    lea     rax, [r14 + 1]
+    imul    rax, r8
+    add     rax, r10
+    movss   xmm1, [verify_a + rax*4]
+    mulss   xmm1, xmm4
+    lea     rax, [r13 + 2]
+    imul    rax, r10
+    add     rax, r9
+    mulss   xmm1, [verify_b + rax*4]
+    addss   xmm0, xmm1
+    inc     r10
+    jmp     .ref_p
+.ref_store:
+    lea     rax, [r13 + 3]
+    imul    rax, r8
+    add     rax, r9
+    movd    r11d, xmm5
+    test    r11d, r11d
+    jz      .ref_put
+    movss   xmm1, [verify_c + rax*4]
+    mulss   xmm1, xmm5
+    addss   xmm0, xmm1
+.ref_put:
+    movss   [verify_ref + rax*4], xmm0
+    inc     r9
+    jmp     .ref_j
+.ref_i_next:
+    inc     r8
+    jmp     .ref_i
+
+    ; sgemm_mt(M, N, K, 2, A, K+1, B, N+2, beta, C, N+3, threads)
+.run:
+    push    qword [rbx + 24]
+    lea     rax, [r13 + 3]
+    push    rax
+    lea     rax, [verify_c]
+    push    rax
+    lea     rax, [r13 + 2]
+    push    rax
+    mov     rdi, r12
+    mov     rsi, r13
+    mov     rdx, r14
+    movaps  xmm0, xmm4
+    lea     rcx, [verify_a]
+    lea     r8, [r14 + 1]
+    lea     r9, [verify_b]
+    movaps  xmm1, xmm5
+    call    sgemm_mt
+    add     rsp, 32
+
+    ; Bitwise comparison, padding included
+    xor     ecx, ecx
+    xor     eax, eax
+.cmp:
+    cmp     rcx, rbp
+    jae     .done
+    mov     edx, [verify_c + rcx*4]
+    cmp     edx, [verify_ref + rcx*4]
+    jne     .bad
+    inc     rcx
+    jmp     .cmp
+.bad:
+    mov     eax, 1
+.done:
+    pop     rbp
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    ret
+
+; verify_all -> RAX = 0 if every case matches with the current kernel
+verify_all:
+    push    rbx
+    push    r12
+    push    r13
+    lea     rbx, [verify_cases]
+    xor     r12d, r12d
+    mov     r13d, verify_count
+.loop:
+    call    verify_case
+    or      r12, rax
+    add     rbx, VERIFY_CASE
+    dec     r13d
+    jnz     .loop
+    mov     rax, r12
+    pop     r13
+    pop     r12
+    pop     rbx
+    ret
+
+_start:
+    ; SSE2 kernel (the default)
+    call    verify_all
+    mov     r12, rax
+
+    mov     rsi, msg_sse_ok
+    mov     rdx, msg_sse_ok_len
+    test    r12, r12
+    jz      print_sse
+    mov     rsi, msg_sse_bad
+    mov     rdx, msg_sse_bad_len
+print_sse:
+    mov     rax, SYS_WRITE
+    mov     rdi, 1
+    syscall
+
+    ; AVX2/FMA kernel, if sgemm_init selects it
+    call    sgemm_init
+    mov     rsi, msg_no_avx
+    mov     rdx, msg_no_avx_len
+    test    rax, rax
+    jz      print_avx
+
+    call    verify_all
+    mov     r13, rax
+    or      r12, rax
+
+    mov     rsi, msg_avx_ok
+    mov     rdx, msg_avx_ok_len
+    test    r13, r13
+    jz      print_avx
+    mov     rsi, msg_avx_bad
+    mov     rdx, msg_avx_bad_len
+print_avx:
+    mov     rax, SYS_WRITE
+    mov     rdi, 1
+    syscall
+
+    ; Exit with 1 if anything mismatched
+    mov     rax, SYS_EXIT
+    mov     rdi, r12
+    syscall
+%endif
+
+; ============================================================================
+; NOTES: SGEMM
+; ============================================================================
+;
+; Why the tile is 6x16:
+;   Per k step the kernel loads 2 B vectors and broadcasts 6 A values for
+;   12 FMAs: 8 loads per 12 FMAs, below the 2 loads/cycle the core can
+;   sustain, and 12 accumulators cover the FMA latency x throughput
+;   product. 12 + 2 (B) + 2 (A) = all 16 YMM registers. 8x8 or 4x24 tiles
+;   also fit, but 6x16 has the best FMA:load ratio for 16 registers.
+;
+; Blocking sizes:
+;   KC keeps one B micro-panel (KC x 16) in L1 while the kernel sweeps the
+;   A block; MC keeps the packed A block in L2; NC keeps the packed B block
+;   in (a share of) L3. The values suit cores with 32-48 KiB L1d and
+;   >= 256 KiB L2; tune SGEMM_KC/MC/NC for other parts (MC must stay a
+;   multiple of 6 and NC of 16).
+;
+; Edge tiles:
+;   Packing pads A and B with zeros to whole tiles, so the kernel always
+;   computes 6x16. Partial tiles go to a stack tile and only their valid
+;   mr x nr part is merged into C - C is never read or written past its
+;   edges.
+;
+; Threads:
+;   Every thread owns a strip of C and repacks the parts of A and B it
+;   needs. That duplicates some packing (each thread packs its own copy of
+;   the shared operand) but needs no barriers; BLIS instead shares one
+;   packed B block and splits the ic/jr loops, which scales better on many
+;   cores at the price of synchronisation per block.
+;   The workers are clone(CLONE_THREAD) threads without libc state: they
+;   share the caller's TLS pointer and must not call libc, which the
+;   kernels never do. Packing buffers and stacks are static (~35 MiB of
+;   .bss, only touched pages cost memory), so sgemm/sgemm_mt must not be
+;   called from two threads at once.
+;
+; Not covered:
+;   - Transposed operands (pack from the transposed layout instead)
+;   - Column-major storage (swap A and B: C^T = B^T A^T)
+;   - Small-matrix fast paths that skip packing for tiny M, N or K
+;
+; ============================================================================
@@ -0,0 +1,47 @@
+/*
+ * ============================================================================
+ * File: 15_sgemm.h
+ * Description: C interface to the SGEMM routines in 15_sgemm.asm
+ * Build: nasm -f elf64 -DLIBRARY 15_sgemm.asm -o 15_lib.o
+ *        gcc -O2 -no-pie your_program.c 15_lib.o
+ * ============================================================================
+ *
+ *   C = alpha * A * B + beta * C
+ *
+ * A is M x K, B is K x N and C is M x N, all row-major with leading
+ * dimensions (in elements) lda >= K, ldb >= N, ldc >= N. beta == 0 never
+ * reads C. Transposed operands are not supported.
+ *
+ * The SSE2 microkernel is used until sgemm_init() has selected the AVX2/FMA
+ * one. Call it once at startup.
+ *
+ * sgemm_mt() splits C into strips and computes them on up to `threads`
+ * threads (at most 16; the caller is one of them). Both functions use
+ * static packing buffers: do not call them from two threads at once.
+ */
+
+#ifndef SGEMM_H
+#define SGEMM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns 1 if the AVX2/FMA microkernel was selected, 0 if SSE2 stays in use
+int sgemm_init(void);
+
+void sgemm(size_t m, size_t n, size_t k, float alpha,
+           const float *a, size_t lda, const float *b, size_t ldb,
+           float beta, float *c, size_t ldc);
+
+void sgemm_mt(size_t m, size_t n, size_t k, float alpha,
+              const float *a, size_t lda, const float *b, size_t ldb,
+              float beta, float *c, size_t ldc, size_t threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SGEMM_H
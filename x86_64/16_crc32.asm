@@ -0,0 +1,846 @@
+; ============================================================================
+; File: 16_crc32.asm
+; Description: CRC32C, CRC-32 and CRC-64 checksums with SSE4.2 CRC32 and
+;              PCLMULQDQ code paths, plus a fused copy + CRC32C
+; Topics: CRC32 instruction, latency hiding with interleaved streams,
+;         carry-less multiplication, polynomial folding, Barrett reduction,
+;         assemble-time lookup tables
+; Assembler: NASM
+; Build: nasm -f elf64 16_crc32.asm && ld -o 16_crc32 16_crc32.o
+; Run: ./16_crc32   (checks every code path against the table-driven one)
+; Library: nasm -f elf64 -DLIBRARY 16_crc32.asm -o 16_lib.o
+;          (C interface: 16_crc32.h)
+; ============================================================================
+;
+; Three checksums, all "reflected" (least significant bit first) with the
+; usual initial and final inversion, and all chainable the way zlib's
+; crc32() is: crc = f(f(0, a, len_a), b, len_b) == f(0, ab, len_a + len_b)
+;
+;   crc32c      CRC-32C (Castagnoli, 0x1EDC6F41): iSCSI, ext4, Btrfs, SCTP
+;   crc32_ieee  CRC-32 (0x04C11DB7): zlib, gzip, PNG, Ethernet
+;   crc64_xz    CRC-64/XZ (ECMA-182, 0x42F0E1EBA9EA3693): xz, 7-Zip
+;   crc32c_copy memcpy that returns the CRC32C of what it copied
+;
+; Arguments follow the System V ABI:
+;   RDI = crc (0 to start), RSI = buffer, RDX = length
+;   crc32c_copy: RDI = crc, RSI = destination, RDX = source, RCX = length
+;   Result: RAX
+;
+; Code paths (the plain names jump through crc_dispatch, which starts out
+; at the table-driven versions; crc32_init moves it to the fastest one):
+;   _sw     one table lookup per byte, tables built by the assembler
+;   _sse42  CRC32C with the SSE4.2 CRC32 instruction, 8 bytes at a time
+;   _3way   CRC32C on three independent streams, merged with PCLMULQDQ
+;   _pclmul CRC-32 and CRC-64 by PCLMULQDQ folding, 64 bytes per iteration
+;           (any reflected polynomial of up to 64 bits: only the constants
+;           differ)
+;
+; ============================================================================
+
+%ifdef LIBRARY
+    global crc32_init
+    global crc32c, crc32c_copy, crc32_ieee, crc64_xz
+    global crc32c_sw, crc32c_copy_sw, crc32_ieee_sw, crc64_xz_sw
+    global crc32c_sse42, crc32c_copy_sse42
+    global crc32c_3way, crc32c_copy_3way
+    global crc32c_pclmul, crc32_ieee_pclmul, crc64_xz_pclmul
+%else
+global _start
+%endif
+
+CRC_SLOTS       equ 4               ; Entry points per table
+CRC_LONG        equ 8192            ; Bytes per stream, long 3-way blocks
+CRC_SHORT       equ 256             ; Bytes per stream, short 3-way blocks
+VERIFY_MAX_N    equ 320             ; Lengths 0..VERIFY_MAX_N are checked
+VERIFY_BYTES    equ 65536 + 64      ; Size of the verification buffers
+VERIFY_GUARD    equ 0x5A            ; Byte after the end of a copy
+
+; Polynomials, bit-reversed (the form a reflected CRC shifts with). These
+; are %defines because the preprocessor builds the tables from them.
+%define CRC32C_POLY     0x82F63B78
+%define CRC32_POLY      0xEDB88320
+%define CRC64_POLY      0xC96C5795D7870F42
+
+section .data
+    ; Entry points in slot order: crc32c, crc32c_copy, crc32_ieee, crc64_xz
+    crc_dispatch:
+                    dq crc32c_sw, crc32c_copy_sw, crc32_ieee_sw, crc64_xz_sw
+    crc_sw_table:
+                    dq crc32c_sw, crc32c_copy_sw, crc32_ieee_sw, crc64_xz_sw
+    crc_sse42_table:
+                    dq crc32c_sse42, crc32c_copy_sse42, crc32_ieee_sw, crc64_xz_sw
+    crc_pclmul_table:
+                    dq crc32c_3way, crc32c_copy_3way, crc32_ieee_pclmul, crc64_xz_pclmul
+    ; The folding kernels, checked against the tables by the self-test
+    crc_fold_table:
+                    dq crc32c_pclmul, crc32c_copy_3way, crc32_ieee_pclmul, crc64_xz_pclmul
+
+    ; Folding constants, one 48-byte block per polynomial (see NOTES).
+    ; P64 = P * x^(64 - width); refl() is the bit-reversed 64-bit form.
+    ;   +0  refl(x^575 mod P64), refl(x^511 mod P64)   4 x 128-bit fold
+    ;   +16 refl(x^191 mod P64), refl(x^127 mod P64)   1 x 128-bit fold
+    ;   +32 refl(x^128 div P64 - x^64), refl(P64 - x^64)  Barrett
+    align 16
+    crc32c_fold:    dq 0x00000000740EEF02, 0x000000009E4ADDF8
+                    dq 0x00000000F20C0DFE, 0x00000000493C7D27
+                    dq 0xA434F61C6F5389F8, 0x0000000082F63B78
+    crc32_fold:     dq 0x000000008F352D95, 0x000000001D9513D7
+                    dq 0x00000000AE689191, 0x00000000CCAA009E
+                    dq 0x5A72D812FB808B20, 0x00000000EDB88320
+    crc64_fold:     dq 0x6AE3EFBB9DD441F3, 0x081F6054A7842DF4
+                    dq 0xE05DD497CA393AE4, 0xDABE95AFC7875F40
+                    dq 0x4E1F23360B94B1EA, 0xC96C5795D7870F42
+
+    ; 3-way merge: bit-reversed x^(8*2n - 33) and x^(8*n - 33) mod P for
+    ; n = bytes per stream (the CRC32 instruction adds the other x^33)
+    crc32c_shift_long:  dq 0x1DC403CC, 0x54A86326
+    crc32c_shift_short: dq 0xDD7E3B0C, 0xB9E02B86
+
+; CRC_TABLE poly, dd|dq: the 256-entry byte table of a reflected CRC,
+; computed by the preprocessor one bit at a time
+%macro CRC_TABLE 2
+%assign crc_i 0
+%rep 256
+    %assign crc_c crc_i
+    %rep 8
+        %assign crc_c (crc_c >> 1) ^ ((crc_c & 1) * %1)
+    %endrep
+    %2 crc_c
+    %assign crc_i crc_i + 1
+%endrep
+%endmacro
+
+    align 64
+    crc32c_table:   CRC_TABLE CRC32C_POLY, dd
+    crc32_table:    CRC_TABLE CRC32_POLY, dd
+    crc64_table:    CRC_TABLE CRC64_POLY, dq
+
+    ; Long lengths for the self-check (0-terminated): every combination
+    ; of 3-way blocks, 8-byte steps and byte tails
+    verify_lengths: dq 3*CRC_SHORT, 3*CRC_SHORT + 7, 2*3*CRC_SHORT + 15
+                    dq 3*CRC_LONG, 3*CRC_LONG + 3*CRC_SHORT + 13
+                    dq 2*3*CRC_LONG + 2*3*CRC_SHORT + 8*31 + 5
+                    dq VERIFY_BYTES - 64, 0
+
+    check_string:   db "123456789"
+    check_len:      equ $ - check_string
+
+    msg_sw_ok:      db "Table-driven CRCs match the standard check values", 0x0a
+    msg_sw_ok_len:  equ $ - msg_sw_ok
+    msg_sw_bad:     db "Table-driven CRCs MISMATCH the check values", 0x0a
+    msg_sw_bad_len: equ $ - msg_sw_bad
+    msg_sse_ok:     db "SSE4.2 CRC32C matches the tables", 0x0a
+    msg_sse_ok_len: equ $ - msg_sse_ok
+    msg_sse_bad:    db "SSE4.2 CRC32C MISMATCH", 0x0a
+    msg_sse_bad_len: equ $ - msg_sse_bad
+    msg_clmul_ok:   db "3-way CRC32C and PCLMULQDQ folding match the tables", 0x0a
+    msg_clmul_ok_len: equ $ - msg_clmul_ok
+    msg_clmul_bad:  db "3-way CRC32C or PCLMULQDQ folding MISMATCH", 0x0a
+    msg_clmul_bad_len: equ $ - msg_clmul_bad
+    msg_no_sse:     db "SSE4.2 not available: only the tables were checked", 0x0a
+    msg_no_sse_len: equ $ - msg_no_sse
+    msg_no_clmul:   db "PCLMULQDQ not available: folding kernels not checked", 0x0a
+    msg_no_clmul_len: equ $ - msg_no_clmul
+
+section .bss
+    alignb 64
+    verify_src:     resb VERIFY_BYTES
+    verify_dst:     resb VERIFY_BYTES
+
+section .text
+
+; ============================================================================
+; SHARED PIECES
+; ============================================================================
+
+; CRC_BYTES table, entry bytes, crc register: one table lookup per byte
+; RAX = crc register, RSI = data, RDX = length (all advanced). Clobbers RCX.
+%macro CRC_BYTES 3
+    test    rdx, rdx
+    jz      %%done
+%%loop:
+    movzx   ecx, byte [rsi]
+    xor     cl, al                  ; Index = low byte of crc ^ data
+    shr     rax, 8
+    xor     %3, [%1 + rcx*%2]
+    inc     rsi
+    dec     rdx
+    jnz     %%loop
+%%done:
+%endmacro
+
+; CRC32C_BYTES: the same with the CRC32 instruction (RAX = crc register)
+%macro CRC32C_BYTES 0
+    test    rdx, rdx
+    jz      %%done
+%%loop:
+    crc32   eax, byte [rsi]
+    inc     rsi
+    dec     rdx
+    jnz     %%loop
+%%done:
+%endmacro
+
+; CRC32C_QWORDS copy: 8 bytes per CRC32 instruction while RDX >= 8
+; (copy = 1 also stores each quadword to RDI)
+%macro CRC32C_QWORDS 1
+    cmp     rdx, 8
+    jb      %%done
+%%loop:
+    mov     r10, [rsi]
+    crc32   rax, r10
+%if %1
+    mov     [rdi], r10
+    add     rdi, 8
+%endif
+    add     rsi, 8
+    sub     rdx, 8
+    cmp     rdx, 8
+    jae     %%loop
+%%done:
+%endmacro
+
+; ============================================================================
+; TABLE-DRIVEN KERNELS
+; ============================================================================
+
+; CRC_SW name, table, entry bytes, crc register
+%macro CRC_SW 4
+%1:
+    mov     rax, rdi
+    not     %4                      ; 32-bit NOT also clears bits 32-63
+    CRC_BYTES %2, %3, %4
+    not     %4
+    ret
+%endmacro
+
+CRC_SW crc32c_sw, crc32c_table, 4, eax
+CRC_SW crc32_ieee_sw, crc32_table, 4, eax
+CRC_SW crc64_xz_sw, crc64_table, 8, rax
+
+; ----------------------------------------------------------------------------
+; crc32c_copy_sw: RDI = crc, RSI = destination, RDX = source, RCX = length
+; ----------------------------------------------------------------------------
+crc32c_copy_sw:
+    mov     eax, edi
+    not     eax
+    mov     rdi, rsi                ; RDI = destination
+    mov     rsi, rdx                ; RSI = source
+    test    rcx, rcx
+    jz      .done
+.loop:
+    movzx   edx, byte [rsi]
+    mov     [rdi], dl
+    xor     dl, al
+    shr     eax, 8
+    xor     eax, [crc32c_table + rdx*4]
+    inc     rsi
+    inc     rdi
+    dec     rcx
+    jnz     .loop
+.done:
+    not     eax
+    ret
+
+; ============================================================================
+; SSE4.2 KERNELS (one CRC32 instruction stream)
+; ============================================================================
+
+; ----------------------------------------------------------------------------
+; crc32c_sse42: RDI = crc, RSI = buffer, RDX = length
+; ----------------------------------------------------------------------------
+crc32c_sse42:
+    mov     eax, edi
+    not     eax
+
+    ; Bytes up to an 8-byte boundary, so no quadword load splits a line
+.head:
+    test    sil, 7
+    jz      .body
+    test    rdx, rdx
+    jz      .done
+    crc32   eax, byte [rsi]
+    inc     rsi
+    dec     rdx
+    jmp     .head
+
+.body:
+    CRC32C_QWORDS 0
+    CRC32C_BYTES
+.done:
+    not     eax
+    ret
+
+; ----------------------------------------------------------------------------
+; crc32c_copy_sse42: RDI = crc, RSI = destination, RDX = source, RCX = length
+; ----------------------------------------------------------------------------
+crc32c_copy_sse42:
+    mov     eax, edi
+    not     eax
+    mov     rdi, rsi                ; RDI = destination
+    mov     rsi, rdx                ; RSI = source
+    mov     rdx, rcx                ; RDX = length
+
+    CRC32C_QWORDS 1
+    test    rdx, rdx
+    jz      .done
+.tail:
+    movzx   ecx, byte [rsi]
+    crc32   eax, cl
+    mov     [rdi], cl
+    inc     rsi
+    inc     rdi
+    dec     rdx
+    jnz     .tail
+.done:
+    not     eax
+    ret
+
+; ============================================================================
+; 3-WAY CRC32C (SSE4.2 + PCLMULQDQ)
+; ============================================================================
+;
+; CRC32 has a latency of 3 cycles but a throughput of 1 per cycle, so one
+; dependent chain runs at a third of the possible speed. A block of 3n
+; bytes is split into three streams A, B, C of n bytes each, which are
+; summed in parallel (B and C starting from 0), and then merged:
+;
+;   crc(ABC) = crc(A) * x^(16n) + crc(B) * x^(8n) + crc(C)   (mod P)
+;
+; The two multiplications are carry-less multiplies by precomputed
+; constants; one CRC32 of the XOR of both products reduces them mod P.
+;
+
+; CRC32C_3WAY bytes per stream, shift constants, copy
+; RAX = crc register, RSI = source, RDX = length, RDI = destination (copy)
+; Runs whole blocks of 3 * bytes while they fit. With copy = 1 each block
+; is then copied from L1, where the checksum loop has just left it.
+; Clobbers RCX, R8-R10, XMM0-XMM3.
+%macro CRC32C_3WAY 3
+    cmp     rdx, 3 * %1
+    jb      %%done
+%%block:
+    xor     r8d, r8d                ; Stream B
+    xor     r9d, r9d                ; Stream C
+    add     rsi, %1                 ; End of stream A; index runs up to 0
+    mov     rcx, -%1
+%%loop:
+    crc32   rax, qword [rsi + rcx]
+    crc32   r8, qword [rsi + rcx + %1]
+    crc32   r9, qword [rsi + rcx + 2*%1]
+    add     rcx, 8
+    jnz     %%loop
+
+    ; crc = CRC32(0, A * x^(16n-33) ^ B * x^(8n-33)) ^ C
+    movd    xmm0, eax
+    movd    xmm1, r8d
+    pclmulqdq xmm0, [%2], 0x00
+    pclmulqdq xmm1, [%2], 0x10
+    pxor    xmm0, xmm1
+    movq    rcx, xmm0
+    xor     eax, eax
+    crc32   rax, rcx
+    xor     eax, r9d
+
+    add     rsi, 2 * %1
+%if %3
+    add     rdi, 3 * %1
+    mov     rcx, -3 * %1
+%%copy:
+    movdqu  xmm0, [rsi + rcx]
+    movdqu  xmm1, [rsi + rcx + 16]
+    movdqu  xmm2, [rsi + rcx + 32]
+    movdqu  xmm3, [rsi + rcx + 48]
+    movdqu  [rdi + rcx], xmm0
+    movdqu  [rdi + rcx + 16], xmm1
+    movdqu  [rdi + rcx + 32], xmm2
+    movdqu  [rdi + rcx + 48], xmm3
+    add     rcx, 64
+    jnz     %%copy
+%endif
+    sub     rdx, 3 * %1
+    cmp     rdx, 3 * %1
+    jae     %%block
+%%done:
+%endmacro
+
+; ----------------------------------------------------------------------------
+; crc32c_3way: RDI = crc, RSI = buffer, RDX = length
+; ----------------------------------------------------------------------------
+crc32c_3way:
+    mov     eax, edi
+    not     eax
+
+.head:
+    test    sil, 7
+    jz      .body
+    test    rdx, rdx
+    jz      .done
+    crc32   eax, byte [rsi]
+    inc     rsi
+    dec     rdx
+    jmp     .head
+
+.body:
+    CRC32C_3WAY CRC_LONG, crc32c_shift_long, 0
+    CRC32C_3WAY CRC_SHORT, crc32c_shift_short, 0
+    CRC32C_QWORDS 0
+    CRC32C_BYTES
+.done:
+    not     eax
+    ret
+
+; ----------------------------------------------------------------------------
+; crc32c_copy_3way: RDI = crc, RSI = destination, RDX = source, RCX = length
+; ----------------------------------------------------------------------------
+crc32c_copy_3way:
+    mov     eax, edi
+    not     eax
+    mov     rdi, rsi                ; RDI = destination
+    mov     rsi, rdx                ; RSI = source
+    mov     rdx, rcx                ; RDX = length
+
+    CRC32C_3WAY CRC_LONG, crc32c_shift_long, 1
+    CRC32C_3WAY CRC_SHORT, crc32c_shift_short, 1
+    CRC32C_QWORDS 1
+    test    rdx, rdx
+    jz      .done
+.tail:
+    movzx   ecx, byte [rsi]
+    crc32   eax, cl
+    mov     [rdi], cl
+    inc     rsi
+    inc     rdi
+    dec     rdx
+    jnz     .tail
+.done:
+    not     eax
+    ret
+
+; ============================================================================
+; PCLMULQDQ FOLDING (any reflected CRC of up to 64 bits)
+; ============================================================================
+
+; FOLD acc, constants, scratch, next data block (XMM register)
+; acc = acc.lo * constants.lo ^ acc.hi * constants.hi ^ next
+%macro FOLD 4
+    movdqa  %3, %1
+    pclmulqdq %1, %2, 0x00
+    pclmulqdq %3, %2, 0x11
+    pxor    %1, %3
+    pxor    %1, %4
+%endmacro
+
+; CRC_FOLD name, constants, table, entry bytes, crc register
+; RDI = crc, RSI = buffer, RDX = length. Buffers shorter than 64 bytes,
+; and the last 0-15 bytes of longer ones, go through the table.
+%macro CRC_FOLD 5
+%1:
+    mov     rax, rdi
+    not     %5
+    cmp     rdx, 64
+    jb      .tail
+
+    ; Four accumulators = the first 64 bytes, with the crc added to the
+    ; first bytes of the message (that is what a reflected CRC register is)
+    movq    xmm4, rax
+    movdqu  xmm0, [rsi]
+    movdqu  xmm1, [rsi + 16]
+    movdqu  xmm2, [rsi + 32]
+    movdqu  xmm3, [rsi + 48]
+    pxor    xmm0, xmm4
+    add     rsi, 64
+    sub     rdx, 64
+
+    ; Fold each accumulator 512 bits forward onto the next 64 bytes
+    movdqa  xmm4, [%2]
+    cmp     rdx, 64
+    jb      .fold4
+.loop64:
+    movdqu  xmm9, [rsi]
+    movdqu  xmm10, [rsi + 16]
+    movdqu  xmm11, [rsi + 32]
+    movdqu  xmm12, [rsi + 48]
+    FOLD    xmm0, xmm4, xmm5, xmm9
+    FOLD    xmm1, xmm4, xmm6, xmm10
+    FOLD    xmm2, xmm4, xmm7, xmm11
+    FOLD    xmm3, xmm4, xmm8, xmm12
+    add     rsi, 64
+    sub     rdx, 64
+    cmp     rdx, 64
+    jae     .loop64
+
+    ; Fold the four accumulators into one, then 16 bytes at a time
+.fold4:
+    movdqa  xmm4, [%2 + 16]
+    FOLD    xmm0, xmm4, xmm5, xmm1
+    FOLD    xmm0, xmm4, xmm5, xmm2
+    FOLD    xmm0, xmm4, xmm5, xmm3
+    cmp     rdx, 16
+    jb      .reduce
+.loop16:
+    movdqu  xmm1, [rsi]
+    FOLD    xmm0, xmm4, xmm5, xmm1
+    add     rsi, 16
+    sub     rdx, 16
+    cmp     rdx, 16
+    jae     .loop16
+
+    ; 128 -> 64 bits: T = X * x^64 (mod P64), T1 = high-order half
+.reduce:
+    movdqa  xmm1, xmm0
+    pclmulqdq xmm0, xmm4, 0x10      ; X.lo * x^127 (the other x from PCLMUL)
+    psrldq  xmm1, 8
+    pxor    xmm0, xmm1
+    movq    rax, xmm0               ; T1
+    pextrq  rcx, xmm0, 1            ; T0
+
+    ; Barrett: q = floor(T1 * x^128 / P64) / x^64, crc = (q * P64 + T) mod x^64
+    movdqa  xmm5, [%2 + 32]
+    pclmulqdq xmm0, xmm5, 0x00      ; T1 * mu'
+    movq    r8, xmm0
+    shl     r8, 1                   ; Bits 64-127 of the product
+    xor     rax, r8                 ; q = T1 + T1 * mu' / x^64
+    movq    xmm0, rax
+    pclmulqdq xmm0, xmm5, 0x10      ; q * P64'
+    movq    r8, xmm0
+    pextrq  rax, xmm0, 1
+    shld    rax, r8, 1              ; Bits 0-63 of the product
+    xor     rax, rcx
+
+.tail:
+    CRC_BYTES %3, %4, %5
+    not     %5
+    ret
+%endmacro
+
+CRC_FOLD crc32c_pclmul, crc32c_fold, crc32c_table, 4, eax
+CRC_FOLD crc32_ieee_pclmul, crc32_fold, crc32_table, 4, eax
+CRC_FOLD crc64_xz_pclmul, crc64_fold, crc64_table, 8, rax
+
+; ============================================================================
+; DISPATCH
+; ============================================================================
+
+; CRC_ENTRY name, slot: public entry point that jumps to the selected
+; implementation (arguments are passed through untouched)
+%macro CRC_ENTRY 2
+%1:
+    jmp     [crc_dispatch + %2 * 8]
+%endmacro
+
+CRC_ENTRY crc32c, 0
+CRC_ENTRY crc32c_copy, 1
+CRC_ENTRY crc32_ieee, 2
+CRC_ENTRY crc64_xz, 3
+
+; ============================================================================
+; FUNCTION: crc32_init
+; Description: Select the fastest CRC code paths the CPU supports
+;              (call once, before other threads use the crc* entries)
+; Returns: RAX = 2 for SSE4.2 + PCLMULQDQ, 1 for SSE4.2 only, 0 for tables
+; ============================================================================
+crc32_init:
+    push    rbx                     ; CPUID writes EBX (callee-saved)
+
+    mov     eax, 1
+    cpuid
+    xor     eax, eax
+    bt      ecx, 20                 ; SSE4.2: CRC32
+    jnc     .done
+    lea     rsi, [crc_sse42_table]
+    inc     eax
+    bt      ecx, 1                  ; PCLMULQDQ
+    jnc     .select
+    lea     rsi, [crc_pclmul_table]
+    inc     eax
+
+.select:
+    lea     rdi, [crc_dispatch]
+    mov     ecx, CRC_SLOTS
+    rep     movsq
+.done:
+    pop     rbx
+    ret
+
+; ============================================================================
+; SELF-CHECK
+; ============================================================================
+;
+; The tables are checked against the published check values (the CRC of
+; "123456789"). Every other code path must then give the same result as
+; the tables for every length 0..VERIFY_MAX_N at every alignment mod 8,
+; and for lengths that run through the long and short 3-way blocks. The
+; copies must also reproduce the source and stop at the last byte.
+;
+
+%ifndef LIBRARY
+; ----------------------------------------------------------------------------
+; verify_tier: RBX = entry points (slot order of crc_dispatch)
+; Returns RAX = 0 if everything matches, 1 otherwise
+; ----------------------------------------------------------------------------
+verify_tier:
+    push    r12
+    push    r13
+    push    r14
+    push    r15
+    push    rbp
+
+    xor     r12d, r12d              ; Length
+.short_loop:
+    mov     r13, r12
+    and     r13, 7                  ; Offset
+    call    .check
+    test    eax, eax
+    jnz     .fail
+    inc     r12
+    cmp     r12, VERIFY_MAX_N
+    jbe     .short_loop
+
+    lea     rbp, [verify_lengths]
+.long_loop:
+    mov     r12, [rbp]
+    test    r12, r12
+    jz      .pass
+    mov     r13, r12
+    and     r13, 7
+    call    .check
+    test    eax, eax
+    jnz     .fail
+    add     rbp, 8
+    jmp     .long_loop
+
+.pass:
+    xor     eax, eax
+    jmp     .done
+.fail:
+    mov     eax, 1
+.done:
+    pop     rbp
+    pop     r15
+    pop     r14
+    pop     r13
+    pop     r12
+    ret
+
+; R12 = length, R13 = offset (clobbered). Returns EAX = 0 if every slot
+; matches.
+.check:
+    lea     r14, [verify_src + r13]
+    imul    r15d, r12d, 0x9E3779B9  ; Some non-zero starting crc
+
+    ; crc32c, crc32_ieee and crc64_xz against the tables
+%assign slot 0
+%rep 4
+%if slot != 1
+    mov     edi, r15d
+    mov     rsi, r14
+    mov     rdx, r12
+    call    [crc_sw_table + slot*8]
+    push    rax
+    mov     edi, r15d
+    mov     rsi, r14
+    mov     rdx, r12
+    call    [rbx + slot*8]
+    pop     rcx
+    cmp     rax, rcx
+    jne     .check_bad
+%endif
+%assign slot slot + 1
+%endrep
+
+    ; crc32c_copy to a different alignment, guard byte after the end
+    mov     rdi, r12
+    neg     rdi
+    and     rdi, 7
+    lea     r13, [verify_dst + rdi]
+    mov     byte [r13 + r12], VERIFY_GUARD
+    mov     edi, r15d
+    mov     rsi, r13
+    mov     rdx, r14
+    mov     rcx, r12
+    call    [rbx + 8]
+    push    rax
+    mov     edi, r15d
+    mov     rsi, r14
+    mov     rdx, r12
+    call    crc32c_sw
+    pop     rcx
+    cmp     eax, ecx
+    jne     .check_bad
+    cmp     byte [r13 + r12], VERIFY_GUARD
+    jne     .check_bad
+    mov     rsi, r14
+    mov     rdi, r13
+    mov     rcx, r12
+    repe    cmpsb
+    jne     .check_bad
+    xor     eax, eax
+    ret
+.check_bad:
+    mov     eax, 1
+    ret
+
+; ============================================================================
+; MAIN PROGRAM
+; ============================================================================
+
+_start:
+    ; Fill the source with xorshift64 noise
+    mov     rax, 0x2545F4914F6CDD1D
+    lea     rdi, [verify_src]
+    mov     ecx, VERIFY_BYTES / 8
+.fill:
+    mov     rdx, rax
+    shl     rdx, 13
+    xor     rax, rdx
+    mov     rdx, rax
+    shr     rdx, 7
+    xor     rax, rdx
+    mov     rdx, rax
+    shl     rdx, 17
+    xor     rax, rdx
+    stosq
+    dec     ecx
+    jnz     .fill
+
+    ; Tables against the standard check values
+    xor     r12d, r12d
+    xor     edi, edi
+    lea     rsi, [check_string]
+    mov     edx, check_len
+    call    crc32c_sw
+    cmp     eax, 0xE3069283
+    setne   r12b
+    xor     edi, edi
+    lea     rsi, [check_string]
+    mov     edx, check_len
+    call    crc32_ieee_sw
+    cmp     eax, 0xCBF43926
+    setne   al
+    or      r12b, al
+    xor     edi, edi
+    lea     rsi, [check_string]
+    mov     edx, check_len
+    call    crc64_xz_sw
+    mov     rcx, 0x995DC9BBDF1939FA
+    cmp     rax, rcx
+    setne   al
+    or      r12b, al
+    lea     rbx, [crc_sw_table]
+    call    verify_tier             ; The copy loop, and a sanity check
+    or      r12d, eax
+
+    mov     rsi, msg_sw_ok
+    mov     rdx, msg_sw_ok_len
+    test    r12d, r12d
+    jz      print_sw
+    mov     rsi, msg_sw_bad
+    mov     rdx, msg_sw_bad_len
+print_sw:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+
+    ; Hardware paths, as far as crc32_init finds them
+    call    crc32_init
+    mov     r13, rax
+    mov     rsi, msg_no_sse
+    mov     rdx, msg_no_sse_len
+    test    r13, r13
+    jz      print_last
+
+    lea     rbx, [crc_sse42_table]
+    call    verify_tier
+    or      r12d, eax
+    mov     rsi, msg_sse_ok
+    mov     rdx, msg_sse_ok_len
+    test    eax, eax
+    jz      print_sse
+    mov     rsi, msg_sse_bad
+    mov     rdx, msg_sse_bad_len
+print_sse:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+
+    mov     rsi, msg_no_clmul
+    mov     rdx, msg_no_clmul_len
+    cmp     r13, 2
+    jb      print_last
+
+    lea     rbx, [crc_pclmul_table]
+    call    verify_tier
+    mov     r14d, eax
+    lea     rbx, [crc_fold_table]
+    call    verify_tier
+    or      r14d, eax
+    or      r12d, r14d
+    mov     rsi, msg_clmul_ok
+    mov     rdx, msg_clmul_ok_len
+    test    r14d, r14d
+    jz      print_last
+    mov     rsi, msg_clmul_bad
+    mov     rdx, msg_clmul_bad_len
+print_last:
+    mov     rax, 1
+    mov     rdi, 1
+    syscall
+
+    ; Exit with 1 if anything mismatched
+    mov     rax, 60
+    mov     rdi, r12
+    syscall
+
+%endif
+
+; ============================================================================
+; NOTES: CRC Kernels
+; ============================================================================
+;
+; Reflected CRCs:
+;   A CRC is the remainder of the message, read as a polynomial over GF(2),
+;   times x^width, divided by the generator polynomial P. Reflected CRCs
+;   take the first bit of each byte as the highest power, so on a
+;   little-endian machine the register shifts right and the low byte of
+;   the CRC lines up with the next message byte. The initial and final
+;   inversions make leading zeros count.
+;
+; Why three streams:
+;   CRC32 issues one per cycle (port 1 on Intel) but each result takes 3
+;   cycles, so a single chain reaches ~2.7 bytes/cycle and three reach ~8.
+;   AMD Zen runs two or three per cycle with the same latency and likes
+;   more streams still. The merge costs two PCLMULQDQ and one CRC32 per
+;   block, which is why the blocks are long (3 x 8 KiB) and only fall back
+;   to 3 x 256 bytes, and then one stream, near the end of the buffer.
+;
+; Folding (Intel, "Fast CRC Computation for Generic Polynomials Using
+; PCLMULQDQ"):
+;   Multiplying a 128-bit piece of the message by x^k mod P moves it k
+;   bits further along without changing the remainder. Each accumulator
+;   is split into two 64-bit halves, multiplied by the two constants and
+;   added to the data 512 bits later - four independent chains hide the
+;   7-cycle PCLMULQDQ latency. At the end, one 128-bit remainder is left;
+;   one more multiply and a Barrett reduction (two multiplies, no
+;   division) bring it to width bits.
+;
+; One kernel, any width:
+;   A 32-bit CRC mod P is the same as a 64-bit one mod P * x^32, shifted:
+;   (M * x^64) mod (P * x^32) = ((M * x^32) mod P) * x^32. So the 32-bit
+;   polynomials run through the 64-bit reduction unchanged and their
+;   constants are just computed from P * x^32. Supporting another
+;   reflected polynomial means another 48-byte constant block and table.
+;
+; Fused copy + checksum (crc32c_copy):
+;   Checking a copy afterwards reads the data a second time; past the L2
+;   cache that is a second trip to memory. crc32c_copy reads the source
+;   once: each 24 KiB 3-way block is checksummed from memory and then
+;   copied out of L1. Storing every quadword from inside the CRC loop
+;   instead is slower: the stores compete with the three load streams,
+;   and those streams are 8 KiB apart, so loads falsely alias the stores
+;   (same address bits 0-11) and wait for them. The short tail is done a
+;   quadword at a time, load -> CRC32 -> store. For whole files see
+;   copy_file_checksum in 07_file_io.asm, which checksums each chunk right
+;   after read() has put it in the cache.
+;
+; ============================================================================
@@ -0,0 +1,63 @@
+/*
+ * ============================================================================
+ * File: 16_crc32.h
+ * Description: C interface to the CRC routines in 16_crc32.asm
+ * Build: nasm -f elf64 -DLIBRARY 16_crc32.asm -o 16_lib.o
+ *        gcc -O2 -no-pie your_program.c 16_lib.o
+ * ============================================================================
+ *
+ *   crc32c       CRC-32C (Castagnoli): iSCSI, ext4, Btrfs, SCTP
+ *   crc32_ieee   CRC-32: zlib, gzip, PNG, Ethernet
+ *   crc64_xz     CRC-64/XZ (ECMA-182 polynomial): xz, 7-Zip
+ *   crc32c_copy  memcpy(dst, src, len) that also returns the CRC32C of the
+ *                bytes, reading them only once
+ *
+ * All of them start from crc = 0 and chain like zlib's crc32():
+ *   crc32c(crc32c(0, a, na), b, nb) == crc32c(0, ab, na + nb)
+ *
+ * The plain names use lookup tables until crc32_init() has selected the
+ * SSE4.2 / PCLMULQDQ code. Call it once at startup, before any other thread
+ * calls into the library. The suffixed variants bypass the dispatch:
+ * _sse42 needs SSE4.2, _3way and _pclmul need SSE4.2 and PCLMULQDQ.
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns 2 for SSE4.2 + PCLMULQDQ, 1 for SSE4.2 only, 0 for the tables
+int crc32_init(void);
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_copy(uint32_t crc, void *dst, const void *src, size_t len);
+uint32_t crc32_ieee(uint32_t crc, const void *buf, size_t len);
+uint64_t crc64_xz(uint64_t crc, const void *buf, size_t len);
+
+// --- Fixed code paths ---
+
+uint32_t crc32c_sw(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_copy_sw(uint32_t crc, void *dst, const void *src, size_t len);
+uint32_t crc32_ieee_sw(uint32_t crc, const void *buf, size_t len);
+uint64_t crc64_xz_sw(uint64_t crc, const void *buf, size_t len);
+
+uint32_t crc32c_sse42(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_copy_sse42(uint32_t crc, void *dst, const void *src, size_t len);
+
+uint32_t crc32c_3way(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_copy_3way(uint32_t crc, void *dst, const void *src, size_t len);
+
+uint32_t crc32c_pclmul(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32_ieee_pclmul(uint32_t crc, const void *buf, size_t len);
+uint64_t crc64_xz_pclmul(uint64_t crc, const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC32_H